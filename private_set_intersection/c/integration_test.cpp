@@ -16,6 +16,9 @@
 
 #include <math.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
 #include "gtest/gtest.h"
@@ -216,6 +219,49 @@ TEST_P(Correctness, intersection) {
       }
     }
 
+    // The compact encodings hold the same indices.
+    for (auto encoding :
+         {PSI_INTERSECTION_BITMAP, PSI_INTERSECTION_DELTA_VARINT,
+          PSI_INTERSECTION_COMPACT}) {
+      psi_intersection_ctx compact = nullptr;
+      ok = psi_client_get_compact_intersection(
+          client, {server_setup, server_setup_buff_len},
+          {server_response, response_len}, encoding, &compact, &err);
+      ASSERT_TRUE(ok == 0);
+      EXPECT_EQ(psi_intersection_size(compact), intersect_len);
+      EXPECT_EQ(psi_intersection_num_client_inputs(compact),
+                num_client_inputs);
+      if (encoding != PSI_INTERSECTION_COMPACT) {
+        EXPECT_EQ(psi_intersection_get_encoding(compact), encoding);
+      }
+      const char *data = nullptr;
+      size_t data_len = 0;
+      psi_intersection_get_data(compact, &data, &data_len);
+      EXPECT_NE(data, nullptr);
+      EXPECT_GT(data_len, 0);
+      for (int i = 0; i < num_client_inputs; i++) {
+        EXPECT_EQ(psi_intersection_contains(compact, i),
+                  intersection_set.contains(i));
+      }
+      // Enumerating the indices yields the same set, in ascending order.
+      struct psi_intersection_cursor_t cursor = {0, 0};
+      int64_t index = -1;
+      std::vector<int64_t> indices;
+      while (psi_intersection_next(compact, &cursor, &index)) {
+        indices.push_back(index);
+      }
+      EXPECT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+      EXPECT_EQ(absl::flat_hash_set<int64_t>(indices.begin(), indices.end()),
+                intersection_set);
+      EXPECT_EQ(indices.size(), intersect_len);
+      psi_intersection_delete(&compact);
+      ASSERT_TRUE(compact == nullptr);
+      // Accessors tolerate a deleted result.
+      EXPECT_EQ(psi_intersection_size(compact), 0);
+      EXPECT_FALSE(psi_intersection_next(compact, &cursor, &index));
+    }
+    free(intersection);
+
   } else {
     // Compute intersection size.
     int64_t intersection_size = 0;
@@ -2,11 +2,16 @@
 
 #include <algorithm>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "google/protobuf/arena.h"
+
 #include "private_set_intersection/c/internal_utils.h"
 #include "private_set_intersection/cpp/psi_client.h"
 #include "private_set_intersection/proto/psi.pb.h"
 
 namespace {
+using private_set_intersection::IntersectionResult;
 using private_set_intersection::PsiClient;
 using private_set_intersection::c_bindings_internal::generate_error;
 }  // namespace
@@ -53,31 +58,35 @@ int psi_client_create_request(psi_client_ctx ctx, psi_client_buffer_t *inputs,
                           error_out);
   }
   std::vector<std::string> in;
+  in.reserve(input_len);
   for (size_t idx = 0; idx < input_len; ++idx) {
     in.push_back(std::string(inputs[idx].buff, inputs[idx].buff_len));
   }
 
-  auto result = client->CreateRequest(in);
+  // All encrypted elements live on the arena and are released at once when it
+  // goes out of scope.
+  google::protobuf::Arena arena;
+  auto result = client->CreateRequest(&arena, in);
   if (!result.ok()) {
     return generate_error(result.status(), error_out);
   }
-  auto proto = std::move(*result);
 
-  std::string value;
+  const psi_proto::Request *proto = *result;
+  const size_t proto_len = proto->ByteSizeLong();
 
-  *output = (char *)malloc(proto.ByteSizeLong() * sizeof(char));
+  *output = (char *)malloc(proto_len * sizeof(char));
   if (*output == nullptr) {
     return generate_error(
         absl::InvalidArgumentError("failed to allocate memory"), error_out);
   }
 
-  if (!proto.SerializeToArray(*output, proto.ByteSizeLong())) {
+  if (!proto->SerializeToArray(*output, proto_len)) {
     return generate_error(
         absl::InvalidArgumentError("failed to serialize protobuffer"),
         error_out);
   }
 
-  *out_len = proto.ByteSizeLong();
+  *out_len = proto_len;
   return 0;
 }
 
@@ -91,23 +100,20 @@ int psi_client_get_intersection_size(psi_client_ctx ctx,
                           error_out);
   }
 
-  psi_proto::ServerSetup server_setup_proto;
-  if (!server_setup_proto.ParseFromArray(server_setup.buff,
-                                         server_setup.buff_len)) {
-    return generate_error(
-        absl::InvalidArgumentError("failed to parse server setup"), error_out);
-  }
-
-  psi_proto::Response server_response_proto;
-  if (!server_response_proto.ParseFromArray(server_response.buff,
-                                            server_response.buff_len)) {
+  // The server setup is queried in place; only the response is parsed.
+  google::protobuf::Arena arena;
+  auto *server_response_proto =
+      google::protobuf::Arena::Create<psi_proto::Response>(&arena);
+  if (!server_response_proto->ParseFromArray(server_response.buff,
+                                             server_response.buff_len)) {
     return generate_error(
         absl::InvalidArgumentError("failed to parse server response"),
         error_out);
   }
 
-  auto result =
-      client->GetIntersectionSize(server_setup_proto, server_response_proto);
+  auto result = client->GetIntersectionSize(
+      absl::string_view(server_setup.buff, server_setup.buff_len),
+      *server_response_proto);
   if (!result.ok()) {
     return generate_error(result.status(), error_out);
   }
@@ -127,23 +133,20 @@ int psi_client_get_intersection(psi_client_ctx ctx,
     return generate_error(absl::InvalidArgumentError("invalid client context"),
                           error_out);
   }
-  psi_proto::ServerSetup server_setup_proto;
-  if (!server_setup_proto.ParseFromArray(server_setup.buff,
-                                         server_setup.buff_len)) {
-    return generate_error(
-        absl::InvalidArgumentError("failed to parse server setup"), error_out);
-  }
-
-  psi_proto::Response server_response_proto;
-  if (!server_response_proto.ParseFromArray(server_response.buff,
-                                            server_response.buff_len)) {
+  // The server setup is queried in place; only the response is parsed.
+  google::protobuf::Arena arena;
+  auto *server_response_proto =
+      google::protobuf::Arena::Create<psi_proto::Response>(&arena);
+  if (!server_response_proto->ParseFromArray(server_response.buff,
+                                             server_response.buff_len)) {
     return generate_error(
         absl::InvalidArgumentError("failed to parse server response"),
         error_out);
   }
 
-  auto result =
-      client->GetIntersection(server_setup_proto, server_response_proto);
+  auto result = client->GetIntersection(
+      absl::string_view(server_setup.buff, server_setup.buff_len),
+      *server_response_proto);
   if (!result.ok()) {
     return generate_error(result.status(), error_out);
   }
@@ -155,6 +158,120 @@ int psi_client_get_intersection(psi_client_ctx ctx,
   return 0;
 }
 
+int psi_client_get_compact_intersection(
+    psi_client_ctx ctx, struct psi_client_buffer_t server_setup,
+    struct psi_client_buffer_t server_response,
+    enum psi_intersection_encoding encoding, psi_intersection_ctx *out,
+    char **error_out) {
+  auto client = static_cast<PsiClient *>(ctx);
+  if (client == nullptr) {
+    return generate_error(absl::InvalidArgumentError("invalid client context"),
+                          error_out);
+  }
+  absl::optional<IntersectionResult::Encoding> result_encoding;
+  switch (encoding) {
+    case PSI_INTERSECTION_BITMAP:
+      result_encoding = IntersectionResult::Encoding::kBitmap;
+      break;
+    case PSI_INTERSECTION_DELTA_VARINT:
+      result_encoding = IntersectionResult::Encoding::kDeltaVarint;
+      break;
+    case PSI_INTERSECTION_COMPACT:
+      break;
+    default:
+      return generate_error(absl::InvalidArgumentError("invalid encoding"),
+                            error_out);
+  }
+  google::protobuf::Arena arena;
+  auto *server_response_proto =
+      google::protobuf::Arena::Create<psi_proto::Response>(&arena);
+  if (!server_response_proto->ParseFromArray(server_response.buff,
+                                             server_response.buff_len)) {
+    return generate_error(
+        absl::InvalidArgumentError("failed to parse server response"),
+        error_out);
+  }
+
+  auto result = client->GetCompactIntersection(
+      absl::string_view(server_setup.buff, server_setup.buff_len),
+      *server_response_proto, result_encoding);
+  if (!result.ok()) {
+    return generate_error(result.status(), error_out);
+  }
+  // The result is handed over as is, so `psi_intersection_get_data` does not
+  // need to copy it.
+  if (out != nullptr) {
+    *out = new IntersectionResult(*std::move(result));
+  }
+  return 0;
+}
+
+void psi_intersection_get_data(psi_intersection_ctx ctx, const char **data,
+                               size_t *data_len) {
+  auto result = static_cast<IntersectionResult *>(ctx);
+  if (result == nullptr || data == nullptr || data_len == nullptr) {
+    return;
+  }
+  *data = result->data().data();
+  *data_len = result->data().size();
+}
+
+enum psi_intersection_encoding psi_intersection_get_encoding(
+    psi_intersection_ctx ctx) {
+  auto result = static_cast<IntersectionResult *>(ctx);
+  if (result == nullptr) {
+    return PSI_INTERSECTION_BITMAP;
+  }
+  return result->encoding() == IntersectionResult::Encoding::kBitmap
+             ? PSI_INTERSECTION_BITMAP
+             : PSI_INTERSECTION_DELTA_VARINT;
+}
+
+int64_t psi_intersection_size(psi_intersection_ctx ctx) {
+  auto result = static_cast<IntersectionResult *>(ctx);
+  return result == nullptr ? 0 : result->size();
+}
+
+int64_t psi_intersection_num_client_inputs(psi_intersection_ctx ctx) {
+  auto result = static_cast<IntersectionResult *>(ctx);
+  return result == nullptr ? 0 : result->num_client_inputs();
+}
+
+bool psi_intersection_contains(psi_intersection_ctx ctx, int64_t index) {
+  auto result = static_cast<IntersectionResult *>(ctx);
+  return result != nullptr && result->Contains(index);
+}
+
+bool psi_intersection_next(psi_intersection_ctx ctx,
+                           struct psi_intersection_cursor_t *cursor,
+                           int64_t *index) {
+  auto result = static_cast<IntersectionResult *>(ctx);
+  if (result == nullptr || cursor == nullptr || index == nullptr) {
+    return false;
+  }
+  IntersectionResult::Cursor position;
+  position.offset = cursor->offset;
+  position.base = cursor->base;
+  if (!result->Next(&position, index)) {
+    return false;
+  }
+  cursor->offset = position.offset;
+  cursor->base = position.base;
+  return true;
+}
+
+void psi_intersection_delete(psi_intersection_ctx *ctx) {
+  if (ctx == nullptr) {
+    return;
+  }
+  auto result = static_cast<IntersectionResult *>(*ctx);
+  if (result == nullptr) {
+    return;
+  }
+  delete result;
+  *ctx = nullptr;
+}
+
 int psi_client_get_private_key_bytes(psi_client_ctx ctx, char **output,
                                      size_t *output_len, char **error_out) {
   auto client = static_cast<PsiClient *>(ctx);
@@ -26,6 +26,7 @@ extern "C" {
 #endif
 
 typedef void *psi_client_ctx;
+typedef void *psi_intersection_ctx;
 
 struct psi_client_buffer_t {
   const char *buff;
@@ -51,6 +52,45 @@ int psi_client_get_intersection(psi_client_ctx ctx,
                                 struct psi_client_buffer_t server_response,
                                 int64_t **out, size_t *out_len,
                                 char **error_out);
+// Encodings of a compact intersection. Bitmaps hold one bit per element of the
+// server response, where bit i % 8 of byte i / 8 is set iff index i is in the
+// intersection. Delta-varint results hold the ascending indices as unsigned
+// LEB128 varints of the gap to the previous index minus one.
+enum psi_intersection_encoding {
+  PSI_INTERSECTION_BITMAP = 0,
+  PSI_INTERSECTION_DELTA_VARINT = 1,
+  // Picks whichever of the above is smaller.
+  PSI_INTERSECTION_COMPACT = 2,
+};
+int psi_client_get_compact_intersection(
+    psi_client_ctx ctx, struct psi_client_buffer_t server_setup,
+    struct psi_client_buffer_t server_response,
+    enum psi_intersection_encoding encoding, psi_intersection_ctx *out,
+    char **error_out);
+// Points `data` to the encoded indices, which stay owned by `ctx` and valid
+// until it is deleted.
+void psi_intersection_get_data(psi_intersection_ctx ctx, const char **data,
+                               size_t *data_len);
+enum psi_intersection_encoding psi_intersection_get_encoding(
+    psi_intersection_ctx ctx);
+int64_t psi_intersection_size(psi_intersection_ctx ctx);
+int64_t psi_intersection_num_client_inputs(psi_intersection_ctx ctx);
+// Returns true if `index` is in the intersection. Takes linear time for
+// delta-varint results; use `psi_intersection_next` to enumerate them.
+bool psi_intersection_contains(psi_intersection_ctx ctx, int64_t index);
+// Position of an enumeration of a compact intersection. Zero-initialize it to
+// start at the first index, and leave the fields to `psi_intersection_next`.
+struct psi_intersection_cursor_t {
+  size_t offset;
+  int64_t base;
+};
+// Writes the index at `cursor` to `index` and advances `cursor` past it, so
+// that a loop over all indices takes linear time in either encoding. Returns
+// false, leaving `index` unchanged, once all indices have been visited.
+bool psi_intersection_next(psi_intersection_ctx ctx,
+                           struct psi_intersection_cursor_t *cursor,
+                           int64_t *index);
+void psi_intersection_delete(psi_intersection_ctx *ctx);
 int psi_client_get_private_key_bytes(psi_client_ctx ctx, char **output,
                                      size_t *output_len, char **error_out);
 #ifdef __cplusplus
@@ -2,6 +2,8 @@
 
 #include <algorithm>
 
+#include "google/protobuf/arena.h"
+
 #include "private_set_intersection/c/internal_utils.h"
 #include "private_set_intersection/cpp/datastructure/datastructure.h"
 #include "private_set_intersection/cpp/psi_server.h"
@@ -56,31 +58,36 @@ int psi_server_create_setup_message(
   }
 
   std::vector<std::string> in;
+  in.reserve(input_len);
   for (size_t idx = 0; idx < input_len; ++idx) {
     in.push_back(std::string(input[idx].buff, input[idx].buff_len));
   }
 
-  auto result =
-      server->CreateSetupMessage(fpr, num_client_inputs, in, datastructure);
+  // All fields of the setup message live on the arena and are released at
+  // once when it goes out of scope.
+  google::protobuf::Arena arena;
+  auto result = server->CreateSetupMessage(&arena, fpr, num_client_inputs, in,
+                                           datastructure);
   if (!result.ok()) {
     return generate_error(result.status(), error_out);
   }
 
-  auto proto = std::move(*result);
+  const psi_proto::ServerSetup *proto = *result;
+  const size_t proto_len = proto->ByteSizeLong();
 
-  *output = (char *)malloc(proto.ByteSizeLong() * sizeof(char));
+  *output = (char *)malloc(proto_len * sizeof(char));
   if (*output == nullptr) {
     return generate_error(
         absl::InvalidArgumentError("failed to allocate memory"), error_out);
   }
 
-  if (!proto.SerializeToArray(*output, proto.ByteSizeLong())) {
+  if (!proto->SerializeToArray(*output, proto_len)) {
     return generate_error(
         absl::InvalidArgumentError("failed to serialize setup message"),
         error_out);
   }
 
-  *output_len = proto.ByteSizeLong();
+  *output_len = proto_len;
   return 0;
 }
 
@@ -94,32 +101,37 @@ int psi_server_process_request(psi_server_ctx ctx,
                           error_out);
   }
 
-  psi_proto::Request request_proto;
-  if (!request_proto.ParseFromArray(client_request.buff,
-                                    client_request.buff_len)) {
+  // Parse the request and build the response on one arena, so that all
+  // element strings of both messages are freed at once.
+  google::protobuf::Arena arena;
+  auto *request_proto =
+      google::protobuf::Arena::Create<psi_proto::Request>(&arena);
+  if (!request_proto->ParseFromArray(client_request.buff,
+                                     client_request.buff_len)) {
     return generate_error(
         absl::InvalidArgumentError("failed to parse client request"),
         error_out);
   }
-  auto result = server->ProcessRequest(request_proto);
+  auto result = server->ProcessRequest(&arena, *request_proto);
   if (!result.ok()) {
     return generate_error(result.status(), error_out);
   }
 
-  auto proto = std::move(*result);
-  *output = (char *)malloc(proto.ByteSizeLong() * sizeof(char));
+  const psi_proto::Response *proto = *result;
+  const size_t proto_len = proto->ByteSizeLong();
+  *output = (char *)malloc(proto_len * sizeof(char));
   if (*output == nullptr) {
     return generate_error(
         absl::InvalidArgumentError("failed to allocate memory"), error_out);
   }
 
-  if (!proto.SerializeToArray(*output, proto.ByteSizeLong())) {
+  if (!proto->SerializeToArray(*output, proto_len)) {
     return generate_error(
         absl::InvalidArgumentError("failed to serialize server response"),
         error_out);
   }
 
-  *output_len = proto.ByteSizeLong();
+  *output_len = proto_len;
   return 0;
 }
 
@@ -0,0 +1,115 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/cpu_features.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+#include "absl/strings/str_cat.h"
+
+namespace private_set_intersection {
+
+namespace {
+
+// Cap of the active tier when nothing is forced.
+constexpr int kNoCap = static_cast<int>(CpuTier::kAvx512);
+
+CpuTier DetectCpuTier() {
+#if PSI_X86_DISPATCH
+  // The builtins also check that the OS saves the vector registers.
+  __builtin_cpu_init();
+  if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("bmi") ||
+      !__builtin_cpu_supports("bmi2")) {
+    return CpuTier::kSse2;
+  }
+  if (!__builtin_cpu_supports("avx512f")) {
+    return CpuTier::kAvx2;
+  }
+  return CpuTier::kAvx512;
+#elif PSI_HAVE_AVX512_TIER
+  return CpuTier::kAvx512;
+#elif PSI_HAVE_AVX2_TIER
+  return CpuTier::kAvx2;
+#elif PSI_HAVE_SSE2_TIER
+  return CpuTier::kSse2;
+#else
+  return CpuTier::kScalar;
+#endif
+}
+
+int InitialCap() {
+  const char* name = std::getenv("PSI_CPU_TIER");
+  if (name == nullptr) {
+    return kNoCap;
+  }
+  const absl::StatusOr<CpuTier> tier = ParseCpuTier(name);
+  return tier.ok() ? static_cast<int>(*tier) : kNoCap;
+}
+
+std::atomic<int>& Cap() {
+  static std::atomic<int> cap(InitialCap());
+  return cap;
+}
+
+}  // namespace
+
+CpuTier DetectedCpuTier() {
+  static const CpuTier tier = DetectCpuTier();
+  return tier;
+}
+
+CpuTier ActiveCpuTier() {
+  return static_cast<CpuTier>(
+      std::min(static_cast<int>(DetectedCpuTier()),
+               Cap().load(std::memory_order_relaxed)));
+}
+
+void ForceCpuTier(CpuTier tier) {
+  Cap().store(static_cast<int>(tier), std::memory_order_relaxed);
+}
+
+void ClearForcedCpuTier() {
+  Cap().store(kNoCap, std::memory_order_relaxed);
+}
+
+absl::string_view CpuTierName(CpuTier tier) {
+  switch (tier) {
+    case CpuTier::kScalar:
+      return "scalar";
+    case CpuTier::kSse2:
+      return "sse2";
+    case CpuTier::kAvx2:
+      return "avx2";
+    case CpuTier::kAvx512:
+      return "avx512";
+  }
+  return "unknown";
+}
+
+absl::StatusOr<CpuTier> ParseCpuTier(absl::string_view name) {
+  for (CpuTier tier : {CpuTier::kScalar, CpuTier::kSse2, CpuTier::kAvx2,
+                       CpuTier::kAvx512}) {
+    if (name == CpuTierName(tier)) {
+      return tier;
+    }
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown CPU tier: ", name));
+}
+
+}  // namespace private_set_intersection
@@ -0,0 +1,100 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CPU_FEATURES_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CPU_FEATURES_H_
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+// On x86-64 with GCC or Clang, kernels for every tier are compiled into the
+// same binary with `PSI_TARGET`, independent of the -m flags of the build, and
+// picked at runtime. Elsewhere only the tiers enabled at compile time exist.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PSI_X86_DISPATCH 1
+#define PSI_TARGET(features) __attribute__((target(features)))
+// Inlines all calls into the function, so that generic templates instantiated
+// for a tier's vector types are compiled for that tier.
+#define PSI_TARGET_FLATTEN(features) \
+  __attribute__((target(features), flatten))
+#else
+#define PSI_X86_DISPATCH 0
+#define PSI_TARGET(features)
+#define PSI_TARGET_FLATTEN(features)
+#endif
+
+// Whether kernels for each tier are compiled in at all.
+#if PSI_X86_DISPATCH || defined(__SSE2__)
+#define PSI_HAVE_SSE2_TIER 1
+#else
+#define PSI_HAVE_SSE2_TIER 0
+#endif
+#if PSI_X86_DISPATCH || (defined(__AVX2__) && defined(__BMI2__))
+#define PSI_HAVE_AVX2_TIER 1
+#else
+#define PSI_HAVE_AVX2_TIER 0
+#endif
+#if PSI_X86_DISPATCH || \
+    (defined(__AVX512F__) && defined(__AVX2__) && defined(__BMI2__))
+#define PSI_HAVE_AVX512_TIER 1
+#else
+#define PSI_HAVE_AVX512_TIER 0
+#endif
+
+namespace private_set_intersection {
+
+// Instruction set tiers that the hot kernels are specialized for, in
+// increasing order. Each tier implies all lower ones.
+enum class CpuTier {
+  // Portable C++ only.
+  kScalar = 0,
+  // The x86-64 baseline.
+  kSse2 = 1,
+  // AVX2, BMI1 and BMI2, as on Haswell, Zen and later.
+  kAvx2 = 2,
+  // AVX-512F on top of the AVX2 tier, as on Skylake-SP, Zen 4 and later.
+  kAvx512 = 3,
+};
+
+// Returns the highest tier that both this CPU and the binary support. The CPU
+// is only queried on the first call.
+CpuTier DetectedCpuTier();
+
+// Returns the tier that dispatched kernels should use: the detected tier,
+// capped by `ForceCpuTier` or, if that was never called, by the environment
+// variable PSI_CPU_TIER, which takes the names of `CpuTierName`. Unknown
+// names in PSI_CPU_TIER are ignored.
+CpuTier ActiveCpuTier();
+
+// Caps the tier of all dispatched kernels in this process at `tier`, for
+// testing and benchmarking. A tier above the detected one is ignored, since
+// its instructions would fault.
+void ForceCpuTier(CpuTier tier);
+
+// Undoes `ForceCpuTier`, including any cap set through PSI_CPU_TIER.
+void ClearForcedCpuTier();
+
+// Returns the lower-case name of `tier`, e.g. "avx2".
+absl::string_view CpuTierName(CpuTier tier);
+
+// Parses a name returned by `CpuTierName`.
+//
+// Returns INVALID_ARGUMENT for any other string.
+absl::StatusOr<CpuTier> ParseCpuTier(absl::string_view name);
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CPU_FEATURES_H_
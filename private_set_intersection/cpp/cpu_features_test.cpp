@@ -0,0 +1,63 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/cpu_features.h"
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+namespace private_set_intersection {
+namespace {
+
+constexpr CpuTier kAllTiers[] = {CpuTier::kScalar, CpuTier::kSse2,
+                                 CpuTier::kAvx2, CpuTier::kAvx512};
+
+TEST(CpuFeaturesTest, TestParseName) {
+  for (CpuTier tier : kAllTiers) {
+    absl::StatusOr<CpuTier> parsed = ParseCpuTier(CpuTierName(tier));
+    ASSERT_TRUE(parsed.ok());
+    EXPECT_EQ(*parsed, tier);
+  }
+  EXPECT_EQ(CpuTierName(CpuTier::kAvx2), "avx2");
+  EXPECT_FALSE(ParseCpuTier("AVX2").ok());
+  EXPECT_FALSE(ParseCpuTier("").ok());
+}
+
+TEST(CpuFeaturesTest, TestDetected) {
+#if defined(__x86_64__)
+  EXPECT_GE(DetectedCpuTier(), CpuTier::kSse2);
+#endif
+#if defined(__AVX2__) && defined(__BMI2__)
+  EXPECT_GE(DetectedCpuTier(), CpuTier::kAvx2);
+#endif
+#if defined(__AVX512F__)
+  EXPECT_EQ(DetectedCpuTier(), CpuTier::kAvx512);
+#endif
+}
+
+TEST(CpuFeaturesTest, TestForce) {
+  const CpuTier detected = DetectedCpuTier();
+  for (CpuTier tier : kAllTiers) {
+    ForceCpuTier(tier);
+    EXPECT_EQ(ActiveCpuTier(), std::min(tier, detected));
+  }
+  ClearForcedCpuTier();
+  EXPECT_EQ(ActiveCpuTier(), detected);
+}
+
+}  // namespace
+}  // namespace private_set_intersection
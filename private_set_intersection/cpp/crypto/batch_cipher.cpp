@@ -0,0 +1,161 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/batch_cipher.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+
+namespace private_set_intersection {
+
+namespace {
+
+// Number of points hashed or decoded at a time, so that the scratch space
+// stays in cache.
+constexpr size_t kBatchSize = 256;
+
+// Decodes `ciphertext`, a SEC1 point or, in the x-only format, also a bare x
+// coordinate. Lifting an x coordinate computes the y coordinate, but it is
+// the same exponentiation that checks that the point is on the curve rather
+// than on its twist, so the x-only format saves no work here.
+bool DecodeCiphertext(absl::string_view ciphertext, P256PointFormat format,
+                      P256AffinePoint* point) {
+  if (format == P256PointFormat::kXOnly &&
+      ciphertext.size() == kP256XCoordinateSize) {
+    return P256DecodeXCoordinate(ciphertext, point);
+  }
+  return P256DecodePoint(ciphertext, point);
+}
+
+}  // namespace
+
+BatchCipher::BatchCipher(P256PointFormat format,
+                         std::unique_ptr<BoringSslP256Multiplier> key,
+                         std::unique_ptr<BoringSslP256Multiplier> key_inverse)
+    : format_(format),
+      key_(std::move(key)),
+      key_inverse_(std::move(key_inverse)) {}
+
+StatusOr<std::unique_ptr<BatchCipher>> BatchCipher::CreateFromKey(
+    absl::string_view key_bytes, P256PointFormat format) {
+  P256Scalar key;
+  if (!P256DecodeScalar(key_bytes, &key)) {
+    return absl::InvalidArgumentError("Invalid P-256 private key");
+  }
+  ASSIGN_OR_RETURN(auto multiplier, BoringSslP256Multiplier::Create(key));
+  ASSIGN_OR_RETURN(auto inverse_multiplier,
+                   BoringSslP256Multiplier::Create(P256InvertScalar(key)));
+  return absl::WrapUnique(new BatchCipher(format, std::move(multiplier),
+                                          std::move(inverse_multiplier)));
+}
+
+absl::Status BatchCipher::Encrypt(const P256HashToCurve& hasher,
+                                  absl::Span<const std::string> inputs,
+                                  std::string* out) const {
+  // The hashed points are uncompressed, so decoding them needs no square
+  // root.
+  std::vector<std::string> points(std::min(inputs.size(), kBatchSize));
+  std::vector<absl::string_view> views(points.size());
+  for (size_t begin = 0; begin < inputs.size(); begin += kBatchSize) {
+    const size_t size = std::min(kBatchSize, inputs.size() - begin);
+    RETURN_IF_ERROR(hasher.HashBatch(inputs.subspan(begin, size),
+                                     POINT_CONVERSION_UNCOMPRESSED,
+                                     absl::MakeSpan(points).subspan(0, size)));
+    for (size_t i = 0; i < size; i++) {
+      views[i] = points[i];
+    }
+    RETURN_IF_ERROR(
+        Multiply(absl::MakeConstSpan(views).subspan(0, size), false, out));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status BatchCipher::ReEncrypt(
+    absl::Span<const absl::string_view> ciphertexts, std::string* out) const {
+  return Multiply(ciphertexts, false, out);
+}
+
+absl::Status BatchCipher::Decrypt(
+    absl::Span<const absl::string_view> ciphertexts, std::string* out) const {
+  return Multiply(ciphertexts, true, out);
+}
+
+absl::Status BatchCipher::Multiply(absl::Span<const absl::string_view> points,
+                                   bool inverse, std::string* out) const {
+  // The points are decoded and multiplied in groups, so that the scratch
+  // space stays in cache.
+  std::vector<P256AffinePoint> decoded(std::min(points.size(), kBatchSize));
+  const size_t initial_size = out->size();
+  for (size_t begin = 0; begin < points.size(); begin += kBatchSize) {
+    const size_t size = std::min(kBatchSize, points.size() - begin);
+    for (size_t i = 0; i < size; i++) {
+      if (!DecodeCiphertext(points[begin + i], format_, &decoded[i])) {
+        out->resize(initial_size);
+        return absl::InvalidArgumentError(
+            "Ciphertext is not a valid P-256 point");
+      }
+    }
+    const BoringSslP256Multiplier& multiplier =
+        inverse ? *key_inverse_ : *key_;
+    absl::Status status = multiplier.Multiply(
+        absl::MakeConstSpan(decoded).subspan(0, size), format_, out);
+    if (!status.ok()) {
+      out->resize(initial_size);
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+StatusOr<P256PointFormat> GetPointFormat(psi_proto::PointEncoding encoding) {
+  switch (encoding) {
+    case psi_proto::POINT_ENCODING_COMPRESSED:
+      return P256PointFormat::kCompressed;
+    case psi_proto::POINT_ENCODING_X_ONLY:
+      return P256PointFormat::kXOnly;
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported point encoding ", encoding));
+  }
+}
+
+absl::Status EncryptElements(
+    ::private_join_and_compute::ECCommutativeCipher& cipher,
+    const BatchCipher& batch_cipher, const P256HashToCurve* hasher,
+    absl::Span<const std::string> inputs, std::string* out) {
+  if (hasher != nullptr) {
+    return batch_cipher.Encrypt(*hasher, inputs, out);
+  }
+  // The try-and-increment hash is internal to the cipher, so its points are
+  // only available encrypted, and compressed.
+  const size_t prefix_size =
+      kP256CompressedPointSize - batch_cipher.element_size();
+  out->reserve(out->size() + inputs.size() * batch_cipher.element_size());
+  for (const std::string& input : inputs) {
+    ASSIGN_OR_RETURN(std::string encrypted, cipher.Encrypt(input));
+    if (encrypted.size() != kP256CompressedPointSize) {
+      return absl::InternalError("Encrypted element has an unexpected width");
+    }
+    out->append(encrypted, prefix_size, std::string::npos);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace private_set_intersection
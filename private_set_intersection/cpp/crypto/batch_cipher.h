@@ -0,0 +1,123 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CRYPTO_BATCH_CIPHER_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CRYPTO_BATCH_CIPHER_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "private_join_and_compute/crypto/ec_commutative_cipher.h"
+#include "private_set_intersection/cpp/crypto/hash_to_curve.h"
+#include "private_set_intersection/cpp/crypto/p256.h"
+#include "private_set_intersection/cpp/crypto/p256_boringssl.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+
+// Encrypts, re-encrypts and decrypts batches of P-256 points under a single
+// key, without the per-element overhead of `ECCommutativeCipher`. The points
+// are multiplied in the crypto library's built-in P-256 group, see
+// `BoringSslP256Multiplier`.
+//
+// In the compressed format, the results are byte for byte those of
+// `ECCommutativeCipher` with the same key. In the x-only format, they are
+// the same without the prefix byte. All scratch state is allocated per call,
+// so a single instance can be shared between threads.
+class BatchCipher {
+ public:
+  BatchCipher(const BatchCipher&) = delete;
+  BatchCipher& operator=(const BatchCipher&) = delete;
+
+  // Creates a cipher for the big-endian key `key_bytes`, as returned by
+  // `ECCommutativeCipher::GetPrivateKeyBytes`, that returns points in
+  // `format`.
+  //
+  // Returns INVALID_ARGUMENT if the key is not between 1 and the group order
+  // minus 1, or INTERNAL if the library group cannot be set up.
+  static StatusOr<std::unique_ptr<BatchCipher>> CreateFromKey(
+      absl::string_view key_bytes,
+      P256PointFormat format = P256PointFormat::kCompressed);
+
+  P256PointFormat format() const { return format_; }
+
+  // Returns the size of every result, `P256PointSize(format())`.
+  size_t element_size() const { return P256PointSize(format_); }
+
+  // Maps `inputs` to the curve with `hasher`, encrypts them and appends the
+  // points, `element_size()` bytes each, to `out`.
+  //
+  // Returns INTERNAL if hashing fails.
+  absl::Status Encrypt(const P256HashToCurve& hasher,
+                       absl::Span<const std::string> inputs,
+                       std::string* out) const;
+
+  // Re-encrypts `ciphertexts` and appends the results to `out`. Ciphertexts
+  // are SEC1 points or, in the x-only format, also bare x coordinates.
+  //
+  // Returns INVALID_ARGUMENT if a ciphertext is not a point on the curve.
+  absl::Status ReEncrypt(absl::Span<const absl::string_view> ciphertexts,
+                         std::string* out) const;
+
+  // Decrypts `ciphertexts`, encoded as for `ReEncrypt`, and appends the
+  // results to `out`.
+  //
+  // Returns INVALID_ARGUMENT if a ciphertext is not a point on the curve.
+  absl::Status Decrypt(absl::Span<const absl::string_view> ciphertexts,
+                       std::string* out) const;
+
+ private:
+  BatchCipher(P256PointFormat format,
+              std::unique_ptr<BoringSslP256Multiplier> key,
+              std::unique_ptr<BoringSslP256Multiplier> key_inverse);
+
+  // Multiplies each of `points` with the multiplier of the key, or of its
+  // inverse if `inverse` is true, and appends the results to `out`. On
+  // error, `out` is left as it was.
+  absl::Status Multiply(absl::Span<const absl::string_view> points,
+                        bool inverse, std::string* out) const;
+
+  P256PointFormat format_;
+
+  // Multipliers for the key and its inverse, set up once for the lifetime of
+  // the cipher.
+  std::unique_ptr<BoringSslP256Multiplier> key_;
+  std::unique_ptr<BoringSslP256Multiplier> key_inverse_;
+};
+
+// Returns the format that encodes points as `encoding`.
+//
+// Returns INVALID_ARGUMENT if `encoding` is unknown.
+StatusOr<P256PointFormat> GetPointFormat(psi_proto::PointEncoding encoding);
+
+// Maps `inputs` to the curve with `hasher`, encrypts them and appends the
+// points, in the format of `batch_cipher`, to `out`. `cipher` and
+// `batch_cipher` must use the same key. If `hasher` is null, the cipher's own
+// hashing is used instead, which encrypts one element at a time.
+//
+// Returns INTERNAL if hashing or encryption fails.
+absl::Status EncryptElements(
+    ::private_join_and_compute::ECCommutativeCipher& cipher,
+    const BatchCipher& batch_cipher, const P256HashToCurve* hasher,
+    absl::Span<const std::string> inputs, std::string* out);
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CRYPTO_BATCH_CIPHER_H_
@@ -0,0 +1,184 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/batch_cipher.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "openssl/obj_mac.h"
+#include "private_set_intersection/cpp/util/status_matchers.h"
+
+namespace private_set_intersection {
+namespace {
+
+using ::private_join_and_compute::ECCommutativeCipher;
+
+class BatchCipherTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    PSI_ASSERT_OK_AND_ASSIGN(
+        cipher_,
+        ECCommutativeCipher::CreateWithNewKey(
+            NID_X9_62_prime256v1, ECCommutativeCipher::HashType::SHA256));
+    PSI_ASSERT_OK_AND_ASSIGN(
+        batch_cipher_,
+        BatchCipher::CreateFromKey(cipher_->GetPrivateKeyBytes()));
+    PSI_ASSERT_OK_AND_ASSIGN(hasher_, P256HashToCurve::Create());
+
+    // More elements than fit into one batch of the batch cipher.
+    for (int i = 0; i < 600; i++) {
+      inputs_.push_back(absl::StrCat("Element ", i));
+    }
+  }
+
+  // Splits `packed` into elements of `width` bytes, compressed points by
+  // default.
+  static std::vector<std::string> Split(
+      const std::string& packed, size_t width = kP256CompressedPointSize) {
+    std::vector<std::string> elements;
+    for (size_t i = 0; i < packed.size(); i += width) {
+      elements.push_back(packed.substr(i, width));
+    }
+    return elements;
+  }
+
+  std::unique_ptr<ECCommutativeCipher> cipher_;
+  // With the key of `cipher_`.
+  std::unique_ptr<BatchCipher> batch_cipher_;
+  std::unique_ptr<P256HashToCurve> hasher_;
+  std::vector<std::string> inputs_;
+};
+
+TEST_F(BatchCipherTest, TestMatchesCommutativeCipher) {
+  std::vector<std::string> encrypted;
+  for (const std::string& input : inputs_) {
+    PSI_ASSERT_OK_AND_ASSIGN(std::string element, cipher_->Encrypt(input));
+    encrypted.push_back(element);
+  }
+  const std::vector<absl::string_view> views(encrypted.begin(),
+                                             encrypted.end());
+
+  std::vector<std::string> expected_reencrypted;
+  std::vector<std::string> expected_decrypted;
+  for (const std::string& element : encrypted) {
+    PSI_ASSERT_OK_AND_ASSIGN(std::string expected, cipher_->ReEncrypt(element));
+    expected_reencrypted.push_back(expected);
+    PSI_ASSERT_OK_AND_ASSIGN(expected, cipher_->Decrypt(element));
+    expected_decrypted.push_back(expected);
+  }
+
+  std::string reencrypted;
+  ASSERT_TRUE(batch_cipher_->ReEncrypt(views, &reencrypted).ok());
+  std::string decrypted;
+  ASSERT_TRUE(batch_cipher_->Decrypt(views, &decrypted).ok());
+  EXPECT_EQ(Split(reencrypted), expected_reencrypted);
+  EXPECT_EQ(Split(decrypted), expected_decrypted);
+}
+
+TEST_F(BatchCipherTest, TestEncryptElements) {
+  // Without a hasher, the cipher's own hashing is used.
+  const P256HashToCurve* hashers[] = {nullptr, hasher_.get()};
+  for (const P256HashToCurve* hasher : hashers) {
+    std::vector<std::string> expected;
+    for (const std::string& input : inputs_) {
+      PSI_ASSERT_OK_AND_ASSIGN(std::string element,
+                               EncryptElement(*cipher_, hasher, input));
+      expected.push_back(element);
+    }
+    std::string encrypted = "prefix";
+    ASSERT_TRUE(EncryptElements(*cipher_, *batch_cipher_, hasher, inputs_,
+                                &encrypted)
+                    .ok());
+    ASSERT_EQ(encrypted.substr(0, 6), "prefix");
+    EXPECT_EQ(Split(encrypted.substr(6)), expected);
+  }
+}
+
+TEST_F(BatchCipherTest, TestXOnlyDropsPrefix) {
+  std::vector<std::string> encrypted;
+  std::vector<std::string> x_only;
+  std::vector<std::string> expected_reencrypted;
+  std::vector<std::string> expected_decrypted;
+  std::vector<std::string> expected_encrypted;
+  for (const std::string& input : inputs_) {
+    PSI_ASSERT_OK_AND_ASSIGN(std::string element, cipher_->Encrypt(input));
+    encrypted.push_back(element);
+    x_only.push_back(element.substr(1));
+    expected_encrypted.push_back(element.substr(1));
+    PSI_ASSERT_OK_AND_ASSIGN(std::string expected, cipher_->ReEncrypt(element));
+    expected_reencrypted.push_back(expected.substr(1));
+    PSI_ASSERT_OK_AND_ASSIGN(expected, cipher_->Decrypt(element));
+    expected_decrypted.push_back(expected.substr(1));
+  }
+
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto batch_cipher,
+      BatchCipher::CreateFromKey(cipher_->GetPrivateKeyBytes(),
+                                 P256PointFormat::kXOnly));
+  EXPECT_EQ(batch_cipher->element_size(), kP256XCoordinateSize);
+  // Either y coordinate gives the same x coordinate, so SEC1 points and bare
+  // x coordinates are accepted alike.
+  for (const auto* ciphertexts : {&encrypted, &x_only}) {
+    const std::vector<absl::string_view> views(ciphertexts->begin(),
+                                               ciphertexts->end());
+    std::string reencrypted;
+    ASSERT_TRUE(batch_cipher->ReEncrypt(views, &reencrypted).ok());
+    std::string decrypted;
+    ASSERT_TRUE(batch_cipher->Decrypt(views, &decrypted).ok());
+    EXPECT_EQ(Split(reencrypted, kP256XCoordinateSize), expected_reencrypted);
+    EXPECT_EQ(Split(decrypted, kP256XCoordinateSize), expected_decrypted);
+  }
+
+  std::string out;
+  ASSERT_TRUE(
+      EncryptElements(*cipher_, *batch_cipher, nullptr, inputs_, &out).ok());
+  EXPECT_EQ(Split(out, kP256XCoordinateSize), expected_encrypted);
+
+  // Bare x coordinates need the x-only format, and must be on the curve.
+  const std::string not_reduced(kP256XCoordinateSize, '\xff');
+  const std::vector<absl::string_view> invalid = {x_only[0], not_reduced};
+  EXPECT_THAT(batch_cipher->ReEncrypt(invalid, &out),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(batch_cipher_->ReEncrypt({x_only[0]}, &out),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(BatchCipherTest, FailIfInvalid) {
+  PSI_ASSERT_OK_AND_ASSIGN(std::string valid, cipher_->Encrypt("valid"));
+  const std::vector<absl::string_view> views = {valid, "invalid"};
+  // The single zero byte encodes the point at infinity.
+  const std::vector<absl::string_view> infinity = {valid,
+                                                   absl::string_view("\0", 1)};
+  std::string out = "unchanged";
+  EXPECT_THAT(batch_cipher_->ReEncrypt(views, &out),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(batch_cipher_->Decrypt(views, &out),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(batch_cipher_->ReEncrypt(infinity, &out),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(out, "unchanged");
+
+  EXPECT_THAT(BatchCipher::CreateFromKey(std::string(32, '\0')),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(BatchCipher::CreateFromKey(std::string(32, '\xff')),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace private_set_intersection
@@ -0,0 +1,439 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/batch_sha256.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "private_set_intersection/cpp/cpu_features.h"
+
+#if PSI_HAVE_SSE2_TIER
+// GCC 12 reports the undefined vectors in the AVX-512 intrinsics as
+// uninitialized when they are inlined into a function with a target attribute.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+#include "absl/numeric/int128.h"
+#include "openssl/sha.h"
+
+namespace private_set_intersection {
+
+namespace {
+
+// Bytes of a SHA-256 input block.
+constexpr size_t kBlockSize = 64;
+
+constexpr uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+constexpr uint32_t kInitialState[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                       0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                       0x1f83d9ab, 0x5be0cd19};
+
+uint32_t LoadBigEndian32(const uint8_t* bytes) {
+  return (uint32_t{bytes[0]} << 24) | (uint32_t{bytes[1]} << 16) |
+         (uint32_t{bytes[2]} << 8) | uint32_t{bytes[3]};
+}
+
+void StoreBigEndian32(uint32_t value, uint8_t* bytes) {
+  bytes[0] = static_cast<uint8_t>(value >> 24);
+  bytes[1] = static_cast<uint8_t>(value >> 16);
+  bytes[2] = static_cast<uint8_t>(value >> 8);
+  bytes[3] = static_cast<uint8_t>(value);
+}
+
+// Each word type below holds one 32-bit word of `kLanes` independent SHA-256
+// computations, with the operators and rotations that the compression function
+// needs. Those of the wider types are compiled for their tier only, see
+// `PSI_TARGET_FLATTEN` below.
+
+#if PSI_HAVE_SSE2_TIER
+struct Sse2Word {
+  static constexpr int kLanes = 4;
+
+  static Sse2Word Broadcast(uint32_t x) {
+    return {_mm_set1_epi32(static_cast<int>(x))};
+  }
+  static Sse2Word Load(const uint32_t* words) {
+    return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(words))};
+  }
+  void Store(uint32_t* words) const {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(words), v);
+  }
+
+  __m128i v;
+};
+
+Sse2Word operator+(Sse2Word a, Sse2Word b) {
+  return {_mm_add_epi32(a.v, b.v)};
+}
+Sse2Word operator^(Sse2Word a, Sse2Word b) {
+  return {_mm_xor_si128(a.v, b.v)};
+}
+Sse2Word operator&(Sse2Word a, Sse2Word b) {
+  return {_mm_and_si128(a.v, b.v)};
+}
+Sse2Word operator|(Sse2Word a, Sse2Word b) {
+  return {_mm_or_si128(a.v, b.v)};
+}
+
+template <int kBits>
+Sse2Word Shr(Sse2Word a) {
+  return {_mm_srli_epi32(a.v, kBits)};
+}
+
+template <int kBits>
+Sse2Word Rotr(Sse2Word a) {
+  return {_mm_or_si128(_mm_srli_epi32(a.v, kBits),
+                       _mm_slli_epi32(a.v, 32 - kBits))};
+}
+#endif
+
+#if PSI_HAVE_AVX2_TIER
+struct Avx2Word {
+  static constexpr int kLanes = 8;
+
+  PSI_TARGET("avx2")
+  static Avx2Word Broadcast(uint32_t x) {
+    return {_mm256_set1_epi32(static_cast<int>(x))};
+  }
+  PSI_TARGET("avx2")
+  static Avx2Word Load(const uint32_t* words) {
+    return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words))};
+  }
+  PSI_TARGET("avx2")
+  void Store(uint32_t* words) const {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(words), v);
+  }
+
+  __m256i v;
+};
+
+PSI_TARGET("avx2")
+Avx2Word operator+(Avx2Word a, Avx2Word b) {
+  return {_mm256_add_epi32(a.v, b.v)};
+}
+PSI_TARGET("avx2")
+Avx2Word operator^(Avx2Word a, Avx2Word b) {
+  return {_mm256_xor_si256(a.v, b.v)};
+}
+PSI_TARGET("avx2")
+Avx2Word operator&(Avx2Word a, Avx2Word b) {
+  return {_mm256_and_si256(a.v, b.v)};
+}
+PSI_TARGET("avx2")
+Avx2Word operator|(Avx2Word a, Avx2Word b) {
+  return {_mm256_or_si256(a.v, b.v)};
+}
+
+template <int kBits>
+PSI_TARGET("avx2")
+Avx2Word Shr(Avx2Word a) {
+  return {_mm256_srli_epi32(a.v, kBits)};
+}
+
+template <int kBits>
+PSI_TARGET("avx2")
+Avx2Word Rotr(Avx2Word a) {
+  return {_mm256_or_si256(_mm256_srli_epi32(a.v, kBits),
+                          _mm256_slli_epi32(a.v, 32 - kBits))};
+}
+#endif
+
+#if PSI_HAVE_AVX512_TIER
+struct Avx512Word {
+  static constexpr int kLanes = 16;
+
+  PSI_TARGET("avx512f")
+  static Avx512Word Broadcast(uint32_t x) {
+    return {_mm512_set1_epi32(static_cast<int>(x))};
+  }
+  PSI_TARGET("avx512f")
+  static Avx512Word Load(const uint32_t* words) {
+    return {_mm512_loadu_si512(words)};
+  }
+  PSI_TARGET("avx512f")
+  void Store(uint32_t* words) const { _mm512_storeu_si512(words, v); }
+
+  __m512i v;
+};
+
+PSI_TARGET("avx512f")
+Avx512Word operator+(Avx512Word a, Avx512Word b) {
+  return {_mm512_add_epi32(a.v, b.v)};
+}
+PSI_TARGET("avx512f")
+Avx512Word operator^(Avx512Word a, Avx512Word b) {
+  return {_mm512_xor_si512(a.v, b.v)};
+}
+
+template <int kBits>
+PSI_TARGET("avx512f")
+Avx512Word Shr(Avx512Word a) {
+  return {_mm512_srli_epi32(a.v, kBits)};
+}
+
+template <int kBits>
+PSI_TARGET("avx512f")
+Avx512Word Rotr(Avx512Word a) {
+  return {_mm512_ror_epi32(a.v, kBits)};
+}
+
+// AVX-512 evaluates any three-input boolean function in one instruction.
+PSI_TARGET("avx512f")
+Avx512Word Ch(Avx512Word e, Avx512Word f, Avx512Word g) {
+  return {_mm512_ternarylogic_epi32(e.v, f.v, g.v, 0xca)};
+}
+PSI_TARGET("avx512f")
+Avx512Word Maj(Avx512Word a, Avx512Word b, Avx512Word c) {
+  return {_mm512_ternarylogic_epi32(a.v, b.v, c.v, 0xe8)};
+}
+#endif
+
+#if PSI_HAVE_SSE2_TIER
+template <typename Word>
+Word Ch(Word e, Word f, Word g) {
+  return g ^ (e & (f ^ g));
+}
+
+template <typename Word>
+Word Maj(Word a, Word b, Word c) {
+  return (a & b) | (c & (a | b));
+}
+
+// Runs the SHA-256 compression function on `state`, where `words[i][lane]` is
+// the i-th big-endian word of the block of each lane.
+template <typename Word>
+void Compress(Word state[8], const uint32_t words[16][Word::kLanes]) {
+  Word w[16];
+  for (int i = 0; i < 16; i++) {
+    w[i] = Word::Load(words[i]);
+  }
+  Word a = state[0], b = state[1], c = state[2], d = state[3];
+  Word e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int i = 0; i < 64; i++) {
+    if (i >= 16) {
+      // The message schedule only needs the last 16 words.
+      const Word w15 = w[(i - 15) & 15];
+      const Word w2 = w[(i - 2) & 15];
+      w[i & 15] = w[i & 15] + (Rotr<7>(w15) ^ Rotr<18>(w15) ^ Shr<3>(w15)) +
+                  w[(i - 7) & 15] +
+                  (Rotr<17>(w2) ^ Rotr<19>(w2) ^ Shr<10>(w2));
+    }
+    const Word t1 = h + (Rotr<6>(e) ^ Rotr<11>(e) ^ Rotr<25>(e)) +
+                    Ch(e, f, g) + Word::Broadcast(kRoundConstants[i]) +
+                    w[i & 15];
+    const Word t2 = (Rotr<2>(a) ^ Rotr<13>(a) ^ Rotr<22>(a)) + Maj(a, b, c);
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state[0] = state[0] + a;
+  state[1] = state[1] + b;
+  state[2] = state[2] + c;
+  state[3] = state[3] + d;
+  state[4] = state[4] + e;
+  state[5] = state[5] + f;
+  state[6] = state[6] + g;
+  state[7] = state[7] + h;
+}
+
+// Hashes the `Word::kLanes` messages starting at `messages`, one per lane.
+template <typename Word>
+void HashLanes(const absl::string_view* messages, uint8_t* digests) {
+  constexpr int kLanes = Word::kLanes;
+  // The blocks holding the end of each message and its padding, which are
+  // the only ones not read from the message directly.
+  uint8_t tails[kLanes][2 * kBlockSize];
+  size_t full_blocks[kLanes];
+  size_t num_blocks[kLanes];
+  size_t max_blocks = 0;
+  for (int lane = 0; lane < kLanes; lane++) {
+    const size_t size = messages[lane].size();
+    const size_t rest = size % kBlockSize;
+    full_blocks[lane] = size / kBlockSize;
+    // The padding is 0x80, then zeros, then the length in bits as 8 bytes.
+    num_blocks[lane] = full_blocks[lane] + (rest + 8 < kBlockSize ? 1 : 2);
+    max_blocks = std::max(max_blocks, num_blocks[lane]);
+    uint8_t* tail = tails[lane];
+    std::memset(tail, 0, sizeof(tails[lane]));
+    if (rest > 0) {
+      std::memcpy(tail, messages[lane].data() + size - rest, rest);
+    }
+    tail[rest] = 0x80;
+    const uint64_t num_bits = uint64_t{size} * 8;
+    uint8_t* length =
+        tail + (num_blocks[lane] - full_blocks[lane]) * kBlockSize - 8;
+    StoreBigEndian32(static_cast<uint32_t>(num_bits >> 32), length);
+    StoreBigEndian32(static_cast<uint32_t>(num_bits), length + 4);
+  }
+
+  Word state[8];
+  for (int i = 0; i < 8; i++) {
+    state[i] = Word::Broadcast(kInitialState[i]);
+  }
+  alignas(64) uint32_t words[16][kLanes];
+  alignas(64) uint32_t lanes[8][kLanes];
+  for (size_t block = 0; block < max_blocks; block++) {
+    for (int lane = 0; lane < kLanes; lane++) {
+      // Lanes that are done hash their last block again, and the result is
+      // discarded.
+      const size_t lane_block = std::min(block, num_blocks[lane] - 1);
+      const uint8_t* data =
+          lane_block < full_blocks[lane]
+              ? reinterpret_cast<const uint8_t*>(messages[lane].data()) +
+                    lane_block * kBlockSize
+              : tails[lane] + (lane_block - full_blocks[lane]) * kBlockSize;
+      for (int i = 0; i < 16; i++) {
+        words[i][lane] = LoadBigEndian32(data + 4 * i);
+      }
+    }
+    Compress(state, words);
+
+    // Write out the digests of the messages that end with this block.
+    bool stored = false;
+    for (int lane = 0; lane < kLanes; lane++) {
+      if (num_blocks[lane] != block + 1) {
+        continue;
+      }
+      if (!stored) {
+        for (int i = 0; i < 8; i++) {
+          state[i].Store(lanes[i]);
+        }
+        stored = true;
+      }
+      for (int i = 0; i < 8; i++) {
+        StoreBigEndian32(lanes[i][lane],
+                         digests + lane * kSha256DigestSize + 4 * i);
+      }
+    }
+  }
+}
+
+// Hashes groups of `Word::kLanes` messages starting at `*begin`, as long as
+// enough messages are left, and advances `*begin` past them.
+template <typename Word>
+void HashGroups(absl::Span<const absl::string_view> messages, uint8_t* digests,
+                size_t* begin) {
+  for (; *begin + Word::kLanes <= messages.size(); *begin += Word::kLanes) {
+    HashLanes<Word>(&messages[*begin], digests + *begin * kSha256DigestSize);
+  }
+}
+
+void HashGroupsSse2(absl::Span<const absl::string_view> messages,
+                    uint8_t* digests, size_t* begin) {
+  HashGroups<Sse2Word>(messages, digests, begin);
+}
+#endif
+
+// The entry points of the wider tiers inline the whole kernel, so that it is
+// compiled for their instruction set.
+
+#if PSI_HAVE_AVX2_TIER
+PSI_TARGET_FLATTEN("avx2")
+void HashGroupsAvx2(absl::Span<const absl::string_view> messages,
+                    uint8_t* digests, size_t* begin) {
+  HashGroups<Avx2Word>(messages, digests, begin);
+}
+#endif
+
+#if PSI_HAVE_AVX512_TIER
+PSI_TARGET_FLATTEN("avx512f")
+void HashGroupsAvx512(absl::Span<const absl::string_view> messages,
+                      uint8_t* digests, size_t* begin) {
+  HashGroups<Avx512Word>(messages, digests, begin);
+}
+#endif
+
+}  // namespace
+
+void BatchSha256(absl::Span<const absl::string_view> messages,
+                 uint8_t* digests) {
+  const CpuTier tier = ActiveCpuTier();
+  size_t begin = 0;
+#if PSI_HAVE_AVX512_TIER
+  if (tier >= CpuTier::kAvx512) {
+    HashGroupsAvx512(messages, digests, &begin);
+  }
+#endif
+#if PSI_HAVE_AVX2_TIER
+  if (tier >= CpuTier::kAvx2) {
+    HashGroupsAvx2(messages, digests, &begin);
+  }
+#endif
+#if PSI_HAVE_SSE2_TIER
+  if (tier >= CpuTier::kSse2) {
+    HashGroupsSse2(messages, digests, &begin);
+  }
+#endif
+  for (; begin < messages.size(); begin++) {
+    SHA256(reinterpret_cast<const uint8_t*>(messages[begin].data()),
+           messages[begin].size(), digests + begin * kSha256DigestSize);
+  }
+}
+
+int BatchSha256Lanes() {
+  switch (ActiveCpuTier()) {
+    case CpuTier::kAvx512:
+      return 16;
+    case CpuTier::kAvx2:
+      return 8;
+    case CpuTier::kSse2:
+      return 4;
+    case CpuTier::kScalar:
+      break;
+  }
+  return 1;
+}
+
+int64_t ReduceSha256Digest(const uint8_t* digest, int64_t modulus) {
+  // Horner's rule over 64-bit words; the remainder stays below 2^63.
+  const uint64_t m = static_cast<uint64_t>(modulus);
+  uint64_t remainder = 0;
+  for (size_t i = 0; i < kSha256DigestSize; i += 8) {
+    const uint64_t word =
+        (uint64_t{LoadBigEndian32(digest + i)} << 32) |
+        LoadBigEndian32(digest + i + 4);
+    remainder = absl::Uint128Low64(
+        absl::MakeUint128(remainder, word) % m);
+  }
+  return static_cast<int64_t>(remainder);
+}
+
+}  // namespace private_set_intersection
@@ -0,0 +1,54 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CRYPTO_BATCH_SHA256_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CRYPTO_BATCH_SHA256_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace private_set_intersection {
+
+// Bytes of a SHA-256 digest.
+inline constexpr size_t kSha256DigestSize = 32;
+
+// Computes the SHA-256 digests of many independent messages, writing
+// `kSha256DigestSize` bytes per message to `digests`, in order.
+//
+// Messages are hashed in groups, one message per 32-bit lane of the widest
+// vector unit of the active CPU tier (see cpu_features.h): 16 with AVX-512, 8
+// with AVX2 and 4 with SSE2. Lanes whose message has fewer blocks than the
+// longest one in the group idle until it is done, so batches of short messages
+// of similar length, such as encrypted PSI elements, work best. Leftover
+// messages that do not fill a group, and all messages in the scalar tier, are
+// hashed one at a time by the crypto library.
+void BatchSha256(absl::Span<const absl::string_view> messages,
+                 uint8_t* digests);
+
+// Returns the number of messages that `BatchSha256` hashes at once, or 1 if it
+// only uses the crypto library.
+int BatchSha256Lanes();
+
+// Returns `digest`, read as a big-endian unsigned integer, modulo `modulus`,
+// which must be positive.
+int64_t ReduceSha256Digest(const uint8_t* digest, int64_t modulus);
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CRYPTO_BATCH_SHA256_H_
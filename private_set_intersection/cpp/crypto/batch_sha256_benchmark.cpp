@@ -0,0 +1,102 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "openssl/sha.h"
+#include "private_set_intersection/cpp/cpu_features.h"
+#include "private_set_intersection/cpp/crypto/batch_sha256.h"
+
+namespace private_set_intersection {
+namespace {
+
+// Number of messages hashed per iteration.
+constexpr int kNumMessages = 1024;
+
+// Returns `kNumMessages` messages of `size` bytes each, e.g. 33 for an
+// encrypted element, or 34 for one prefixed as in the Bloom filter.
+std::vector<std::string> Messages(size_t size) {
+  std::vector<std::string> messages(kNumMessages);
+  for (int i = 0; i < kNumMessages; i++) {
+    messages[i] = absl::StrCat("Element", i);
+    messages[i].resize(size, 'x');
+  }
+  return messages;
+}
+
+// The second argument caps the CPU tier, see cpu_features.h.
+void BM_BatchSha256(benchmark::State& state) {
+  const std::vector<std::string> messages = Messages(state.range(0));
+  const std::vector<absl::string_view> views(messages.begin(),
+                                             messages.end());
+  std::vector<uint8_t> digests(kNumMessages * kSha256DigestSize);
+  ForceCpuTier(static_cast<CpuTier>(state.range(1)));
+  for (auto _ : state) {
+    BatchSha256(views, digests.data());
+    ::benchmark::DoNotOptimize(digests.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumMessages);
+  state.SetLabel(absl::StrCat(CpuTierName(ActiveCpuTier()), ", ",
+                              BatchSha256Lanes(), " lanes"));
+  ClearForcedCpuTier();
+}
+BENCHMARK(BM_BatchSha256)->Apply([](benchmark::internal::Benchmark* b) {
+  for (int size : {33, 100, 200}) {
+    for (CpuTier tier : {CpuTier::kSse2, CpuTier::kAvx2, CpuTier::kAvx512}) {
+      b->Args({size, static_cast<int>(tier)});
+    }
+  }
+});
+
+// The same messages hashed one at a time by the crypto library, which uses
+// the SHA extensions of the CPU if it has them.
+void BM_Sha256OneAtATime(benchmark::State& state) {
+  const std::vector<std::string> messages = Messages(state.range(0));
+  std::vector<uint8_t> digests(kNumMessages * kSha256DigestSize);
+  for (auto _ : state) {
+    for (int i = 0; i < kNumMessages; i++) {
+      SHA256(reinterpret_cast<const uint8_t*>(messages[i].data()),
+             messages[i].size(), &digests[i * kSha256DigestSize]);
+    }
+    ::benchmark::DoNotOptimize(digests.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumMessages);
+}
+BENCHMARK(BM_Sha256OneAtATime)->Arg(33)->Arg(100)->Arg(200);
+
+// Reduces digests modulo a hash range, as the GCS and Bloom filter do.
+void BM_ReduceSha256Digest(benchmark::State& state) {
+  const std::vector<std::string> messages = Messages(33);
+  const std::vector<absl::string_view> views(messages.begin(),
+                                             messages.end());
+  std::vector<uint8_t> digests(kNumMessages * kSha256DigestSize);
+  BatchSha256(views, digests.data());
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (int i = 0; i < kNumMessages; i++) {
+      sum += ReduceSha256Digest(&digests[i * kSha256DigestSize], 1000003);
+    }
+    ::benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumMessages);
+}
+BENCHMARK(BM_ReduceSha256Digest);
+
+}  // namespace
+}  // namespace private_set_intersection
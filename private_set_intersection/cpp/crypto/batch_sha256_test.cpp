@@ -0,0 +1,117 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/batch_sha256.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/escaping.h"
+#include "gtest/gtest.h"
+#include "openssl/sha.h"
+#include "private_set_intersection/cpp/cpu_features.h"
+
+namespace private_set_intersection {
+namespace {
+
+std::vector<std::string> BatchSha256Hex(
+    const std::vector<std::string>& messages) {
+  const std::vector<absl::string_view> views(messages.begin(), messages.end());
+  std::string digests(messages.size() * kSha256DigestSize, '\0');
+  BatchSha256(views, reinterpret_cast<uint8_t*>(&digests[0]));
+  std::vector<std::string> result;
+  for (size_t i = 0; i < messages.size(); i++) {
+    result.push_back(absl::BytesToHexString(
+        digests.substr(i * kSha256DigestSize, kSha256DigestSize)));
+  }
+  return result;
+}
+
+std::string Sha256Hex(const std::string& message) {
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(message.data()), message.size(),
+         digest);
+  return absl::BytesToHexString(
+      absl::string_view(reinterpret_cast<const char*>(digest), sizeof(digest)));
+}
+
+TEST(BatchSha256Test, TestKnownAnswers) {
+  // From FIPS 180-2, appendix B, with the first one repeated so that the
+  // batch fills the widest group.
+  std::vector<std::string> messages(16, "abc");
+  messages.push_back(
+      "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq");
+  messages.push_back("");
+  const std::vector<std::string> digests = BatchSha256Hex(messages);
+  for (int i = 0; i < 16; i++) {
+    EXPECT_EQ(
+        digests[i],
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  }
+  EXPECT_EQ(digests[16],
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  EXPECT_EQ(digests[17],
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+}
+
+TEST(BatchSha256Test, TestMatchesSingleMessages) {
+  // Lengths around the block boundaries, in an order that mixes long and short
+  // messages in every group.
+  std::vector<std::string> messages;
+  for (int i = 0; i < 64; i++) {
+    const size_t size = (i * 37) % 200;
+    std::string message(size, '\0');
+    for (size_t j = 0; j < size; j++) {
+      message[j] = static_cast<char>(j * 7 + i);
+    }
+    messages.push_back(message);
+  }
+  for (size_t size : {55, 56, 63, 64, 119, 120}) {
+    messages.push_back(std::string(size, 'x'));
+  }
+  // Batches of these sizes use every group size and the one-at-a-time path,
+  // in every tier that this CPU supports.
+  for (CpuTier tier : {CpuTier::kScalar, CpuTier::kSse2, CpuTier::kAvx2,
+                       CpuTier::kAvx512}) {
+    ForceCpuTier(tier);
+    for (size_t count : {1, 3, 4, 7, 8, 15, 16, 31, 70}) {
+      const std::vector<std::string> batch(messages.end() - count,
+                                           messages.end());
+      const std::vector<std::string> digests = BatchSha256Hex(batch);
+      for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(digests[i], Sha256Hex(batch[i]))
+            << CpuTierName(tier) << " " << count << " " << batch[i].size();
+      }
+    }
+  }
+  ClearForcedCpuTier();
+}
+
+TEST(BatchSha256Test, TestReduceDigest) {
+  const std::string digest = absl::HexStringToBytes(
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  const auto* bytes = reinterpret_cast<const uint8_t*>(digest.data());
+  EXPECT_EQ(ReduceSha256Digest(bytes, 1), 0);
+  EXPECT_EQ(ReduceSha256Digest(bytes, 256), 0xad);
+  EXPECT_EQ(ReduceSha256Digest(bytes, int64_t{1} << 40), 0x61f20015ad);
+  // Computed with Python's arbitrary-precision integers.
+  EXPECT_EQ(ReduceSha256Digest(bytes, 1000003), 127342);
+  EXPECT_EQ(ReduceSha256Digest(bytes, 0x7fffffffffffffff),
+            7844562598752555730);
+}
+
+}  // namespace
+}  // namespace private_set_intersection
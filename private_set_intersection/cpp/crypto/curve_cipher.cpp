@@ -0,0 +1,434 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/curve_cipher.h"
+
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "openssl/obj_mac.h"
+#include "openssl/rand.h"
+#include "private_join_and_compute/crypto/ec_commutative_cipher.h"
+#include "private_set_intersection/cpp/crypto/batch_cipher.h"
+#include "private_set_intersection/cpp/crypto/hash_to_curve.h"
+#include "private_set_intersection/cpp/crypto/p256.h"
+#include "private_set_intersection/cpp/crypto/ristretto255.h"
+#include "private_set_intersection/cpp/crypto/secp256k1.h"
+
+namespace private_set_intersection {
+
+namespace {
+
+using ::private_join_and_compute::ECCommutativeCipher;
+
+absl::Status UnsupportedCombination(psi_proto::Curve curve,
+                                    psi_proto::HashToCurve hash_to_curve,
+                                    psi_proto::PointEncoding point_encoding) {
+  return absl::InvalidArgumentError(absl::StrCat(
+      "Curve ", curve, " does not support hash-to-curve method ",
+      hash_to_curve, " with point encoding ", point_encoding));
+}
+
+// P-256 through `ECCommutativeCipher`, whose try-and-increment hashing is the
+// original mapping of the protocol, and `BatchCipher` for everything else.
+class P256CurveCipher : public CurveCipher {
+ public:
+  // Creates a cipher for `key`, 32 big-endian bytes.
+  static StatusOr<std::unique_ptr<CurveCipher>> Create(
+      std::string key, psi_proto::HashToCurve hash_to_curve,
+      psi_proto::PointEncoding point_encoding) {
+    if (hash_to_curve == psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP) {
+      return UnsupportedCombination(psi_proto::CURVE_P256, hash_to_curve,
+                                    point_encoding);
+    }
+    ASSIGN_OR_RETURN(std::shared_ptr<const P256HashToCurve> hasher,
+                     SharedHashToCurve(hash_to_curve));
+    ASSIGN_OR_RETURN(P256PointFormat format, GetPointFormat(point_encoding));
+    ASSIGN_OR_RETURN(
+        std::shared_ptr<const BatchCipher> batch_cipher,
+        BatchCipher::CreateFromKey(key, format));
+    return absl::WrapUnique(new P256CurveCipher(
+        std::move(key), std::move(batch_cipher), std::move(hasher)));
+  }
+
+  StatusOr<std::unique_ptr<CurveCipher>> Clone() const override {
+    // Only the commutative cipher keeps scratch state, and clones create
+    // their own when they need it; the batch cipher and the hasher are
+    // shared.
+    return absl::WrapUnique(
+        new P256CurveCipher(key_, batch_cipher_, hasher_));
+  }
+
+  size_t element_size() const override {
+    return batch_cipher_->element_size();
+  }
+
+  std::string GetPrivateKeyBytes() const override { return key_; }
+
+  absl::Status Encrypt(absl::Span<const std::string> inputs,
+                       std::string* out) override {
+    if (hasher_ != nullptr) {
+      return batch_cipher_->Encrypt(*hasher_, inputs, out);
+    }
+    if (cipher_ == nullptr) {
+      // The commutative cipher sets up its own group, which cannot be shared,
+      // so it is only created once the try-and-increment hash is needed.
+      ASSIGN_OR_RETURN(cipher_, ECCommutativeCipher::CreateFromKey(
+                                    NID_X9_62_prime256v1, key_,
+                                    ECCommutativeCipher::HashType::SHA256));
+    }
+    return EncryptElements(*cipher_, *batch_cipher_, nullptr, inputs, out);
+  }
+
+  absl::Status ReEncrypt(absl::Span<const absl::string_view> ciphertexts,
+                         std::string* out) const override {
+    return batch_cipher_->ReEncrypt(ciphertexts, out);
+  }
+
+  absl::Status Decrypt(absl::Span<const absl::string_view> ciphertexts,
+                       std::string* out) const override {
+    return batch_cipher_->Decrypt(ciphertexts, out);
+  }
+
+ private:
+  P256CurveCipher(std::string key,
+                  std::shared_ptr<const BatchCipher> batch_cipher,
+                  std::shared_ptr<const P256HashToCurve> hasher)
+      : key_(std::move(key)),
+        batch_cipher_(std::move(batch_cipher)),
+        hasher_(std::move(hasher)) {}
+
+  std::string key_;
+  // Created by the first `Encrypt` with `HASH_TO_CURVE_TRY_AND_INCREMENT`.
+  std::unique_ptr<ECCommutativeCipher> cipher_;
+  // Handles whole batches of points with the same key.
+  std::shared_ptr<const BatchCipher> batch_cipher_;
+  // Null for `HASH_TO_CURVE_TRY_AND_INCREMENT`, which `cipher_` implements.
+  std::shared_ptr<const P256HashToCurve> hasher_;
+};
+
+// ristretto255 with the arithmetic of ristretto255.h. Nothing keeps scratch
+// state, so clones share everything.
+class Ristretto255CurveCipher : public CurveCipher {
+ public:
+  static StatusOr<std::unique_ptr<CurveCipher>> Create(
+      const Ristretto255Scalar& key, psi_proto::HashToCurve hash_to_curve,
+      psi_proto::PointEncoding point_encoding) {
+    if (hash_to_curve != psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP ||
+        point_encoding != psi_proto::POINT_ENCODING_COMPRESSED) {
+      return UnsupportedCombination(psi_proto::CURVE_RISTRETTO255,
+                                    hash_to_curve, point_encoding);
+    }
+    return absl::WrapUnique(
+        new Ristretto255CurveCipher(key, SharedRistretto255HashToGroup()));
+  }
+
+  StatusOr<std::unique_ptr<CurveCipher>> Clone() const override {
+    return absl::WrapUnique(new Ristretto255CurveCipher(*this));
+  }
+
+  size_t element_size() const override { return kRistretto255PointSize; }
+
+  std::string GetPrivateKeyBytes() const override {
+    std::string key(kCurveCipherKeySize, '\0');
+    Ristretto255EncodeScalar(key_, &key[0]);
+    return key;
+  }
+
+  absl::Status Encrypt(absl::Span<const std::string> inputs,
+                       std::string* out) override {
+    size_t offset = out->size();
+    out->resize(offset + inputs.size() * kRistretto255PointSize);
+    Ristretto255Point point;
+    for (const std::string& input : inputs) {
+      hasher_->Hash(input, &point);
+      key_multiplier_.Multiply(point, &point);
+      Ristretto255EncodePoint(point, &(*out)[offset]);
+      offset += kRistretto255PointSize;
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status ReEncrypt(absl::Span<const absl::string_view> ciphertexts,
+                         std::string* out) const override {
+    return Multiply(ciphertexts, key_multiplier_, out);
+  }
+
+  absl::Status Decrypt(absl::Span<const absl::string_view> ciphertexts,
+                       std::string* out) const override {
+    return Multiply(ciphertexts, key_inverse_multiplier_, out);
+  }
+
+ private:
+  Ristretto255CurveCipher(const Ristretto255Scalar& key,
+                          std::shared_ptr<const Ristretto255HashToGroup> hasher)
+      : key_(key),
+        key_multiplier_(key),
+        key_inverse_multiplier_(Ristretto255InvertScalar(key)),
+        hasher_(std::move(hasher)) {}
+
+  Ristretto255CurveCipher(const Ristretto255CurveCipher&) = default;
+
+  // Multiplies each of `ciphertexts` with `multiplier` and appends the
+  // results to `out`. All ciphertexts are decoded first, so that `out` is
+  // left as it was if one of them is invalid.
+  absl::Status Multiply(absl::Span<const absl::string_view> ciphertexts,
+                        const Ristretto255BulkMultiplier& multiplier,
+                        std::string* out) const {
+    std::vector<Ristretto255Point> points(ciphertexts.size());
+    for (size_t i = 0; i < ciphertexts.size(); i++) {
+      if (!Ristretto255DecodePoint(ciphertexts[i], &points[i])) {
+        return absl::InvalidArgumentError(
+            "Ciphertext is not a valid ristretto255 element");
+      }
+    }
+    multiplier.Multiply(points, absl::MakeSpan(points));
+    size_t offset = out->size();
+    out->resize(offset + points.size() * kRistretto255PointSize);
+    for (const Ristretto255Point& point : points) {
+      Ristretto255EncodePoint(point, &(*out)[offset]);
+      offset += kRistretto255PointSize;
+    }
+    return absl::OkStatus();
+  }
+
+  Ristretto255Scalar key_;
+  // Multipliers for the key and its inverse, with the recoding of the scalar
+  // done once for the lifetime of the cipher.
+  Ristretto255BulkMultiplier key_multiplier_;
+  Ristretto255BulkMultiplier key_inverse_multiplier_;
+  std::shared_ptr<const Ristretto255HashToGroup> hasher_;
+};
+
+// secp256k1 with the arithmetic of secp256k1.h. `ECCommutativeCipher` cannot
+// be used for any part of it, since BoringSSL does not support the curve.
+// Nothing keeps scratch state, so clones share everything.
+class Secp256k1CurveCipher : public CurveCipher {
+ public:
+  static StatusOr<std::unique_ptr<CurveCipher>> Create(
+      const Secp256k1Scalar& key, psi_proto::HashToCurve hash_to_curve,
+      psi_proto::PointEncoding point_encoding) {
+    if (hash_to_curve != psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT ||
+        point_encoding != psi_proto::POINT_ENCODING_COMPRESSED) {
+      return UnsupportedCombination(psi_proto::CURVE_SECP256K1, hash_to_curve,
+                                    point_encoding);
+    }
+    return absl::WrapUnique(
+        new Secp256k1CurveCipher(key, SharedSecp256k1HashToCurve()));
+  }
+
+  StatusOr<std::unique_ptr<CurveCipher>> Clone() const override {
+    return absl::WrapUnique(new Secp256k1CurveCipher(*this));
+  }
+
+  size_t element_size() const override {
+    return kSecp256k1CompressedPointSize;
+  }
+
+  std::string GetPrivateKeyBytes() const override {
+    std::string key(kCurveCipherKeySize, '\0');
+    Secp256k1EncodeScalar(key_, &key[0]);
+    return key;
+  }
+
+  absl::Status Encrypt(absl::Span<const std::string> inputs,
+                       std::string* out) override {
+    std::vector<Secp256k1AffinePoint> points(inputs.size());
+    hasher_->HashBatch(inputs, points.data());
+    return MultiplyAndEncode(absl::MakeSpan(points), key_multiplier_, out);
+  }
+
+  absl::Status ReEncrypt(absl::Span<const absl::string_view> ciphertexts,
+                         std::string* out) const override {
+    return Multiply(ciphertexts, key_multiplier_, out);
+  }
+
+  absl::Status Decrypt(absl::Span<const absl::string_view> ciphertexts,
+                       std::string* out) const override {
+    return Multiply(ciphertexts, key_inverse_multiplier_, out);
+  }
+
+ private:
+  Secp256k1CurveCipher(const Secp256k1Scalar& key,
+                       std::shared_ptr<const Secp256k1HashToCurve> hasher)
+      : key_(key),
+        key_multiplier_(key),
+        key_inverse_multiplier_(Secp256k1InvertScalar(key)),
+        hasher_(std::move(hasher)) {}
+
+  Secp256k1CurveCipher(const Secp256k1CurveCipher&) = default;
+
+  // Multiplies each of `ciphertexts` with `multiplier` and appends the
+  // results to `out`. All ciphertexts are decoded first, so that `out` is
+  // left as it was if one of them is invalid.
+  absl::Status Multiply(absl::Span<const absl::string_view> ciphertexts,
+                        const Secp256k1BulkMultiplier& multiplier,
+                        std::string* out) const {
+    std::vector<Secp256k1AffinePoint> points(ciphertexts.size());
+    for (size_t i = 0; i < ciphertexts.size(); i++) {
+      if (ciphertexts[i].size() != kSecp256k1CompressedPointSize ||
+          !Secp256k1DecodePoint(ciphertexts[i], &points[i])) {
+        return absl::InvalidArgumentError(
+            "Ciphertext is not a valid secp256k1 point");
+      }
+    }
+    return MultiplyAndEncode(absl::MakeSpan(points), multiplier, out);
+  }
+
+  // Multiplies `points` with `multiplier`, overwriting them, and appends the
+  // compressed results to `out`. All products are converted to affine
+  // coordinates with a single inversion.
+  static absl::Status MultiplyAndEncode(
+      absl::Span<Secp256k1AffinePoint> points,
+      const Secp256k1BulkMultiplier& multiplier, std::string* out) {
+    std::vector<Secp256k1ProjectivePoint> products(points.size());
+    multiplier.Multiply(points, absl::MakeSpan(products));
+    // The group has prime order and the scalar is not zero, so this only
+    // fails on a bug.
+    if (!Secp256k1BatchToAffine(products, points)) {
+      return absl::InternalError("Product is the point at infinity");
+    }
+    size_t offset = out->size();
+    out->resize(offset + points.size() * kSecp256k1CompressedPointSize);
+    for (const Secp256k1AffinePoint& point : points) {
+      Secp256k1EncodePoint(point, &(*out)[offset]);
+      offset += kSecp256k1CompressedPointSize;
+    }
+    return absl::OkStatus();
+  }
+
+  Secp256k1Scalar key_;
+  // Multipliers for the key and its inverse, with the decomposition and
+  // recoding of the scalar done once for the lifetime of the cipher.
+  Secp256k1BulkMultiplier key_multiplier_;
+  Secp256k1BulkMultiplier key_inverse_multiplier_;
+  std::shared_ptr<const Secp256k1HashToCurve> hasher_;
+};
+
+// Returns a uniformly random P-256 key between 1 and the group order minus 1,
+// as 32 big-endian bytes, by rejection sampling: the order is within 2^224 of
+// 2^256, so practically every candidate is accepted.
+StatusOr<std::string> NewP256Key() {
+  std::string key(kCurveCipherKeySize, '\0');
+  P256Scalar scalar;
+  do {
+    if (RAND_bytes(reinterpret_cast<uint8_t*>(&key[0]), key.size()) != 1) {
+      return absl::InternalError("Crypto library operation failed");
+    }
+  } while (!P256DecodeScalar(key, &scalar));
+  return key;
+}
+
+// Returns a uniformly random scalar between 1 and the ristretto255 group
+// order minus 1, by rejection sampling: the order is slightly above 2^252, so
+// about half of all 253-bit candidates are accepted.
+StatusOr<Ristretto255Scalar> NewRistretto255Key() {
+  uint8_t bytes[kCurveCipherKeySize];
+  Ristretto255Scalar key;
+  do {
+    if (RAND_bytes(bytes, sizeof(bytes)) != 1) {
+      return absl::InternalError("Crypto library operation failed");
+    }
+    bytes[0] &= 0x1f;
+  } while (!Ristretto255DecodeScalar(
+      absl::string_view(reinterpret_cast<const char*>(bytes), sizeof(bytes)),
+      &key));
+  return key;
+}
+
+// Returns a uniformly random scalar between 1 and the secp256k1 group order
+// minus 1, by rejection sampling: the order is within 2^129 of 2^256, so
+// practically every candidate is accepted.
+StatusOr<Secp256k1Scalar> NewSecp256k1Key() {
+  uint8_t bytes[kCurveCipherKeySize];
+  Secp256k1Scalar key;
+  do {
+    if (RAND_bytes(bytes, sizeof(bytes)) != 1) {
+      return absl::InternalError("Crypto library operation failed");
+    }
+  } while (!Secp256k1DecodeScalar(
+      absl::string_view(reinterpret_cast<const char*>(bytes), sizeof(bytes)),
+      &key));
+  return key;
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<CurveCipher>> CurveCipher::CreateWithNewKey(
+    psi_proto::Curve curve, psi_proto::HashToCurve hash_to_curve,
+    psi_proto::PointEncoding point_encoding) {
+  switch (curve) {
+    case psi_proto::CURVE_P256: {
+      // P-256 gives 128 bits of security.
+      ASSIGN_OR_RETURN(std::string key, NewP256Key());
+      return P256CurveCipher::Create(std::move(key), hash_to_curve,
+                                     point_encoding);
+    }
+    case psi_proto::CURVE_RISTRETTO255: {
+      ASSIGN_OR_RETURN(Ristretto255Scalar key, NewRistretto255Key());
+      return Ristretto255CurveCipher::Create(key, hash_to_curve,
+                                             point_encoding);
+    }
+    case psi_proto::CURVE_SECP256K1: {
+      ASSIGN_OR_RETURN(Secp256k1Scalar key, NewSecp256k1Key());
+      return Secp256k1CurveCipher::Create(key, hash_to_curve, point_encoding);
+    }
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported curve ", curve));
+  }
+}
+
+StatusOr<std::unique_ptr<CurveCipher>> CurveCipher::CreateFromKey(
+    psi_proto::Curve curve, absl::string_view key_bytes,
+    psi_proto::HashToCurve hash_to_curve,
+    psi_proto::PointEncoding point_encoding) {
+  switch (curve) {
+    case psi_proto::CURVE_P256: {
+      P256Scalar key;
+      if (!P256DecodeScalar(key_bytes, &key)) {
+        return absl::InvalidArgumentError("Invalid P-256 private key");
+      }
+      // Keys from older versions may be shorter, without leading zeros.
+      std::string padded(kCurveCipherKeySize - key_bytes.size(), '\0');
+      padded.append(key_bytes.data(), key_bytes.size());
+      return P256CurveCipher::Create(std::move(padded), hash_to_curve,
+                                     point_encoding);
+    }
+    case psi_proto::CURVE_RISTRETTO255: {
+      Ristretto255Scalar key;
+      if (!Ristretto255DecodeScalar(key_bytes, &key)) {
+        return absl::InvalidArgumentError("Invalid ristretto255 private key");
+      }
+      return Ristretto255CurveCipher::Create(key, hash_to_curve,
+                                             point_encoding);
+    }
+    case psi_proto::CURVE_SECP256K1: {
+      Secp256k1Scalar key;
+      if (!Secp256k1DecodeScalar(key_bytes, &key)) {
+        return absl::InvalidArgumentError("Invalid secp256k1 private key");
+      }
+      return Secp256k1CurveCipher::Create(key, hash_to_curve, point_encoding);
+    }
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported curve ", curve));
+  }
+}
+
+}  // namespace private_set_intersection
@@ -0,0 +1,100 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CRYPTO_CURVE_CIPHER_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CRYPTO_CURVE_CIPHER_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+
+using absl::StatusOr;
+
+// Size of the keys returned by `CurveCipher::GetPrivateKeyBytes`.
+inline constexpr size_t kCurveCipherKeySize = 32;
+
+// Commutative encryption of PSI elements in one of the groups of
+// `psi_proto::Curve`: inputs are hashed to the group and multiplied by a
+// secret scalar, and ciphertexts are multiplied by the scalar or its inverse.
+// `PsiServer` and `PsiClient` only use this interface, so that the group is
+// selected when they are created.
+class CurveCipher {
+ public:
+  virtual ~CurveCipher() = default;
+
+  // Creates a cipher with a new random key. `hash_to_curve` selects how
+  // inputs are mapped to the group and `point_encoding` how elements are
+  // encoded; both must be supported on `curve`.
+  //
+  // Returns INVALID_ARGUMENT if `curve`, `hash_to_curve` or `point_encoding`
+  // is unknown, or if they cannot be combined.
+  static StatusOr<std::unique_ptr<CurveCipher>> CreateWithNewKey(
+      psi_proto::Curve curve, psi_proto::HashToCurve hash_to_curve,
+      psi_proto::PointEncoding point_encoding);
+
+  // Like `CreateWithNewKey` for the big-endian key `key_bytes`.
+  //
+  // Also returns INVALID_ARGUMENT if the key is not between 1 and the group
+  // order minus 1.
+  static StatusOr<std::unique_ptr<CurveCipher>> CreateFromKey(
+      psi_proto::Curve curve, absl::string_view key_bytes,
+      psi_proto::HashToCurve hash_to_curve,
+      psi_proto::PointEncoding point_encoding);
+
+  // Returns a cipher with the same key and settings. `Encrypt` may keep
+  // scratch state, so threads that encrypt concurrently need their own
+  // instances; the other methods can be called from any thread.
+  virtual StatusOr<std::unique_ptr<CurveCipher>> Clone() const = 0;
+
+  // Returns the size of every encrypted element.
+  virtual size_t element_size() const = 0;
+
+  // Returns the key as `kCurveCipherKeySize` big-endian bytes.
+  virtual std::string GetPrivateKeyBytes() const = 0;
+
+  // Hashes `inputs` to the group, encrypts them and appends the results,
+  // `element_size()` bytes each, to `out`.
+  //
+  // Returns INTERNAL if hashing or encryption fails.
+  virtual absl::Status Encrypt(absl::Span<const std::string> inputs,
+                               std::string* out) = 0;
+
+  // Re-encrypts `ciphertexts` and appends the results to `out`. On error,
+  // `out` is left as it was.
+  //
+  // Returns INVALID_ARGUMENT if a ciphertext is not an element of the group.
+  virtual absl::Status ReEncrypt(
+      absl::Span<const absl::string_view> ciphertexts,
+      std::string* out) const = 0;
+
+  // Decrypts `ciphertexts` and appends the results to `out`. On error, `out`
+  // is left as it was.
+  //
+  // Returns INVALID_ARGUMENT if a ciphertext is not an element of the group.
+  virtual absl::Status Decrypt(absl::Span<const absl::string_view> ciphertexts,
+                               std::string* out) const = 0;
+};
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CRYPTO_CURVE_CIPHER_H_
@@ -0,0 +1,191 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/curve_cipher.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "private_set_intersection/cpp/util/status_matchers.h"
+
+namespace private_set_intersection {
+namespace {
+
+struct Settings {
+  psi_proto::Curve curve;
+  psi_proto::HashToCurve hash_to_curve;
+  psi_proto::PointEncoding point_encoding;
+  size_t element_size;
+};
+
+// Every supported combination of curve, hash-to-curve method and encoding.
+const Settings kAllSettings[] = {
+    {psi_proto::CURVE_P256, psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+     psi_proto::POINT_ENCODING_COMPRESSED, 33},
+    {psi_proto::CURVE_P256, psi_proto::HASH_TO_CURVE_P256_SSWU,
+     psi_proto::POINT_ENCODING_COMPRESSED, 33},
+    {psi_proto::CURVE_P256, psi_proto::HASH_TO_CURVE_P256_SSWU,
+     psi_proto::POINT_ENCODING_X_ONLY, 32},
+    {psi_proto::CURVE_RISTRETTO255,
+     psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP,
+     psi_proto::POINT_ENCODING_COMPRESSED, 32},
+    {psi_proto::CURVE_SECP256K1, psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+     psi_proto::POINT_ENCODING_COMPRESSED, 33},
+};
+
+std::vector<std::string> Split(const std::string& packed, size_t width) {
+  std::vector<std::string> elements;
+  for (size_t i = 0; i < packed.size(); i += width) {
+    elements.push_back(packed.substr(i, width));
+  }
+  return elements;
+}
+
+std::vector<absl::string_view> Views(const std::vector<std::string>& elements) {
+  return std::vector<absl::string_view>(elements.begin(), elements.end());
+}
+
+TEST(CurveCipherTest, TestEncryptionCommutes) {
+  std::vector<std::string> inputs;
+  for (int i = 0; i < 100; i++) {
+    inputs.push_back(absl::StrCat("Element ", i));
+  }
+  for (const Settings& settings : kAllSettings) {
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto client,
+        CurveCipher::CreateWithNewKey(settings.curve, settings.hash_to_curve,
+                                      settings.point_encoding));
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto server,
+        CurveCipher::CreateWithNewKey(settings.curve, settings.hash_to_curve,
+                                      settings.point_encoding));
+    EXPECT_EQ(client->element_size(), settings.element_size);
+
+    // H(x)^(ab)^(1/a) = H(x)^b.
+    std::string encrypted;
+    ASSERT_TRUE(client->Encrypt(inputs, &encrypted).ok());
+    std::string reencrypted;
+    ASSERT_TRUE(
+        server->ReEncrypt(Views(Split(encrypted, settings.element_size)),
+                          &reencrypted)
+            .ok());
+    std::string decrypted;
+    ASSERT_TRUE(
+        client->Decrypt(Views(Split(reencrypted, settings.element_size)),
+                        &decrypted)
+            .ok());
+    std::string expected;
+    ASSERT_TRUE(server->Encrypt(inputs, &expected).ok());
+    EXPECT_EQ(decrypted, expected) << settings.curve;
+  }
+}
+
+TEST(CurveCipherTest, TestKeyRoundTripAndClone) {
+  const std::vector<std::string> inputs = {"a", "b", "c"};
+  for (const Settings& settings : kAllSettings) {
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto cipher,
+        CurveCipher::CreateWithNewKey(settings.curve, settings.hash_to_curve,
+                                      settings.point_encoding));
+    const std::string key = cipher->GetPrivateKeyBytes();
+    EXPECT_EQ(key.size(), kCurveCipherKeySize);
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto restored,
+        CurveCipher::CreateFromKey(settings.curve, key, settings.hash_to_curve,
+                                   settings.point_encoding));
+    PSI_ASSERT_OK_AND_ASSIGN(auto clone, cipher->Clone());
+    EXPECT_EQ(restored->GetPrivateKeyBytes(), key);
+    EXPECT_EQ(clone->GetPrivateKeyBytes(), key);
+
+    std::string expected;
+    ASSERT_TRUE(cipher->Encrypt(inputs, &expected).ok());
+    for (CurveCipher* other : {restored.get(), clone.get()}) {
+      std::string encrypted;
+      ASSERT_TRUE(other->Encrypt(inputs, &encrypted).ok());
+      EXPECT_EQ(encrypted, expected);
+    }
+  }
+}
+
+TEST(CurveCipherTest, FailIfInvalidCiphertext) {
+  for (const Settings& settings : kAllSettings) {
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto cipher,
+        CurveCipher::CreateWithNewKey(settings.curve, settings.hash_to_curve,
+                                      settings.point_encoding));
+    std::string valid;
+    ASSERT_TRUE(cipher->Encrypt({"valid"}, &valid).ok());
+    const std::vector<absl::string_view> views = {valid, "invalid"};
+    std::string out = "unchanged";
+    EXPECT_THAT(cipher->ReEncrypt(views, &out),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    EXPECT_THAT(cipher->Decrypt(views, &out),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    EXPECT_EQ(out, "unchanged");
+  }
+}
+
+TEST(CurveCipherTest, FailIfUnsupported) {
+  EXPECT_THAT(
+      CurveCipher::CreateWithNewKey(static_cast<psi_proto::Curve>(7),
+                                    psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                                    psi_proto::POINT_ENCODING_COMPRESSED),
+      StatusIs(absl::StatusCode::kInvalidArgument, "Unsupported curve 7"));
+  EXPECT_THAT(
+      CurveCipher::CreateWithNewKey(
+          psi_proto::CURVE_P256, psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP,
+          psi_proto::POINT_ENCODING_COMPRESSED),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "Curve 0 does not support hash-to-curve method 2 with point "
+               "encoding 0"));
+  EXPECT_THAT(
+      CurveCipher::CreateWithNewKey(psi_proto::CURVE_RISTRETTO255,
+                                    psi_proto::HASH_TO_CURVE_P256_SSWU,
+                                    psi_proto::POINT_ENCODING_COMPRESSED),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(
+      CurveCipher::CreateWithNewKey(
+          psi_proto::CURVE_RISTRETTO255,
+          psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP,
+          psi_proto::POINT_ENCODING_X_ONLY),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "Curve 1 does not support hash-to-curve method 2 with point "
+               "encoding 1"));
+  EXPECT_THAT(
+      CurveCipher::CreateWithNewKey(psi_proto::CURVE_SECP256K1,
+                                    psi_proto::HASH_TO_CURVE_P256_SSWU,
+                                    psi_proto::POINT_ENCODING_COMPRESSED),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "Curve 2 does not support hash-to-curve method 1 with point "
+               "encoding 0"));
+  EXPECT_THAT(CurveCipher::CreateFromKey(
+                  psi_proto::CURVE_RISTRETTO255, std::string(32, '\xff'),
+                  psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP,
+                  psi_proto::POINT_ENCODING_COMPRESSED),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Invalid ristretto255 private key"));
+  EXPECT_THAT(CurveCipher::CreateFromKey(
+                  psi_proto::CURVE_P256, std::string(32, '\xff'),
+                  psi_proto::HASH_TO_CURVE_P256_SSWU,
+                  psi_proto::POINT_ENCODING_COMPRESSED),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Invalid P-256 private key"));
+}
+
+}  // namespace
+}  // namespace private_set_intersection
@@ -0,0 +1,495 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/hash_to_curve.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "openssl/sha.h"
+#include "private_set_intersection/cpp/crypto/batch_sha256.h"
+#include "private_set_intersection/cpp/crypto/p256_boringssl.h"
+
+namespace private_set_intersection {
+
+namespace {
+
+// Parameters of P256_XMD:SHA-256_SSWU_RO_, see RFC 9380, section 8.2.
+constexpr char kFieldPrime[] =
+    "FFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF";
+constexpr char kCurveB[] =
+    "5AC635D8AA3A93E7B3EBBD55769886BC651D06B0CC53B0F63BCE3C3E27D2604B";
+constexpr int kCurveA = -3;
+constexpr int kMapZ = -10;
+
+// Bytes of SHA-256 output, and of its input block.
+constexpr size_t kHashSize = SHA256_DIGEST_LENGTH;
+constexpr size_t kBlockSize = 64;
+
+// Bytes of the SHA-512 input block, as used by ristretto255.
+constexpr size_t kSha512BlockSize = 128;
+
+// Bytes hashed to each of the two field elements, i.e. L in the RFC.
+constexpr size_t kFieldElementSize = 48;
+constexpr size_t kExpandedSize = 2 * kFieldElementSize;
+
+// Sizes of compressed and uncompressed SEC1 points.
+constexpr size_t kCompressedPointSize = 33;
+constexpr size_t kUncompressedPointSize = 65;
+
+absl::Status CryptoError() {
+  return absl::InternalError("Crypto library operation failed");
+}
+
+absl::Status CheckDst(absl::string_view dst) {
+  if (dst.empty() || dst.size() > 255) {
+    return absl::InvalidArgumentError(
+        "The domain separation tag must have 1 to 255 bytes");
+  }
+  return absl::OkStatus();
+}
+
+// Frees a BN_CTX and balances its frame when going out of scope.
+class ScopedBnCtx {
+ public:
+  ScopedBnCtx() : ctx_(BN_CTX_new()) {
+    if (ctx_ != nullptr) {
+      BN_CTX_start(ctx_);
+    }
+  }
+  ~ScopedBnCtx() {
+    if (ctx_ != nullptr) {
+      BN_CTX_end(ctx_);
+      BN_CTX_free(ctx_);
+    }
+  }
+
+  BN_CTX* get() const { return ctx_; }
+
+ private:
+  BN_CTX* ctx_;
+};
+
+// Sets `bn` to the signed integer `value` modulo `p`.
+bool SetSmallInt(int value, const BIGNUM* p, BIGNUM* bn) {
+  if (BN_set_word(bn, static_cast<BN_ULONG>(value < 0 ? -value : value)) !=
+      1) {
+    return false;
+  }
+  return value >= 0 || BN_sub(bn, p, bn) == 1;
+}
+
+// Computes `expand_message_xmd` of RFC 9380, section 5.3.1, with the hash
+// function `hash`, which has `hash_size` bytes of output and consumes input in
+// blocks of `block_size` bytes. Writes `out_size` bytes, a multiple of
+// `hash_size`, to `out`.
+void ExpandMessageXmd(uint8_t* (*hash)(const uint8_t*, size_t, uint8_t*),
+                      size_t hash_size, size_t block_size,
+                      absl::string_view dst_prime, absl::string_view input,
+                      size_t out_size, uint8_t* out) {
+  // b_0 = H(Z_pad || msg || I2OSP(len_in_bytes, 2) || I2OSP(0, 1) || DST')
+  std::string buffer(block_size, '\0');
+  buffer.append(input.data(), input.size());
+  buffer.push_back(static_cast<char>(out_size >> 8));
+  buffer.push_back(static_cast<char>(out_size & 0xff));
+  buffer.push_back('\0');
+  buffer.append(dst_prime.data(), dst_prime.size());
+  uint8_t b0[SHA512_DIGEST_LENGTH];
+  hash(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size(), b0);
+
+  // b_i = H((b_0 XOR b_(i-1)) || I2OSP(i, 1) || DST'), with b_1 = H(b_0 ||
+  // I2OSP(1, 1) || DST').
+  buffer.assign(hash_size + 1, '\0');
+  buffer.append(dst_prime.data(), dst_prime.size());
+  auto* block = reinterpret_cast<uint8_t*>(&buffer[0]);
+  for (size_t i = 1; i * hash_size <= out_size; i++) {
+    for (size_t j = 0; j < hash_size; j++) {
+      block[j] = b0[j] ^ (i == 1 ? 0 : out[(i - 2) * hash_size + j]);
+    }
+    block[hash_size] = static_cast<uint8_t>(i);
+    hash(block, buffer.size(), out + (i - 1) * hash_size);
+  }
+}
+
+// Computes `expand_message_xmd` with SHA-256 for each of `inputs`, writing
+// `out_size` bytes, a multiple of 32, per input to `out`. Each step of the
+// expansion hashes all inputs together with `BatchSha256`.
+void ExpandMessagesXmdSha256(absl::string_view dst_prime,
+                             absl::Span<const absl::string_view> inputs,
+                             size_t out_size, uint8_t* out) {
+  // b_0 = H(Z_pad || msg || I2OSP(len_in_bytes, 2) || I2OSP(0, 1) || DST')
+  std::string buffer;
+  for (absl::string_view input : inputs) {
+    buffer.append(kBlockSize, '\0');
+    buffer.append(input.data(), input.size());
+    buffer.push_back(static_cast<char>(out_size >> 8));
+    buffer.push_back(static_cast<char>(out_size & 0xff));
+    buffer.push_back('\0');
+    buffer.append(dst_prime.data(), dst_prime.size());
+  }
+  std::vector<absl::string_view> messages(inputs.size());
+  size_t offset = 0;
+  for (size_t k = 0; k < inputs.size(); k++) {
+    const size_t size = kBlockSize + inputs[k].size() + 3 + dst_prime.size();
+    messages[k] = absl::string_view(buffer).substr(offset, size);
+    offset += size;
+  }
+  std::vector<uint8_t> b0(inputs.size() * kHashSize);
+  BatchSha256(messages, b0.data());
+
+  // b_i = H((b_0 XOR b_(i-1)) || I2OSP(i, 1) || DST'), with b_1 = H(b_0 ||
+  // I2OSP(1, 1) || DST').
+  const size_t message_size = kHashSize + 1 + dst_prime.size();
+  buffer.assign(inputs.size() * message_size, '\0');
+  for (size_t k = 0; k < inputs.size(); k++) {
+    std::memcpy(&buffer[k * message_size + kHashSize + 1], dst_prime.data(),
+                dst_prime.size());
+    messages[k] = absl::string_view(buffer).substr(k * message_size,
+                                                   message_size);
+  }
+  std::vector<uint8_t> digests(inputs.size() * kHashSize);
+  for (size_t i = 1; i * kHashSize <= out_size; i++) {
+    for (size_t k = 0; k < inputs.size(); k++) {
+      auto* block = reinterpret_cast<uint8_t*>(&buffer[k * message_size]);
+      const uint8_t* previous = out + k * out_size + (i - 2) * kHashSize;
+      for (size_t j = 0; j < kHashSize; j++) {
+        block[j] = b0[k * kHashSize + j] ^ (i == 1 ? 0 : previous[j]);
+      }
+      block[kHashSize] = static_cast<uint8_t>(i);
+    }
+    BatchSha256(messages, digests.data());
+    for (size_t k = 0; k < inputs.size(); k++) {
+      std::memcpy(out + k * out_size + (i - 1) * kHashSize,
+                  &digests[k * kHashSize], kHashSize);
+    }
+  }
+}
+
+}  // namespace
+
+P256HashToCurve::~P256HashToCurve() {
+  for (BIGNUM* bn : {p_, a_, b_, z_, minus_b_over_a_, b_over_za_,
+                     sqrt_exponent_, sqrt_minus_z3_}) {
+    BN_free(bn);
+  }
+}
+
+StatusOr<std::unique_ptr<P256HashToCurve>> P256HashToCurve::Create(
+    absl::string_view dst) {
+  RETURN_IF_ERROR(CheckDst(dst));
+  auto hasher = absl::WrapUnique(new P256HashToCurve());
+  hasher->dst_prime_ = std::string(dst);
+  hasher->dst_prime_.push_back(static_cast<char>(dst.size()));
+
+  hasher->group_ = SharedP256Group();
+  hasher->a_ = BN_new();
+  hasher->z_ = BN_new();
+  hasher->minus_b_over_a_ = BN_new();
+  hasher->b_over_za_ = BN_new();
+  hasher->sqrt_exponent_ = BN_new();
+  hasher->sqrt_minus_z3_ = BN_new();
+  ScopedBnCtx ctx;
+  if (hasher->group_ == nullptr || ctx.get() == nullptr ||
+      BN_hex2bn(&hasher->p_, kFieldPrime) == 0 ||
+      BN_hex2bn(&hasher->b_, kCurveB) == 0 || hasher->a_ == nullptr ||
+      hasher->z_ == nullptr || hasher->minus_b_over_a_ == nullptr ||
+      hasher->b_over_za_ == nullptr || hasher->sqrt_exponent_ == nullptr ||
+      hasher->sqrt_minus_z3_ == nullptr) {
+    return CryptoError();
+  }
+  const BIGNUM* p = hasher->p_;
+  BIGNUM* tmp = BN_CTX_get(ctx.get());
+  if (tmp == nullptr || !SetSmallInt(kCurveA, p, hasher->a_) ||
+      !SetSmallInt(kMapZ, p, hasher->z_) ||
+      // -B / A, the numerator of x1 in the map.
+      BN_mod_inverse(tmp, hasher->a_, p, ctx.get()) == nullptr ||
+      BN_mod_mul(hasher->minus_b_over_a_, hasher->b_, tmp, p, ctx.get()) !=
+          1 ||
+      BN_sub(hasher->minus_b_over_a_, p, hasher->minus_b_over_a_) != 1 ||
+      // B / (Z * A), the value of x1 in the exceptional case.
+      BN_mod_mul(tmp, hasher->z_, hasher->a_, p, ctx.get()) != 1 ||
+      BN_mod_inverse(tmp, tmp, p, ctx.get()) == nullptr ||
+      BN_mod_mul(hasher->b_over_za_, hasher->b_, tmp, p, ctx.get()) != 1 ||
+      // (p + 1) / 4, since p = 3 mod 4.
+      BN_add(hasher->sqrt_exponent_, p, BN_value_one()) != 1 ||
+      BN_rshift(hasher->sqrt_exponent_, hasher->sqrt_exponent_, 2) != 1 ||
+      // sqrt(-Z^3).
+      !SetSmallInt(-kMapZ * kMapZ * kMapZ, p, tmp) ||
+      BN_mod_exp(hasher->sqrt_minus_z3_, tmp, hasher->sqrt_exponent_, p,
+                 ctx.get()) != 1) {
+    return CryptoError();
+  }
+  return hasher;
+}
+
+void P256HashToCurve::ExpandMessages(
+    absl::Span<const absl::string_view> inputs, uint8_t* out) const {
+  ExpandMessagesXmdSha256(dst_prime_, inputs, kExpandedSize, out);
+}
+
+absl::Status P256HashToCurve::MapToCurve(const BIGNUM* u, BIGNUM* x,
+                                         BIGNUM* y, BN_CTX* ctx) const {
+  // Simplified SWU for p = 3 mod 4, see RFC 9380, section 6.6.2. Instead of a
+  // second square root, sqrt(g(x2)) is derived from the one computed for
+  // g(x1): g(x2) = (Z * u^2)^3 * g(x1), and if g(x1) is not a square, then
+  // g(x1)^((p + 1) / 4) = sqrt(-g(x1)). Either way the map costs one
+  // inversion and one exponentiation.
+  BN_CTX_start(ctx);
+  BIGNUM* u2 = BN_CTX_get(ctx);
+  BIGNUM* z_u2 = BN_CTX_get(ctx);
+  BIGNUM* tv1 = BN_CTX_get(ctx);
+  BIGNUM* x1 = BN_CTX_get(ctx);
+  BIGNUM* gx1 = BN_CTX_get(ctx);
+  BIGNUM* y1 = BN_CTX_get(ctx);
+  bool ok = y1 != nullptr &&
+            // tv1 = Z^2 * u^4 + Z * u^2
+            BN_mod_sqr(u2, u, p_, ctx) == 1 &&
+            BN_mod_mul(z_u2, z_, u2, p_, ctx) == 1 &&
+            BN_mod_sqr(tv1, z_u2, p_, ctx) == 1 &&
+            BN_mod_add(tv1, tv1, z_u2, p_, ctx) == 1;
+  if (ok) {
+    if (BN_is_zero(tv1)) {
+      ok = BN_copy(x1, b_over_za_) != nullptr;
+    } else {
+      // x1 = (-B / A) * (1 + 1 / tv1)
+      ok = BN_mod_inverse(tv1, tv1, p_, ctx) != nullptr &&
+           BN_mod_add(tv1, tv1, BN_value_one(), p_, ctx) == 1 &&
+           BN_mod_mul(x1, minus_b_over_a_, tv1, p_, ctx) == 1;
+    }
+  }
+  // gx1 = (x1^2 + A) * x1 + B, y1 = gx1^((p + 1) / 4)
+  ok = ok && BN_mod_sqr(gx1, x1, p_, ctx) == 1 &&
+       BN_mod_add(gx1, gx1, a_, p_, ctx) == 1 &&
+       BN_mod_mul(gx1, gx1, x1, p_, ctx) == 1 &&
+       BN_mod_add(gx1, gx1, b_, p_, ctx) == 1 &&
+       BN_mod_exp(y1, gx1, sqrt_exponent_, p_, ctx) == 1 &&
+       BN_mod_sqr(tv1, y1, p_, ctx) == 1;
+  if (ok) {
+    if (BN_cmp(tv1, gx1) == 0) {
+      ok = BN_copy(x, x1) != nullptr && BN_copy(y, y1) != nullptr;
+    } else {
+      // x2 = Z * u^2 * x1, y2 = sqrt(-Z^3) * u^3 * sqrt(-g(x1))
+      ok = BN_mod_mul(x, z_u2, x1, p_, ctx) == 1 &&
+           BN_mod_mul(y, u2, u, p_, ctx) == 1 &&
+           BN_mod_mul(y, y, sqrt_minus_z3_, p_, ctx) == 1 &&
+           BN_mod_mul(y, y, y1, p_, ctx) == 1;
+    }
+  }
+  // Match the sign of y to the one of u.
+  if (ok && BN_is_odd(u) != BN_is_odd(y) && !BN_is_zero(y)) {
+    ok = BN_sub(y, p_, y) == 1;
+  }
+  BN_CTX_end(ctx);
+  return ok ? absl::OkStatus() : CryptoError();
+}
+
+StatusOr<std::string> P256HashToCurve::Hash(
+    absl::string_view input, point_conversion_form_t form) const {
+  uint8_t uniform_bytes[kExpandedSize];
+  ExpandMessages(absl::MakeConstSpan(&input, 1), uniform_bytes);
+  return HashUniformBytes(uniform_bytes, form);
+}
+
+absl::Status P256HashToCurve::HashBatch(absl::Span<const std::string> inputs,
+                                        point_conversion_form_t form,
+                                        absl::Span<std::string> points) const {
+  const std::vector<absl::string_view> views(inputs.begin(), inputs.end());
+  std::vector<uint8_t> uniform_bytes(inputs.size() * kExpandedSize);
+  ExpandMessages(views, uniform_bytes.data());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    ASSIGN_OR_RETURN(points[i], HashUniformBytes(
+                                    &uniform_bytes[i * kExpandedSize], form));
+  }
+  return absl::OkStatus();
+}
+
+StatusOr<std::string> P256HashToCurve::HashUniformBytes(
+    const uint8_t* uniform_bytes, point_conversion_form_t form) const {
+  ScopedBnCtx ctx;
+  if (ctx.get() == nullptr) {
+    return CryptoError();
+  }
+  BIGNUM* u = BN_CTX_get(ctx.get());
+  BIGNUM* x = BN_CTX_get(ctx.get());
+  BIGNUM* y = BN_CTX_get(ctx.get());
+  if (y == nullptr) {
+    return CryptoError();
+  }
+  EC_POINT* points[2] = {EC_POINT_new(group_), EC_POINT_new(group_)};
+  std::string result(form == POINT_CONVERSION_COMPRESSED
+                         ? kCompressedPointSize
+                         : kUncompressedPointSize,
+                     '\0');
+  bool ok = points[0] != nullptr && points[1] != nullptr;
+  for (int i = 0; ok && i < 2; i++) {
+    // u_i = OS2IP(uniform_bytes[48 * i, 48 * (i + 1))) mod p
+    ok = BN_bin2bn(uniform_bytes + i * kFieldElementSize, kFieldElementSize,
+                   u) != nullptr &&
+         BN_nnmod(u, u, p_, ctx.get()) == 1 &&
+         MapToCurve(u, x, y, ctx.get()).ok() &&
+         EC_POINT_set_affine_coordinates(group_, points[i], x, y,
+                                         ctx.get()) == 1;
+  }
+  // The cofactor of P-256 is 1, so the sum is the final point.
+  ok = ok &&
+       EC_POINT_add(group_, points[0], points[0], points[1], ctx.get()) == 1 &&
+       EC_POINT_point2oct(group_, points[0], form,
+                          reinterpret_cast<uint8_t*>(&result[0]),
+                          result.size(), ctx.get()) == result.size();
+  EC_POINT_free(points[0]);
+  EC_POINT_free(points[1]);
+  if (!ok) {
+    return CryptoError();
+  }
+  return result;
+}
+
+StatusOr<std::unique_ptr<Ristretto255HashToGroup>>
+Ristretto255HashToGroup::Create(absl::string_view dst) {
+  RETURN_IF_ERROR(CheckDst(dst));
+  std::string dst_prime(dst);
+  dst_prime.push_back(static_cast<char>(dst.size()));
+  return absl::WrapUnique(new Ristretto255HashToGroup(std::move(dst_prime)));
+}
+
+void Ristretto255HashToGroup::Hash(absl::string_view input,
+                                   Ristretto255Point* point) const {
+  uint8_t uniform_bytes[kRistretto255UniformBytesSize];
+  ExpandMessageXmd(SHA512, SHA512_DIGEST_LENGTH, kSha512BlockSize, dst_prime_,
+                   input, kRistretto255UniformBytesSize, uniform_bytes);
+  Ristretto255FromUniformBytes(uniform_bytes, point);
+}
+
+StatusOr<std::unique_ptr<Secp256k1HashToCurve>> Secp256k1HashToCurve::Create(
+    absl::string_view dst) {
+  RETURN_IF_ERROR(CheckDst(dst));
+  std::string dst_prime(dst);
+  dst_prime.push_back(static_cast<char>(dst.size()));
+  return absl::WrapUnique(new Secp256k1HashToCurve(std::move(dst_prime)));
+}
+
+void Secp256k1HashToCurve::Hash(absl::string_view input,
+                                Secp256k1AffinePoint* point) const {
+  const std::string copy(input);
+  HashBatch(absl::MakeConstSpan(&copy, 1), point);
+}
+
+void Secp256k1HashToCurve::HashBatch(absl::Span<const std::string> inputs,
+                                     Secp256k1AffinePoint* points) const {
+  // Every round tries the next counter for all inputs that have not found a
+  // point yet, so that their candidates are expanded together.
+  std::vector<size_t> pending(inputs.size());
+  for (size_t k = 0; k < inputs.size(); k++) {
+    pending[k] = k;
+  }
+  std::vector<std::string> messages;
+  std::vector<absl::string_view> views;
+  std::vector<uint8_t> candidates;
+  for (uint32_t i = 0; !pending.empty(); i++) {
+    messages.resize(pending.size());
+    views.resize(pending.size());
+    for (size_t k = 0; k < pending.size(); k++) {
+      messages[k] = inputs[pending[k]];
+      for (int j = 0; j < 4; j++) {
+        messages[k].push_back(static_cast<char>(i >> (24 - 8 * j)));
+      }
+      views[k] = messages[k];
+    }
+    candidates.resize(pending.size() * kHashSize);
+    ExpandMessagesXmdSha256(dst_prime_, views, kHashSize, candidates.data());
+
+    size_t num_pending = 0;
+    for (size_t k = 0; k < pending.size(); k++) {
+      // A compressed point with an even y, whose x is the candidate.
+      uint8_t encoded[kSecp256k1CompressedPointSize] = {0x02};
+      std::memcpy(encoded + 1, &candidates[k * kHashSize], kHashSize);
+      if (!Secp256k1DecodePoint(
+              absl::string_view(reinterpret_cast<const char*>(encoded),
+                                sizeof(encoded)),
+              &points[pending[k]])) {
+        pending[num_pending++] = pending[k];
+      }
+    }
+    pending.resize(num_pending);
+  }
+}
+
+StatusOr<std::unique_ptr<P256HashToCurve>> CreateHashToCurve(
+    psi_proto::HashToCurve method) {
+  switch (method) {
+    case psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT:
+      return std::unique_ptr<P256HashToCurve>();
+    case psi_proto::HASH_TO_CURVE_P256_SSWU:
+      return P256HashToCurve::Create();
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported hash-to-curve method ", method));
+  }
+}
+
+StatusOr<std::shared_ptr<const P256HashToCurve>> SharedHashToCurve(
+    psi_proto::HashToCurve method) {
+  if (method != psi_proto::HASH_TO_CURVE_P256_SSWU) {
+    return CreateHashToCurve(method);
+  }
+  // Leaked on purpose, like the group it uses. Null if the first attempt
+  // failed, in which case every call tries again and reports the error.
+  static const std::shared_ptr<const P256HashToCurve>* const shared = [] {
+    StatusOr<std::unique_ptr<P256HashToCurve>> hasher =
+        P256HashToCurve::Create();
+    return hasher.ok()
+               ? new std::shared_ptr<const P256HashToCurve>(std::move(*hasher))
+               : nullptr;
+  }();
+  if (shared != nullptr) {
+    return *shared;
+  }
+  return CreateHashToCurve(method);
+}
+
+std::shared_ptr<const Ristretto255HashToGroup> SharedRistretto255HashToGroup() {
+  // The default tag is valid, so creating the hasher cannot fail.
+  static const std::shared_ptr<const Ristretto255HashToGroup>* const shared =
+      new std::shared_ptr<const Ristretto255HashToGroup>(
+          *Ristretto255HashToGroup::Create());
+  return *shared;
+}
+
+std::shared_ptr<const Secp256k1HashToCurve> SharedSecp256k1HashToCurve() {
+  static const std::shared_ptr<const Secp256k1HashToCurve>* const shared =
+      new std::shared_ptr<const Secp256k1HashToCurve>(
+          *Secp256k1HashToCurve::Create());
+  return *shared;
+}
+
+StatusOr<std::string> EncryptElement(
+    ::private_join_and_compute::ECCommutativeCipher& cipher,
+    const P256HashToCurve* hasher, const std::string& input) {
+  if (hasher == nullptr) {
+    return cipher.Encrypt(input);
+  }
+  // Encrypting a point is the same as re-encrypting a ciphertext: both
+  // multiply it by the key. The point is handed over uncompressed, so that the
+  // cipher does not need a square root to decode it.
+  ASSIGN_OR_RETURN(std::string point,
+                   hasher->Hash(input, POINT_CONVERSION_UNCOMPRESSED));
+  return cipher.ReEncrypt(point);
+}
+
+}  // namespace private_set_intersection
@@ -0,0 +1,225 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CRYPTO_HASH_TO_CURVE_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CRYPTO_HASH_TO_CURVE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/bn.h"
+#include "openssl/ec.h"
+#include "private_join_and_compute/crypto/ec_commutative_cipher.h"
+#include "private_set_intersection/cpp/crypto/ristretto255.h"
+#include "private_set_intersection/cpp/crypto/secp256k1.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+
+using absl::StatusOr;
+
+// Domain separation tag with which PsiServer and PsiClient hash their inputs.
+inline constexpr absl::string_view kPsiHashToCurveDst =
+    "OpenMined-PSI-V01-CS02-with-P256_XMD:SHA-256_SSWU_RO_";
+
+// Hashes byte strings to points on the NIST P-256 curve following RFC 9380,
+// suite P256_XMD:SHA-256_SSWU_RO_. Unlike the try-and-increment hashing of
+// `ECCommutativeCipher`, every input costs the same work: four SHA-256
+// invocations, two simplified SWU maps with one inversion and one square root
+// each, and one point addition.
+//
+// All scratch state is allocated per call, so a single instance can be shared
+// between threads.
+class P256HashToCurve {
+ public:
+  P256HashToCurve(const P256HashToCurve&) = delete;
+  P256HashToCurve& operator=(const P256HashToCurve&) = delete;
+  ~P256HashToCurve();
+
+  // Creates a hasher for the domain separation tag `dst`.
+  //
+  // Returns INVALID_ARGUMENT if `dst` is empty or longer than 255 bytes, or
+  // INTERNAL if the curve cannot be set up.
+  static StatusOr<std::unique_ptr<P256HashToCurve>> Create(
+      absl::string_view dst = kPsiHashToCurveDst);
+
+  // Returns the point for `input` in SEC1 encoding, by default compressed to
+  // 33 bytes. The uncompressed encoding is cheaper to decode again, since it
+  // needs no square root.
+  //
+  // Returns INTERNAL if a crypto library operation fails.
+  StatusOr<std::string> Hash(
+      absl::string_view input,
+      point_conversion_form_t form = POINT_CONVERSION_COMPRESSED) const;
+
+  // Like `Hash` for each of `inputs`, writing the points to `points`, which
+  // must have the same size. The messages of all inputs are expanded together
+  // with `BatchSha256`.
+  //
+  // Returns INTERNAL if a crypto library operation fails.
+  absl::Status HashBatch(absl::Span<const std::string> inputs,
+                         point_conversion_form_t form,
+                         absl::Span<std::string> points) const;
+
+ private:
+  P256HashToCurve() = default;
+
+  // Computes `expand_message_xmd` with SHA-256 for each of `inputs`, writing
+  // 96 bytes per input to `out`.
+  void ExpandMessages(absl::Span<const absl::string_view> inputs,
+                      uint8_t* out) const;
+
+  // Maps 96 bytes of `expand_message_xmd` output to the point they encode.
+  StatusOr<std::string> HashUniformBytes(const uint8_t* uniform_bytes,
+                                         point_conversion_form_t form) const;
+
+  // Maps the field element `u` to the point (`x`, `y`) with the simplified
+  // SWU map.
+  absl::Status MapToCurve(const BIGNUM* u, BIGNUM* x, BIGNUM* y,
+                          BN_CTX* ctx) const;
+
+  // `dst` followed by its length, as appended to every hash input.
+  std::string dst_prime_;
+
+  // See `SharedP256Group`.
+  const EC_GROUP* group_ = nullptr;
+
+  // Curve and map constants, see hash_to_curve.cpp.
+  BIGNUM* p_ = nullptr;
+  BIGNUM* a_ = nullptr;
+  BIGNUM* b_ = nullptr;
+  BIGNUM* z_ = nullptr;
+  BIGNUM* minus_b_over_a_ = nullptr;
+  BIGNUM* b_over_za_ = nullptr;
+  BIGNUM* sqrt_exponent_ = nullptr;
+  BIGNUM* sqrt_minus_z3_ = nullptr;
+};
+
+// Domain separation tag with which PsiServer and PsiClient hash their inputs
+// to ristretto255.
+inline constexpr absl::string_view kPsiRistretto255HashToGroupDst =
+    "OpenMined-PSI-V01-CS02-with-ristretto255_XMD:SHA-512_R255MAP_RO_";
+
+// Hashes byte strings to ristretto255 group elements following RFC 9380,
+// suite ristretto255_XMD:SHA-512_R255MAP_RO_: `expand_message_xmd` with
+// SHA-512 yields 64 uniform bytes, which `Ristretto255FromUniformBytes` maps
+// to the group. Every input costs two SHA-512 invocations and two square
+// roots, and there is no scratch state, so a single instance can be shared
+// between threads.
+class Ristretto255HashToGroup {
+ public:
+  Ristretto255HashToGroup(const Ristretto255HashToGroup&) = delete;
+  Ristretto255HashToGroup& operator=(const Ristretto255HashToGroup&) = delete;
+
+  // Creates a hasher for the domain separation tag `dst`.
+  //
+  // Returns INVALID_ARGUMENT if `dst` is empty or longer than 255 bytes.
+  static StatusOr<std::unique_ptr<Ristretto255HashToGroup>> Create(
+      absl::string_view dst = kPsiRistretto255HashToGroupDst);
+
+  // Sets `point` to the group element for `input`.
+  void Hash(absl::string_view input, Ristretto255Point* point) const;
+
+ private:
+  explicit Ristretto255HashToGroup(std::string dst_prime)
+      : dst_prime_(std::move(dst_prime)) {}
+
+  // `dst` followed by its length, as appended to every hash input.
+  std::string dst_prime_;
+};
+
+// Domain separation tag with which PsiServer and PsiClient hash their inputs
+// to secp256k1.
+inline constexpr absl::string_view kPsiSecp256k1HashToCurveDst =
+    "OpenMined-PSI-V01-CS02-with-secp256k1_XMD:SHA-256_TAI_";
+
+// Hashes byte strings to points on secp256k1 by try-and-increment, since the
+// RFC 9380 suite for this curve needs an isogenous curve: for i = 0, 1, ...,
+// the candidate x coordinate is `expand_message_xmd` with SHA-256 of the input
+// followed by i as 4 big-endian bytes, 32 bytes long, and the first candidate
+// that is the x coordinate of a point gives the point with an even y. Half of
+// all candidates succeed, so inputs take two attempts with one square root
+// each on average; the number of attempts depends on the input, as with the
+// try-and-increment hashing of `ECCommutativeCipher`. There is no scratch
+// state, so a single instance can be shared between threads.
+class Secp256k1HashToCurve {
+ public:
+  Secp256k1HashToCurve(const Secp256k1HashToCurve&) = delete;
+  Secp256k1HashToCurve& operator=(const Secp256k1HashToCurve&) = delete;
+
+  // Creates a hasher for the domain separation tag `dst`.
+  //
+  // Returns INVALID_ARGUMENT if `dst` is empty or longer than 255 bytes.
+  static StatusOr<std::unique_ptr<Secp256k1HashToCurve>> Create(
+      absl::string_view dst = kPsiSecp256k1HashToCurveDst);
+
+  // Sets `point` to the point for `input`.
+  void Hash(absl::string_view input, Secp256k1AffinePoint* point) const;
+
+  // Sets `points[i]` to the point for `inputs[i]`. The candidates of all
+  // inputs are expanded together with `BatchSha256`, one counter at a time.
+  void HashBatch(absl::Span<const std::string> inputs,
+                 Secp256k1AffinePoint* points) const;
+
+ private:
+  explicit Secp256k1HashToCurve(std::string dst_prime)
+      : dst_prime_(std::move(dst_prime)) {}
+
+  // `dst` followed by its length, as appended to every hash input.
+  std::string dst_prime_;
+};
+
+// Creates the hasher for `method`, or returns null for
+// `HASH_TO_CURVE_TRY_AND_INCREMENT`, whose hashing is built into
+// `ECCommutativeCipher`.
+//
+// Returns INVALID_ARGUMENT if `method` is unknown.
+StatusOr<std::unique_ptr<P256HashToCurve>> CreateHashToCurve(
+    psi_proto::HashToCurve method);
+
+// Like `CreateHashToCurve`, but returns one hasher per method that is created
+// on first use and shared by all callers in the process, so that ciphers with
+// fresh keys skip setting up the curve constants. Hashers are immutable, so
+// the shared instance can be used from any thread.
+//
+// Returns INVALID_ARGUMENT if `method` is unknown, or INTERNAL if the hasher
+// cannot be created.
+StatusOr<std::shared_ptr<const P256HashToCurve>> SharedHashToCurve(
+    psi_proto::HashToCurve method);
+
+// Returns the hasher for `kPsiRistretto255HashToGroupDst`, shared like those of
+// `SharedHashToCurve`.
+std::shared_ptr<const Ristretto255HashToGroup> SharedRistretto255HashToGroup();
+
+// Returns the hasher for `kPsiSecp256k1HashToCurveDst`, shared like those of
+// `SharedHashToCurve`.
+std::shared_ptr<const Secp256k1HashToCurve> SharedSecp256k1HashToCurve();
+
+// Maps `input` to the curve with `hasher` and encrypts the point under
+// `cipher`. If `hasher` is null, the cipher's own hashing is used instead.
+//
+// Returns INTERNAL if hashing or encryption fails.
+StatusOr<std::string> EncryptElement(
+    ::private_join_and_compute::ECCommutativeCipher& cipher,
+    const P256HashToCurve* hasher, const std::string& input);
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CRYPTO_HASH_TO_CURVE_H_
@@ -0,0 +1,249 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/hash_to_curve.h"
+
+#include <thread>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "private_set_intersection/cpp/util/status_matchers.h"
+
+namespace private_set_intersection {
+namespace {
+
+constexpr char kTestDst[] = "QUUX-V01-CS02-with-P256_XMD:SHA-256_SSWU_RO_";
+
+// Returns the hex-encoded compressed encoding of the point with the given
+// hex-encoded coordinates.
+std::string CompressedPointHex(absl::string_view x, absl::string_view y) {
+  const char last = absl::ascii_tolower(y.back());
+  const int last_digit = last <= '9' ? last - '0' : last - 'a' + 10;
+  return absl::StrCat(last_digit % 2 == 1 ? "03" : "02", x);
+}
+
+TEST(P256HashToCurveTest, TestRfc9380Vectors) {
+  // Test vectors from RFC 9380, appendix J.1.1.
+  struct TestVector {
+    std::string msg;
+    std::string x;
+    std::string y;
+  };
+  const std::vector<TestVector> vectors = {
+      {"", "2c15230b26dbc6fc9a37051158c95b79656e17a1a920b11394ca91c44247d3e4",
+       "8a7a74985cc5c776cdfe4b1f19884970453912e9d31528c060be9ab5c43e8415"},
+      {"abc",
+       "0bb8b87485551aa43ed54f009230450b492fead5f1cc91658775dac4a3388a0f",
+       "5c41b3d0731a27a7b14bc0bf0ccded2d8751f83493404c84a88e71ffd424212e"},
+      {"abcdef0123456789",
+       "65038ac8f2b1def042a5df0b33b1f4eca6bff7cb0f9c6c1526811864e544ed80",
+       "cad44d40a656e7aff4002a8de287abc8ae0482b5ae825822bb870d6df9b56ca3"},
+      {absl::StrCat("q128_", std::string(128, 'q')),
+       "4be61ee205094282ba8a2042bcb48d88dfbb609301c49aa8b078533dc65a0b5d",
+       "98f8df449a072c4721d241a3b1236d3caccba603f916ca680f4539d2bfb3c29e"},
+      {absl::StrCat("a512_", std::string(512, 'a')),
+       "457ae2981f70ca85d8e24c308b14db22f3e3862c5ea0f652ca38b5e49cd64bc5",
+       "ecb9f0eadc9aeed232dabc53235368c1394c78de05dd96893eefa62b0f4757dc"},
+  };
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto hasher, P256HashToCurve::Create(kTestDst));
+  for (const auto& vector : vectors) {
+    PSI_ASSERT_OK_AND_ASSIGN(std::string point, hasher->Hash(vector.msg));
+    EXPECT_EQ(absl::BytesToHexString(point),
+              CompressedPointHex(vector.x, vector.y))
+        << "msg: " << vector.msg.substr(0, 16);
+  }
+}
+
+TEST(P256HashToCurveTest, TestDomainSeparation) {
+  PSI_ASSERT_OK_AND_ASSIGN(auto psi_hasher, P256HashToCurve::Create());
+  PSI_ASSERT_OK_AND_ASSIGN(auto test_hasher, P256HashToCurve::Create(kTestDst));
+  PSI_ASSERT_OK_AND_ASSIGN(std::string psi_point, psi_hasher->Hash("abc"));
+  PSI_ASSERT_OK_AND_ASSIGN(std::string test_point, test_hasher->Hash("abc"));
+  EXPECT_EQ(psi_point.size(), 33);
+  EXPECT_NE(psi_point, test_point);
+}
+
+TEST(P256HashToCurveTest, TestConcurrentUse) {
+  PSI_ASSERT_OK_AND_ASSIGN(auto hasher, P256HashToCurve::Create());
+  std::vector<std::string> expected;
+  for (int i = 0; i < 100; i++) {
+    PSI_ASSERT_OK_AND_ASSIGN(std::string point,
+                             hasher->Hash(absl::StrCat("Element ", i)));
+    expected.push_back(point);
+  }
+
+  std::vector<std::vector<std::string>> results(4);
+  std::vector<std::thread> threads;
+  for (auto& result : results) {
+    threads.emplace_back([&hasher, &result]() {
+      for (int i = 0; i < 100; i++) {
+        auto point = hasher->Hash(absl::StrCat("Element ", i));
+        result.push_back(point.ok() ? *point : "");
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const auto& result : results) {
+    EXPECT_EQ(result, expected);
+  }
+}
+
+TEST(P256HashToCurveTest, TestHashBatch) {
+  PSI_ASSERT_OK_AND_ASSIGN(auto hasher, P256HashToCurve::Create());
+  std::vector<std::string> inputs;
+  for (int i = 0; i < 40; i++) {
+    inputs.push_back(std::string(i * 3, 'a' + i % 26));
+  }
+  std::vector<std::string> points(inputs.size());
+  ASSERT_TRUE(hasher
+                  ->HashBatch(inputs, POINT_CONVERSION_COMPRESSED,
+                              absl::MakeSpan(points))
+                  .ok());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    PSI_ASSERT_OK_AND_ASSIGN(std::string expected, hasher->Hash(inputs[i]));
+    EXPECT_EQ(points[i], expected) << i;
+  }
+}
+
+TEST(P256HashToCurveTest, FailIfInvalidDst) {
+  EXPECT_THAT(P256HashToCurve::Create(""),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "The domain separation tag must have 1 to 255 bytes"));
+  EXPECT_THAT(P256HashToCurve::Create(std::string(256, 'x')),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "The domain separation tag must have 1 to 255 bytes"));
+}
+
+TEST(P256HashToCurveTest, TestShared) {
+  PSI_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<const P256HashToCurve> shared,
+      SharedHashToCurve(psi_proto::HASH_TO_CURVE_P256_SSWU));
+  ASSERT_NE(shared, nullptr);
+  PSI_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<const P256HashToCurve> again,
+      SharedHashToCurve(psi_proto::HASH_TO_CURVE_P256_SSWU));
+  EXPECT_EQ(shared, again);
+  PSI_ASSERT_OK_AND_ASSIGN(auto fresh, P256HashToCurve::Create());
+  PSI_ASSERT_OK_AND_ASSIGN(std::string expected, fresh->Hash("abc"));
+  PSI_ASSERT_OK_AND_ASSIGN(std::string actual, shared->Hash("abc"));
+  EXPECT_EQ(actual, expected);
+
+  PSI_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<const P256HashToCurve> none,
+      SharedHashToCurve(psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT));
+  EXPECT_EQ(none, nullptr);
+  EXPECT_THAT(SharedHashToCurve(static_cast<psi_proto::HashToCurve>(99)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  EXPECT_EQ(SharedRistretto255HashToGroup(), SharedRistretto255HashToGroup());
+  EXPECT_EQ(SharedSecp256k1HashToCurve(), SharedSecp256k1HashToCurve());
+}
+
+std::string Ristretto255Hex(const Ristretto255HashToGroup& hasher,
+                           absl::string_view input) {
+  Ristretto255Point point;
+  hasher.Hash(input, &point);
+  std::string encoded(kRistretto255PointSize, '\0');
+  Ristretto255EncodePoint(point, &encoded[0]);
+  return absl::BytesToHexString(encoded);
+}
+
+TEST(Ristretto255HashToGroupTest, TestReferenceVectors) {
+  // RFC 9380 defines the suite without test vectors. These were computed with
+  // straightforward implementations of RFC 9380 and RFC 9496.
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto test_hasher, Ristretto255HashToGroup::Create(
+                            "QUUX-V01-CS02-with-ristretto255_XMD:SHA-512_"
+                            "R255MAP_RO_"));
+  EXPECT_EQ(Ristretto255Hex(*test_hasher, ""),
+            "bed61e1ee1966329962880e236dfdc83afd52fd1ce116f64fb806f1e8acea926");
+  EXPECT_EQ(Ristretto255Hex(*test_hasher, "abc"),
+            "627b997b104ee62543358e22576c75a98dff9dc5f348d5ab228689735d77b258");
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto psi_hasher, Ristretto255HashToGroup::Create());
+  EXPECT_EQ(Ristretto255Hex(*psi_hasher, ""),
+            "6435e9d4a78a6d9537599d1ab16c3da135bdd161b5fb842675b9b7d32b6f5f14");
+  EXPECT_EQ(Ristretto255Hex(*psi_hasher, "abc"),
+            "b8ca8232e9d2f0651975aa83e6a668d9386c69fa3b9ef375a1a4737eec684632");
+}
+
+TEST(Ristretto255HashToGroupTest, FailIfInvalidDst) {
+  EXPECT_THAT(Ristretto255HashToGroup::Create(""),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "The domain separation tag must have 1 to 255 bytes"));
+}
+
+std::string Secp256k1Hex(const Secp256k1HashToCurve& hasher,
+                         absl::string_view input) {
+  Secp256k1AffinePoint point;
+  hasher.Hash(input, &point);
+  std::string encoded(kSecp256k1CompressedPointSize, '\0');
+  Secp256k1EncodePoint(point, &encoded[0]);
+  return absl::BytesToHexString(encoded);
+}
+
+TEST(Secp256k1HashToCurveTest, TestReferenceVectors) {
+  // Computed with a straightforward implementation. The empty input only
+  // succeeds with the third candidate.
+  PSI_ASSERT_OK_AND_ASSIGN(auto hasher, Secp256k1HashToCurve::Create());
+  EXPECT_EQ(
+      Secp256k1Hex(*hasher, ""),
+      "025ce021adf0f509ac460f15f1f3dd624c3fb90496734842e8889d55ad24e8f5a6");
+  EXPECT_EQ(
+      Secp256k1Hex(*hasher, "abc"),
+      "02d8d78793b00d630744620481d42e6ed92ba3d043d14210b140baddb6527b9954");
+
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto test_hasher,
+      Secp256k1HashToCurve::Create(
+          "QUUX-V01-CS02-with-secp256k1_XMD:SHA-256_TAI_"));
+  EXPECT_EQ(
+      Secp256k1Hex(*test_hasher, "abcdef0123456789"),
+      "0278298f034bdf6b2c5c7f1faa48c73fe3b417572bc5a148f471be016ec636369e");
+}
+
+TEST(Secp256k1HashToCurveTest, TestHashBatch) {
+  // Inputs need different numbers of candidates, so they drop out of the
+  // batch in different rounds.
+  PSI_ASSERT_OK_AND_ASSIGN(auto hasher, Secp256k1HashToCurve::Create());
+  std::vector<std::string> inputs = {"", "abc"};
+  for (int i = 0; i < 40; i++) {
+    inputs.push_back(absl::StrCat("Element ", i));
+  }
+  std::vector<Secp256k1AffinePoint> points(inputs.size());
+  hasher->HashBatch(inputs, points.data());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    std::string encoded(kSecp256k1CompressedPointSize, '\0');
+    Secp256k1EncodePoint(points[i], &encoded[0]);
+    EXPECT_EQ(absl::BytesToHexString(encoded), Secp256k1Hex(*hasher, inputs[i]))
+        << i;
+  }
+}
+
+TEST(Secp256k1HashToCurveTest, FailIfInvalidDst) {
+  EXPECT_THAT(Secp256k1HashToCurve::Create(""),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "The domain separation tag must have 1 to 255 bytes"));
+}
+
+}  // namespace
+}  // namespace private_set_intersection
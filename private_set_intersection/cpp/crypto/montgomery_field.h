@@ -0,0 +1,289 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CRYPTO_MONTGOMERY_FIELD_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CRYPTO_MONTGOMERY_FIELD_H_
+
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace private_set_intersection {
+
+// An integer below 2^256 as four 64-bit limbs, least significant first.
+struct FieldElement256 {
+  uint64_t limbs[4];
+};
+
+// Arithmetic modulo an odd prime p < 2^256, on elements in Montgomery form,
+// i.e. x is stored as x * 2^256 mod p. `Params` provides the constants
+//
+//   static constexpr uint64_t kModulus[4];  // p
+//   static constexpr uint64_t kN0;          // -p^-1 mod 2^64
+//   static constexpr uint64_t kOne[4];      // 2^256 mod p
+//   static constexpr uint64_t kR2[4];       // 2^512 mod p
+//
+// Elements are always fully reduced, so that equal values have equal limbs.
+// All operations run in time independent of the elements they are given;
+// `Pow` only branches on the exponent, which must be public.
+template <typename Params>
+class MontgomeryField {
+ public:
+  using Element = FieldElement256;
+
+  static Element Zero() { return Element{{0, 0, 0, 0}}; }
+
+  static Element One() {
+    return Element{{Params::kOne[0], Params::kOne[1], Params::kOne[2],
+                    Params::kOne[3]}};
+  }
+
+  // The limb operations below are unrolled by hand: compilers tend to keep
+  // the loops, and with them the limbs, in memory.
+
+  static Element Add(const Element& a, const Element& b) {
+    uint64_t sum[4];
+    uint64_t carry = 0;
+    sum[0] = AddCarry(a.limbs[0], b.limbs[0], &carry);
+    sum[1] = AddCarry(a.limbs[1], b.limbs[1], &carry);
+    sum[2] = AddCarry(a.limbs[2], b.limbs[2], &carry);
+    sum[3] = AddCarry(a.limbs[3], b.limbs[3], &carry);
+    return ReduceOnce(sum, carry);
+  }
+
+  static Element Sub(const Element& a, const Element& b) {
+    uint64_t borrow = 0;
+    const uint64_t d0 = SubBorrow(a.limbs[0], b.limbs[0], &borrow);
+    const uint64_t d1 = SubBorrow(a.limbs[1], b.limbs[1], &borrow);
+    const uint64_t d2 = SubBorrow(a.limbs[2], b.limbs[2], &borrow);
+    const uint64_t d3 = SubBorrow(a.limbs[3], b.limbs[3], &borrow);
+    // Add p back if the subtraction wrapped around.
+    const uint64_t mask = 0 - borrow;
+    uint64_t carry = 0;
+    Element diff;
+    diff.limbs[0] = AddCarry(d0, Params::kModulus[0] & mask, &carry);
+    diff.limbs[1] = AddCarry(d1, Params::kModulus[1] & mask, &carry);
+    diff.limbs[2] = AddCarry(d2, Params::kModulus[2] & mask, &carry);
+    diff.limbs[3] = AddCarry(d3, Params::kModulus[3] & mask, &carry);
+    return diff;
+  }
+
+  static Element Neg(const Element& a) { return Sub(Zero(), a); }
+
+  // Returns a * b * 2^-256 mod p, which is the Montgomery form of the product.
+  static Element Mul(const Element& a, const Element& b) {
+    // Coarsely integrated operand scanning: interleave one row of the
+    // product with one word of reduction, so that the accumulator never
+    // exceeds five limbs.
+    uint64_t t[5] = {0, 0, 0, 0, 0};
+    MulRound(a, b.limbs[0], t);
+    MulRound(a, b.limbs[1], t);
+    MulRound(a, b.limbs[2], t);
+    MulRound(a, b.limbs[3], t);
+    return ReduceOnce(t, t[4]);
+  }
+
+  static Element Sqr(const Element& a) { return Mul(a, a); }
+
+  // Returns a^exponent, where `exponent` is a public constant given as plain
+  // limbs, least significant first.
+  static Element Pow(const Element& a, const uint64_t exponent[4]) {
+    Element table[16];
+    table[0] = One();
+    table[1] = a;
+    for (int i = 2; i < 16; i++) {
+      table[i] = Mul(table[i - 1], a);
+    }
+    Element result = One();
+    bool started = false;
+    for (int i = 63; i >= 0; i--) {
+      if (started) {
+        for (int j = 0; j < 4; j++) {
+          result = Sqr(result);
+        }
+      }
+      const int nibble =
+          static_cast<int>((exponent[i / 16] >> (4 * (i % 16))) & 15);
+      if (nibble != 0) {
+        result = started ? Mul(result, table[nibble]) : table[nibble];
+        started = true;
+      }
+    }
+    return result;
+  }
+
+  // Returns a^-1 by Fermat's little theorem, or zero if a is zero.
+  static Element Inverse(const Element& a) {
+    uint64_t exponent[4];
+    uint64_t borrow = 2;
+    for (int i = 0; i < 4; i++) {
+      exponent[i] = Params::kModulus[i] - borrow;
+      borrow = Params::kModulus[i] < borrow ? 1 : 0;
+    }
+    return Pow(a, exponent);
+  }
+
+  // Converts the plain integer `a`, which must be below p, to Montgomery
+  // form.
+  static Element ToMontgomery(const Element& a) {
+    return Mul(a, Element{{Params::kR2[0], Params::kR2[1], Params::kR2[2],
+                           Params::kR2[3]}});
+  }
+
+  // Converts `a` from Montgomery form back to a plain integer.
+  static Element FromMontgomery(const Element& a) {
+    return Mul(a, Element{{1, 0, 0, 0}});
+  }
+
+  // Parses 32 big-endian bytes. Returns false if the value is not below p.
+  static bool FromBytes(const uint8_t* bytes, Element* result) {
+    Element value;
+    for (int i = 0; i < 4; i++) {
+      uint64_t limb = 0;
+      for (int j = 0; j < 8; j++) {
+        limb = (limb << 8) | bytes[8 * (3 - i) + j];
+      }
+      value.limbs[i] = limb;
+    }
+    if (!IsReduced(value)) {
+      return false;
+    }
+    *result = ToMontgomery(value);
+    return true;
+  }
+
+  // Writes `a` as 32 big-endian bytes.
+  static void ToBytes(const Element& a, uint8_t* bytes) {
+    const Element value = FromMontgomery(a);
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 8; j++) {
+        bytes[8 * (3 - i) + j] =
+            static_cast<uint8_t>(value.limbs[i] >> (56 - 8 * j));
+      }
+    }
+  }
+
+  // Returns all ones if `a` is zero, and zero otherwise.
+  static uint64_t IsZero(const Element& a) {
+    const uint64_t bits = a.limbs[0] | a.limbs[1] | a.limbs[2] | a.limbs[3];
+    return ((bits | (0 - bits)) >> 63) - 1;
+  }
+
+  // Returns all ones if `a` equals `b`, and zero otherwise.
+  static uint64_t Equal(const Element& a, const Element& b) {
+    return IsZero(Element{{a.limbs[0] ^ b.limbs[0], a.limbs[1] ^ b.limbs[1],
+                           a.limbs[2] ^ b.limbs[2], a.limbs[3] ^ b.limbs[3]}});
+  }
+
+  // Returns `a` if `mask` is all ones, and `b` if it is zero.
+  static Element Select(uint64_t mask, const Element& a, const Element& b) {
+    return Element{{(a.limbs[0] & mask) | (b.limbs[0] & ~mask),
+                    (a.limbs[1] & mask) | (b.limbs[1] & ~mask),
+                    (a.limbs[2] & mask) | (b.limbs[2] & ~mask),
+                    (a.limbs[3] & mask) | (b.limbs[3] & ~mask)}};
+  }
+
+ private:
+  using uint128 = unsigned __int128;
+
+  // Returns whether the plain integer `a` is below p. Only used on public
+  // inputs.
+  static bool IsReduced(const Element& a) {
+    for (int i = 3; i >= 0; i--) {
+      if (a.limbs[i] != Params::kModulus[i]) {
+        return a.limbs[i] < Params::kModulus[i];
+      }
+    }
+    return false;
+  }
+
+  // Returns a + b + `carry` modulo 2^64 and sets `carry` to the carry out.
+  // On x86-64 the intrinsic becomes a single add-with-carry, where compilers
+  // make a mess of 128-bit additions.
+  static uint64_t AddCarry(uint64_t a, uint64_t b, uint64_t* carry) {
+#if defined(__x86_64__)
+    unsigned long long sum;  // NOLINT(runtime/int)
+    *carry = _addcarry_u64(static_cast<unsigned char>(*carry), a, b, &sum);
+    return sum;
+#else
+    const uint128 t = static_cast<uint128>(a) + b + *carry;
+    *carry = static_cast<uint64_t>(t >> 64);
+    return static_cast<uint64_t>(t);
+#endif
+  }
+
+  // Returns a - b - `borrow` modulo 2^64 and sets `borrow` to the borrow out.
+  static uint64_t SubBorrow(uint64_t a, uint64_t b, uint64_t* borrow) {
+#if defined(__x86_64__)
+    unsigned long long diff;  // NOLINT(runtime/int)
+    *borrow = _subborrow_u64(static_cast<unsigned char>(*borrow), a, b, &diff);
+    return diff;
+#else
+    const uint128 t = static_cast<uint128>(a) - b - *borrow;
+    *borrow = static_cast<uint64_t>(t >> 64) & 1;
+    return static_cast<uint64_t>(t);
+#endif
+  }
+
+  // Returns the low word of a * b + c + `carry` and sets `carry` to the high
+  // word, which cannot overflow.
+  static uint64_t MulAdd(uint64_t a, uint64_t b, uint64_t c,
+                         uint64_t* carry) {
+    const uint128 t = static_cast<uint128>(a) * b + c + *carry;
+    *carry = static_cast<uint64_t>(t >> 64);
+    return static_cast<uint64_t>(t);
+  }
+  // Adds a * b to the accumulator `t` and divides it by 2^64 modulo p.
+  static void MulRound(const Element& a, uint64_t b, uint64_t t[5]) {
+    uint64_t carry = 0;
+    t[0] = MulAdd(a.limbs[0], b, t[0], &carry);
+    t[1] = MulAdd(a.limbs[1], b, t[1], &carry);
+    t[2] = MulAdd(a.limbs[2], b, t[2], &carry);
+    t[3] = MulAdd(a.limbs[3], b, t[3], &carry);
+    uint64_t top = 0;
+    t[4] = AddCarry(t[4], carry, &top);
+
+    // Adding m * p clears the lowest word, which is then shifted out.
+    const uint64_t m = t[0] * Params::kN0;
+    carry = 0;
+    MulAdd(m, Params::kModulus[0], t[0], &carry);
+    t[0] = MulAdd(m, Params::kModulus[1], t[1], &carry);
+    t[1] = MulAdd(m, Params::kModulus[2], t[2], &carry);
+    t[2] = MulAdd(m, Params::kModulus[3], t[3], &carry);
+    t[3] = AddCarry(t[4], carry, &top);
+    t[4] = top;
+  }
+
+  // Returns the value `carry` * 2^256 + `value` minus p if that does not
+  // underflow, given that the value is below 2p.
+  static Element ReduceOnce(const uint64_t value[4], uint64_t carry) {
+    uint64_t borrow = 0;
+    const Element diff = {{SubBorrow(value[0], Params::kModulus[0], &borrow),
+                           SubBorrow(value[1], Params::kModulus[1], &borrow),
+                           SubBorrow(value[2], Params::kModulus[2], &borrow),
+                           SubBorrow(value[3], Params::kModulus[3], &borrow)}};
+    // Keep the value if the subtraction borrowed beyond the carry.
+    const uint64_t keep = 0 - (borrow & (carry ^ 1));
+    return Select(keep, Element{{value[0], value[1], value[2], value[3]}},
+                  diff);
+  }
+};
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CRYPTO_MONTGOMERY_FIELD_H_
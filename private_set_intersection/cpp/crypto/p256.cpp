@@ -0,0 +1,160 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/p256.h"
+
+#include <cstring>
+
+namespace private_set_intersection {
+
+namespace {
+
+// The base field, p = 2^256 - 2^224 + 2^192 + 2^96 - 1.
+struct P256FieldParams {
+  static constexpr uint64_t kModulus[4] = {
+      0xffffffffffffffff, 0x00000000ffffffff, 0x0000000000000000,
+      0xffffffff00000001};
+  static constexpr uint64_t kN0 = 1;
+  static constexpr uint64_t kOne[4] = {0x0000000000000001, 0xffffffff00000000,
+                                       0xffffffffffffffff, 0x00000000fffffffe};
+  static constexpr uint64_t kR2[4] = {0x0000000000000003, 0xfffffffbffffffff,
+                                      0xfffffffffffffffe, 0x00000004fffffffd};
+};
+
+// The scalar field, i.e. integers modulo the group order n.
+struct P256OrderParams {
+  static constexpr uint64_t kModulus[4] = {
+      0xf3b9cac2fc632551, 0xbce6faada7179e84, 0xffffffffffffffff,
+      0xffffffff00000000};
+  static constexpr uint64_t kN0 = 0xccd1c8aaee00bc4f;
+  static constexpr uint64_t kOne[4] = {0x0c46353d039cdaaf, 0x4319055258e8617b,
+                                       0x0000000000000000, 0x00000000ffffffff};
+  static constexpr uint64_t kR2[4] = {0x83244c95be79eea2, 0x4699799c49bd6fa6,
+                                      0x2845b2392b6bec59, 0x66e12d94f3d95620};
+};
+
+using Field = MontgomeryField<P256FieldParams>;
+using Order = MontgomeryField<P256OrderParams>;
+using Element = FieldElement256;
+
+// The curve coefficient b in Montgomery form; a is -3.
+constexpr Element kCurveB = {{0xd89cdf6229c4bddf, 0xacf005cd78843090,
+                              0xe5a220abf7212ed6, 0xdc30061d04874834}};
+
+// (p + 1) / 4, the exponent of a square root since p = 3 mod 4.
+constexpr uint64_t kSqrtExponent[4] = {0x0000000000000000, 0x0000000040000000,
+                                       0x4000000000000000, 0x3fffffffc0000000};
+
+// Returns x^3 - 3x + b, the square of y for points on the curve.
+Element CurveRhs(const Element& x) {
+  const Element x3 = Field::Mul(Field::Sqr(x), x);
+  const Element three_x = Field::Add(Field::Add(x, x), x);
+  return Field::Add(Field::Sub(x3, three_x), kCurveB);
+}
+
+// Sets `point` to the point with the 32 big-endian bytes `x_bytes` as x
+// coordinate, and an odd y if `odd` is true. Returns false if there is no such
+// point.
+bool DecodeX(const uint8_t* x_bytes, bool odd, P256AffinePoint* point) {
+  if (!Field::FromBytes(x_bytes, &point->x)) {
+    return false;
+  }
+  const Element rhs = CurveRhs(point->x);
+  Element y = Field::Pow(rhs, kSqrtExponent);
+  if (!Field::Equal(Field::Sqr(y), rhs)) {
+    return false;
+  }
+  if (((Field::FromMontgomery(y).limbs[0] & 1) != 0) != odd) {
+    if (Field::IsZero(y)) {
+      return false;
+    }
+    y = Field::Neg(y);
+  }
+  point->y = y;
+  return true;
+}
+
+}  // namespace
+
+bool P256DecodePoint(absl::string_view encoded, P256AffinePoint* point) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(encoded.data());
+  if (encoded.size() == kP256CompressedPointSize &&
+      (bytes[0] == 0x02 || bytes[0] == 0x03)) {
+    return DecodeX(bytes + 1, bytes[0] == 0x03, point);
+  }
+  if (encoded.size() == kP256UncompressedPointSize && bytes[0] == 0x04) {
+    return Field::FromBytes(bytes + 1, &point->x) &&
+           Field::FromBytes(bytes + 33, &point->y) &&
+           Field::Equal(Field::Sqr(point->y), CurveRhs(point->x));
+  }
+  return false;
+}
+
+bool P256DecodeXCoordinate(absl::string_view encoded, P256AffinePoint* point) {
+  return encoded.size() == kP256XCoordinateSize &&
+         DecodeX(reinterpret_cast<const uint8_t*>(encoded.data()), false,
+                 point);
+}
+
+void P256EncodeXCoordinate(const FieldElement256& x, char* out) {
+  Field::ToBytes(x, reinterpret_cast<uint8_t*>(out));
+}
+
+void P256EncodeUncompressedPoint(const P256AffinePoint& point, char* out) {
+  auto* bytes = reinterpret_cast<uint8_t*>(out);
+  bytes[0] = 0x04;
+  Field::ToBytes(point.x, bytes + 1);
+  Field::ToBytes(point.y, bytes + 33);
+}
+
+bool P256DecodeScalar(absl::string_view bytes, P256Scalar* scalar) {
+  if (bytes.size() > 32) {
+    return false;
+  }
+  uint8_t padded[32] = {0};
+  std::memcpy(padded + 32 - bytes.size(), bytes.data(), bytes.size());
+  // `FromBytes` checks that the scalar is below the order; the Montgomery
+  // form is not needed.
+  FieldElement256 montgomery;
+  if (!Order::FromBytes(padded, &montgomery) || Order::IsZero(montgomery)) {
+    return false;
+  }
+  *scalar = P256Scalar{};
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) {
+      scalar->limbs[i] = (scalar->limbs[i] << 8) | padded[8 * (3 - i) + j];
+    }
+  }
+  return true;
+}
+
+P256Scalar P256InvertScalar(const P256Scalar& scalar) {
+  uint64_t exponent[4];
+  uint64_t borrow = 2;
+  for (int i = 0; i < 4; i++) {
+    exponent[i] = P256OrderParams::kModulus[i] - borrow;
+    borrow = P256OrderParams::kModulus[i] < borrow ? 1 : 0;
+  }
+  const FieldElement256 value = Order::ToMontgomery(
+      FieldElement256{{scalar.limbs[0], scalar.limbs[1], scalar.limbs[2],
+                       scalar.limbs[3]}});
+  const FieldElement256 inverse =
+      Order::FromMontgomery(Order::Pow(value, exponent));
+  return P256Scalar{{inverse.limbs[0], inverse.limbs[1], inverse.limbs[2],
+                     inverse.limbs[3]}};
+}
+
+}  // namespace private_set_intersection
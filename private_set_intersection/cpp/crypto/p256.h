@@ -0,0 +1,94 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CRYPTO_P256_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CRYPTO_P256_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "private_set_intersection/cpp/crypto/montgomery_field.h"
+
+namespace private_set_intersection {
+
+// Point and scalar encodings for the NIST P-256 curve, implemented on top of
+// `MontgomeryField`. Coordinates are in Montgomery form. The points are
+// multiplied in the crypto library's group, see p256_boringssl.h.
+
+// Sizes of compressed and uncompressed SEC1 point encodings.
+inline constexpr size_t kP256CompressedPointSize = 33;
+inline constexpr size_t kP256UncompressedPointSize = 65;
+
+// Size of a bare big-endian x coordinate, as used by the x-only encoding.
+inline constexpr size_t kP256XCoordinateSize = 32;
+
+// Encodings of the points that are sent on the wire.
+enum class P256PointFormat {
+  // Compressed SEC1 points, `kP256CompressedPointSize` bytes each.
+  kCompressed,
+  // Bare x coordinates, `kP256XCoordinateSize` bytes each. A point and its
+  // negation share their encoding, which does not matter to a protocol that
+  // only multiplies points by scalars, since x(kP) = x(k(-P)).
+  kXOnly,
+};
+
+// Returns the size of a point in `format`.
+inline constexpr size_t P256PointSize(P256PointFormat format) {
+  return format == P256PointFormat::kXOnly ? kP256XCoordinateSize
+                                           : kP256CompressedPointSize;
+}
+
+// A point in affine coordinates. The point at infinity has no affine form.
+struct P256AffinePoint {
+  FieldElement256 x;
+  FieldElement256 y;
+};
+
+// A scalar modulo the group order, as a plain integer.
+struct P256Scalar {
+  uint64_t limbs[4];
+};
+
+// Parses a compressed or uncompressed SEC1 point. Returns false if `encoded`
+// is not a point on the curve other than the point at infinity.
+bool P256DecodePoint(absl::string_view encoded, P256AffinePoint* point);
+
+// Writes the uncompressed SEC1 encoding of `point`, i.e.
+// `kP256UncompressedPointSize` bytes, to `out`.
+void P256EncodeUncompressedPoint(const P256AffinePoint& point, char* out);
+
+// Parses a `kP256XCoordinateSize`-byte big-endian x coordinate into the point
+// with that x coordinate and an even y. Multiplying either of the two points
+// with that x coordinate gives the same x coordinate. Returns false unless
+// `encoded` is the x coordinate of a point on the curve; checking that takes
+// the same exponentiation as computing y.
+bool P256DecodeXCoordinate(absl::string_view encoded, P256AffinePoint* point);
+
+// Writes the x coordinate `x` as `kP256XCoordinateSize` big-endian bytes to
+// `out`.
+void P256EncodeXCoordinate(const FieldElement256& x, char* out);
+
+// Parses a big-endian scalar of at most 32 bytes. Returns false unless it is
+// between 1 and the group order minus 1.
+bool P256DecodeScalar(absl::string_view bytes, P256Scalar* scalar);
+
+// Returns the inverse of `scalar` modulo the group order.
+P256Scalar P256InvertScalar(const P256Scalar& scalar);
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CRYPTO_P256_H_
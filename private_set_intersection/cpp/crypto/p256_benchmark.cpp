@@ -0,0 +1,181 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "openssl/bn.h"
+#include "openssl/ec.h"
+#include "openssl/obj_mac.h"
+#include "private_join_and_compute/crypto/ec_commutative_cipher.h"
+#include "private_set_intersection/cpp/crypto/batch_cipher.h"
+#include "private_set_intersection/cpp/crypto/hash_to_curve.h"
+#include "private_set_intersection/cpp/crypto/p256.h"
+
+namespace private_set_intersection {
+namespace {
+
+using ::private_join_and_compute::ECCommutativeCipher;
+
+// Number of points multiplied per iteration.
+constexpr int kNumPoints = 1000;
+
+// Returns `kNumPoints` encrypted elements, i.e. compressed points, and the
+// key of a second cipher to multiply them with.
+std::vector<std::string> EncryptedElements(std::string* key) {
+  auto cipher = ECCommutativeCipher::CreateWithNewKey(
+                    NID_X9_62_prime256v1, ECCommutativeCipher::HashType::SHA256)
+                    .value();
+  std::vector<std::string> elements(kNumPoints);
+  for (int i = 0; i < kNumPoints; i++) {
+    elements[i] = cipher->Encrypt(absl::StrCat("Element", i)).value();
+  }
+  *key = ECCommutativeCipher::CreateWithNewKey(
+             NID_X9_62_prime256v1, ECCommutativeCipher::HashType::SHA256)
+             .value()
+             ->GetPrivateKeyBytes();
+  return elements;
+}
+
+// The generic path: one variable-base, variable-scalar multiplication per
+// element, including the conversion from and to SEC1 bytes.
+void BM_CommutativeCipherReEncrypt(benchmark::State& state) {
+  std::string key;
+  const std::vector<std::string> elements = EncryptedElements(&key);
+  auto cipher = ECCommutativeCipher::CreateFromKey(
+                    NID_X9_62_prime256v1, key,
+                    ECCommutativeCipher::HashType::SHA256)
+                    .value();
+  for (auto _ : state) {
+    for (const std::string& element : elements) {
+      ::benchmark::DoNotOptimize(cipher->ReEncrypt(element));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPoints);
+}
+BENCHMARK(BM_CommutativeCipherReEncrypt);
+
+// Lifting x coordinates to points, which is what validating them costs.
+void BM_P256DecodeXCoordinate(benchmark::State& state) {
+  std::string key;
+  std::vector<std::string> elements = EncryptedElements(&key);
+  for (std::string& element : elements) {
+    element.erase(0, 1);
+  }
+  P256AffinePoint point;
+  for (auto _ : state) {
+    for (const std::string& element : elements) {
+      ::benchmark::DoNotOptimize(P256DecodeXCoordinate(element, &point));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPoints);
+}
+BENCHMARK(BM_P256DecodeXCoordinate);
+
+// Returns a copy of the P-256 group built from its explicit parameters. The
+// library cannot tell that it is P-256, so it multiplies with its generic
+// Montgomery arithmetic.
+EC_GROUP* NewExplicitGroup(const EC_GROUP* named, BN_CTX* ctx) {
+  BIGNUM* p = BN_new();
+  BIGNUM* a = BN_new();
+  BIGNUM* b = BN_new();
+  EC_GROUP_get_curve_GFp(named, p, a, b, ctx);
+  EC_GROUP* group = EC_GROUP_new_curve_GFp(p, a, b, ctx);
+  EC_POINT* generator = EC_POINT_new(group);
+  BIGNUM* x = BN_new();
+  BIGNUM* y = BN_new();
+  EC_POINT_get_affine_coordinates(named, EC_GROUP_get0_generator(named), x, y,
+                                  ctx);
+  EC_POINT_set_affine_coordinates(group, generator, x, y, ctx);
+  EC_GROUP_set_generator(group, generator, EC_GROUP_get0_order(named),
+                         BN_value_one());
+  for (BIGNUM* bn : {p, a, b, x, y}) {
+    BN_free(bn);
+  }
+  EC_POINT_free(generator);
+  return group;
+}
+
+// A single `EC_POINT_mul` with a variable base, in the library's built-in
+// P-256 group and in a copy of it with explicit parameters. The gap between
+// the two shows whether the built-in group takes the specialized P-256 code,
+// such as BoringSSL's nistz256 assembly.
+void BM_LibraryGroupMultiply(benchmark::State& state,
+                             bool explicit_parameters) {
+  BN_CTX* ctx = BN_CTX_new();
+  EC_GROUP* named = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+  EC_GROUP* group = explicit_parameters ? NewExplicitGroup(named, ctx) : named;
+  BIGNUM* scalar = BN_new();
+  BN_rand_range(scalar, EC_GROUP_get0_order(group));
+  EC_POINT* point = EC_POINT_new(group);
+  EC_POINT_mul(group, point, scalar, nullptr, nullptr, ctx);
+  EC_POINT* product = EC_POINT_new(group);
+  for (auto _ : state) {
+    EC_POINT_mul(group, product, nullptr, point, scalar, ctx);
+    ::benchmark::DoNotOptimize(product);
+  }
+  state.SetItemsProcessed(state.iterations());
+  EC_POINT_free(product);
+  EC_POINT_free(point);
+  BN_free(scalar);
+  if (group != named) {
+    EC_GROUP_free(group);
+  }
+  EC_GROUP_free(named);
+  BN_CTX_free(ctx);
+}
+BENCHMARK_CAPTURE(BM_LibraryGroupMultiply, built-in group, false);
+BENCHMARK_CAPTURE(BM_LibraryGroupMultiply, explicit parameters, true);
+
+enum class Operation { kEncrypt, kReEncrypt, kDecrypt };
+
+// The operations of `BatchCipher`, per point.
+void BM_BatchCipher(benchmark::State& state, Operation operation) {
+  std::string key;
+  const std::vector<std::string> elements = EncryptedElements(&key);
+  const std::vector<absl::string_view> views(elements.begin(),
+                                             elements.end());
+  std::vector<std::string> inputs(kNumPoints);
+  for (int i = 0; i < kNumPoints; i++) {
+    inputs[i] = absl::StrCat("Element", i);
+  }
+  auto hasher = P256HashToCurve::Create().value();
+  auto cipher = BatchCipher::CreateFromKey(key).value();
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    switch (operation) {
+      case Operation::kEncrypt:
+        ::benchmark::DoNotOptimize(cipher->Encrypt(*hasher, inputs, &out));
+        break;
+      case Operation::kReEncrypt:
+        ::benchmark::DoNotOptimize(cipher->ReEncrypt(views, &out));
+        break;
+      case Operation::kDecrypt:
+        ::benchmark::DoNotOptimize(cipher->Decrypt(views, &out));
+        break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPoints);
+}
+BENCHMARK_CAPTURE(BM_BatchCipher, encrypt, Operation::kEncrypt);
+BENCHMARK_CAPTURE(BM_BatchCipher, reencrypt, Operation::kReEncrypt);
+BENCHMARK_CAPTURE(BM_BatchCipher, decrypt, Operation::kDecrypt);
+
+}  // namespace
+}  // namespace private_set_intersection
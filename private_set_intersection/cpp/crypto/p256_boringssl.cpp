@@ -0,0 +1,106 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/p256_boringssl.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "absl/memory/memory.h"
+#include "openssl/obj_mac.h"
+
+namespace private_set_intersection {
+
+namespace {
+
+absl::Status CryptoError() {
+  return absl::InternalError("Crypto library operation failed");
+}
+
+}  // namespace
+
+BoringSslP256Multiplier::~BoringSslP256Multiplier() { BN_clear_free(scalar_); }
+
+StatusOr<std::unique_ptr<BoringSslP256Multiplier>>
+BoringSslP256Multiplier::Create(const P256Scalar& scalar) {
+  auto multiplier = absl::WrapUnique(new BoringSslP256Multiplier());
+  multiplier->group_ = SharedP256Group();
+  uint8_t bytes[32];
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) {
+      bytes[8 * (3 - i) + j] =
+          static_cast<uint8_t>(scalar.limbs[i] >> (56 - 8 * j));
+    }
+  }
+  multiplier->scalar_ = BN_bin2bn(bytes, sizeof(bytes), nullptr);
+  if (multiplier->group_ == nullptr || multiplier->scalar_ == nullptr) {
+    return CryptoError();
+  }
+  return multiplier;
+}
+
+absl::Status BoringSslP256Multiplier::Multiply(
+    absl::Span<const P256AffinePoint> points, P256PointFormat format,
+    std::string* out) const {
+  BN_CTX* ctx = BN_CTX_new();
+  EC_POINT* point = EC_POINT_new(group_);
+  EC_POINT* product = EC_POINT_new(group_);
+  const size_t initial_size = out->size();
+  const size_t point_size = P256PointSize(format);
+  out->resize(initial_size + points.size() * point_size);
+  char* result = &(*out)[initial_size];
+
+  absl::Status status;
+  if (ctx == nullptr || point == nullptr || product == nullptr) {
+    status = CryptoError();
+  }
+  char uncompressed[kP256UncompressedPointSize];
+  uint8_t compressed[kP256CompressedPointSize];
+  for (size_t i = 0; status.ok() && i < points.size(); i++) {
+    P256EncodeUncompressedPoint(points[i], uncompressed);
+    if (EC_POINT_oct2point(group_, point,
+                           reinterpret_cast<const uint8_t*>(uncompressed),
+                           sizeof(uncompressed), ctx) != 1 ||
+        EC_POINT_mul(group_, product, nullptr, point, scalar_, ctx) != 1 ||
+        EC_POINT_point2oct(group_, product, POINT_CONVERSION_COMPRESSED,
+                           compressed, sizeof(compressed),
+                           ctx) != sizeof(compressed)) {
+      status = CryptoError();
+      break;
+    }
+    // The x-only encoding is the compressed one without the prefix byte.
+    std::memcpy(result, compressed + sizeof(compressed) - point_size,
+                point_size);
+    result += point_size;
+  }
+
+  EC_POINT_free(product);
+  EC_POINT_free(point);
+  BN_CTX_free(ctx);
+  if (!status.ok()) {
+    out->resize(initial_size);
+  }
+  return status;
+}
+
+const EC_GROUP* SharedP256Group() {
+  // Leaked on purpose, since ciphers may use it until the process exits.
+  static const EC_GROUP* const group =
+      EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+  return group;
+}
+
+}  // namespace private_set_intersection
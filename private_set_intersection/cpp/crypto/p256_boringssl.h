@@ -0,0 +1,84 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CRYPTO_P256_BORINGSSL_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CRYPTO_P256_BORINGSSL_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/bn.h"
+#include "openssl/ec.h"
+#include "private_set_intersection/cpp/crypto/p256.h"
+
+namespace private_set_intersection {
+
+using absl::StatusOr;
+
+// Multiplies P-256 points by one scalar with the crypto library's built-in
+// P-256 group. In BoringSSL that group runs the nistz256 assembly on x86-64
+// and AArch64, and fiat-crypto's P-256 code elsewhere, instead of the generic
+// Montgomery arithmetic that a group with explicit parameters would use.
+//
+// Points are decoded by the caller, with a square root that is much cheaper
+// than the library's, and handed to the library uncompressed. Every result is
+// converted to affine coordinates by the library on its own.
+//
+// All scratch state is allocated per call, so a single instance can be shared
+// between threads.
+class BoringSslP256Multiplier {
+ public:
+  BoringSslP256Multiplier(const BoringSslP256Multiplier&) = delete;
+  BoringSslP256Multiplier& operator=(const BoringSslP256Multiplier&) = delete;
+  ~BoringSslP256Multiplier();
+
+  // Creates a multiplier for `scalar`.
+  //
+  // Returns INTERNAL if the group cannot be set up.
+  static StatusOr<std::unique_ptr<BoringSslP256Multiplier>> Create(
+      const P256Scalar& scalar);
+
+  // Multiplies each of `points` by the scalar and appends the results,
+  // encoded in `format`, to `out`. On error, `out` is left as it was.
+  //
+  // Returns INTERNAL if a crypto library operation fails.
+  absl::Status Multiply(absl::Span<const P256AffinePoint> points,
+                        P256PointFormat format, std::string* out) const;
+
+ private:
+  BoringSslP256Multiplier() = default;
+
+  // See `SharedP256Group`.
+  const EC_GROUP* group_ = nullptr;
+  BIGNUM* scalar_ = nullptr;
+};
+
+// Returns the crypto library's built-in P-256 group, created on first use and
+// shared by all multipliers and hashers in the process, so that a new key
+// does not pay for setting up the curve again; depending on the library, that
+// takes tens of microseconds. The group is never modified after it is created,
+// so threads can use it concurrently. It must not be freed.
+//
+// Returns null if the library cannot create the group.
+const EC_GROUP* SharedP256Group();
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CRYPTO_P256_BORINGSSL_H_
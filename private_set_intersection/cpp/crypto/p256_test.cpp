@@ -0,0 +1,149 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/p256.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace private_set_intersection {
+namespace {
+
+// The generator of the group, and its y coordinate.
+constexpr char kGeneratorHex[] =
+    "036b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296";
+constexpr char kGeneratorYHex[] =
+    "4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5";
+
+// Returns the bytes encoded by the hex string `hex`.
+std::string FromHex(absl::string_view hex) {
+  std::string bytes(hex.size() / 2, '\0');
+  for (size_t i = 0; i < bytes.size(); i++) {
+    auto digit = [](char c) { return c <= '9' ? c - '0' : c - 'a' + 10; };
+    bytes[i] =
+        static_cast<char>(digit(hex[2 * i]) * 16 + digit(hex[2 * i + 1]));
+  }
+  return bytes;
+}
+
+// Returns the hex-encoded compressed encoding of `point`.
+std::string EncodeHex(const P256AffinePoint& point) {
+  std::string uncompressed(kP256UncompressedPointSize, '\0');
+  P256EncodeUncompressedPoint(point, &uncompressed[0]);
+  // The prefix holds the parity of y, whose last byte ends the encoding.
+  const bool odd = (uncompressed.back() & 1) != 0;
+  return absl::BytesToHexString(
+      absl::StrCat(odd ? "\x03" : "\x02", uncompressed.substr(1, 32)));
+}
+
+P256AffinePoint Generator() {
+  P256AffinePoint generator;
+  EXPECT_TRUE(P256DecodePoint(FromHex(kGeneratorHex), &generator));
+  return generator;
+}
+
+P256Scalar Scalar(absl::string_view hex) {
+  P256Scalar scalar;
+  EXPECT_TRUE(P256DecodeScalar(FromHex(hex), &scalar));
+  return scalar;
+}
+
+TEST(P256Test, TestDecodeAndEncode) {
+  const P256AffinePoint compressed = Generator();
+  EXPECT_EQ(EncodeHex(compressed), kGeneratorHex);
+
+  P256AffinePoint uncompressed;
+  ASSERT_TRUE(P256DecodePoint(
+      FromHex(std::string("04") + (kGeneratorHex + 2) + kGeneratorYHex),
+      &uncompressed));
+  EXPECT_EQ(EncodeHex(uncompressed), kGeneratorHex);
+
+  // The other point with the same x coordinate.
+  P256AffinePoint negated;
+  ASSERT_TRUE(P256DecodePoint(FromHex(std::string("02") + (kGeneratorHex + 2)),
+                              &negated));
+  EXPECT_EQ(EncodeHex(negated), std::string("02") + (kGeneratorHex + 2));
+}
+
+TEST(P256Test, TestDecodeXCoordinate) {
+  // The point with an even y, which is the negated generator.
+  P256AffinePoint point;
+  ASSERT_TRUE(P256DecodeXCoordinate(FromHex(kGeneratorHex + 2), &point));
+  EXPECT_EQ(EncodeHex(point), std::string("02") + (kGeneratorHex + 2));
+
+  // Wrong size, x not below p, and x with no point on the curve.
+  for (const std::string& hex :
+       {std::string(kGeneratorHex), std::string(64, 'f'),
+        std::string(63, '0') + "1"}) {
+    EXPECT_FALSE(P256DecodeXCoordinate(FromHex(hex), &point)) << hex;
+  }
+}
+
+TEST(P256Test, TestInvertScalar) {
+  // Pairs of scalars and their inverses modulo the group order.
+  const std::vector<std::pair<std::string, std::string>> pairs = {
+      {"01", "01"},
+      {"02",
+       "7fffffff800000007fffffffffffffffde737d56d38bcf4279dce5617e3192a9"},
+      {"ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632550",
+       "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632550"},
+  };
+  for (const auto& pair : pairs) {
+    const P256Scalar inverse = P256InvertScalar(Scalar(pair.first));
+    const P256Scalar expected = Scalar(pair.second);
+    EXPECT_TRUE(std::equal(inverse.limbs, inverse.limbs + 4, expected.limbs))
+        << pair.first;
+  }
+
+  // Inverting twice gives the scalar back.
+  const P256Scalar scalar = Scalar(
+      "c9afa9d845ba75166b5c215767b1d6934e50c3db36e89b127b8a622b120f6721");
+  const P256Scalar twice = P256InvertScalar(P256InvertScalar(scalar));
+  EXPECT_TRUE(std::equal(twice.limbs, twice.limbs + 4, scalar.limbs));
+}
+
+TEST(P256Test, FailIfInvalid) {
+  P256AffinePoint point;
+  const std::string x = kGeneratorHex + 2;
+  // Wrong prefix or size, the point at infinity, x not below p, and x with
+  // no point on the curve.
+  for (const std::string& hex :
+       {std::string("05") + x, std::string("03") + x.substr(2),
+        std::string("00"), std::string("02") + std::string(64, 'f'),
+        std::string("02") + std::string(63, '0') + "1",
+        std::string("04") + x + std::string(64, '1')}) {
+    EXPECT_FALSE(P256DecodePoint(FromHex(hex), &point)) << hex;
+  }
+
+  P256Scalar scalar;
+  EXPECT_FALSE(P256DecodeScalar("", &scalar));
+  EXPECT_FALSE(P256DecodeScalar(std::string(32, '\0'), &scalar));
+  EXPECT_FALSE(P256DecodeScalar(std::string(33, '\1'), &scalar));
+  EXPECT_FALSE(P256DecodeScalar(
+      FromHex("ffffffff00000000ffffffffffffffff"
+              "bce6faada7179e84f3b9cac2fc632551"),
+      &scalar));
+  EXPECT_TRUE(P256DecodeScalar(std::string(32, '\1'), &scalar));
+}
+
+}  // namespace
+}  // namespace private_set_intersection
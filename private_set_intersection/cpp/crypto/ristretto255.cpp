@@ -0,0 +1,606 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/ristretto255.h"
+
+#include <cstring>
+
+#include "private_set_intersection/cpp/crypto/montgomery_field.h"
+
+namespace private_set_intersection {
+
+namespace {
+
+// Arithmetic modulo p = 2^255 - 19 in radix 2^51. Since 2^255 = 19 mod p,
+// the high half of a product folds back into the low half with a
+// multiplication by 19, and the spare bits of every limb absorb carries, so
+// that they are only propagated once per operation. Every operation returns
+// limbs below 2^52, which is what `Mul` and `Sub` accept; only
+// `Canonicalize` fully reduces.
+//
+// All operations run in time independent of the elements they are given.
+class Field {
+ public:
+  using Element = FieldElement25519;
+
+  static Element Zero() { return Element{{0, 0, 0, 0, 0}}; }
+
+  static Element One() { return Element{{1, 0, 0, 0, 0}}; }
+
+  static Element Add(const Element& a, const Element& b) {
+    return Carry(Element{{a.limbs[0] + b.limbs[0], a.limbs[1] + b.limbs[1],
+                          a.limbs[2] + b.limbs[2], a.limbs[3] + b.limbs[3],
+                          a.limbs[4] + b.limbs[4]}});
+  }
+
+  // Adds 4p before subtracting, so that no limb can underflow.
+  static Element Sub(const Element& a, const Element& b) {
+    return Carry(Element{{(a.limbs[0] + 0x1fffffffffffb4) - b.limbs[0],
+                          (a.limbs[1] + 0x1ffffffffffffc) - b.limbs[1],
+                          (a.limbs[2] + 0x1ffffffffffffc) - b.limbs[2],
+                          (a.limbs[3] + 0x1ffffffffffffc) - b.limbs[3],
+                          (a.limbs[4] + 0x1ffffffffffffc) - b.limbs[4]}});
+  }
+
+  static Element Neg(const Element& a) { return Sub(Zero(), a); }
+
+  static Element Mul(const Element& a, const Element& b) {
+    const uint64_t b1_19 = 19 * b.limbs[1];
+    const uint64_t b2_19 = 19 * b.limbs[2];
+    const uint64_t b3_19 = 19 * b.limbs[3];
+    const uint64_t b4_19 = 19 * b.limbs[4];
+    const uint64_t* x = a.limbs;
+    const uint64_t* y = b.limbs;
+    uint128 c[5];
+    c[0] = M(x[0], y[0]) + M(x[4], b1_19) + M(x[3], b2_19) + M(x[2], b3_19) +
+           M(x[1], b4_19);
+    c[1] = M(x[1], y[0]) + M(x[0], y[1]) + M(x[4], b2_19) + M(x[3], b3_19) +
+           M(x[2], b4_19);
+    c[2] = M(x[2], y[0]) + M(x[1], y[1]) + M(x[0], y[2]) + M(x[4], b3_19) +
+           M(x[3], b4_19);
+    c[3] = M(x[3], y[0]) + M(x[2], y[1]) + M(x[1], y[2]) + M(x[0], y[3]) +
+           M(x[4], b4_19);
+    c[4] = M(x[4], y[0]) + M(x[3], y[1]) + M(x[2], y[2]) + M(x[1], y[3]) +
+           M(x[0], y[4]);
+    return CarryWide(c);
+  }
+
+  // As `Mul(a, a)`, sharing the products that appear twice.
+  static Element Sqr(const Element& a) {
+    const uint64_t* x = a.limbs;
+    const uint64_t x0_2 = 2 * x[0];
+    const uint64_t x1_2 = 2 * x[1];
+    const uint64_t x2_2 = 2 * x[2];
+    const uint64_t x3_19 = 19 * x[3];
+    const uint64_t x4_19 = 19 * x[4];
+    uint128 c[5];
+    c[0] = M(x[0], x[0]) + M(x1_2, x4_19) + M(x2_2, x3_19);
+    c[1] = M(x0_2, x[1]) + M(x2_2, x4_19) + M(x[3], x3_19);
+    c[2] = M(x0_2, x[2]) + M(x[1], x[1]) + M(2 * x[3], x4_19);
+    c[3] = M(x0_2, x[3]) + M(x1_2, x[2]) + M(x[4], x4_19);
+    c[4] = M(x0_2, x[4]) + M(x1_2, x[3]) + M(x[2], x[2]);
+    return CarryWide(c);
+  }
+
+  // Returns a^(2^n), i.e. squares n times.
+  static Element SqrN(Element a, int n) {
+    for (int i = 0; i < n; i++) {
+      a = Sqr(a);
+    }
+    return a;
+  }
+
+  // Returns a^((p - 5) / 8) = a^(2^252 - 3), the exponentiation of the square
+  // root in `SqrtRatioM1`, with the addition chain of ref10: 251 squarings
+  // and 11 multiplications.
+  static Element Pow22523(const Element& a) {
+    const Element a2 = Sqr(a);
+    const Element a9 = Mul(SqrN(a2, 2), a);
+    const Element a11 = Mul(a9, a2);
+    const Element e5 = Mul(Sqr(a11), a9);  // 2^5 - 1
+    const Element e10 = Mul(SqrN(e5, 5), e5);
+    const Element e20 = Mul(SqrN(e10, 10), e10);
+    const Element e40 = Mul(SqrN(e20, 20), e20);
+    const Element e50 = Mul(SqrN(e40, 10), e10);
+    const Element e100 = Mul(SqrN(e50, 50), e50);
+    const Element e200 = Mul(SqrN(e100, 100), e100);
+    const Element e250 = Mul(SqrN(e200, 50), e50);
+    return Mul(SqrN(e250, 2), a);
+  }
+
+  // Returns the representation of `a` below p, with limbs of 51 bits.
+  static Element Canonicalize(const Element& a) {
+    // After two rounds of carries the value is below 2^255 + 19 < 2p, so it
+    // is reduced by subtracting p once if a + 19 carries out of bit 255.
+    Element r = Carry(Carry(a));
+    uint64_t q = (r.limbs[0] + 19) >> 51;
+    q = (r.limbs[1] + q) >> 51;
+    q = (r.limbs[2] + q) >> 51;
+    q = (r.limbs[3] + q) >> 51;
+    q = (r.limbs[4] + q) >> 51;
+    r.limbs[0] += 19 * q;
+    r.limbs[1] += r.limbs[0] >> 51;
+    r.limbs[0] &= kMask;
+    r.limbs[2] += r.limbs[1] >> 51;
+    r.limbs[1] &= kMask;
+    r.limbs[3] += r.limbs[2] >> 51;
+    r.limbs[2] &= kMask;
+    r.limbs[4] += r.limbs[3] >> 51;
+    r.limbs[3] &= kMask;
+    // Drops the 2^255 of the subtracted p.
+    r.limbs[4] &= kMask;
+    return r;
+  }
+
+  // Parses 32 little-endian bytes, ignoring the top bit.
+  static Element FromBytes(const uint8_t* bytes) {
+    uint64_t words[4];
+    for (int i = 0; i < 4; i++) {
+      uint64_t word = 0;
+      for (int j = 7; j >= 0; j--) {
+        word = (word << 8) | bytes[8 * i + j];
+      }
+      words[i] = word;
+    }
+    return Element{{words[0] & kMask, (words[0] >> 51 | words[1] << 13) & kMask,
+                    (words[1] >> 38 | words[2] << 26) & kMask,
+                    (words[2] >> 25 | words[3] << 39) & kMask,
+                    (words[3] >> 12) & kMask}};
+  }
+
+  // Writes the value of `a` below p as 32 little-endian bytes.
+  static void ToBytes(const Element& a, uint8_t* bytes) {
+    const Element r = Canonicalize(a);
+    const uint64_t words[4] = {r.limbs[0] | r.limbs[1] << 51,
+                               r.limbs[1] >> 13 | r.limbs[2] << 38,
+                               r.limbs[2] >> 26 | r.limbs[3] << 25,
+                               r.limbs[3] >> 39 | r.limbs[4] << 12};
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 8; j++) {
+        bytes[8 * i + j] = static_cast<uint8_t>(words[i] >> (8 * j));
+      }
+    }
+  }
+
+  // Returns all ones if `a` is zero modulo p, and zero otherwise.
+  static uint64_t IsZero(const Element& a) {
+    const Element r = Canonicalize(a);
+    const uint64_t bits =
+        r.limbs[0] | r.limbs[1] | r.limbs[2] | r.limbs[3] | r.limbs[4];
+    return ((bits | (0 - bits)) >> 63) - 1;
+  }
+
+  // Returns all ones if `a` equals `b` modulo p, and zero otherwise.
+  static uint64_t Equal(const Element& a, const Element& b) {
+    return IsZero(Sub(a, b));
+  }
+
+  // Returns all ones if `a` is negative in the sense of RFC 9496, i.e. odd
+  // once reduced, and zero otherwise.
+  static uint64_t IsNegative(const Element& a) {
+    return 0 - (Canonicalize(a).limbs[0] & 1);
+  }
+
+  // Returns `a` if `mask` is all ones, and `b` if it is zero.
+  static Element Select(uint64_t mask, const Element& a, const Element& b) {
+    Element r;
+    for (int i = 0; i < 5; i++) {
+      r.limbs[i] = (a.limbs[i] & mask) | (b.limbs[i] & ~mask);
+    }
+    return r;
+  }
+
+ private:
+  using uint128 = unsigned __int128;
+
+  static constexpr uint64_t kMask = (uint64_t{1} << 51) - 1;
+
+  static uint128 M(uint64_t a, uint64_t b) {
+    return static_cast<uint128>(a) * b;
+  }
+
+  // Propagates the bits above 51 of each limb into the next one, and those of
+  // the top limb, times 19, into the lowest one. Limbs below 2^63 come out
+  // below 2^52.
+  static Element Carry(Element a) {
+    uint64_t* l = a.limbs;
+    l[1] += l[0] >> 51;
+    l[0] &= kMask;
+    l[2] += l[1] >> 51;
+    l[1] &= kMask;
+    l[3] += l[2] >> 51;
+    l[2] &= kMask;
+    l[4] += l[3] >> 51;
+    l[3] &= kMask;
+    l[0] += 19 * (l[4] >> 51);
+    l[4] &= kMask;
+    return a;
+  }
+
+  // Reduces the 102-bit column sums of a product to limbs below 2^52.
+  static Element CarryWide(uint128 c[5]) {
+    c[1] += static_cast<uint64_t>(c[0] >> 51);
+    c[2] += static_cast<uint64_t>(c[1] >> 51);
+    c[3] += static_cast<uint64_t>(c[2] >> 51);
+    c[4] += static_cast<uint64_t>(c[3] >> 51);
+    // The top carry is below 2^60, so 19 times it still fits the accumulator
+    // of the lowest limb.
+    const uint128 low =
+        (c[0] & kMask) + static_cast<uint128>(c[4] >> 51) * 19;
+    Element r;
+    r.limbs[0] = static_cast<uint64_t>(low) & kMask;
+    r.limbs[1] = (static_cast<uint64_t>(c[1]) & kMask) +
+                 static_cast<uint64_t>(low >> 51);
+    r.limbs[2] = static_cast<uint64_t>(c[2]) & kMask;
+    r.limbs[3] = static_cast<uint64_t>(c[3]) & kMask;
+    r.limbs[4] = static_cast<uint64_t>(c[4]) & kMask;
+    return r;
+  }
+};
+
+// The scalar field, i.e. integers modulo the group order l.
+struct Ristretto255OrderParams {
+  static constexpr uint64_t kModulus[4] = {
+      0x5812631a5cf5d3ed, 0x14def9dea2f79cd6, 0x0000000000000000,
+      0x1000000000000000};
+  static constexpr uint64_t kN0 = 0xd2b51da312547e1b;
+  static constexpr uint64_t kOne[4] = {0xd6ec31748d98951d, 0xc6ef5bf4737dcf70,
+                                       0xfffffffffffffffe, 0x0fffffffffffffff};
+  static constexpr uint64_t kR2[4] = {0xa40611e3449c0f01, 0xd00e1ba768859347,
+                                      0xceec73d217f5be65, 0x0399411b7c309a3d};
+};
+
+using Order = MontgomeryField<Ristretto255OrderParams>;
+using Element = FieldElement25519;
+
+// Constants of RFC 9496, section 4.1. d is the curve coefficient of
+// edwards25519, whose other coefficient a is -1.
+constexpr Element kCurveD = {{0x34dca135978a3, 0x1a8283b156ebd,
+                              0x5e7a26001c029, 0x739c663a03cbb,
+                              0x52036cee2b6ff}};
+constexpr Element kCurveD2 = {{0x69b9426b2f159, 0x35050762add7a,
+                               0x3cf44c0038052, 0x6738cc7407977,
+                               0x2406d9dc56dff}};
+constexpr Element kSqrtM1 = {{0x61b274a0ea0b0, 0x0d5a5fc8f189d,
+                              0x7ef5e9cbd0c60, 0x78595a6804c9e,
+                              0x2b8324804fc1d}};
+constexpr Element kSqrtAdMinusOne = {{0x7f6a0497b2e1b, 0x1836f0a97afd2,
+                                      0x7d747f6be7638, 0x456079e7e6498,
+                                      0x376931bf2b834}};
+constexpr Element kInvSqrtAMinusD = {{0x0fdaa805d40ea, 0x2eb482e57d339,
+                                      0x007610274bc58, 0x6510b613dc8ff,
+                                      0x786c8905cfaff}};
+constexpr Element kOneMinusDSquared = {{0x409c1945fc176, 0x719abc6a1fc4f,
+                                        0x1c37f90b20684, 0x06bccca55eedf,
+                                        0x029072a8b2b3e}};
+constexpr Element kDMinusOneSquared = {{0x55aaa44ed4d20, 0x59603c3332635,
+                                        0x26d3baf4a7928, 0x120a66e6997a9,
+                                        0x5968b37af66c2}};
+
+// Bits of the scalar consumed per addition in `Ristretto255BulkMultiplier`.
+// Digits are signed, so the table only holds the multiples 0 to
+// 2^(kWindowBits - 1) of the point, and negative digits negate the entry.
+constexpr int kWindowBits = 5;
+constexpr int kMaxDigit = 1 << (kWindowBits - 1);
+constexpr int kTableSize = kMaxDigit + 1;
+
+// A point prepared for additions, i.e. (y + x, y - x, 2z, 2dt). Negating it
+// swaps the first two coordinates and negates the last one.
+struct CachedPoint {
+  Element y_plus_x;
+  Element y_minus_x;
+  Element z2;
+  Element t2d;
+};
+
+Ristretto255Point Identity() {
+  return Ristretto255Point{Field::Zero(), Field::One(), Field::One(),
+                           Field::Zero()};
+}
+
+// Returns all ones if `a` and `b` are equal, and zero otherwise.
+uint64_t EqualMask(uint64_t a, uint64_t b) {
+  const uint64_t diff = a ^ b;
+  return ((diff | (0 - diff)) >> 63) - 1;
+}
+
+Element Abs(const Element& a) {
+  return Field::Select(Field::IsNegative(a), Field::Neg(a), a);
+}
+
+// Sets `r` to sqrt(u / v) if that exists, and to sqrt(i * u / v) otherwise,
+// choosing the non-negative root. Returns all ones in the first case, and zero
+// in the second one. See RFC 9496, section 4.2.
+uint64_t SqrtRatioM1(const Element& u, const Element& v, Element* r) {
+  const Element v3 = Field::Mul(Field::Sqr(v), v);
+  const Element v7 = Field::Mul(Field::Sqr(v3), v);
+  Element root =
+      Field::Mul(Field::Mul(u, v3), Field::Pow22523(Field::Mul(u, v7)));
+  const Element check = Field::Mul(v, Field::Sqr(root));
+  const Element minus_u = Field::Neg(u);
+  const uint64_t correct_sign = Field::Equal(check, u);
+  const uint64_t flipped_sign = Field::Equal(check, minus_u);
+  const uint64_t flipped_sign_i =
+      Field::Equal(check, Field::Mul(minus_u, kSqrtM1));
+  root = Field::Select(flipped_sign | flipped_sign_i,
+                       Field::Mul(root, kSqrtM1), root);
+  *r = Abs(root);
+  return correct_sign | flipped_sign;
+}
+
+// Returns 2 * `p`, with the doubling formula of Hisil, Wong, Carter and
+// Dawson for a = -1. The formula does not read t, so a result that is only
+// doubled again can skip it with `with_t` = false.
+Ristretto255Point Double(const Ristretto255Point& p, bool with_t = true) {
+  const Element xx = Field::Sqr(p.x);
+  const Element yy = Field::Sqr(p.y);
+  Element zz2 = Field::Sqr(p.z);
+  zz2 = Field::Add(zz2, zz2);
+  const Element e = Field::Sub(Field::Sqr(Field::Add(p.x, p.y)),
+                               Field::Add(xx, yy));
+  const Element g = Field::Sub(yy, xx);
+  const Element h = Field::Add(yy, xx);
+  const Element f = Field::Sub(zz2, g);
+  return Ristretto255Point{Field::Mul(e, f), Field::Mul(h, g),
+                           Field::Mul(g, f),
+                           with_t ? Field::Mul(e, h) : Field::Zero()};
+}
+
+// Returns `p` + `q`, with the unified addition formula of Hisil, Wong, Carter
+// and Dawson for a = -1. The formula is complete, so any two points can be
+// added, including equal ones and the identity.
+Ristretto255Point Add(const Ristretto255Point& p, const CachedPoint& q) {
+  const Element a = Field::Mul(Field::Sub(p.y, p.x), q.y_minus_x);
+  const Element b = Field::Mul(Field::Add(p.y, p.x), q.y_plus_x);
+  const Element c = Field::Mul(p.t, q.t2d);
+  const Element d = Field::Mul(p.z, q.z2);
+  const Element e = Field::Sub(b, a);
+  const Element f = Field::Sub(d, c);
+  const Element g = Field::Add(d, c);
+  const Element h = Field::Add(b, a);
+  return Ristretto255Point{Field::Mul(e, f), Field::Mul(g, h),
+                           Field::Mul(f, g), Field::Mul(e, h)};
+}
+
+CachedPoint ToCached(const Ristretto255Point& p) {
+  return CachedPoint{Field::Add(p.y, p.x), Field::Sub(p.y, p.x),
+                     Field::Add(p.z, p.z), Field::Mul(p.t, kCurveD2)};
+}
+
+// Returns `a` if `mask` is all ones, and `b` if it is zero.
+CachedPoint SelectCached(uint64_t mask, const CachedPoint& a,
+                         const CachedPoint& b) {
+  return CachedPoint{Field::Select(mask, a.y_plus_x, b.y_plus_x),
+                     Field::Select(mask, a.y_minus_x, b.y_minus_x),
+                     Field::Select(mask, a.z2, b.z2),
+                     Field::Select(mask, a.t2d, b.t2d)};
+}
+
+// Returns `table`[`index`], reading every entry so that the access pattern
+// does not depend on `index`.
+CachedPoint Lookup(const CachedPoint* table, uint64_t index) {
+  CachedPoint result = table[0];
+  for (uint64_t i = 1; i < kTableSize; i++) {
+    result = SelectCached(EqualMask(i, index), table[i], result);
+  }
+  return result;
+}
+
+// Returns the `kWindowBits` bits of the plain integer `value` starting at bit
+// `bit`.
+uint64_t ScalarWindow(const uint64_t value[4], int bit) {
+  const int limb = bit / 64;
+  const int shift = bit % 64;
+  uint64_t window = value[limb] >> shift;
+  if (shift > 64 - kWindowBits && limb < 3) {
+    window |= value[limb + 1] << (64 - shift);
+  }
+  return window & ((uint64_t{1} << kWindowBits) - 1);
+}
+
+// Maps the field element `t` to a point, see MAP in RFC 9496, section 4.3.4.
+Ristretto255Point Map(const Element& t) {
+  const Element one = Field::One();
+  const Element r = Field::Mul(kSqrtM1, Field::Sqr(t));
+  const Element u = Field::Mul(Field::Add(r, one), kOneMinusDSquared);
+  const Element v = Field::Mul(
+      Field::Sub(Field::Neg(one), Field::Mul(r, kCurveD)),
+      Field::Add(r, kCurveD));
+  Element s;
+  const uint64_t was_square = SqrtRatioM1(u, v, &s);
+  const Element s_prime = Field::Neg(Abs(Field::Mul(s, t)));
+  s = Field::Select(was_square, s, s_prime);
+  const Element c = Field::Select(was_square, Field::Neg(one), r);
+  const Element n = Field::Sub(
+      Field::Mul(Field::Mul(c, Field::Sub(r, one)), kDMinusOneSquared), v);
+
+  Element w0 = Field::Mul(s, v);
+  w0 = Field::Add(w0, w0);
+  const Element w1 = Field::Mul(n, kSqrtAdMinusOne);
+  const Element ss = Field::Sqr(s);
+  const Element w2 = Field::Sub(one, ss);
+  const Element w3 = Field::Add(one, ss);
+  return Ristretto255Point{Field::Mul(w0, w3), Field::Mul(w2, w1),
+                           Field::Mul(w1, w3), Field::Mul(w0, w2)};
+}
+
+}  // namespace
+
+bool Ristretto255DecodePoint(absl::string_view encoded,
+                             Ristretto255Point* point) {
+  if (encoded.size() != kRistretto255PointSize) {
+    return false;
+  }
+  // Only the canonical encoding is accepted, i.e. the top bit must be clear
+  // and the value below p, which is the case if it encodes back to itself.
+  const auto* bytes = reinterpret_cast<const uint8_t*>(encoded.data());
+  const Element s = Field::FromBytes(bytes);
+  uint8_t canonical[32];
+  Field::ToBytes(s, canonical);
+  if (std::memcmp(canonical, bytes, sizeof(canonical)) != 0 ||
+      Field::IsNegative(s) || Field::IsZero(s)) {
+    return false;
+  }
+  const Element one = Field::One();
+  const Element ss = Field::Sqr(s);
+  const Element u1 = Field::Sub(one, ss);
+  const Element u2 = Field::Add(one, ss);
+  const Element u2_sqr = Field::Sqr(u2);
+  // v = -(d * u1^2) - u2^2
+  const Element v = Field::Sub(
+      Field::Neg(Field::Mul(kCurveD, Field::Sqr(u1))), u2_sqr);
+  Element invsqrt;
+  const uint64_t was_square =
+      SqrtRatioM1(one, Field::Mul(v, u2_sqr), &invsqrt);
+  const Element den_x = Field::Mul(invsqrt, u2);
+  const Element den_y = Field::Mul(Field::Mul(invsqrt, den_x), v);
+  const Element two_s = Field::Add(s, s);
+  point->x = Abs(Field::Mul(two_s, den_x));
+  point->y = Field::Mul(u1, den_y);
+  point->z = one;
+  point->t = Field::Mul(point->x, point->y);
+  return was_square != 0 && Field::IsNegative(point->t) == 0 &&
+         Field::IsZero(point->y) == 0;
+}
+
+void Ristretto255EncodePoint(const Ristretto255Point& point, char* out) {
+  const Element u1 =
+      Field::Mul(Field::Add(point.z, point.y), Field::Sub(point.z, point.y));
+  const Element u2 = Field::Mul(point.x, point.y);
+  Element invsqrt;
+  SqrtRatioM1(Field::One(), Field::Mul(u1, Field::Sqr(u2)), &invsqrt);
+  const Element den1 = Field::Mul(invsqrt, u1);
+  const Element den2 = Field::Mul(invsqrt, u2);
+  const Element z_inv = Field::Mul(Field::Mul(den1, den2), point.t);
+
+  // Rotate by the 4-torsion point (sqrt(-1), 0) if t / z is negative, so that
+  // all representatives of the element agree on the sign.
+  const uint64_t rotate = Field::IsNegative(Field::Mul(point.t, z_inv));
+  const Element x =
+      Field::Select(rotate, Field::Mul(point.y, kSqrtM1), point.x);
+  Element y = Field::Select(rotate, Field::Mul(point.x, kSqrtM1), point.y);
+  const Element den_inv =
+      Field::Select(rotate, Field::Mul(den1, kInvSqrtAMinusD), den2);
+  y = Field::Select(Field::IsNegative(Field::Mul(x, z_inv)), Field::Neg(y),
+                    y);
+  const Element s = Abs(Field::Mul(den_inv, Field::Sub(point.z, y)));
+
+  Field::ToBytes(s, reinterpret_cast<uint8_t*>(out));
+}
+
+void Ristretto255FromUniformBytes(const uint8_t* bytes,
+                                  Ristretto255Point* point) {
+  // The top bit of each half is ignored, as the RFC requires.
+  const Ristretto255Point p1 = Map(Field::FromBytes(bytes));
+  const Ristretto255Point p2 = Map(Field::FromBytes(bytes + 32));
+  *point = Add(p1, ToCached(p2));
+}
+
+bool Ristretto255DecodeScalar(absl::string_view bytes,
+                              Ristretto255Scalar* scalar) {
+  if (bytes.size() > 32) {
+    return false;
+  }
+  uint8_t padded[32] = {0};
+  std::memcpy(padded + 32 - bytes.size(), bytes.data(), bytes.size());
+  // `FromBytes` checks that the scalar is below the order; the Montgomery
+  // form is not needed.
+  FieldElement256 montgomery;
+  if (!Order::FromBytes(padded, &montgomery) || Order::IsZero(montgomery)) {
+    return false;
+  }
+  *scalar = Ristretto255Scalar{};
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) {
+      scalar->limbs[i] = (scalar->limbs[i] << 8) | padded[8 * (3 - i) + j];
+    }
+  }
+  return true;
+}
+
+void Ristretto255EncodeScalar(const Ristretto255Scalar& scalar, char* out) {
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) {
+      out[8 * (3 - i) + j] = static_cast<char>(scalar.limbs[i] >> (56 - 8 * j));
+    }
+  }
+}
+
+Ristretto255Scalar Ristretto255InvertScalar(const Ristretto255Scalar& scalar) {
+  const FieldElement256 value = Order::ToMontgomery(
+      FieldElement256{{scalar.limbs[0], scalar.limbs[1], scalar.limbs[2],
+                       scalar.limbs[3]}});
+  const FieldElement256 inverse = Order::FromMontgomery(Order::Inverse(value));
+  return Ristretto255Scalar{{inverse.limbs[0], inverse.limbs[1],
+                             inverse.limbs[2], inverse.limbs[3]}};
+}
+
+Ristretto255BulkMultiplier::Ristretto255BulkMultiplier(
+    const Ristretto255Scalar& scalar) {
+  // Map each window w to w - 2^kWindowBits when it exceeds kMaxDigit, and
+  // carry one into the next window. The top window holds at most the three
+  // bits 250 to 252 plus the carry, so it never carries out.
+  uint64_t carry = 0;
+  for (int i = 0; i < kNumWindows; i++) {
+    const uint64_t window = ScalarWindow(scalar.limbs, i * kWindowBits) + carry;
+    carry = (window + kMaxDigit - 1) >> kWindowBits;
+    digits_[i] = static_cast<int8_t>(
+        static_cast<int64_t>(window) -
+        static_cast<int64_t>(carry << kWindowBits));
+  }
+}
+
+void Ristretto255BulkMultiplier::Multiply(const Ristretto255Point& point,
+                                          Ristretto255Point* result) const {
+  // table[i] = i * point, prepared for additions.
+  CachedPoint table[kTableSize];
+  Ristretto255Point multiple = point;
+  table[0] = ToCached(Identity());
+  table[1] = ToCached(point);
+  for (int i = 2; i < kTableSize; i++) {
+    multiple = i == 2 ? Double(point) : Add(multiple, table[1]);
+    table[i] = ToCached(multiple);
+  }
+
+  // Signed windows from the most significant end. Unlike on P-256, the
+  // addition is complete, so the identity and equal points need no care.
+  Ristretto255Point acc = Identity();
+  for (int w = kNumWindows - 1; w >= 0; w--) {
+    if (w != kNumWindows - 1) {
+      for (int i = 0; i < kWindowBits; i++) {
+        acc = Double(acc, /*with_t=*/i == kWindowBits - 1);
+      }
+    }
+    const auto digit = static_cast<uint64_t>(int64_t{digits_[w]});
+    const uint64_t negative = 0 - (digit >> 63);
+    const uint64_t magnitude = (digit ^ negative) - negative;
+    const CachedPoint addend = Lookup(table, magnitude);
+    const CachedPoint negated = {addend.y_minus_x, addend.y_plus_x, addend.z2,
+                                 Field::Neg(addend.t2d)};
+    acc = Add(acc, SelectCached(negative, negated, addend));
+  }
+  *result = acc;
+}
+
+void Ristretto255BulkMultiplier::Multiply(
+    absl::Span<const Ristretto255Point> points,
+    absl::Span<Ristretto255Point> results) const {
+  for (size_t i = 0; i < points.size(); i++) {
+    Multiply(points[i], &results[i]);
+  }
+}
+
+}  // namespace private_set_intersection
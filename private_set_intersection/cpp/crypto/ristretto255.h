@@ -0,0 +1,116 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CRYPTO_RISTRETTO255_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CRYPTO_RISTRETTO255_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace private_set_intersection {
+
+// The ristretto255 group of RFC 9496, a prime-order group built on top of
+// edwards25519. Points are kept in extended twisted Edwards coordinates,
+// whose addition formulas are complete, so that no input needs special
+// handling.
+
+// Size of an encoded group element.
+inline constexpr size_t kRistretto255PointSize = 32;
+
+// Number of uniformly random bytes that `Ristretto255FromUniformBytes` maps to
+// a group element.
+inline constexpr size_t kRistretto255UniformBytesSize = 64;
+
+// An integer modulo 2^255 - 19 in radix 2^51, i.e. the sum of limbs[i] *
+// 2^(51 * i). Limbs may exceed 51 bits by a little, so that carries can be
+// deferred, and the same value has several representations.
+struct FieldElement25519 {
+  uint64_t limbs[5];
+};
+
+// A point in extended coordinates, i.e. (x / z, y / z) with x * y = z * t.
+// Every group element has several representatives; `Ristretto255EncodePoint`
+// maps all of them to the same bytes.
+struct Ristretto255Point {
+  FieldElement25519 x;
+  FieldElement25519 y;
+  FieldElement25519 z;
+  FieldElement25519 t;
+};
+
+// A scalar modulo the group order, a prime slightly above 2^252, as a plain
+// integer.
+struct Ristretto255Scalar {
+  uint64_t limbs[4];
+};
+
+// Parses the canonical encoding of a group element. Returns false if `encoded`
+// is not one, or if it is the identity.
+bool Ristretto255DecodePoint(absl::string_view encoded,
+                             Ristretto255Point* point);
+
+// Writes the canonical encoding of `point`, i.e. `kRistretto255PointSize`
+// bytes, to `out`. Costs one field exponentiation.
+void Ristretto255EncodePoint(const Ristretto255Point& point, char* out);
+
+// Maps `kRistretto255UniformBytesSize` uniformly random bytes to a group
+// element with the one-way map of RFC 9496, section 4.3.4.
+void Ristretto255FromUniformBytes(const uint8_t* bytes,
+                                  Ristretto255Point* point);
+
+// Parses a big-endian scalar of at most 32 bytes. Returns false unless it is
+// between 1 and the group order minus 1.
+bool Ristretto255DecodeScalar(absl::string_view bytes,
+                              Ristretto255Scalar* scalar);
+
+// Writes `scalar` as 32 big-endian bytes to `out`.
+void Ristretto255EncodeScalar(const Ristretto255Scalar& scalar, char* out);
+
+// Returns the inverse of `scalar` modulo the group order.
+Ristretto255Scalar Ristretto255InvertScalar(const Ristretto255Scalar& scalar);
+
+// Multiplies points by one fixed scalar. The scalar is recoded into signed
+// windows once, when the multiplier is created, so that a batch of points
+// only pays for the group operations. Multiplications run in time independent
+// of the scalar.
+class Ristretto255BulkMultiplier {
+ public:
+  explicit Ristretto255BulkMultiplier(const Ristretto255Scalar& scalar);
+
+  // Sets `result` to the scalar times `point`.
+  void Multiply(const Ristretto255Point& point,
+                Ristretto255Point* result) const;
+
+  // Sets each of `results`, which must have the same size as `points`, to
+  // the scalar times the corresponding point.
+  void Multiply(absl::Span<const Ristretto255Point> points,
+                absl::Span<Ristretto255Point> results) const;
+
+ private:
+  // Scalars are below 2^253, so windows of 5 bits cover them without a
+  // separate window for the final carry.
+  static constexpr int kNumWindows = 51;
+
+  // Signed digits in [-15, 16], least significant first.
+  int8_t digits_[kNumWindows];
+};
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CRYPTO_RISTRETTO255_H_
@@ -0,0 +1,148 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "private_set_intersection/cpp/crypto/curve_cipher.h"
+#include "private_set_intersection/cpp/crypto/hash_to_curve.h"
+#include "private_set_intersection/cpp/crypto/ristretto255.h"
+
+namespace private_set_intersection {
+namespace {
+
+// Number of points multiplied per iteration.
+constexpr int kNumPoints = 1000;
+
+std::vector<std::string> Inputs() {
+  std::vector<std::string> inputs(kNumPoints);
+  for (int i = 0; i < kNumPoints; i++) {
+    inputs[i] = absl::StrCat("Element", i);
+  }
+  return inputs;
+}
+
+// Returns `kNumPoints` hashed elements and a key to multiply them with.
+std::vector<Ristretto255Point> HashedPoints(Ristretto255Scalar* key) {
+  auto hasher = Ristretto255HashToGroup::Create().value();
+  std::vector<Ristretto255Point> points(kNumPoints);
+  const std::vector<std::string> inputs = Inputs();
+  for (int i = 0; i < kNumPoints; i++) {
+    hasher->Hash(inputs[i], &points[i]);
+  }
+  auto cipher = CurveCipher::CreateWithNewKey(
+                    psi_proto::CURVE_RISTRETTO255,
+                    psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP,
+                    psi_proto::POINT_ENCODING_COMPRESSED)
+                    .value();
+  Ristretto255DecodeScalar(cipher->GetPrivateKeyBytes(), key);
+  return points;
+}
+
+// Hashes inputs to the group with expand_message_xmd and the ristretto255
+// map, per input.
+void BM_Ristretto255HashToGroup(benchmark::State& state) {
+  auto hasher = Ristretto255HashToGroup::Create().value();
+  const std::vector<std::string> inputs = Inputs();
+  Ristretto255Point point;
+  for (auto _ : state) {
+    for (const std::string& input : inputs) {
+      hasher->Hash(input, &point);
+    }
+    ::benchmark::DoNotOptimize(point);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPoints);
+}
+BENCHMARK(BM_Ristretto255HashToGroup);
+
+// Multiplies points in extended coordinates with the scalar recoded once up
+// front, without decoding or encoding.
+void BM_Ristretto255BulkMultiplier(benchmark::State& state) {
+  Ristretto255Scalar key;
+  const std::vector<Ristretto255Point> points = HashedPoints(&key);
+  const Ristretto255BulkMultiplier multiplier(key);
+  std::vector<Ristretto255Point> results(points.size());
+  for (auto _ : state) {
+    multiplier.Multiply(points, absl::MakeSpan(results));
+    ::benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPoints);
+}
+BENCHMARK(BM_Ristretto255BulkMultiplier);
+
+// Decodes and encodes points, the per-element overhead of re-encryption on
+// top of the multiplication.
+void BM_Ristretto255DecodeAndEncode(benchmark::State& state) {
+  Ristretto255Scalar key;
+  const std::vector<Ristretto255Point> points = HashedPoints(&key);
+  std::string encoded(kNumPoints * kRistretto255PointSize, '\0');
+  for (int i = 0; i < kNumPoints; i++) {
+    Ristretto255EncodePoint(points[i], &encoded[i * kRistretto255PointSize]);
+  }
+  Ristretto255Point point;
+  for (auto _ : state) {
+    for (int i = 0; i < kNumPoints; i++) {
+      char* element = &encoded[i * kRistretto255PointSize];
+      Ristretto255DecodePoint(
+          absl::string_view(element, kRistretto255PointSize), &point);
+      Ristretto255EncodePoint(point, element);
+    }
+    ::benchmark::DoNotOptimize(encoded.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPoints);
+}
+BENCHMARK(BM_Ristretto255DecodeAndEncode);
+
+// The operations of `CurveCipher` on each curve, per element.
+void BM_CurveCipher(benchmark::State& state, psi_proto::Curve curve,
+                    psi_proto::HashToCurve hash_to_curve, bool reencrypt) {
+  auto cipher = CurveCipher::CreateWithNewKey(
+                    curve, hash_to_curve, psi_proto::POINT_ENCODING_COMPRESSED)
+                    .value();
+  const std::vector<std::string> inputs = Inputs();
+  std::string encrypted;
+  cipher->Encrypt(inputs, &encrypted).IgnoreError();
+  const size_t width = cipher->element_size();
+  std::vector<absl::string_view> views(kNumPoints);
+  for (int i = 0; i < kNumPoints; i++) {
+    views[i] = absl::string_view(encrypted).substr(i * width, width);
+  }
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    if (reencrypt) {
+      ::benchmark::DoNotOptimize(cipher->ReEncrypt(views, &out));
+    } else {
+      ::benchmark::DoNotOptimize(cipher->Encrypt(inputs, &out));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPoints);
+}
+BENCHMARK_CAPTURE(BM_CurveCipher, encrypt p256, psi_proto::CURVE_P256,
+                  psi_proto::HASH_TO_CURVE_P256_SSWU, false);
+BENCHMARK_CAPTURE(BM_CurveCipher, encrypt ristretto255,
+                  psi_proto::CURVE_RISTRETTO255,
+                  psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP, false);
+BENCHMARK_CAPTURE(BM_CurveCipher, reencrypt p256, psi_proto::CURVE_P256,
+                  psi_proto::HASH_TO_CURVE_P256_SSWU, true);
+BENCHMARK_CAPTURE(BM_CurveCipher, reencrypt ristretto255,
+                  psi_proto::CURVE_RISTRETTO255,
+                  psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP, true);
+
+}  // namespace
+}  // namespace private_set_intersection
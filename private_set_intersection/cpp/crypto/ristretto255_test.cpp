@@ -0,0 +1,182 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/ristretto255.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace private_set_intersection {
+namespace {
+
+// Multiples 1 to 8 of the generator, from RFC 9496, appendix A.1.
+const char* const kGeneratorMultiplesHex[] = {
+    "e2f2ae0a6abc4e71a884a961c500515f58e30b6aa582dd8db6a65945e08d2d76",
+    "6a493210f7499cd17fecb510ae0cea23a110e8d5b901f8acadd3095c73a3b919",
+    "94741f5d5d52755ece4f23f044ee27d5d1ea1e2bd196b462166b16152a9d0259",
+    "da80862773358b466ffadfe0b3293ab3d9fd53c5ea6c955358f568322daf6a57",
+    "e882b131016b52c1d3337080187cf768423efccbb517bb495ab812c4160ff44e",
+    "f64746d3c92b13050ed8d80236a7f0007c3b3f962f5ba793d19a601ebb1df403",
+    "44f53520926ec81fbd5a387845beb7df85a96a24ece18738bdcfa6a7822a176d",
+    "903293d8f2287ebe10e2374dc1a53e0bc887e592699f02d077d5263cdd55601c",
+};
+
+std::string EncodeHex(const Ristretto255Point& point) {
+  std::string encoded(kRistretto255PointSize, '\0');
+  Ristretto255EncodePoint(point, &encoded[0]);
+  return absl::BytesToHexString(encoded);
+}
+
+Ristretto255Point Generator() {
+  Ristretto255Point generator;
+  EXPECT_TRUE(Ristretto255DecodePoint(
+      absl::HexStringToBytes(kGeneratorMultiplesHex[0]), &generator));
+  return generator;
+}
+
+Ristretto255Scalar Scalar(absl::string_view hex) {
+  Ristretto255Scalar scalar;
+  EXPECT_TRUE(Ristretto255DecodeScalar(absl::HexStringToBytes(hex), &scalar));
+  return scalar;
+}
+
+TEST(Ristretto255Test, TestDecodeAndEncode) {
+  for (const char* hex : kGeneratorMultiplesHex) {
+    Ristretto255Point point;
+    ASSERT_TRUE(
+        Ristretto255DecodePoint(absl::HexStringToBytes(hex), &point));
+    EXPECT_EQ(EncodeHex(point), hex);
+  }
+}
+
+TEST(Ristretto255Test, TestGeneratorMultiples) {
+  const Ristretto255Point generator = Generator();
+  for (int i = 1; i <= 8; i++) {
+    Ristretto255Point result;
+    Ristretto255BulkMultiplier(Scalar(absl::StrCat("0", i)))
+        .Multiply(generator, &result);
+    EXPECT_EQ(EncodeHex(result), kGeneratorMultiplesHex[i - 1]) << i;
+  }
+}
+
+TEST(Ristretto255Test, TestMultiplyMatchesReference) {
+  // Computed with a straightforward implementation of RFC 9496.
+  const Ristretto255Scalar scalar = Scalar(
+      "00cf1f5d9d8c3c6a5e6d4f5b6a7980123456789abcdef0fedcba9876543210fe");
+  Ristretto255Point result;
+  Ristretto255BulkMultiplier(scalar).Multiply(Generator(), &result);
+  EXPECT_EQ(EncodeHex(result),
+            "5ecb548ce8fbdf3570cf7becb054bda99f26a1c96196e2cc181d1b4020a47e45");
+
+  // Scalars are written back in the same encoding.
+  std::string encoded(32, '\0');
+  Ristretto255EncodeScalar(scalar, &encoded[0]);
+  EXPECT_EQ(absl::BytesToHexString(encoded),
+            "00cf1f5d9d8c3c6a5e6d4f5b6a7980123456789abcdef0fedcba9876543210fe");
+}
+
+TEST(Ristretto255Test, TestFromUniformBytes) {
+  // Test vectors from RFC 9496, appendix A.3.
+  struct TestVector {
+    std::string input;
+    std::string output;
+  };
+  const std::vector<TestVector> vectors = {
+      {"5d1be09e3d0c82fc538112490e35701979d99e06ca3e2b5b54bffe8b4dc772c1"
+       "4d98b696a1bbfb5ca32c436cc61c16563790306c79eaca7705668b47dffe5bb6",
+       "3066f82a1a747d45120d1740f14358531a8f04bbffe6a819f86dfe50f44a0a46"},
+      {"f116b34b8f17ceb56e8732a60d913dd10cce47a6d53bee9204be8b44f6678b27"
+       "0102a56902e2488c46120e9276cfe54638286b9e4b3cdb470b542d46c2068d38",
+       "f26e5b6f7d362d2d2a94c5d0e7602cb4773c95a2e5c31a64f133189fa76ed61b"},
+      {"8422e1bbdaab52938b81fd602effb6f89110e1e57208ad12d9ad767e2e25510c"
+       "27140775f9337088b982d83d7fcf0b2fa1edffe51952cbe7365e95c86eaf325c",
+       "006ccd2a9e6867e6a2c5cea83d3302cc9de128dd2a9a57dd8ee7b9d7ffe02826"},
+  };
+  for (const auto& vector : vectors) {
+    const std::string input = absl::HexStringToBytes(vector.input);
+    Ristretto255Point point;
+    Ristretto255FromUniformBytes(reinterpret_cast<const uint8_t*>(input.data()),
+                                 &point);
+    EXPECT_EQ(EncodeHex(point), vector.output);
+  }
+}
+
+TEST(Ristretto255Test, TestBulkMultiplierMatchesSingleMultiplications) {
+  const Ristretto255Scalar scalar = Scalar(
+      "0a3c5e7f9b1d2f4e6a8c0b2d4f6e8a0c1e3f5a7b9d1c3e5f7a9b1d3c5e7f9a1b");
+  const Ristretto255BulkMultiplier multiplier(scalar);
+  std::vector<Ristretto255Point> points;
+  for (const char* hex : kGeneratorMultiplesHex) {
+    Ristretto255Point point;
+    ASSERT_TRUE(
+        Ristretto255DecodePoint(absl::HexStringToBytes(hex), &point));
+    points.push_back(point);
+  }
+  std::vector<Ristretto255Point> results(points.size());
+  multiplier.Multiply(points, absl::MakeSpan(results));
+  for (size_t i = 0; i < points.size(); i++) {
+    Ristretto255Point expected;
+    multiplier.Multiply(points[i], &expected);
+    EXPECT_EQ(EncodeHex(results[i]), EncodeHex(expected));
+  }
+}
+
+TEST(Ristretto255Test, TestInvertScalar) {
+  const Ristretto255Scalar scalar = Scalar(
+      "0a3c5e7f9b1d2f4e6a8c0b2d4f6e8a0c1e3f5a7b9d1c3e5f7a9b1d3c5e7f9a1b");
+  Ristretto255Point encrypted;
+  Ristretto255BulkMultiplier(scalar).Multiply(Generator(), &encrypted);
+  Ristretto255Point decrypted;
+  Ristretto255BulkMultiplier(Ristretto255InvertScalar(scalar))
+      .Multiply(encrypted, &decrypted);
+  EXPECT_EQ(EncodeHex(decrypted), kGeneratorMultiplesHex[0]);
+}
+
+TEST(Ristretto255Test, FailIfInvalid) {
+  // Bad encodings from RFC 9496, appendix A.2: non-canonical field elements,
+  // negative field elements and non-square x^2, plus the identity.
+  const char* const invalid[] = {
+      "00ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+      "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+      "edffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+      "0100000000000000000000000000000000000000000000000000000000000000",
+      "26948d35ca62e643e26a83177332e6b6afeb9d08e4268b650f1f5bbd8d81d371",
+      "0000000000000000000000000000000000000000000000000000000000000000",
+  };
+  Ristretto255Point point;
+  for (const char* hex : invalid) {
+    EXPECT_FALSE(Ristretto255DecodePoint(absl::HexStringToBytes(hex), &point))
+        << hex;
+  }
+  EXPECT_FALSE(Ristretto255DecodePoint(
+      absl::HexStringToBytes(kGeneratorMultiplesHex[0]).substr(1), &point));
+
+  Ristretto255Scalar scalar;
+  EXPECT_FALSE(Ristretto255DecodeScalar(std::string(32, '\0'), &scalar));
+  // The group order itself.
+  EXPECT_FALSE(Ristretto255DecodeScalar(
+      absl::HexStringToBytes("1000000000000000000000000000000014def9dea2f79cd6"
+                             "5812631a5cf5d3ed"),
+      &scalar));
+  EXPECT_FALSE(Ristretto255DecodeScalar(std::string(33, '\x01'), &scalar));
+}
+
+}  // namespace
+}  // namespace private_set_intersection
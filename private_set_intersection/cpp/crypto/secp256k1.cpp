@@ -0,0 +1,683 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/secp256k1.h"
+
+#include <cstring>
+
+namespace private_set_intersection {
+
+namespace {
+
+// Arithmetic modulo p = 2^256 - 2^32 - 977, on plain integers below p, with
+// the interface of `MontgomeryField`. Since 2^256 = c mod p for the small
+// c = 2^32 + 977, the high half of a product folds into the low half with
+// four multiplications by c, where Montgomery reduction takes sixteen
+// multiplications. All operations run in time independent of the elements
+// they are given; `Pow` only branches on the exponent, which must be public.
+class Field {
+ public:
+  using Element = FieldElement256;
+
+  static constexpr uint64_t kModulus[4] = {
+      0xfffffffefffffc2f, 0xffffffffffffffff, 0xffffffffffffffff,
+      0xffffffffffffffff};
+
+  static Element Zero() { return Element{{0, 0, 0, 0}}; }
+
+  static Element One() { return Element{{1, 0, 0, 0}}; }
+
+  static Element Add(const Element& a, const Element& b) {
+    uint64_t sum[4];
+    uint64_t carry = 0;
+    sum[0] = AddCarry(a.limbs[0], b.limbs[0], &carry);
+    sum[1] = AddCarry(a.limbs[1], b.limbs[1], &carry);
+    sum[2] = AddCarry(a.limbs[2], b.limbs[2], &carry);
+    sum[3] = AddCarry(a.limbs[3], b.limbs[3], &carry);
+    return ReduceOnce(sum, carry);
+  }
+
+  static Element Sub(const Element& a, const Element& b) {
+    uint64_t borrow = 0;
+    uint64_t diff[4];
+    diff[0] = SubBorrow(a.limbs[0], b.limbs[0], &borrow);
+    diff[1] = SubBorrow(a.limbs[1], b.limbs[1], &borrow);
+    diff[2] = SubBorrow(a.limbs[2], b.limbs[2], &borrow);
+    diff[3] = SubBorrow(a.limbs[3], b.limbs[3], &borrow);
+    // Adding p back if the subtraction wrapped around is subtracting c
+    // modulo 2^256.
+    const uint64_t c = kC & (0 - borrow);
+    borrow = 0;
+    return Element{{SubBorrow(diff[0], c, &borrow),
+                    SubBorrow(diff[1], 0, &borrow),
+                    SubBorrow(diff[2], 0, &borrow),
+                    SubBorrow(diff[3], 0, &borrow)}};
+  }
+
+  static Element Neg(const Element& a) { return Sub(Zero(), a); }
+
+  static Element Mul(const Element& a, const Element& b) {
+    uint64_t t[8];
+    uint64_t carry = 0;
+    t[0] = MulAdd(a.limbs[0], b.limbs[0], 0, &carry);
+    t[1] = MulAdd(a.limbs[0], b.limbs[1], 0, &carry);
+    t[2] = MulAdd(a.limbs[0], b.limbs[2], 0, &carry);
+    t[3] = MulAdd(a.limbs[0], b.limbs[3], 0, &carry);
+    t[4] = carry;
+    for (int i = 1; i < 4; i++) {
+      carry = 0;
+      t[i] = MulAdd(a.limbs[i], b.limbs[0], t[i], &carry);
+      t[i + 1] = MulAdd(a.limbs[i], b.limbs[1], t[i + 1], &carry);
+      t[i + 2] = MulAdd(a.limbs[i], b.limbs[2], t[i + 2], &carry);
+      t[i + 3] = MulAdd(a.limbs[i], b.limbs[3], t[i + 3], &carry);
+      t[i + 4] = carry;
+    }
+    return Reduce(t);
+  }
+
+  static Element Sqr(const Element& a) {
+    // The products a_i * a_j for i < j appear twice, so compute them once
+    // and double them.
+    uint64_t t[8];
+    uint64_t carry = 0;
+    t[1] = MulAdd(a.limbs[0], a.limbs[1], 0, &carry);
+    t[2] = MulAdd(a.limbs[0], a.limbs[2], 0, &carry);
+    t[3] = MulAdd(a.limbs[0], a.limbs[3], 0, &carry);
+    t[4] = carry;
+    carry = 0;
+    t[3] = MulAdd(a.limbs[1], a.limbs[2], t[3], &carry);
+    t[4] = MulAdd(a.limbs[1], a.limbs[3], t[4], &carry);
+    t[5] = carry;
+    carry = 0;
+    t[5] = MulAdd(a.limbs[2], a.limbs[3], t[5], &carry);
+    t[6] = carry;
+    t[7] = t[6] >> 63;
+    t[6] = (t[6] << 1) | (t[5] >> 63);
+    t[5] = (t[5] << 1) | (t[4] >> 63);
+    t[4] = (t[4] << 1) | (t[3] >> 63);
+    t[3] = (t[3] << 1) | (t[2] >> 63);
+    t[2] = (t[2] << 1) | (t[1] >> 63);
+    t[1] = t[1] << 1;
+    // Add the squares a_i^2 on the diagonal.
+    uint64_t square_carry = 0;
+    t[0] = MulAdd(a.limbs[0], a.limbs[0], 0, &square_carry);
+    carry = 0;
+    t[1] = AddCarry(t[1], square_carry, &carry);
+    for (int i = 1; i < 4; i++) {
+      square_carry = 0;
+      const uint64_t low = MulAdd(a.limbs[i], a.limbs[i], 0, &square_carry);
+      t[2 * i] = AddCarry(t[2 * i], low, &carry);
+      t[2 * i + 1] = AddCarry(t[2 * i + 1], square_carry, &carry);
+    }
+    return Reduce(t);
+  }
+
+  // Returns a^exponent, where `exponent` is a public constant given as plain
+  // limbs, least significant first.
+  static Element Pow(const Element& a, const uint64_t exponent[4]) {
+    Element table[16];
+    table[0] = One();
+    table[1] = a;
+    for (int i = 2; i < 16; i++) {
+      table[i] = Mul(table[i - 1], a);
+    }
+    Element result = One();
+    bool started = false;
+    for (int i = 63; i >= 0; i--) {
+      if (started) {
+        for (int j = 0; j < 4; j++) {
+          result = Sqr(result);
+        }
+      }
+      const int nibble =
+          static_cast<int>((exponent[i / 16] >> (4 * (i % 16))) & 15);
+      if (nibble != 0) {
+        result = started ? Mul(result, table[nibble]) : table[nibble];
+        started = true;
+      }
+    }
+    return result;
+  }
+
+  // Returns a^-1 by Fermat's little theorem, or zero if a is zero.
+  static Element Inverse(const Element& a) {
+    static constexpr uint64_t kExponent[4] = {
+        0xfffffffefffffc2d, 0xffffffffffffffff, 0xffffffffffffffff,
+        0xffffffffffffffff};
+    return Pow(a, kExponent);
+  }
+
+  // Parses 32 big-endian bytes. Returns false if the value is not below p.
+  static bool FromBytes(const uint8_t* bytes, Element* result) {
+    Element value;
+    for (int i = 0; i < 4; i++) {
+      uint64_t limb = 0;
+      for (int j = 0; j < 8; j++) {
+        limb = (limb << 8) | bytes[8 * (3 - i) + j];
+      }
+      value.limbs[i] = limb;
+    }
+    // Only the lowest limb of p is not all ones.
+    if ((value.limbs[1] & value.limbs[2] & value.limbs[3]) == ~uint64_t{0} &&
+        value.limbs[0] >= kModulus[0]) {
+      return false;
+    }
+    *result = value;
+    return true;
+  }
+
+  // Writes `a` as 32 big-endian bytes.
+  static void ToBytes(const Element& a, uint8_t* bytes) {
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 8; j++) {
+        bytes[8 * (3 - i) + j] =
+            static_cast<uint8_t>(a.limbs[i] >> (56 - 8 * j));
+      }
+    }
+  }
+
+  // Returns whether `a` is odd.
+  static bool IsOdd(const Element& a) { return (a.limbs[0] & 1) != 0; }
+
+  // Returns all ones if `a` is zero, and zero otherwise.
+  static uint64_t IsZero(const Element& a) {
+    const uint64_t bits = a.limbs[0] | a.limbs[1] | a.limbs[2] | a.limbs[3];
+    return ((bits | (0 - bits)) >> 63) - 1;
+  }
+
+  // Returns all ones if `a` equals `b`, and zero otherwise.
+  static uint64_t Equal(const Element& a, const Element& b) {
+    return IsZero(Element{{a.limbs[0] ^ b.limbs[0], a.limbs[1] ^ b.limbs[1],
+                           a.limbs[2] ^ b.limbs[2], a.limbs[3] ^ b.limbs[3]}});
+  }
+
+  // Returns `a` if `mask` is all ones, and `b` if it is zero.
+  static Element Select(uint64_t mask, const Element& a, const Element& b) {
+    return Element{{(a.limbs[0] & mask) | (b.limbs[0] & ~mask),
+                    (a.limbs[1] & mask) | (b.limbs[1] & ~mask),
+                    (a.limbs[2] & mask) | (b.limbs[2] & ~mask),
+                    (a.limbs[3] & mask) | (b.limbs[3] & ~mask)}};
+  }
+
+ private:
+  using uint128 = unsigned __int128;
+
+  // 2^256 mod p.
+  static constexpr uint64_t kC = 0x1000003d1;
+
+  // Returns a + b + `carry` modulo 2^64 and sets `carry` to the carry out.
+  static uint64_t AddCarry(uint64_t a, uint64_t b, uint64_t* carry) {
+#if defined(__x86_64__)
+    unsigned long long sum;  // NOLINT(runtime/int)
+    *carry = _addcarry_u64(static_cast<unsigned char>(*carry), a, b, &sum);
+    return sum;
+#else
+    const uint128 t = static_cast<uint128>(a) + b + *carry;
+    *carry = static_cast<uint64_t>(t >> 64);
+    return static_cast<uint64_t>(t);
+#endif
+  }
+
+  // Returns a - b - `borrow` modulo 2^64 and sets `borrow` to the borrow out.
+  static uint64_t SubBorrow(uint64_t a, uint64_t b, uint64_t* borrow) {
+#if defined(__x86_64__)
+    unsigned long long diff;  // NOLINT(runtime/int)
+    *borrow = _subborrow_u64(static_cast<unsigned char>(*borrow), a, b, &diff);
+    return diff;
+#else
+    const uint128 t = static_cast<uint128>(a) - b - *borrow;
+    *borrow = static_cast<uint64_t>(t >> 64) & 1;
+    return static_cast<uint64_t>(t);
+#endif
+  }
+
+  // Returns the low word of a * b + c + `carry` and sets `carry` to the high
+  // word, which cannot overflow.
+  static uint64_t MulAdd(uint64_t a, uint64_t b, uint64_t c,
+                         uint64_t* carry) {
+    const uint128 t = static_cast<uint128>(a) * b + c + *carry;
+    *carry = static_cast<uint64_t>(t >> 64);
+    return static_cast<uint64_t>(t);
+  }
+
+  // Returns the 512-bit value `t` modulo p.
+  static Element Reduce(const uint64_t t[8]) {
+    // hi * 2^256 + lo = hi * c + lo, which has at most 290 bits.
+    uint64_t r[4];
+    uint64_t carry = 0;
+    r[0] = MulAdd(t[4], kC, t[0], &carry);
+    r[1] = MulAdd(t[5], kC, t[1], &carry);
+    r[2] = MulAdd(t[6], kC, t[2], &carry);
+    r[3] = MulAdd(t[7], kC, t[3], &carry);
+    // Fold the top word the same way. If that carries out of 2^256 again,
+    // the low words are now tiny, and a last fold of c cannot carry.
+    uint64_t high = 0;
+    const uint64_t low = MulAdd(carry, kC, 0, &high);
+    uint64_t add_carry = 0;
+    r[0] = AddCarry(r[0], low, &add_carry);
+    r[1] = AddCarry(r[1], high, &add_carry);
+    r[2] = AddCarry(r[2], 0, &add_carry);
+    r[3] = AddCarry(r[3], 0, &add_carry);
+    const uint64_t c = kC & (0 - add_carry);
+    add_carry = 0;
+    r[0] = AddCarry(r[0], c, &add_carry);
+    r[1] = AddCarry(r[1], 0, &add_carry);
+    r[2] = AddCarry(r[2], 0, &add_carry);
+    r[3] = AddCarry(r[3], 0, &add_carry);
+    return ReduceOnce(r, 0);
+  }
+
+  // Returns the value `carry` * 2^256 + `value` minus p if that does not
+  // underflow, given that the value is below 2p. Subtracting p is adding c
+  // modulo 2^256, and the value is at least p exactly if either the carry is
+  // set or adding c carries.
+  static Element ReduceOnce(const uint64_t value[4], uint64_t carry) {
+    uint64_t add_carry = 0;
+    const Element reduced = {{AddCarry(value[0], kC, &add_carry),
+                              AddCarry(value[1], 0, &add_carry),
+                              AddCarry(value[2], 0, &add_carry),
+                              AddCarry(value[3], 0, &add_carry)}};
+    return Select(0 - (carry | add_carry), reduced,
+                  Element{{value[0], value[1], value[2], value[3]}});
+  }
+};
+
+// The scalar field, i.e. integers modulo the group order n.
+struct Secp256k1OrderParams {
+  static constexpr uint64_t kModulus[4] = {
+      0xbfd25e8cd0364141, 0xbaaedce6af48a03b, 0xfffffffffffffffe,
+      0xffffffffffffffff};
+  static constexpr uint64_t kN0 = 0x4b0dff665588b13f;
+  static constexpr uint64_t kOne[4] = {0x402da1732fc9bebf, 0x4551231950b75fc4,
+                                       0x0000000000000001, 0x0000000000000000};
+  static constexpr uint64_t kR2[4] = {0x896cf21467d7d140, 0x741496c20e7cf878,
+                                      0xe697f5e45bcd07c6, 0x9d671cd581c69bc5};
+};
+
+using Order = MontgomeryField<Secp256k1OrderParams>;
+using Element = FieldElement256;
+
+// The curve coefficient b; a is 0.
+constexpr Element kCurveB = {{7, 0, 0, 0}};
+
+// (p + 1) / 4, the exponent of a square root since p = 3 mod 4.
+constexpr uint64_t kSqrtExponent[4] = {0xffffffffbfffff0c, 0xffffffffffffffff,
+                                       0xffffffffffffffff, 0x3fffffffffffffff};
+
+// beta, a cube root of unity modulo p. The endomorphism
+// (x, y) -> (beta * x, y) multiplies every point by lambda.
+constexpr Element kBeta = {{0xc1396c28719501ee, 0x9cf0497512f58995,
+                            0x6e64479eac3434e9, 0x7ae96a2b657c0710}};
+
+// lambda, the matching cube root of unity modulo n, as a plain integer.
+constexpr Element kLambda = {{0xdf02967c1b23bd72, 0x122e22ea20816678,
+                              0xa5261c028812645a, 0x5363ad4cc05c30e0}};
+
+// Constants of the decomposition of k into k1 + k2 * lambda, as in
+// libsecp256k1: with the short lattice basis (a1, b1), (a2, b2) of the
+// solutions of x + y * lambda = 0 mod n, c1 = round(k * g1 / 2^384) and
+// c2 = round(k * g2 / 2^384) approximate k * b2 / n and -k * b1 / n, and
+// k2 = -(c1 * b1 + c2 * b2) mod n. -b1 and -b2 mod n are plain integers.
+constexpr uint64_t kMinusB1[4] = {0x6f547fa90abfe4c3, 0xe4437ed6010e8828,
+                                  0x0000000000000000, 0x0000000000000000};
+constexpr uint64_t kMinusB2[4] = {0xd765cda83db1562c, 0x8a280ac50774346d,
+                                  0xfffffffffffffffe, 0xffffffffffffffff};
+constexpr uint64_t kG1[4] = {0xe893209a45dbb031, 0x3daa8a1471e8ca7f,
+                             0xe86c90e49284eb15, 0x3086d221a7d46bcd};
+constexpr uint64_t kG2[4] = {0x1571b4ae8ac47f71, 0x221208ac9df506c6,
+                             0x6f547fa90abfe4c4, 0xe4437ed6010e8828};
+
+// Bits of either half of the scalar consumed per addition in
+// `Secp256k1BulkMultiplier`. Digits are signed, so the table only holds the
+// multiples 0 to 2^(kWindowBits - 1) of the point, and negative digits negate
+// the entry.
+constexpr int kWindowBits = 5;
+constexpr int kMaxDigit = 1 << (kWindowBits - 1);
+constexpr int kTableSize = kMaxDigit + 1;
+
+// Returns x^3 + 7, the square of y for points on the curve.
+Element CurveRhs(const Element& x) {
+  return Field::Add(Field::Mul(Field::Sqr(x), x), kCurveB);
+}
+
+// Returns 3 * b * `a` = 21 * `a`, with additions only.
+Element MulB3(const Element& a) {
+  const Element a4 = Field::Add(Field::Add(a, a), Field::Add(a, a));
+  const Element a16 = Field::Add(Field::Add(a4, a4), Field::Add(a4, a4));
+  return Field::Add(Field::Add(a16, a4), a);
+}
+
+// Returns all ones if `a` and `b` are equal, and zero otherwise.
+uint64_t EqualMask(uint64_t a, uint64_t b) {
+  const uint64_t diff = a ^ b;
+  return ((diff | (0 - diff)) >> 63) - 1;
+}
+
+// Returns `a` if `mask` is all ones, and `b` if it is zero.
+Secp256k1ProjectivePoint SelectPoint(uint64_t mask,
+                                     const Secp256k1ProjectivePoint& a,
+                                     const Secp256k1ProjectivePoint& b) {
+  return Secp256k1ProjectivePoint{Field::Select(mask, a.x, b.x),
+                                  Field::Select(mask, a.y, b.y),
+                                  Field::Select(mask, a.z, b.z)};
+}
+
+// Returns 2 * `p`, with the complete doubling formula for a = 0 of Renes,
+// Costello and Batina, "Complete addition formulas for prime order elliptic
+// curves" (2016), algorithm 9.
+Secp256k1ProjectivePoint Double(const Secp256k1ProjectivePoint& p) {
+  const Element yy = Field::Sqr(p.y);
+  Element z8yy = Field::Add(yy, yy);
+  z8yy = Field::Add(z8yy, z8yy);
+  z8yy = Field::Add(z8yy, z8yy);
+  const Element b3zz = MulB3(Field::Sqr(p.z));
+  const Element b9zz = Field::Add(Field::Add(b3zz, b3zz), b3zz);
+  const Element diff = Field::Sub(yy, b9zz);
+  const Element xy = Field::Mul(p.x, p.y);
+
+  Secp256k1ProjectivePoint r;
+  r.x = Field::Mul(diff, xy);
+  r.x = Field::Add(r.x, r.x);
+  r.y = Field::Add(Field::Mul(b3zz, z8yy),
+                   Field::Mul(diff, Field::Add(yy, b3zz)));
+  r.z = Field::Mul(Field::Mul(p.y, p.z), z8yy);
+  return r;
+}
+
+// Returns `p` + `q`, with the complete addition formula for a = 0 of Renes,
+// Costello and Batina, algorithm 7. Either input may be the point at infinity,
+// and they may be equal or opposite.
+Secp256k1ProjectivePoint Add(const Secp256k1ProjectivePoint& p,
+                             const Secp256k1ProjectivePoint& q) {
+  const Element xx = Field::Mul(p.x, q.x);
+  const Element yy = Field::Mul(p.y, q.y);
+  const Element zz = Field::Mul(p.z, q.z);
+  // x1 y2 + x2 y1, y1 z2 + y2 z1 and x1 z2 + x2 z1 with one product each.
+  const Element xy = Field::Sub(
+      Field::Mul(Field::Add(p.x, p.y), Field::Add(q.x, q.y)),
+      Field::Add(xx, yy));
+  const Element yz = Field::Sub(
+      Field::Mul(Field::Add(p.y, p.z), Field::Add(q.y, q.z)),
+      Field::Add(yy, zz));
+  const Element xz = Field::Sub(
+      Field::Mul(Field::Add(p.x, p.z), Field::Add(q.x, q.z)),
+      Field::Add(xx, zz));
+  const Element xx3 = Field::Add(Field::Add(xx, xx), xx);
+  const Element b3zz = MulB3(zz);
+  const Element b3xz = MulB3(xz);
+  const Element sum = Field::Add(yy, b3zz);
+  const Element diff = Field::Sub(yy, b3zz);
+
+  Secp256k1ProjectivePoint r;
+  r.x = Field::Sub(Field::Mul(xy, diff), Field::Mul(yz, b3xz));
+  r.y = Field::Add(Field::Mul(diff, sum), Field::Mul(b3xz, xx3));
+  r.z = Field::Add(Field::Mul(sum, yz), Field::Mul(xx3, xy));
+  return r;
+}
+
+// Returns all ones if the plain integer `a` is below `b`, and zero otherwise.
+uint64_t LessThanMask(const uint64_t a[4], const uint64_t b[4]) {
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; i++) {
+    const unsigned __int128 diff =
+        static_cast<unsigned __int128>(a[i]) - b[i] - borrow;
+    borrow = static_cast<uint64_t>(diff >> 64) & 1;
+  }
+  return 0 - borrow;
+}
+
+// Returns round(`a` * `b` / 2^384) for plain integers below 2^256. The result
+// is below 2^128.
+Element MulShift384(const uint64_t a[4], const uint64_t b[4]) {
+  uint64_t product[8] = {0};
+  for (int i = 0; i < 4; i++) {
+    uint64_t carry = 0;
+    for (int j = 0; j < 4; j++) {
+      const unsigned __int128 t =
+          static_cast<unsigned __int128>(a[i]) * b[j] + product[i + j] + carry;
+      product[i + j] = static_cast<uint64_t>(t);
+      carry = static_cast<uint64_t>(t >> 64);
+    }
+    product[i + 4] = carry;
+  }
+  const unsigned __int128 low =
+      static_cast<unsigned __int128>(product[6]) + (product[5] >> 63);
+  return Element{{static_cast<uint64_t>(low),
+                  product[7] + static_cast<uint64_t>(low >> 64), 0, 0}};
+}
+
+// Sets `digits` to the signed windows, least significant first, of the plain
+// integer `value`, which must be below 2^128.
+void Recode(const Element& value, int8_t* digits, int num_windows) {
+  // Map each window w to w - 2^kWindowBits when it exceeds kMaxDigit, and
+  // carry one into the next window.
+  uint64_t carry = 0;
+  for (int i = 0; i < num_windows; i++) {
+    const int limb = i * kWindowBits / 64;
+    const int shift = i * kWindowBits % 64;
+    uint64_t window = value.limbs[limb] >> shift;
+    if (shift > 64 - kWindowBits) {
+      window |= value.limbs[limb + 1] << (64 - shift);
+    }
+    window = (window & ((uint64_t{1} << kWindowBits) - 1)) + carry;
+    carry = (window + kMaxDigit - 1) >> kWindowBits;
+    digits[i] = static_cast<int8_t>(static_cast<int64_t>(window) -
+                                    static_cast<int64_t>(carry << kWindowBits));
+  }
+}
+
+// Returns `table`[|`digit`|], negated if `digit` is negative, reading every
+// entry so that the access pattern does not depend on `digit`.
+Secp256k1ProjectivePoint Lookup(const Secp256k1ProjectivePoint* table,
+                                int8_t digit) {
+  const auto value = static_cast<uint64_t>(int64_t{digit});
+  const uint64_t negative = 0 - (value >> 63);
+  const uint64_t magnitude = (value ^ negative) - negative;
+  Secp256k1ProjectivePoint result = table[0];
+  for (uint64_t i = 1; i < kTableSize; i++) {
+    result = SelectPoint(EqualMask(i, magnitude), table[i], result);
+  }
+  result.y = Field::Select(negative, Field::Neg(result.y), result.y);
+  return result;
+}
+
+// Sets `point` to the point with the 32 big-endian bytes `x_bytes` as x
+// coordinate, and an odd y if `odd` is true. Returns false if there is no such
+// point.
+bool DecodeX(const uint8_t* x_bytes, bool odd, Secp256k1AffinePoint* point) {
+  if (!Field::FromBytes(x_bytes, &point->x)) {
+    return false;
+  }
+  const Element rhs = CurveRhs(point->x);
+  Element y = Field::Pow(rhs, kSqrtExponent);
+  if (!Field::Equal(Field::Sqr(y), rhs)) {
+    return false;
+  }
+  // y is never zero, since x^3 = -7 has no solution modulo p.
+  if (Field::IsOdd(y) != odd) {
+    y = Field::Neg(y);
+  }
+  point->y = y;
+  return true;
+}
+
+}  // namespace
+
+bool Secp256k1DecodePoint(absl::string_view encoded,
+                          Secp256k1AffinePoint* point) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(encoded.data());
+  if (encoded.size() == kSecp256k1CompressedPointSize &&
+      (bytes[0] == 0x02 || bytes[0] == 0x03)) {
+    return DecodeX(bytes + 1, bytes[0] == 0x03, point);
+  }
+  if (encoded.size() == kSecp256k1UncompressedPointSize && bytes[0] == 0x04) {
+    return Field::FromBytes(bytes + 1, &point->x) &&
+           Field::FromBytes(bytes + 33, &point->y) &&
+           Field::Equal(Field::Sqr(point->y), CurveRhs(point->x));
+  }
+  return false;
+}
+
+void Secp256k1EncodePoint(const Secp256k1AffinePoint& point, char* out) {
+  auto* bytes = reinterpret_cast<uint8_t*>(out);
+  bytes[0] = Field::IsOdd(point.y) ? 0x03 : 0x02;
+  Field::ToBytes(point.x, bytes + 1);
+}
+
+bool Secp256k1DecodeScalar(absl::string_view bytes, Secp256k1Scalar* scalar) {
+  if (bytes.size() > 32) {
+    return false;
+  }
+  uint8_t padded[32] = {0};
+  std::memcpy(padded + 32 - bytes.size(), bytes.data(), bytes.size());
+  // `FromBytes` checks that the scalar is below the order; the Montgomery
+  // form is not needed.
+  FieldElement256 montgomery;
+  if (!Order::FromBytes(padded, &montgomery) || Order::IsZero(montgomery)) {
+    return false;
+  }
+  *scalar = Secp256k1Scalar{};
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) {
+      scalar->limbs[i] = (scalar->limbs[i] << 8) | padded[8 * (3 - i) + j];
+    }
+  }
+  return true;
+}
+
+void Secp256k1EncodeScalar(const Secp256k1Scalar& scalar, char* out) {
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) {
+      out[8 * (3 - i) + j] = static_cast<char>(scalar.limbs[i] >> (56 - 8 * j));
+    }
+  }
+}
+
+Secp256k1Scalar Secp256k1InvertScalar(const Secp256k1Scalar& scalar) {
+  const FieldElement256 value = Order::ToMontgomery(
+      FieldElement256{{scalar.limbs[0], scalar.limbs[1], scalar.limbs[2],
+                       scalar.limbs[3]}});
+  const FieldElement256 inverse = Order::FromMontgomery(Order::Inverse(value));
+  return Secp256k1Scalar{{inverse.limbs[0], inverse.limbs[1],
+                          inverse.limbs[2], inverse.limbs[3]}};
+}
+
+Secp256k1BulkMultiplier::Secp256k1BulkMultiplier(
+    const Secp256k1Scalar& scalar) {
+  const FieldElement256 k = {
+      {scalar.limbs[0], scalar.limbs[1], scalar.limbs[2], scalar.limbs[3]}};
+  // `Order::Mul` of a Montgomery-form and a plain operand gives the plain
+  // product, so only c1, c2 and k2 need converting.
+  const FieldElement256 c1 = Order::ToMontgomery(MulShift384(k.limbs, kG1));
+  const FieldElement256 c2 = Order::ToMontgomery(MulShift384(k.limbs, kG2));
+  const FieldElement256 k2 =
+      Order::Add(Order::Mul(c1, Element{{kMinusB1[0], kMinusB1[1],
+                                         kMinusB1[2], kMinusB1[3]}}),
+                 Order::Mul(c2, Element{{kMinusB2[0], kMinusB2[1],
+                                         kMinusB2[2], kMinusB2[3]}}));
+  const FieldElement256 k1 =
+      Order::Sub(k, Order::Mul(Order::ToMontgomery(k2), kLambda));
+
+  // Both halves are below 2^128 in absolute value, i.e. either them or their
+  // negations modulo n are.
+  const FieldElement256 negated1 = Order::Neg(k1);
+  negate1_ = LessThanMask(negated1.limbs, k1.limbs);
+  Recode(Order::Select(negate1_, negated1, k1), digits1_, kNumWindows);
+  const FieldElement256 negated2 = Order::Neg(k2);
+  negate2_ = LessThanMask(negated2.limbs, k2.limbs);
+  Recode(Order::Select(negate2_, negated2, k2), digits2_, kNumWindows);
+}
+
+void Secp256k1BulkMultiplier::Multiply(
+    const Secp256k1AffinePoint& point,
+    Secp256k1ProjectivePoint* result) const {
+  // table[i] = i * (+-point), with the sign of k1.
+  Secp256k1ProjectivePoint table[kTableSize];
+  table[0] = Secp256k1ProjectivePoint{Field::Zero(), Field::One(),
+                                      Field::Zero()};
+  table[1] = Secp256k1ProjectivePoint{
+      point.x, Field::Select(negate1_, Field::Neg(point.y), point.y),
+      Field::One()};
+  table[2] = Double(table[1]);
+  for (int i = 3; i < kTableSize; i++) {
+    table[i] = Add(table[i - 1], table[1]);
+  }
+  // The endomorphism commutes with multiplication, so the multiples of
+  // lambda * (+-point), with the sign of k2, take one product per entry.
+  const uint64_t flip = negate1_ ^ negate2_;
+  Secp256k1ProjectivePoint endo_table[kTableSize];
+  for (int i = 0; i < kTableSize; i++) {
+    endo_table[i] = Secp256k1ProjectivePoint{
+        Field::Mul(table[i].x, kBeta),
+        Field::Select(flip, Field::Neg(table[i].y), table[i].y), table[i].z};
+  }
+
+  // Signed windows of both halves from the most significant end, sharing the
+  // doublings. The formulas are complete, so zero digits and the point at
+  // infinity need no special handling.
+  Secp256k1ProjectivePoint acc =
+      Add(Lookup(table, digits1_[kNumWindows - 1]),
+          Lookup(endo_table, digits2_[kNumWindows - 1]));
+  for (int w = kNumWindows - 2; w >= 0; w--) {
+    for (int i = 0; i < kWindowBits; i++) {
+      acc = Double(acc);
+    }
+    acc = Add(acc, Lookup(table, digits1_[w]));
+    acc = Add(acc, Lookup(endo_table, digits2_[w]));
+  }
+  *result = acc;
+}
+
+void Secp256k1BulkMultiplier::Multiply(
+    absl::Span<const Secp256k1AffinePoint> points,
+    absl::Span<Secp256k1ProjectivePoint> results) const {
+  for (size_t i = 0; i < points.size(); i++) {
+    Multiply(points[i], &results[i]);
+  }
+}
+
+bool Secp256k1BatchToAffine(absl::Span<const Secp256k1ProjectivePoint> points,
+                            absl::Span<Secp256k1AffinePoint> affine) {
+  if (points.empty()) {
+    return true;
+  }
+  // Whether a result is the point at infinity does not depend on secrets.
+  for (const Secp256k1ProjectivePoint& point : points) {
+    if (Field::IsZero(point.z)) {
+      return false;
+    }
+  }
+
+  // Store the prefix products z_0 * ... * z_i in the x coordinates of the
+  // output, invert the last one, and walk back to peel off one z at a time.
+  affine[0].x = points[0].z;
+  for (size_t i = 1; i < points.size(); i++) {
+    affine[i].x = Field::Mul(affine[i - 1].x, points[i].z);
+  }
+  Element inverse = Field::Inverse(affine[points.size() - 1].x);
+  for (size_t i = points.size(); i-- > 0;) {
+    Element z_inverse = inverse;
+    if (i > 0) {
+      z_inverse = Field::Mul(inverse, affine[i - 1].x);
+      inverse = Field::Mul(inverse, points[i].z);
+    }
+    affine[i].x = Field::Mul(points[i].x, z_inverse);
+    affine[i].y = Field::Mul(points[i].y, z_inverse);
+  }
+  return true;
+}
+
+}  // namespace private_set_intersection
@@ -0,0 +1,121 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CRYPTO_SECP256K1_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CRYPTO_SECP256K1_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "private_set_intersection/cpp/crypto/montgomery_field.h"
+
+namespace private_set_intersection {
+
+// Group arithmetic on the SEC 2 curve secp256k1, y^2 = x^3 + 7. Coordinates
+// are plain integers modulo p, which is close enough to 2^256 that reducing
+// products needs no Montgomery form; scalars use `MontgomeryField`. The curve
+// has an efficiently computable endomorphism, which `Secp256k1BulkMultiplier`
+// uses to halve the number of doublings per multiplication.
+
+// Sizes of compressed and uncompressed SEC1 point encodings.
+inline constexpr size_t kSecp256k1CompressedPointSize = 33;
+inline constexpr size_t kSecp256k1UncompressedPointSize = 65;
+
+// A point in affine coordinates. The point at infinity has no affine form.
+struct Secp256k1AffinePoint {
+  FieldElement256 x;
+  FieldElement256 y;
+};
+
+// A point in homogeneous projective coordinates, i.e. (x / z, y / z). The
+// point at infinity is (0, 1, 0). Unlike Jacobian coordinates, these have
+// complete addition formulas for curves with a = 0, so that no pair of points
+// needs special handling.
+struct Secp256k1ProjectivePoint {
+  FieldElement256 x;
+  FieldElement256 y;
+  FieldElement256 z;
+};
+
+// A scalar modulo the group order, as a plain integer.
+struct Secp256k1Scalar {
+  uint64_t limbs[4];
+};
+
+// Parses a compressed or uncompressed SEC1 point. Returns false if `encoded`
+// is not a point on the curve other than the point at infinity.
+bool Secp256k1DecodePoint(absl::string_view encoded,
+                          Secp256k1AffinePoint* point);
+
+// Writes the compressed SEC1 encoding of `point`, i.e.
+// `kSecp256k1CompressedPointSize` bytes, to `out`.
+void Secp256k1EncodePoint(const Secp256k1AffinePoint& point, char* out);
+
+// Parses a big-endian scalar of at most 32 bytes. Returns false unless it is
+// between 1 and the group order minus 1.
+bool Secp256k1DecodeScalar(absl::string_view bytes, Secp256k1Scalar* scalar);
+
+// Writes `scalar` as 32 big-endian bytes to `out`.
+void Secp256k1EncodeScalar(const Secp256k1Scalar& scalar, char* out);
+
+// Returns the inverse of `scalar` modulo the group order.
+Secp256k1Scalar Secp256k1InvertScalar(const Secp256k1Scalar& scalar);
+
+// Multiplies points by one fixed scalar k. When the multiplier is created, k
+// is split into k1 + k2 * lambda modulo the group order, with k1 and k2 of
+// about 128 bits each (GLV decomposition), and both halves are recoded into
+// signed windows. Since lambda * (x, y) = (beta * x, y) for a cube root of
+// unity beta, every multiplication then costs 128 doublings instead of 256,
+// with two table additions per window instead of one. Multiplications run in
+// time independent of the scalar.
+class Secp256k1BulkMultiplier {
+ public:
+  explicit Secp256k1BulkMultiplier(const Secp256k1Scalar& scalar);
+
+  // Sets `result` to the scalar times `point`.
+  void Multiply(const Secp256k1AffinePoint& point,
+                Secp256k1ProjectivePoint* result) const;
+
+  // Sets each of `results`, which must have the same size as `points`, to
+  // the scalar times the corresponding point.
+  void Multiply(absl::Span<const Secp256k1AffinePoint> points,
+                absl::Span<Secp256k1ProjectivePoint> results) const;
+
+ private:
+  // Windows of 5 bits cover the 128 bits of either half, plus the final
+  // carry.
+  static constexpr int kNumWindows = 26;
+
+  // Signed digits in [-15, 16], least significant first, of |k1| and |k2|.
+  int8_t digits1_[kNumWindows];
+  int8_t digits2_[kNumWindows];
+  // All ones if k1, respectively k2, is negative, i.e. if the digits encode
+  // its negation.
+  uint64_t negate1_;
+  uint64_t negate2_;
+};
+
+// Converts `points` to affine coordinates in `affine`, which must have the
+// same size, with a single field inversion for all of them (Montgomery's
+// trick). Returns false if any point is the point at infinity.
+bool Secp256k1BatchToAffine(absl::Span<const Secp256k1ProjectivePoint> points,
+                            absl::Span<Secp256k1AffinePoint> affine);
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CRYPTO_SECP256K1_H_
@@ -0,0 +1,159 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "private_set_intersection/cpp/crypto/curve_cipher.h"
+#include "private_set_intersection/cpp/crypto/secp256k1.h"
+
+namespace private_set_intersection {
+namespace {
+
+// Number of points multiplied per iteration.
+constexpr int kNumPoints = 1000;
+
+std::vector<std::string> Inputs() {
+  std::vector<std::string> inputs(kNumPoints);
+  for (int i = 0; i < kNumPoints; i++) {
+    inputs[i] = absl::StrCat("Element", i);
+  }
+  return inputs;
+}
+
+// Returns `kNumPoints` encrypted elements and the key they were encrypted
+// with.
+std::vector<Secp256k1AffinePoint> EncryptedPoints(Secp256k1Scalar* key) {
+  auto cipher = CurveCipher::CreateWithNewKey(
+                    psi_proto::CURVE_SECP256K1,
+                    psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                    psi_proto::POINT_ENCODING_COMPRESSED)
+                    .value();
+  std::string encrypted;
+  cipher->Encrypt(Inputs(), &encrypted).IgnoreError();
+  std::vector<Secp256k1AffinePoint> points(kNumPoints);
+  for (int i = 0; i < kNumPoints; i++) {
+    Secp256k1DecodePoint(
+        absl::string_view(encrypted).substr(
+            i * kSecp256k1CompressedPointSize, kSecp256k1CompressedPointSize),
+        &points[i]);
+  }
+  Secp256k1DecodeScalar(cipher->GetPrivateKeyBytes(), key);
+  return points;
+}
+
+// Multiplies points with the scalar decomposed and recoded once up front,
+// without conversion to affine coordinates.
+void BM_Secp256k1BulkMultiplier(benchmark::State& state) {
+  Secp256k1Scalar key;
+  const std::vector<Secp256k1AffinePoint> points = EncryptedPoints(&key);
+  const Secp256k1BulkMultiplier multiplier(key);
+  std::vector<Secp256k1ProjectivePoint> results(points.size());
+  for (auto _ : state) {
+    multiplier.Multiply(points, absl::MakeSpan(results));
+    ::benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPoints);
+}
+BENCHMARK(BM_Secp256k1BulkMultiplier);
+
+// Decodes compressed points, each of which takes a square root.
+void BM_Secp256k1Decode(benchmark::State& state) {
+  Secp256k1Scalar key;
+  const std::vector<Secp256k1AffinePoint> points = EncryptedPoints(&key);
+  std::string encoded(kNumPoints * kSecp256k1CompressedPointSize, '\0');
+  for (int i = 0; i < kNumPoints; i++) {
+    Secp256k1EncodePoint(points[i],
+                         &encoded[i * kSecp256k1CompressedPointSize]);
+  }
+  Secp256k1AffinePoint point;
+  for (auto _ : state) {
+    for (int i = 0; i < kNumPoints; i++) {
+      Secp256k1DecodePoint(
+          absl::string_view(encoded).substr(i * kSecp256k1CompressedPointSize,
+                                            kSecp256k1CompressedPointSize),
+          &point);
+    }
+    ::benchmark::DoNotOptimize(point);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPoints);
+}
+BENCHMARK(BM_Secp256k1Decode);
+
+enum class Operation { kEncrypt, kReEncrypt, kDecrypt };
+
+// The operations of `CurveCipher` on secp256k1 and on P-256, per element.
+// P-256 encrypts through the commutative cipher with try-and-increment
+// hashing, or with RFC 9380 hashing, and re-encrypts and decrypts through the
+// crypto library either way.
+void BM_CurveCipher(benchmark::State& state, psi_proto::Curve curve,
+                    psi_proto::HashToCurve hash_to_curve, Operation operation) {
+  auto cipher = CurveCipher::CreateWithNewKey(
+                    curve, hash_to_curve, psi_proto::POINT_ENCODING_COMPRESSED)
+                    .value();
+  const std::vector<std::string> inputs = Inputs();
+  std::string encrypted;
+  cipher->Encrypt(inputs, &encrypted).IgnoreError();
+  const size_t width = cipher->element_size();
+  std::vector<absl::string_view> views(kNumPoints);
+  for (int i = 0; i < kNumPoints; i++) {
+    views[i] = absl::string_view(encrypted).substr(i * width, width);
+  }
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    switch (operation) {
+      case Operation::kEncrypt:
+        ::benchmark::DoNotOptimize(cipher->Encrypt(inputs, &out));
+        break;
+      case Operation::kReEncrypt:
+        ::benchmark::DoNotOptimize(cipher->ReEncrypt(views, &out));
+        break;
+      case Operation::kDecrypt:
+        ::benchmark::DoNotOptimize(cipher->Decrypt(views, &out));
+        break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPoints);
+}
+BENCHMARK_CAPTURE(BM_CurveCipher, encrypt p256, psi_proto::CURVE_P256,
+                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                  Operation::kEncrypt);
+BENCHMARK_CAPTURE(BM_CurveCipher, encrypt p256 sswu, psi_proto::CURVE_P256,
+                  psi_proto::HASH_TO_CURVE_P256_SSWU, Operation::kEncrypt);
+BENCHMARK_CAPTURE(BM_CurveCipher, encrypt secp256k1,
+                  psi_proto::CURVE_SECP256K1,
+                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                  Operation::kEncrypt);
+BENCHMARK_CAPTURE(BM_CurveCipher, reencrypt p256, psi_proto::CURVE_P256,
+                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                  Operation::kReEncrypt);
+BENCHMARK_CAPTURE(BM_CurveCipher, reencrypt secp256k1,
+                  psi_proto::CURVE_SECP256K1,
+                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                  Operation::kReEncrypt);
+BENCHMARK_CAPTURE(BM_CurveCipher, decrypt p256, psi_proto::CURVE_P256,
+                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                  Operation::kDecrypt);
+BENCHMARK_CAPTURE(BM_CurveCipher, decrypt secp256k1,
+                  psi_proto::CURVE_SECP256K1,
+                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                  Operation::kDecrypt);
+
+}  // namespace
+}  // namespace private_set_intersection
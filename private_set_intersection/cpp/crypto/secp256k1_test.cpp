@@ -0,0 +1,184 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/crypto/secp256k1.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/escaping.h"
+#include "gtest/gtest.h"
+
+namespace private_set_intersection {
+namespace {
+
+// The generator of the group, and its y coordinate.
+constexpr char kGeneratorHex[] =
+    "0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798";
+constexpr char kGeneratorYHex[] =
+    "483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8";
+
+// Returns the hex-encoded compressed encoding of `point`.
+std::string EncodeHex(const Secp256k1AffinePoint& point) {
+  std::string encoded(kSecp256k1CompressedPointSize, '\0');
+  Secp256k1EncodePoint(point, &encoded[0]);
+  return absl::BytesToHexString(encoded);
+}
+
+// Returns the hex-encoded compressed encoding of `point`, converting it to
+// affine coordinates on its own.
+std::string EncodeHex(const Secp256k1ProjectivePoint& point) {
+  Secp256k1AffinePoint affine;
+  EXPECT_TRUE(Secp256k1BatchToAffine(absl::MakeConstSpan(&point, 1),
+                                     absl::MakeSpan(&affine, 1)));
+  return EncodeHex(affine);
+}
+
+Secp256k1AffinePoint Generator() {
+  Secp256k1AffinePoint generator;
+  EXPECT_TRUE(Secp256k1DecodePoint(absl::HexStringToBytes(kGeneratorHex),
+                                   &generator));
+  return generator;
+}
+
+Secp256k1Scalar Scalar(absl::string_view hex) {
+  Secp256k1Scalar scalar;
+  EXPECT_TRUE(Secp256k1DecodeScalar(absl::HexStringToBytes(hex), &scalar));
+  return scalar;
+}
+
+TEST(Secp256k1Test, TestDecodeAndEncode) {
+  const Secp256k1AffinePoint compressed = Generator();
+  EXPECT_EQ(EncodeHex(compressed), kGeneratorHex);
+
+  Secp256k1AffinePoint uncompressed;
+  ASSERT_TRUE(Secp256k1DecodePoint(
+      absl::HexStringToBytes(std::string("04") + (kGeneratorHex + 2) +
+                             kGeneratorYHex),
+      &uncompressed));
+  EXPECT_EQ(EncodeHex(uncompressed), kGeneratorHex);
+}
+
+TEST(Secp256k1Test, TestMultiplyMatchesReference) {
+  // Multiples of the generator, computed with affine arithmetic. The scalars
+  // include lambda and its neighbours, whose halves k1 and k2 are tiny, and
+  // scalars around 2^128 and n / 2.
+  struct TestVector {
+    std::string scalar;
+    std::string product;
+  };
+  const std::vector<TestVector> vectors = {
+      {"01", kGeneratorHex},
+      {"02",
+       "02c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee5"},
+      {"03",
+       "02f9308a019258c31049344f85f89d5229b531c845836f99b08601f113bce036f9"},
+      {"0f",
+       "02d7924d4f7d43ea965a465ae3095ff41131e5946f3c85f79e44adbcf8e27e080e"},
+      {"10",
+       "03e60fce93b59e9ec53011aabc21c23e97b2a31369b87a5ae9c44ee89e2a6dec0a"},
+      {"11",
+       "03defdea4cdb677750a420fee807eacf21eb9898ae79b9768766e4faa04a2d4a34"},
+      {"0a3c5e7f9b1d2f4e6a8c0b2d4f6e8a0c1e3f5a7b9d1c3e5f7a9b1d3c5e7f9a1b",
+       "02f5e351d44c2d9752bb3b620b3b55bf9230733e70175cd1a38ed5769b9d750a7f"},
+      // The group order minus 1 negates the generator.
+      {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+       "0379be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798"},
+      // lambda, n - lambda and lambda + 1.
+      {"5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd72",
+       "02bcace2e99da01887ab0102b696902325872844067f15e98da7bba04400b88fcb"},
+      {"ac9c52b33fa3cf1f5ad9e3fd77ed9ba4a880b9fc8ec739c2e0cfc810b51283cf",
+       "03bcace2e99da01887ab0102b696902325872844067f15e98da7bba04400b88fcb"},
+      {"5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd73",
+       "03c994b69768832bcbff5e9ab39ae8d1d3763bbf1e531bed98fe51de5ee84f50fb"},
+      {"ffffffffffffffffffffffffffffffff",
+       "036c034fd8cc8bd548e12569b630710400e6c24a05d9d6b32f08522a241e936da8"},
+      {"0100000000000000000000000000000000",
+       "028f68b9d2f63b5f339239c1ad981f162ee88c5678723ea3351b7b444c9ec4c0da"},
+      {"7fffffffffffffffffffffffffffffff5d576e7357a4501ddfe92f46681b20a0",
+       "0300000000000000000000003b78ce563f89a0ed9414f5aa28ad0d96d6795f9c63"},
+  };
+  for (const TestVector& vector : vectors) {
+    Secp256k1ProjectivePoint product;
+    Secp256k1BulkMultiplier(Scalar(vector.scalar))
+        .Multiply(Generator(), &product);
+    EXPECT_EQ(EncodeHex(product), vector.product) << vector.scalar;
+  }
+}
+
+TEST(Secp256k1Test, TestBulkMultiplierMatchesSingleMultiplications) {
+  std::vector<Secp256k1AffinePoint> points(10);
+  for (size_t i = 0; i < points.size(); i++) {
+    Secp256k1ProjectivePoint point;
+    Secp256k1BulkMultiplier(Scalar(std::string(2 * i, '3') + "17"))
+        .Multiply(Generator(), &point);
+    ASSERT_TRUE(Secp256k1BatchToAffine(absl::MakeConstSpan(&point, 1),
+                                       absl::MakeSpan(&points[i], 1)));
+  }
+
+  const Secp256k1BulkMultiplier multiplier(Scalar(
+      "0a3c5e7f9b1d2f4e6a8c0b2d4f6e8a0c1e3f5a7b9d1c3e5f7a9b1d3c5e7f9a1b"));
+  std::vector<Secp256k1ProjectivePoint> products(points.size());
+  multiplier.Multiply(points, absl::MakeSpan(products));
+  std::vector<Secp256k1AffinePoint> affine(points.size());
+  ASSERT_TRUE(Secp256k1BatchToAffine(products, absl::MakeSpan(affine)));
+  for (size_t i = 0; i < points.size(); i++) {
+    Secp256k1ProjectivePoint expected;
+    multiplier.Multiply(points[i], &expected);
+    EXPECT_EQ(EncodeHex(affine[i]), EncodeHex(expected));
+  }
+}
+
+TEST(Secp256k1Test, TestInvertScalar) {
+  const Secp256k1Scalar scalar = Scalar(
+      "0a3c5e7f9b1d2f4e6a8c0b2d4f6e8a0c1e3f5a7b9d1c3e5f7a9b1d3c5e7f9a1b");
+  Secp256k1ProjectivePoint product;
+  Secp256k1BulkMultiplier(scalar).Multiply(Generator(), &product);
+  Secp256k1AffinePoint affine;
+  ASSERT_TRUE(Secp256k1BatchToAffine(absl::MakeConstSpan(&product, 1),
+                                     absl::MakeSpan(&affine, 1)));
+  Secp256k1BulkMultiplier(Secp256k1InvertScalar(scalar))
+      .Multiply(affine, &product);
+  EXPECT_EQ(EncodeHex(product), kGeneratorHex);
+}
+
+TEST(Secp256k1Test, FailIfInvalid) {
+  Secp256k1AffinePoint point;
+  const std::string x = kGeneratorHex + 2;
+  // Wrong prefix or size, the point at infinity, x not below p, x with no
+  // point on the curve, and a point off the curve.
+  for (const std::string& hex :
+       {std::string("05") + x, std::string("03") + x.substr(2),
+        std::string("00"), std::string("02") + std::string(64, 'f'),
+        std::string("02") + std::string(64, '0'),
+        std::string("04") + x + std::string(64, '1')}) {
+    EXPECT_FALSE(Secp256k1DecodePoint(absl::HexStringToBytes(hex), &point))
+        << hex;
+  }
+
+  Secp256k1Scalar scalar;
+  EXPECT_FALSE(Secp256k1DecodeScalar("", &scalar));
+  EXPECT_FALSE(Secp256k1DecodeScalar(std::string(32, '\0'), &scalar));
+  EXPECT_FALSE(Secp256k1DecodeScalar(std::string(33, '\1'), &scalar));
+  EXPECT_FALSE(Secp256k1DecodeScalar(
+      absl::HexStringToBytes("fffffffffffffffffffffffffffffffe"
+                             "baaedce6af48a03bbfd25e8cd0364141"),
+      &scalar));
+  EXPECT_TRUE(Secp256k1DecodeScalar(std::string(32, '\1'), &scalar));
+}
+
+}  // namespace
+}  // namespace private_set_intersection
@@ -16,21 +16,165 @@
 
 #include "private_set_intersection/cpp/datastructure/bloom_filter.h"
 
+#include <algorithm>
 #include <cmath>
+#include <thread>
+
+#include "private_set_intersection/cpp/cpu_features.h"
+
+#if PSI_HAVE_SSE2_TIER
+// GCC 12 reports the undefined vectors in the AVX-512 intrinsics as
+// uninitialized when they are inlined into a function with a target attribute.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
 
 #include "absl/memory/memory.h"
 #include "absl/strings/escaping.h"
-#include "absl/strings/str_cat.h"
+#include "private_set_intersection/cpp/crypto/batch_sha256.h"
 #include "private_set_intersection/proto/psi.pb.h"
 
 namespace private_set_intersection {
 
-BloomFilter::BloomFilter(
-    int num_hash_functions, std::string bits,
-    std::unique_ptr<::private_join_and_compute::Context> context)
+namespace {
+
+// Number of elements whose probes are prefetched before the first of them is
+// resolved. With the usual 10-20 hash functions this keeps a few hundred
+// cache lines in flight, which is more than enough to saturate the memory
+// system without evicting the prefetched lines again before they are used.
+constexpr int64_t kQueryWindow = 16;
+
+// Size in bytes of the regions of the filter whose writes are applied together
+// when adding many elements. Chosen to fit into the L2 cache of common CPUs.
+constexpr int64_t kRegionBytes = int64_t{1} << 18;
+
+// Number of inputs whose bit indices are computed and partitioned at once, to
+// bound the memory used for the indices.
+constexpr int64_t kAddChunkSize = int64_t{1} << 16;
+
+void PrefetchForRead(const char* address) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address, /*rw=*/0, /*locality=*/0);
+#else
+  (void)address;
+#endif
+}
+
+// Returns true if the bit indices `probes[i]` to `probes[num_probes - 1]` are
+// all set in `data`.
+bool RemainingBitsSet(const uint8_t* data, const int64_t* probes, int i,
+                      int num_probes) {
+  uint64_t result = 1;
+  for (; i < num_probes; i++) {
+    result &= data[probes[i] / 8] >> (probes[i] % 8);
+  }
+  return result & 1;
+}
+
+// Each of the following returns true if all `num_probes` bit indices in
+// `probes` are set in `bits`, using the instructions of one CPU tier.
+
+bool AllBitsSetScalar(absl::string_view bits, const int64_t* probes,
+                      int num_probes) {
+  return RemainingBitsSet(reinterpret_cast<const uint8_t*>(bits.data()),
+                          probes, 0, num_probes);
+}
+
+#if PSI_HAVE_AVX2_TIER
+// Gathers four 64-bit words at a time, each containing one of the probed bits.
+// The offsets are clamped so that no word extends past the end of `bits`, and
+// the shift is adjusted accordingly.
+PSI_TARGET("avx2")
+bool AllBitsSetAvx2(absl::string_view bits, const int64_t* probes,
+                    int num_probes) {
+  const auto* data = reinterpret_cast<const uint8_t*>(bits.data());
+  int i = 0;
+  if (bits.size() >= 8) {
+    const __m256i max_offset =
+        _mm256_set1_epi64x(static_cast<int64_t>(bits.size()) - 8);
+    __m256i acc = _mm256_set1_epi64x(1);
+    for (; i + 4 <= num_probes; i += 4) {
+      const __m256i probe = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(probes + i));
+      __m256i offset = _mm256_srli_epi64(probe, 3);
+      offset = _mm256_blendv_epi8(offset, max_offset,
+                                  _mm256_cmpgt_epi64(offset, max_offset));
+      const __m256i words = _mm256_i64gather_epi64(
+          reinterpret_cast<const long long*>(data), offset, 1);
+      const __m256i shift =
+          _mm256_sub_epi64(probe, _mm256_slli_epi64(offset, 3));
+      acc = _mm256_and_si256(acc, _mm256_srlv_epi64(words, shift));
+    }
+    const int mask = _mm256_movemask_pd(
+        _mm256_castsi256_pd(_mm256_slli_epi64(acc, 63)));
+    if (mask != 0xf) {
+      return false;
+    }
+  }
+  return RemainingBitsSet(data, probes, i, num_probes);
+}
+#endif
+
+#if PSI_HAVE_AVX512_TIER
+// As `AllBitsSetAvx2`, with eight words per gather.
+PSI_TARGET("avx512f")
+bool AllBitsSetAvx512(absl::string_view bits, const int64_t* probes,
+                      int num_probes) {
+  const auto* data = reinterpret_cast<const uint8_t*>(bits.data());
+  int i = 0;
+  if (bits.size() >= 8) {
+    const __m512i max_offset =
+        _mm512_set1_epi64(static_cast<int64_t>(bits.size()) - 8);
+    const __m512i one = _mm512_set1_epi64(1);
+    __m512i acc = one;
+    for (; i + 8 <= num_probes; i += 8) {
+      const __m512i probe = _mm512_loadu_si512(probes + i);
+      const __m512i offset =
+          _mm512_min_epi64(_mm512_srli_epi64(probe, 3), max_offset);
+      const __m512i words = _mm512_i64gather_epi64(offset, data, 1);
+      const __m512i shift =
+          _mm512_sub_epi64(probe, _mm512_slli_epi64(offset, 3));
+      acc = _mm512_and_si512(acc, _mm512_srlv_epi64(words, shift));
+    }
+    if (_mm512_test_epi64_mask(acc, one) != 0xff) {
+      return false;
+    }
+  }
+  return RemainingBitsSet(data, probes, i, num_probes);
+}
+#endif
+
+using AllBitsSetFunction = bool (*)(absl::string_view, const int64_t*, int);
+
+// Returns the variant of `AllBitsSet*` for the active CPU tier.
+AllBitsSetFunction SelectAllBitsSet() {
+  const CpuTier tier = ActiveCpuTier();
+#if PSI_HAVE_AVX512_TIER
+  if (tier >= CpuTier::kAvx512) {
+    return AllBitsSetAvx512;
+  }
+#endif
+#if PSI_HAVE_AVX2_TIER
+  if (tier >= CpuTier::kAvx2) {
+    return AllBitsSetAvx2;
+  }
+#endif
+  (void)tier;
+  return AllBitsSetScalar;
+}
+
+}  // namespace
+
+BloomFilter::BloomFilter(int num_hash_functions, std::string bits)
     : num_hash_functions_(num_hash_functions),
-      bits_(std::move(bits)),
-      context_(std::move(context)) {}
+      bits_storage_(std::move(bits)),
+      bits_(bits_storage_) {}
 
 StatusOr<std::unique_ptr<BloomFilter>> BloomFilter::Create(
     double fpr, int64_t num_client_inputs,
@@ -59,9 +203,8 @@ StatusOr<std::unique_ptr<BloomFilter>> BloomFilter::CreateEmpty(
   int64_t num_bytes = static_cast<int64_t>(
       std::ceil(-max_elements * std::log2(fpr) / std::log(2) / 8));
   std::string bits(num_bytes, '\0');
-  auto context = absl::make_unique<::private_join_and_compute::Context>();
   return absl::WrapUnique(
-      new BloomFilter(num_hash_functions, std::move(bits), std::move(context)));
+      new BloomFilter(num_hash_functions, std::move(bits)));
 }
 
 StatusOr<std::unique_ptr<BloomFilter>> BloomFilter::CreateFromProtobuf(
@@ -70,21 +213,102 @@ StatusOr<std::unique_ptr<BloomFilter>> BloomFilter::CreateFromProtobuf(
     return absl::InvalidArgumentError("`ServerSetup` is corrupt!");
   }
 
-  auto context = absl::make_unique<::private_join_and_compute::Context>();
-  return absl::WrapUnique(new BloomFilter(
-      encoded_filter.bloom_filter().num_hash_functions(),
-      std::move(encoded_filter.bloom_filter().bits()), std::move(context)));
+  return absl::WrapUnique(
+      new BloomFilter(encoded_filter.bloom_filter().num_hash_functions(),
+                      encoded_filter.bloom_filter().bits()));
+}
+
+StatusOr<std::unique_ptr<BloomFilter>> BloomFilter::CreateFromView(
+    const ServerSetupView& setup) {
+  if (setup.data_structure_case != psi_proto::ServerSetup::kBloomFilter) {
+    return absl::InvalidArgumentError(
+        "`ServerSetup` does not hold a Bloom filter");
+  }
+
+  auto filter = absl::WrapUnique(
+      new BloomFilter(setup.num_hash_functions, std::string()));
+  filter->bits_ = setup.bits;
+  return filter;
 }
 
 void BloomFilter::Add(const std::string& input) {
   Add(absl::MakeConstSpan(&input, 1));
 }
 
-void BloomFilter::Add(absl::Span<const std::string> inputs) {
-  for (const std::string& input : inputs) {
-    for (int64_t index : Hash(input)) {
-      bits_[index / 8] |= (1 << (index % 8));
+void BloomFilter::Add(absl::Span<const std::string> inputs,
+                      int num_threads) {
+  EnsureBitsOwned();
+  const int64_t num_inputs = static_cast<int64_t>(inputs.size());
+  std::vector<int64_t> indices;
+  for (int64_t begin = 0; begin < num_inputs; begin += kAddChunkSize) {
+    const int64_t end = std::min(begin + kAddChunkSize, num_inputs);
+    indices.resize((end - begin) * num_hash_functions_);
+    HashBatch(inputs.subspan(begin, end - begin), indices.data());
+    SetBits(indices, num_threads);
+  }
+}
+
+void BloomFilter::SetBits(absl::Span<const int64_t> indices,
+                          int num_threads) {
+  char* bits = &bits_storage_[0];
+  const int64_t region_bits = 8 * kRegionBytes;
+  const int64_t num_regions =
+      (static_cast<int64_t>(bits_storage_.size()) + kRegionBytes - 1) /
+      kRegionBytes;
+  if (num_regions <= 1 || static_cast<int64_t>(indices.size()) < num_regions) {
+    // Either the whole filter fits into a single region, or there are too few
+    // writes for partitioning to pay off.
+    for (int64_t index : indices) {
+      bits[index / 8] |= (1 << (index % 8));
+    }
+    return;
+  }
+
+  // Radix-partition the indices by region. Each index is stored as its offset
+  // within the region, which fits in 32 bits.
+  std::vector<int64_t> region_begin(num_regions + 1, 0);
+  for (int64_t index : indices) {
+    region_begin[index / region_bits + 1]++;
+  }
+  for (int64_t r = 0; r < num_regions; r++) {
+    region_begin[r + 1] += region_begin[r];
+  }
+  std::vector<uint32_t> offsets(indices.size());
+  std::vector<int64_t> next(region_begin.begin(), region_begin.end() - 1);
+  for (int64_t index : indices) {
+    offsets[next[index / region_bits]++] =
+        static_cast<uint32_t>(index % region_bits);
+  }
+
+  // Apply the writes region by region. Regions are byte-aligned, so threads
+  // working on disjoint ranges of regions never write to the same byte.
+  auto set_regions = [&](int64_t first_region, int64_t last_region) {
+    for (int64_t r = first_region; r < last_region; r++) {
+      char* region = bits + r * kRegionBytes;
+      for (int64_t i = region_begin[r]; i < region_begin[r + 1]; i++) {
+        region[offsets[i] / 8] |= (1 << (offsets[i] % 8));
+      }
     }
+  };
+  const int64_t num_workers = std::min<int64_t>(num_threads, num_regions);
+  if (num_workers <= 1) {
+    set_regions(0, num_regions);
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (int64_t t = 0; t < num_workers; t++) {
+    threads.emplace_back(set_regions, t * num_regions / num_workers,
+                         (t + 1) * num_regions / num_workers);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+void BloomFilter::EnsureBitsOwned() {
+  if (bits_.data() != bits_storage_.data()) {
+    bits_storage_.assign(bits_.data(), bits_.size());
+    bits_ = bits_storage_;
   }
 }
 
@@ -96,54 +320,115 @@ bool BloomFilter::Check(const std::string& input) const {
   return result;
 }
 
-std::vector<int64_t> BloomFilter::Intersect(
-    absl::Span<const std::string> elements) const {
-  std::vector<int64_t> res;
+void BloomFilter::CheckBatch(absl::Span<const std::string> elements,
+                             absl::FunctionRef<void(int64_t)> on_match) const {
+  const int64_t num_elements = static_cast<int64_t>(elements.size());
+  std::vector<int64_t> probes(kQueryWindow * num_hash_functions_);
+  const AllBitsSetFunction all_bits_set = SelectAllBitsSet();
+  for (int64_t begin = 0; begin < num_elements; begin += kQueryWindow) {
+    const int64_t end = std::min(begin + kQueryWindow, num_elements);
 
-  for (size_t i = 0; i < elements.size(); i++) {
-    if (Check(elements[i])) {
-      res.push_back(i);
+    // First pass: compute all probe indices of the window and start loading
+    // the cache lines they hit.
+    HashBatch(elements.subspan(begin, end - begin), probes.data());
+    for (int64_t j = 0; j < (end - begin) * num_hash_functions_; j++) {
+      PrefetchForRead(bits_.data() + probes[j] / 8);
+    }
+
+    // Second pass: resolve the probes, which by now are mostly cached.
+    for (int64_t i = begin; i < end; i++) {
+      if (all_bits_set(bits_, &probes[(i - begin) * num_hash_functions_],
+                       num_hash_functions_)) {
+        on_match(i);
+      }
     }
   }
+}
 
+std::vector<int64_t> BloomFilter::Intersect(
+    absl::Span<const std::string> elements) const {
+  std::vector<int64_t> res;
+  CheckBatch(elements, [&res](int64_t index) { res.push_back(index); });
+  return res;
+}
+
+int64_t BloomFilter::IntersectionSize(
+    absl::Span<const std::string> elements) const {
+  int64_t res = 0;
+  CheckBatch(elements, [&res](int64_t) { res++; });
   return res;
 }
 
 psi_proto::ServerSetup BloomFilter::ToProtobuf() const {
   psi_proto::ServerSetup server_setup;
-  server_setup.mutable_bloom_filter()->set_num_hash_functions(
-      NumHashFunctions());
-  server_setup.mutable_bloom_filter()->set_bits(bits_);
+  ToProtobuf(&server_setup);
   return server_setup;
 }
 
+void BloomFilter::ToProtobuf(psi_proto::ServerSetup* server_setup) const {
+  server_setup->mutable_bloom_filter()->set_num_hash_functions(
+      NumHashFunctions());
+  server_setup->mutable_bloom_filter()->mutable_bits()->assign(bits_.data(),
+                                                              bits_.size());
+}
+
+ServerSetupView BloomFilter::ToView() const {
+  ServerSetupView view;
+  view.data_structure_case = psi_proto::ServerSetup::kBloomFilter;
+  view.num_hash_functions = NumHashFunctions();
+  view.bits = bits_;
+  return view;
+}
+
 int BloomFilter::NumHashFunctions() const { return num_hash_functions_; }
 
-std::string BloomFilter::Bits() const { return bits_; }
+std::string BloomFilter::Bits() const { return std::string(bits_); }
 
 std::vector<int64_t> BloomFilter::Hash(const std::string& x) const {
-  // Compute the number of bits (= size of the output domain) as an OpenSSL
-  // BigNum.
+  std::vector<int64_t> result(num_hash_functions_);
+  Hash(x, result.data());
+  return result;
+}
+
+void BloomFilter::Hash(const std::string& x, int64_t* out) const {
+  HashBatch(absl::MakeConstSpan(&x, 1), out);
+}
+
+void BloomFilter::HashBatch(absl::Span<const std::string> inputs,
+                            int64_t* out) const {
   const int64_t num_bits = 8 * bits_.size();
-  const auto bn_num_bits = context_->CreateBigNum(num_bits);
 
-  // Compute the i-th hash function as SHA256(1 || x) + i * SHA256(2 || x)
-  // (modulo num_bits).
-  std::vector<int64_t> result(num_hash_functions_);
-  const int64_t h1 =
-      context_->CreateBigNum(context_->Sha256String(absl::StrCat(1, x)))
-          .Mod(bn_num_bits)
-          .ToIntValue()
-          .value();  // value() is safe here since bn_num_bits fits in an int64.
-  const int64_t h2 =
-      context_->CreateBigNum(context_->Sha256String(absl::StrCat(2, x)))
-          .Mod(bn_num_bits)
-          .ToIntValue()
-          .value();
-  for (int i = 0; i < num_hash_functions_; i++) {
-    result[i] = (h1 + i * h2) % num_bits;
+  // The i-th hash function is SHA256(1 || x) + i * SHA256(2 || x) (modulo
+  // num_bits), so both prefixed copies of every input are hashed together.
+  std::string messages;
+  for (const std::string& input : inputs) {
+    for (char prefix : {'1', '2'}) {
+      messages.push_back(prefix);
+      messages.append(input);
+    }
+  }
+  std::vector<absl::string_view> views;
+  views.reserve(2 * inputs.size());
+  size_t offset = 0;
+  for (const std::string& input : inputs) {
+    for (int j = 0; j < 2; j++) {
+      views.push_back(absl::string_view(messages).substr(offset,
+                                                         input.size() + 1));
+      offset += input.size() + 1;
+    }
+  }
+  std::vector<uint8_t> digests(views.size() * kSha256DigestSize);
+  BatchSha256(views, digests.data());
+
+  for (size_t k = 0; k < inputs.size(); k++) {
+    const int64_t h1 =
+        ReduceSha256Digest(&digests[2 * k * kSha256DigestSize], num_bits);
+    const int64_t h2 =
+        ReduceSha256Digest(&digests[(2 * k + 1) * kSha256DigestSize], num_bits);
+    for (int i = 0; i < num_hash_functions_; i++) {
+      out[k * num_hash_functions_ + i] = (h1 + i * h2) % num_bits;
+    }
   }
-  return result;
 }
 
 }  // namespace private_set_intersection
@@ -19,9 +19,12 @@
 
 #include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "private_join_and_compute/crypto/context.h"
+#include "private_set_intersection/cpp/datastructure/server_setup_view.h"
 #include "private_set_intersection/proto/psi.pb.h"
 
 namespace private_set_intersection {
@@ -65,13 +68,34 @@ class BloomFilter {
   static StatusOr<std::unique_ptr<BloomFilter>> CreateFromProtobuf(
       const psi_proto::ServerSetup& encoded_filter);
 
+  // Creates a Bloom filter that references the bits in `setup` without copying
+  // them. The buffer underlying `setup` must outlive the returned filter. The
+  // bits are only copied if elements are added to the filter later.
+  //
+  // Returns INVALID_ARGUMENT if `setup` does not hold a Bloom filter.
+  static StatusOr<std::unique_ptr<BloomFilter>> CreateFromView(
+      const ServerSetupView& setup);
+
+  // Returns the indices of all `elements` that pass `Check`, in ascending
+  // order. Elements are queried in windows so that the cache misses of
+  // different elements overlap, which matters once the filter is much larger
+  // than the last-level cache.
   std::vector<int64_t> Intersect(absl::Span<const std::string> elements) const;
 
+  // Returns the number of `elements` that pass `Check`, i.e. the size of
+  // `Intersect`, without tracking their indices.
+  int64_t IntersectionSize(absl::Span<const std::string> elements) const;
+
   // Adds `input` to the Bloom filter.
   void Add(const std::string& input);
 
-  // Adds all elements in `inputs` to the Bloom filter.
-  void Add(absl::Span<const std::string> inputs);
+  // Adds all elements in `inputs` to the Bloom filter. The bit indices of the
+  // inputs are computed up front and partitioned by cache-sized region of the
+  // filter, so that the writes to each region are applied together instead of
+  // being scattered over the whole filter. If `num_threads` is greater than
+  // one, the regions are split among that many threads, each writing to its
+  // own part of the filter.
+  void Add(absl::Span<const std::string> inputs, int num_threads = 0);
 
   // Checks if an element is present in the Bloom filter.
   bool Check(const std::string& input) const;
@@ -79,6 +103,14 @@ class BloomFilter {
   // Returns a protobuf representation of the Bloom filter
   psi_proto::ServerSetup ToProtobuf() const;
 
+  // Writes the protobuf representation of the Bloom filter to `server_setup`,
+  // which may live on an arena.
+  void ToProtobuf(psi_proto::ServerSetup* server_setup) const;
+
+  // Returns a view of the container, which is valid as long as the container
+  // is alive and unmodified.
+  ServerSetupView ToView() const;
+
   // Returns the number of hash functions of the Bloom filter.
   int NumHashFunctions() const;
 
@@ -86,8 +118,7 @@ class BloomFilter {
   std::string Bits() const;
 
  private:
-  BloomFilter(int num_hash_functions, std::string bits,
-              std::unique_ptr<::private_join_and_compute::Context> context);
+  BloomFilter(int num_hash_functions, std::string bits);
 
   // Hashes the input with all `num_hash_functions_` hash functions and
   // returns the result as a vector. The i-th hash  hash function is computed
@@ -95,15 +126,40 @@ class BloomFilter {
   // input and num_bits is the number of bits in the Bloom filter.
   std::vector<int64_t> Hash(const std::string& input) const;
 
+  // Same as `Hash`, but writes the `num_hash_functions_` indices to `out`.
+  void Hash(const std::string& input, int64_t* out) const;
+
+  // Same as `Hash` for each of `inputs`, writing `num_hash_functions_` indices
+  // per input to `out`. The SHA-256 digests of all inputs are computed
+  // together with `BatchSha256`.
+  void HashBatch(absl::Span<const std::string> inputs, int64_t* out) const;
+
+  // Sets all bits in `indices`, grouping the writes by region of the filter.
+  // Requires the bits to be owned.
+  void SetBits(absl::Span<const int64_t> indices, int num_threads);
+
+  // Calls `on_match` with the index of every element of `elements` that
+  // passes `Check`, in ascending order. The probe indices of a window of
+  // elements are computed and prefetched first, and only then resolved
+  // against the bits.
+  void CheckBatch(absl::Span<const std::string> elements,
+                  absl::FunctionRef<void(int64_t)> on_match) const;
+
   // Number of hash functions.
   int num_hash_functions_;
 
+  // Copies the bits into `bits_storage_` if they reference an external
+  // buffer, so that they can be modified.
+  void EnsureBitsOwned();
+
   // Compact representation of the bits. We use a std::string as opposed to
-  // std::vector<bool> to allow serialization with ToString().
-  std::string bits_;
+  // std::vector<bool> to allow serialization with ToString(). Empty if the
+  // filter was created from a view and not modified since.
+  std::string bits_storage_;
 
-  // OpenSSL context used for hashing.
-  std::unique_ptr<::private_join_and_compute::Context> context_;
+  // The bits of the filter, referencing either `bits_storage_` or an external
+  // buffer.
+  absl::string_view bits_;
 };
 
 }  // namespace private_set_intersection
@@ -19,6 +19,7 @@
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "gtest/gtest.h"
+#include "private_set_intersection/cpp/cpu_features.h"
 #include "private_set_intersection/cpp/util/status_matchers.h"
 #include "private_set_intersection/proto/psi.pb.h"
 
@@ -50,6 +51,67 @@ TEST_F(BloomFilterTest, TestAdd) {
   EXPECT_FALSE(filter_->Check("not present"));
 }
 
+TEST_F(BloomFilterTest, TestIntersectionSize) {
+  std::vector<std::string> elements = {"a", "b", "c", "d"};
+  filter_->Add(absl::MakeConstSpan(elements));
+
+  std::vector<std::string> queries = {"a", "x", "c", "y", "a"};
+  EXPECT_EQ(filter_->IntersectionSize(queries),
+            filter_->Intersect(queries).size());
+  EXPECT_EQ(filter_->IntersectionSize(queries), 3);
+}
+
+TEST_F(BloomFilterTest, TestBulkAddMatchesSingleAdds) {
+  // Large enough to span several regions of the partitioned build.
+  int max_elements = 100000;
+  std::vector<std::string> elements;
+  for (int i = 0; i < max_elements; i++) {
+    elements.push_back(absl::StrCat("Element ", i));
+  }
+  SetUp(0.000001, max_elements);
+  for (const std::string& element : elements) {
+    filter_->Add(element);
+  }
+  const std::string expected = filter_->Bits();
+
+  for (int num_threads : {0, 3}) {
+    SetUp(0.000001, max_elements);
+    filter_->Add(absl::MakeConstSpan(elements), num_threads);
+    EXPECT_EQ(filter_->Bits(), expected) << "num_threads: " << num_threads;
+  }
+}
+
+TEST_F(BloomFilterTest, TestIntersectMatchesCheck) {
+  // Includes filters of only a few bytes, and more queries than fit in a
+  // single query window. The lower false-positive rate needs enough hash
+  // functions to fill the widest gathers.
+  for (double fpr : {0.1, 0.0001}) {
+    for (int max_elements : {1, 3, 100, 10000}) {
+      SetUp(fpr, max_elements);
+      for (int i = 0; i < max_elements; i++) {
+        filter_->Add(absl::StrCat("Element ", 2 * i));
+      }
+      std::vector<std::string> queries;
+      std::vector<int64_t> expected;
+      for (int i = 0; i < 1000; i++) {
+        queries.push_back(absl::StrCat("Element ", i));
+        if (filter_->Check(queries.back())) {
+          expected.push_back(i);
+        }
+      }
+      for (CpuTier tier : {CpuTier::kScalar, CpuTier::kSse2, CpuTier::kAvx2,
+                           CpuTier::kAvx512}) {
+        ForceCpuTier(tier);
+        EXPECT_EQ(filter_->Intersect(queries), expected)
+            << absl::StrCat("fpr: ", fpr, ", max_elements: ", max_elements,
+                            ", tier: ", CpuTierName(tier));
+        EXPECT_EQ(filter_->IntersectionSize(queries), expected.size());
+      }
+      ClearForcedCpuTier();
+    }
+  }
+}
+
 TEST_F(BloomFilterTest, TestFPR) {
   for (int max_elements = 1 << 10; max_elements < (1 << 20);
        max_elements *= 2) {
@@ -0,0 +1,285 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/datastructure/chunked_setup.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "openssl/sha.h"
+
+namespace private_set_intersection {
+
+namespace {
+
+std::string Sha256(absl::string_view data) {
+  std::string digest(SHA256_DIGEST_LENGTH, '\0');
+  SHA256(reinterpret_cast<const uint8_t*>(data.data()), data.size(),
+         reinterpret_cast<uint8_t*>(&digest[0]));
+  return digest;
+}
+
+// Serializes `chunk` and records it in `result`.
+void AppendChunk(int64_t offset, int64_t length,
+                 const psi_proto::ServerSetupChunk& chunk,
+                 ChunkedServerSetup* result) {
+  std::string serialized = chunk.SerializeAsString();
+  auto* info = result->manifest.add_chunks();
+  info->set_offset(offset);
+  info->set_length(length);
+  info->set_sha256(Sha256(serialized));
+  result->chunks.push_back(std::move(serialized));
+}
+
+}  // namespace
+
+/**
+ * @brief Split a server setup into a manifest and chunks
+ *
+ * @param setup A view of the server setup
+ * @param max_chunk_size The maximum payload size of each chunk in bytes
+ *
+ * @return StatusOr<ChunkedServerSetup>
+ */
+StatusOr<ChunkedServerSetup> SplitServerSetup(const ServerSetupView& setup,
+                                              int64_t max_chunk_size) {
+  if (max_chunk_size <= 0) {
+    return absl::InvalidArgumentError("`max_chunk_size` must be positive");
+  }
+
+  ChunkedServerSetup result;
+  // Copy the parameters without the payload.
+  ServerSetupView parameters = setup;
+  parameters.encrypted_elements.clear();
+  parameters.bits = absl::string_view();
+  parameters.ToProtobuf(result.manifest.mutable_parameters());
+
+  switch (setup.data_structure_case) {
+    case psi_proto::ServerSetup::kRaw: {
+      const auto& elements = setup.encrypted_elements;
+      result.manifest.set_total_length(static_cast<int64_t>(elements.size()));
+      size_t begin = 0;
+      while (begin < elements.size()) {
+        psi_proto::ServerSetupChunk chunk;
+        chunk.set_index(result.manifest.chunks_size());
+        size_t end = begin;
+        int64_t chunk_size = 0;
+        while (end < elements.size()) {
+          const auto element_size = static_cast<int64_t>(elements[end].size());
+          if (end > begin && chunk_size + element_size > max_chunk_size) {
+            break;
+          }
+          chunk_size += element_size;
+          chunk.add_encrypted_elements()->assign(elements[end].data(),
+                                                 elements[end].size());
+          end++;
+        }
+        AppendChunk(static_cast<int64_t>(begin),
+                    static_cast<int64_t>(end - begin), chunk, &result);
+        begin = end;
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::kGcs:
+    case psi_proto::ServerSetup::kBloomFilter: {
+      const auto total_length = static_cast<int64_t>(setup.bits.size());
+      result.manifest.set_total_length(total_length);
+      for (int64_t offset = 0; offset < total_length;
+           offset += max_chunk_size) {
+        const int64_t length = std::min(max_chunk_size, total_length - offset);
+        psi_proto::ServerSetupChunk chunk;
+        chunk.set_index(result.manifest.chunks_size());
+        chunk.mutable_bits()->assign(setup.bits.data() + offset, length);
+        AppendChunk(offset, length, chunk, &result);
+      }
+      break;
+    }
+    default:
+      return absl::InvalidArgumentError("`ServerSetup` holds no container");
+  }
+  return result;
+}
+
+ServerSetupAssembler::ServerSetupAssembler(
+    psi_proto::ServerSetupManifest manifest)
+    : manifest_(std::move(manifest)),
+      states_(manifest_.chunks_size(), ChunkState::kMissing) {}
+
+/**
+ * @brief Prepare to assemble the setup described by a manifest
+ *
+ * @param manifest The manifest sent by the server
+ *
+ * @return StatusOr<std::unique_ptr<ServerSetupAssembler>>
+ */
+StatusOr<std::unique_ptr<ServerSetupAssembler>> ServerSetupAssembler::Create(
+    const psi_proto::ServerSetupManifest& manifest) {
+  const auto corrupt = []() {
+    return absl::InvalidArgumentError("`ServerSetupManifest` is corrupt!");
+  };
+  const auto& parameters = manifest.parameters();
+  if (parameters.data_structure_case() ==
+          psi_proto::ServerSetup::DATA_STRUCTURE_NOT_SET ||
+      !parameters.raw().encrypted_elements().empty() ||
+      !parameters.gcs().bits().empty() ||
+      !parameters.bloom_filter().bits().empty()) {
+    return corrupt();
+  }
+
+  // The chunks must tile the payload in order.
+  int64_t expected_offset = 0;
+  for (const auto& info : manifest.chunks()) {
+    if (info.offset() != expected_offset || info.length() < 0 ||
+        info.length() > manifest.total_length() - expected_offset ||
+        info.sha256().size() != SHA256_DIGEST_LENGTH) {
+      return corrupt();
+    }
+    expected_offset += info.length();
+  }
+  if (expected_offset != manifest.total_length()) {
+    return corrupt();
+  }
+
+  auto assembler = absl::WrapUnique(new ServerSetupAssembler(manifest));
+  if (parameters.has_raw()) {
+    assembler->elements_.resize(manifest.total_length());
+  } else {
+    assembler->bits_.resize(manifest.total_length());
+  }
+  return assembler;
+}
+
+/**
+ * @brief Verify a chunk and copy its payload into the assembled setup
+ *
+ * @param index The position of the chunk in the manifest
+ * @param serialized_chunk The serialized `ServerSetupChunk`
+ *
+ * @return absl::Status
+ */
+absl::Status ServerSetupAssembler::AddChunk(
+    int index, absl::string_view serialized_chunk) {
+  if (index < 0 || index >= manifest_.chunks_size()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Chunk index ", index, " is out of range"));
+  }
+  if (Sha256(serialized_chunk) != manifest_.chunks(index).sha256()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Chunk ", index, " does not match its checksum"));
+  }
+
+  {
+    absl::MutexLock lock(&mutex_);
+    if (states_[index] != ChunkState::kMissing) {
+      return absl::OkStatus();
+    }
+    states_[index] = ChunkState::kLoading;
+  }
+
+  psi_proto::ServerSetupChunk chunk;
+  absl::Status status;
+  if (!chunk.ParseFromArray(serialized_chunk.data(),
+                            static_cast<int>(serialized_chunk.size()))) {
+    status = absl::InvalidArgumentError(
+        absl::StrCat("Chunk ", index, " is corrupt!"));
+  } else {
+    status = CopyPayload(index, chunk);
+  }
+
+  absl::MutexLock lock(&mutex_);
+  if (status.ok()) {
+    states_[index] = ChunkState::kLoaded;
+    num_loaded_++;
+  } else {
+    states_[index] = ChunkState::kMissing;
+  }
+  return status;
+}
+
+absl::Status ServerSetupAssembler::CopyPayload(
+    int index, const psi_proto::ServerSetupChunk& chunk) {
+  const auto& info = manifest_.chunks(index);
+  if (chunk.index() != index) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Chunk ", index, " does not match its position"));
+  }
+  if (manifest_.parameters().has_raw()) {
+    if (!chunk.bits().empty() ||
+        chunk.encrypted_elements_size() != info.length()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Chunk ", index, " does not match its position"));
+    }
+    for (int i = 0; i < chunk.encrypted_elements_size(); i++) {
+      elements_[info.offset() + i] = chunk.encrypted_elements(i);
+    }
+  } else {
+    if (chunk.encrypted_elements_size() != 0 ||
+        static_cast<int64_t>(chunk.bits().size()) != info.length()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Chunk ", index, " does not match its position"));
+    }
+    std::copy(chunk.bits().begin(), chunk.bits().end(),
+              bits_.begin() + info.offset());
+  }
+  return absl::OkStatus();
+}
+
+std::vector<int> ServerSetupAssembler::MissingChunks() const {
+  absl::MutexLock lock(&mutex_);
+  std::vector<int> missing;
+  for (size_t i = 0; i < states_.size(); i++) {
+    if (states_[i] != ChunkState::kLoaded) {
+      missing.push_back(static_cast<int>(i));
+    }
+  }
+  return missing;
+}
+
+bool ServerSetupAssembler::IsComplete() const {
+  absl::MutexLock lock(&mutex_);
+  return num_loaded_ == static_cast<int>(states_.size());
+}
+
+StatusOr<ServerSetupView> ServerSetupAssembler::GetView() const {
+  if (!IsComplete()) {
+    return absl::FailedPreconditionError("Server setup has missing chunks");
+  }
+  const auto& parameters = manifest_.parameters();
+  ServerSetupView view;
+  view.data_structure_case = parameters.data_structure_case();
+  view.hash_to_curve = parameters.hash_to_curve();
+  view.point_encoding = parameters.point_encoding();
+  view.curve = parameters.curve();
+  switch (view.data_structure_case) {
+    case psi_proto::ServerSetup::kRaw:
+      view.encrypted_elements.assign(elements_.begin(), elements_.end());
+      break;
+    case psi_proto::ServerSetup::kGcs:
+      view.div = parameters.gcs().div();
+      view.hash_range = parameters.gcs().hash_range();
+      view.bits = bits_;
+      break;
+    default:
+      view.num_hash_functions = parameters.bloom_filter().num_hash_functions();
+      view.bits = bits_;
+      break;
+  }
+  return view;
+}
+
+}  // namespace private_set_intersection
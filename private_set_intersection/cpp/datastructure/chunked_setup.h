@@ -0,0 +1,109 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_CHUNKED_SETUP_H_
+#define PRIVATE_SET_INTERSECTION_CPP_CHUNKED_SETUP_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "private_set_intersection/cpp/datastructure/server_setup_view.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+
+using absl::StatusOr;
+
+// A server setup split into a manifest and serialized `ServerSetupChunk`
+// messages, see `psi_proto::ServerSetupManifest`.
+struct ChunkedServerSetup {
+  psi_proto::ServerSetupManifest manifest;
+  std::vector<std::string> chunks;
+};
+
+// Splits `setup` into chunks whose payload is at most `max_chunk_size` bytes.
+// A single Raw element larger than `max_chunk_size` gets a chunk of its own.
+//
+// Returns INVALID_ARGUMENT if `setup` holds no container or `max_chunk_size`
+// is not positive.
+StatusOr<ChunkedServerSetup> SplitServerSetup(const ServerSetupView& setup,
+                                              int64_t max_chunk_size);
+
+// Reassembles a setup from its chunks on the client. Chunks can be added in any
+// order and from multiple threads at once. `MissingChunks` reports what is
+// left to fetch, so that an interrupted transfer can be resumed.
+class ServerSetupAssembler {
+ public:
+  ServerSetupAssembler() = delete;
+  ServerSetupAssembler(const ServerSetupAssembler&) = delete;
+  ServerSetupAssembler& operator=(const ServerSetupAssembler&) = delete;
+
+  // Prepares to receive the chunks listed in `manifest`.
+  //
+  // Returns INVALID_ARGUMENT if `manifest` is malformed.
+  static StatusOr<std::unique_ptr<ServerSetupAssembler>> Create(
+      const psi_proto::ServerSetupManifest& manifest);
+
+  // Verifies the serialized chunk at position `index` of the manifest and
+  // copies its payload into place. Adding a chunk that was already added is a
+  // no-op.
+  //
+  // Returns INVALID_ARGUMENT if `index` is out of range or the chunk does not
+  // match its checksum or position in the manifest.
+  absl::Status AddChunk(int index, absl::string_view serialized_chunk);
+
+  // Returns the indices of chunks that have not been added yet.
+  std::vector<int> MissingChunks() const;
+
+  // Returns true once all chunks have been added.
+  bool IsComplete() const;
+
+  // Returns a view of the assembled setup, which is valid as long as this
+  // assembler is alive.
+  //
+  // Returns FAILED_PRECONDITION if chunks are missing.
+  StatusOr<ServerSetupView> GetView() const;
+
+ private:
+  enum class ChunkState { kMissing, kLoading, kLoaded };
+
+  explicit ServerSetupAssembler(psi_proto::ServerSetupManifest manifest);
+
+  // Copies the payload of `chunk` into `bits_` or `elements_`.
+  absl::Status CopyPayload(int index, const psi_proto::ServerSetupChunk& chunk);
+
+  const psi_proto::ServerSetupManifest manifest_;
+
+  // The assembled payload. Chunks write to disjoint ranges, so only the chunk
+  // states need to be guarded.
+  std::string bits_;
+  std::vector<std::string> elements_;
+
+  mutable absl::Mutex mutex_;
+  std::vector<ChunkState> states_ ABSL_GUARDED_BY(mutex_);
+  int num_loaded_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_CHUNKED_SETUP_H_
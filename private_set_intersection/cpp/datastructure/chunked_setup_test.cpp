@@ -0,0 +1,209 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/datastructure/chunked_setup.h"
+
+#include <thread>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "private_set_intersection/cpp/util/status_matchers.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+namespace {
+
+psi_proto::ServerSetup MakeBloomFilterSetup(int num_bytes) {
+  psi_proto::ServerSetup setup;
+  setup.mutable_bloom_filter()->set_num_hash_functions(11);
+  std::string bits(num_bytes, '\0');
+  for (int i = 0; i < num_bytes; i++) {
+    bits[i] = static_cast<char>(i * 37);
+  }
+  setup.mutable_bloom_filter()->set_bits(bits);
+  return setup;
+}
+
+psi_proto::ServerSetup MakeRawSetup(int num_elements) {
+  psi_proto::ServerSetup setup;
+  for (int i = 0; i < num_elements; i++) {
+    setup.mutable_raw()->add_encrypted_elements(absl::StrCat("Element ", i));
+  }
+  return setup;
+}
+
+// Splits `setup`, reassembles it adding the chunks in reverse order, and
+// returns the reassembled setup.
+psi_proto::ServerSetup RoundTrip(const psi_proto::ServerSetup& setup,
+                                 int64_t max_chunk_size,
+                                 int* num_chunks = nullptr) {
+  psi_proto::ServerSetup result;
+  auto view = ServerSetupView::FromProtobuf(setup);
+  EXPECT_TRUE(view.ok());
+  auto chunked = SplitServerSetup(*view, max_chunk_size);
+  EXPECT_TRUE(chunked.ok());
+  if (num_chunks != nullptr) {
+    *num_chunks = static_cast<int>(chunked->chunks.size());
+  }
+
+  auto assembler = ServerSetupAssembler::Create(chunked->manifest);
+  EXPECT_TRUE(assembler.ok());
+  for (int i = static_cast<int>(chunked->chunks.size()) - 1; i >= 0; i--) {
+    EXPECT_TRUE((*assembler)->AddChunk(i, chunked->chunks[i]).ok());
+  }
+  EXPECT_TRUE((*assembler)->IsComplete());
+  auto assembled = (*assembler)->GetView();
+  EXPECT_TRUE(assembled.ok());
+  assembled->ToProtobuf(&result);
+  return result;
+}
+
+TEST(ChunkedSetupTest, TestBloomFilterRoundTrip) {
+  psi_proto::ServerSetup setup = MakeBloomFilterSetup(1000);
+  setup.set_hash_to_curve(psi_proto::HASH_TO_CURVE_P256_SSWU);
+  setup.set_point_encoding(psi_proto::POINT_ENCODING_X_ONLY);
+  setup.set_curve(psi_proto::CURVE_RISTRETTO255);
+  int num_chunks;
+  psi_proto::ServerSetup result = RoundTrip(setup, 300, &num_chunks);
+  EXPECT_EQ(num_chunks, 4);
+  EXPECT_EQ(result.SerializeAsString(), setup.SerializeAsString());
+}
+
+TEST(ChunkedSetupTest, TestGcsRoundTrip) {
+  psi_proto::ServerSetup setup;
+  setup.mutable_gcs()->set_div(5);
+  setup.mutable_gcs()->set_hash_range(1234567);
+  setup.mutable_gcs()->set_bits(std::string(100, '\x33'));
+  EXPECT_EQ(RoundTrip(setup, 7).SerializeAsString(),
+            setup.SerializeAsString());
+}
+
+TEST(ChunkedSetupTest, TestRawRoundTrip) {
+  psi_proto::ServerSetup setup = MakeRawSetup(100);
+  int num_chunks;
+  psi_proto::ServerSetup result = RoundTrip(setup, 100, &num_chunks);
+  EXPECT_GT(num_chunks, 1);
+  EXPECT_EQ(result.SerializeAsString(), setup.SerializeAsString());
+
+  // Elements larger than a chunk are sent one per chunk.
+  EXPECT_EQ(RoundTrip(setup, 1, &num_chunks).SerializeAsString(),
+            setup.SerializeAsString());
+  EXPECT_EQ(num_chunks, 100);
+}
+
+TEST(ChunkedSetupTest, TestEmptySetup) {
+  psi_proto::ServerSetup setup;
+  setup.mutable_bloom_filter()->set_num_hash_functions(3);
+  int num_chunks;
+  EXPECT_EQ(RoundTrip(setup, 10, &num_chunks).SerializeAsString(),
+            setup.SerializeAsString());
+  EXPECT_EQ(num_chunks, 0);
+}
+
+TEST(ChunkedSetupTest, TestResumeAndDuplicateChunks) {
+  const psi_proto::ServerSetup setup = MakeBloomFilterSetup(100);
+  PSI_ASSERT_OK_AND_ASSIGN(auto view, ServerSetupView::FromProtobuf(setup));
+  PSI_ASSERT_OK_AND_ASSIGN(auto chunked, SplitServerSetup(view, 10));
+  PSI_ASSERT_OK_AND_ASSIGN(auto assembler,
+                           ServerSetupAssembler::Create(chunked.manifest));
+
+  for (int i = 0; i < 10; i += 2) {
+    ASSERT_TRUE(assembler->AddChunk(i, chunked.chunks[i]).ok());
+  }
+  EXPECT_FALSE(assembler->IsComplete());
+  EXPECT_THAT(assembler->GetView(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_EQ(assembler->MissingChunks(), std::vector<int>({1, 3, 5, 7, 9}));
+
+  for (int i : assembler->MissingChunks()) {
+    ASSERT_TRUE(assembler->AddChunk(i, chunked.chunks[i]).ok());
+  }
+  ASSERT_TRUE(assembler->AddChunk(0, chunked.chunks[0]).ok());
+  EXPECT_TRUE(assembler->MissingChunks().empty());
+  PSI_ASSERT_OK_AND_ASSIGN(auto assembled, assembler->GetView());
+  EXPECT_EQ(assembled.bits, view.bits);
+}
+
+TEST(ChunkedSetupTest, TestParallelAssembly) {
+  const psi_proto::ServerSetup setup = MakeRawSetup(1000);
+  PSI_ASSERT_OK_AND_ASSIGN(auto view, ServerSetupView::FromProtobuf(setup));
+  PSI_ASSERT_OK_AND_ASSIGN(auto chunked, SplitServerSetup(view, 64));
+  PSI_ASSERT_OK_AND_ASSIGN(auto assembler,
+                           ServerSetupAssembler::Create(chunked.manifest));
+
+  const int num_threads = 4;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = t; i < chunked.chunks.size(); i += num_threads) {
+        EXPECT_TRUE(assembler->AddChunk(static_cast<int>(i), chunked.chunks[i])
+                        .ok());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  PSI_ASSERT_OK_AND_ASSIGN(auto assembled, assembler->GetView());
+  EXPECT_EQ(assembled.encrypted_elements, view.encrypted_elements);
+}
+
+TEST(ChunkedSetupTest, FailIfChunkIsCorrupt) {
+  const psi_proto::ServerSetup setup = MakeBloomFilterSetup(100);
+  PSI_ASSERT_OK_AND_ASSIGN(auto view, ServerSetupView::FromProtobuf(setup));
+  PSI_ASSERT_OK_AND_ASSIGN(auto chunked, SplitServerSetup(view, 10));
+  PSI_ASSERT_OK_AND_ASSIGN(auto assembler,
+                           ServerSetupAssembler::Create(chunked.manifest));
+
+  std::string corrupted = chunked.chunks[3];
+  corrupted.back() ^= 1;
+  EXPECT_THAT(assembler->AddChunk(3, corrupted),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Chunk 3 does not match its checksum"));
+  EXPECT_THAT(assembler->AddChunk(4, chunked.chunks[3]),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(assembler->AddChunk(10, chunked.chunks[3]),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Chunk index 10 is out of range"));
+  EXPECT_EQ(assembler->MissingChunks().size(), 10);
+
+  EXPECT_THAT(SplitServerSetup(view, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ChunkedSetupTest, FailIfManifestIsCorrupt) {
+  const psi_proto::ServerSetup setup = MakeBloomFilterSetup(100);
+  PSI_ASSERT_OK_AND_ASSIGN(auto view, ServerSetupView::FromProtobuf(setup));
+  PSI_ASSERT_OK_AND_ASSIGN(auto chunked, SplitServerSetup(view, 10));
+
+  psi_proto::ServerSetupManifest manifest = chunked.manifest;
+  manifest.set_total_length(101);
+  EXPECT_THAT(ServerSetupAssembler::Create(manifest),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  manifest = chunked.manifest;
+  manifest.mutable_chunks(2)->set_offset(25);
+  EXPECT_THAT(ServerSetupAssembler::Create(manifest),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  manifest = chunked.manifest;
+  manifest.clear_parameters();
+  EXPECT_THAT(ServerSetupAssembler::Create(manifest),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace private_set_intersection
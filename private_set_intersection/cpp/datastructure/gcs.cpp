@@ -22,40 +22,54 @@
 
 #include "absl/memory/memory.h"
 #include "absl/strings/escaping.h"
+#include "private_set_intersection/cpp/crypto/batch_sha256.h"
 #include "private_set_intersection/cpp/datastructure/golomb.h"
 #include "private_set_intersection/proto/psi.pb.h"
 
 namespace private_set_intersection {
 
-GCS::GCS(std::string golomb, int64_t div, int64_t hash_range,
-         std::unique_ptr<::private_join_and_compute::Context> context)
-    : golomb_(std::move(golomb)),
+namespace {
+
+// Number of elements hashed at once by `HashBatch`, so that their digests stay
+// in cache.
+constexpr size_t kHashChunkSize = 1024;
+
+}  // namespace
+
+GCS::GCS(std::string golomb, int64_t div, int64_t hash_range)
+    : golomb_storage_(std::move(golomb)),
+      golomb_(golomb_storage_),
       div_(div),
-      hash_range_(hash_range),
-      context_(std::move(context)) {}
+      hash_range_(hash_range) {}
 
 StatusOr<std::unique_ptr<GCS>> GCS::Create(
     double fpr, int64_t num_client_inputs,
     absl::Span<const std::string> elements) {
+  ASSIGN_OR_RETURN(
+      int64_t hash_range,
+      ComputeHashRange(fpr, num_client_inputs,
+                       static_cast<int64_t>(elements.size())));
+  std::vector<int64_t> hashes(elements.size());
+  HashBatch(elements, hash_range, hashes.data());
+  return CreateFromHashes(hash_range, std::move(hashes));
+}
+
+StatusOr<int64_t> GCS::ComputeHashRange(double fpr, int64_t num_client_inputs,
+                                        int64_t num_server_inputs) {
   if (fpr <= 0 || fpr >= 1) {
     return absl::InvalidArgumentError("`fpr` must be in (0,1)");
   }
-  auto num_server_inputs = static_cast<int64_t>(elements.size());
-  auto hash_range = static_cast<int64_t>(
-      std::max(num_client_inputs, num_server_inputs) / fpr);
-  std::vector<int64_t> hashes;
-  hashes.reserve(elements.size());
-  auto context = absl::make_unique<::private_join_and_compute::Context>();
-
-  for (const std::string& element : elements) {
-    hashes.push_back(Hash(element, hash_range, *context));
-  }
+  return static_cast<int64_t>(std::max(num_client_inputs, num_server_inputs) /
+                              fpr);
+}
 
+std::unique_ptr<GCS> GCS::CreateFromHashes(int64_t hash_range,
+                                           std::vector<int64_t> hashes) {
   std::sort(hashes.begin(), hashes.end());
   auto compressed = golomb_compress(hashes);
   auto div = compressed.div;
-  return absl::WrapUnique(new GCS(std::move(compressed.compressed), div,
-                                  hash_range, std::move(context)));
+  return absl::WrapUnique(
+      new GCS(std::move(compressed.compressed), div, hash_range));
 }
 
 StatusOr<std::unique_ptr<GCS>> GCS::CreateFromProtobuf(
@@ -64,22 +78,49 @@ StatusOr<std::unique_ptr<GCS>> GCS::CreateFromProtobuf(
     return absl::InvalidArgumentError("`ServerSetup` is corrupt!");
   }
 
-  auto context = absl::make_unique<::private_join_and_compute::Context>();
-  return absl::WrapUnique(new GCS(std::move(encoded_set.gcs().bits()),
+  return absl::WrapUnique(new GCS(encoded_set.gcs().bits(),
                                   static_cast<int64_t>(encoded_set.gcs().div()),
-                                  encoded_set.gcs().hash_range(),
-                                  std::move(context)));
+                                  encoded_set.gcs().hash_range()));
+}
+
+StatusOr<std::unique_ptr<GCS>> GCS::CreateFromView(
+    const ServerSetupView& setup) {
+  if (setup.data_structure_case != psi_proto::ServerSetup::kGcs) {
+    return absl::InvalidArgumentError("`ServerSetup` does not hold a GCS");
+  }
+
+  auto gcs =
+      absl::WrapUnique(new GCS(std::string(), setup.div, setup.hash_range));
+  gcs->golomb_ = setup.bits;
+  return gcs;
 }
 
 std::vector<int64_t> GCS::Intersect(
     absl::Span<const std::string> elements) const {
+  std::vector<int64_t> element_hashes(elements.size());
+  HashElements(elements, element_hashes.data());
   std::vector<std::pair<int64_t, int64_t>> hashes;
   hashes.reserve(elements.size());
-
   for (size_t i = 0; i < elements.size(); i++) {
-    hashes.emplace_back(Hash(elements[i], hash_range_, *context_), i);
+    hashes.emplace_back(element_hashes[i], i);
   }
 
+  return IntersectHashes(std::move(hashes));
+}
+
+int64_t GCS::IntersectionSize(absl::Span<const std::string> elements) const {
+  std::vector<int64_t> hashes(elements.size());
+  HashElements(elements, hashes.data());
+  return IntersectionSizeOfHashes(std::move(hashes));
+}
+
+int64_t GCS::IntersectionSizeOfHashes(std::vector<int64_t> hashes) const {
+  std::sort(hashes.begin(), hashes.end());
+  return golomb_intersection_size(golomb_, div_, hashes);
+}
+
+std::vector<int64_t> GCS::IntersectHashes(
+    std::vector<std::pair<int64_t, int64_t>> hashes) const {
   std::sort(
       hashes.begin(), hashes.end(),
       [](const std::pair<int64_t, int64_t>& a,
@@ -89,30 +130,131 @@ std::vector<int64_t> GCS::Intersect(
   return res;
 }
 
+void GCS::ForEachIntersectingHash(
+    std::vector<std::pair<int64_t, int64_t>> hashes,
+    absl::FunctionRef<void(int64_t)> visit) const {
+  std::sort(
+      hashes.begin(), hashes.end(),
+      [](const std::pair<int64_t, int64_t>& a,
+         const std::pair<int64_t, int64_t>& b) { return a.first < b.first; });
+  golomb_intersect_for_each(golomb_, div_, hashes, visit);
+}
+
 psi_proto::ServerSetup GCS::ToProtobuf() const {
   psi_proto::ServerSetup server_setup;
-  server_setup.mutable_gcs()->set_bits(golomb_);
-  server_setup.mutable_gcs()->set_div(static_cast<int32_t>(div_));
-  server_setup.mutable_gcs()->set_hash_range(hash_range_);
+  ToProtobuf(&server_setup);
   return server_setup;
 }
 
+void GCS::ToProtobuf(psi_proto::ServerSetup* server_setup) const {
+  server_setup->mutable_gcs()->mutable_bits()->assign(golomb_.data(),
+                                                      golomb_.size());
+  server_setup->mutable_gcs()->set_div(static_cast<int32_t>(div_));
+  server_setup->mutable_gcs()->set_hash_range(hash_range_);
+}
+
+ServerSetupView GCS::ToView() const {
+  ServerSetupView view;
+  view.data_structure_case = psi_proto::ServerSetup::kGcs;
+  view.div = div_;
+  view.hash_range = hash_range_;
+  view.bits = golomb_;
+  return view;
+}
+
 int64_t GCS::Div() const { return div_; }
 
 int64_t GCS::HashRange() const { return hash_range_; }
 
-std::string GCS::Golomb() const { return golomb_; }
+std::string GCS::Golomb() const { return std::string(golomb_); }
 
-int64_t GCS::Hash(const std::string& input, int64_t hash_range,
-                  ::private_join_and_compute::Context& context) {
-  const auto bn_num_bits = context.CreateBigNum(hash_range);
+std::vector<int64_t> GCS::Decompress() const {
+  return golomb_decompress(golomb_, div_);
+}
+
+int64_t GCS::HashElement(const std::string& element) const {
+  return Hash(element, hash_range_);
+}
+
+void GCS::HashElements(absl::Span<const std::string> elements,
+                       int64_t* out) const {
+  HashBatch(elements, hash_range_, out);
+}
+
+int64_t GCS::Hash(absl::string_view input, int64_t hash_range) {
+  uint8_t digest[kSha256DigestSize];
+  BatchSha256(absl::MakeConstSpan(&input, 1), digest);
+  return ReduceSha256Digest(digest, hash_range);
+}
+
+void GCS::HashBatch(absl::Span<const std::string> inputs, int64_t hash_range,
+                    int64_t* out) {
+  std::vector<absl::string_view> views;
+  std::vector<uint8_t> digests;
+  for (size_t begin = 0; begin < inputs.size(); begin += kHashChunkSize) {
+    const size_t size = std::min(kHashChunkSize, inputs.size() - begin);
+    views.assign(inputs.begin() + begin, inputs.begin() + begin + size);
+    digests.resize(size * kSha256DigestSize);
+    BatchSha256(views, digests.data());
+    for (size_t i = 0; i < size; i++) {
+      out[begin + i] =
+          ReduceSha256Digest(&digests[i * kSha256DigestSize], hash_range);
+    }
+  }
+}
+
+GCSStreamingIntersector::GCSStreamingIntersector(
+    int64_t div, std::vector<std::pair<int64_t, int64_t>> hashes)
+    : decoder_(absl::make_unique<GolombStreamDecoder>(div)),
+      hashes_(std::move(hashes)) {}
+
+GCSStreamingIntersector::~GCSStreamingIntersector() = default;
+
+StatusOr<std::unique_ptr<GCSStreamingIntersector>>
+GCSStreamingIntersector::Create(int64_t div, int64_t hash_range,
+                                absl::Span<const std::string> elements) {
+  if (div < 0 || div > 62 || hash_range <= 0) {
+    return absl::InvalidArgumentError("GCS parameters are out of range");
+  }
+
+  std::vector<int64_t> element_hashes(elements.size());
+  GCS::HashBatch(elements, hash_range, element_hashes.data());
+  std::vector<std::pair<int64_t, int64_t>> hashes;
+  hashes.reserve(elements.size());
+  for (size_t i = 0; i < elements.size(); i++) {
+    hashes.emplace_back(element_hashes[i], i);
+  }
+  std::sort(
+      hashes.begin(), hashes.end(),
+      [](const std::pair<int64_t, int64_t>& a,
+         const std::pair<int64_t, int64_t>& b) { return a.first < b.first; });
 
-  const int64_t h =
-      context.CreateBigNum(context.Sha256String(input))
-          .Mod(bn_num_bits)
-          .ToIntValue()
-          .value();  // value() is safe here since bn_num_bits fits in an int64.
-  return h;
+  return absl::WrapUnique(new GCSStreamingIntersector(div, std::move(hashes)));
 }
 
+std::vector<int64_t> GCSStreamingIntersector::Push(absl::string_view chunk) {
+  std::vector<int64_t> res;
+  if (done()) {
+    return res;
+  }
+
+  decoded_.clear();
+  decoder_->Push(chunk, &decoded_);
+  for (int64_t value : decoded_) {
+    while (next_ < hashes_.size() && hashes_[next_].first < value) {
+      ++next_;
+    }
+    while (next_ < hashes_.size() && hashes_[next_].first == value) {
+      res.push_back(hashes_[next_].second);
+      ++next_;
+    }
+    if (done()) {
+      break;
+    }
+  }
+  return res;
+}
+
+bool GCSStreamingIntersector::done() const { return next_ == hashes_.size(); }
+
 }  // namespace private_set_intersection
@@ -17,11 +17,16 @@
 #ifndef PRIVATE_SET_INTERSECTION_CPP_GCS_H_
 #define PRIVATE_SET_INTERSECTION_CPP_GCS_H_
 
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "private_join_and_compute/crypto/context.h"
+#include "private_set_intersection/cpp/datastructure/server_setup_view.h"
 #include "private_set_intersection/proto/psi.pb.h"
 
 namespace private_set_intersection {
@@ -36,33 +41,144 @@ class GCS {
       double fpr, int64_t num_client_inputs,
       absl::Span<const std::string> elements);
 
+  // Returns the hash range that `Create` uses for these parameters.
+  //
+  // Returns INVALID_ARGUMENT if `fpr` is not in (0,1).
+  static StatusOr<int64_t> ComputeHashRange(double fpr,
+                                            int64_t num_client_inputs,
+                                            int64_t num_server_inputs);
+
+  // Creates a GCS from the hashes of its elements, in any order, as computed by
+  // `Hash` with the same `hash_range`. This lets callers hash elements as they
+  // become available instead of holding on to them.
+  static std::unique_ptr<GCS> CreateFromHashes(int64_t hash_range,
+                                               std::vector<int64_t> hashes);
+
+  // Hashes `input` to [0, hash_range).
+  static int64_t Hash(absl::string_view input, int64_t hash_range);
+
+  // Hashes each of `inputs` to [0, hash_range) like `Hash`, writing the
+  // results to `out`. The SHA-256 digests are computed with `BatchSha256`.
+  static void HashBatch(absl::Span<const std::string> inputs,
+                        int64_t hash_range, int64_t* out);
+
+  // Creates a GCS holding a copy of the set encoded in `encoded_set`.
   static StatusOr<std::unique_ptr<GCS>> CreateFromProtobuf(
       const psi_proto::ServerSetup& encoded_set);
 
+  // Creates a GCS that references the compressed set in `setup` without
+  // copying it. The buffer underlying `setup` must outlive the returned GCS.
+  //
+  // Returns INVALID_ARGUMENT if `setup` does not hold a GCS.
+  static StatusOr<std::unique_ptr<GCS>> CreateFromView(
+      const ServerSetupView& setup);
+
   std::vector<int64_t> Intersect(absl::Span<const std::string> elements) const;
 
+  // As `Intersect`, but takes pairs of an element's `HashElement` and its
+  // index, in any order. Returns the indices of the matching pairs. This lets
+  // callers hash elements as they are produced and discard them.
+  std::vector<int64_t> IntersectHashes(
+      std::vector<std::pair<int64_t, int64_t>> hashes) const;
+
+  // As `IntersectHashes`, but calls `visit` with each matching index instead of
+  // collecting them.
+  void ForEachIntersectingHash(
+      std::vector<std::pair<int64_t, int64_t>> hashes,
+      absl::FunctionRef<void(int64_t)> visit) const;
+
+  // Returns the number of `elements` in the set, i.e. the size of `Intersect`,
+  // without tracking their indices.
+  int64_t IntersectionSize(absl::Span<const std::string> elements) const;
+
+  // As `IntersectionSize`, but takes the `HashElement` of each element, in any
+  // order.
+  int64_t IntersectionSizeOfHashes(std::vector<int64_t> hashes) const;
+
   psi_proto::ServerSetup ToProtobuf() const;
 
+  // Writes the protobuf representation to `server_setup`, which may live on an
+  // arena.
+  void ToProtobuf(psi_proto::ServerSetup* server_setup) const;
+
+  // Returns a view of the container, which is valid as long as the container
+  // is alive and unmodified.
+  ServerSetupView ToView() const;
+
   int64_t Div() const;
 
   int64_t HashRange() const;
 
   std::string Golomb() const;
 
+  // Returns the sorted hashes encoded in the compressed set.
+  std::vector<int64_t> Decompress() const;
+
+  // Returns the hash of `element` in [0, HashRange()), as matched against the
+  // compressed set by `Intersect`.
+  int64_t HashElement(const std::string& element) const;
+
+  // Writes the `HashElement` of each of `elements` to `out`.
+  void HashElements(absl::Span<const std::string> elements,
+                    int64_t* out) const;
+
  private:
-  GCS(std::string golomb, int64_t div, int64_t hash_range,
-      std::unique_ptr<::private_join_and_compute::Context> context);
+  GCS(std::string golomb, int64_t div, int64_t hash_range);
 
-  static int64_t Hash(const std::string& input, int64_t hash_range,
-                      ::private_join_and_compute::Context& context);
+  // Owns the compressed set unless this GCS was created from a view.
+  std::string golomb_storage_;
 
-  std::string golomb_;
+  // The compressed set, referencing either `golomb_storage_` or an external
+  // buffer.
+  absl::string_view golomb_;
 
   int64_t div_;
 
   int64_t hash_range_;
+};
+
+class GolombStreamDecoder;
+
+// Intersects client elements with a GCS whose compressed bits are pushed in
+// chunks, e.g. while they are still being downloaded, so that decoding
+// overlaps with the transfer. Matches are reported as soon as the values
+// matching them are decoded.
+class GCSStreamingIntersector {
+ public:
+  GCSStreamingIntersector() = delete;
+  GCSStreamingIntersector(const GCSStreamingIntersector&) = delete;
+  GCSStreamingIntersector& operator=(const GCSStreamingIntersector&) = delete;
+  ~GCSStreamingIntersector();
+
+  // Hashes and sorts `elements` for a GCS with the given `div` and
+  // `hash_range`, which are known before its bits arrive.
+  //
+  // Returns INVALID_ARGUMENT if the parameters are out of range.
+  static StatusOr<std::unique_ptr<GCSStreamingIntersector>> Create(
+      int64_t div, int64_t hash_range, absl::Span<const std::string> elements);
+
+  // Decodes the next chunk of the compressed set and returns the indices of
+  // the elements it matched.
+  std::vector<int64_t> Push(absl::string_view chunk);
+
+  // Returns true once all elements have been resolved, so that the remaining
+  // chunks cannot produce any more matches.
+  bool done() const;
+
+ private:
+  GCSStreamingIntersector(int64_t div,
+                          std::vector<std::pair<int64_t, int64_t>> hashes);
+
+  std::unique_ptr<GolombStreamDecoder> decoder_;
+
+  // Hashes of the client elements with their indices, sorted by hash.
+  const std::vector<std::pair<int64_t, int64_t>> hashes_;
+
+  // The first element of `hashes_` not resolved yet.
+  size_t next_ = 0;
 
-  std::unique_ptr<::private_join_and_compute::Context> context_;
+  // Reused buffer for values decoded from a chunk.
+  std::vector<int64_t> decoded_;
 };
 
 }  // namespace private_set_intersection
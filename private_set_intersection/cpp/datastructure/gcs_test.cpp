@@ -52,6 +52,38 @@ TEST(GCSTest, TestIntersect) {
   }
 }
 
+TEST(GCSTest, TestIntersectionSize) {
+  std::vector<std::string> elements = {"a", "b", "c", "d"};
+  std::vector<std::string> elements2 = {"a", "b", "d", "e", "a"};
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto gcs, GCS::Create(0.001, 5, elements));
+  EXPECT_EQ(gcs->IntersectionSize(elements2),
+            gcs->Intersect(elements2).size());
+  EXPECT_EQ(gcs->IntersectionSize(elements2), 4);
+
+  std::vector<int64_t> hashes;
+  for (const std::string& element : elements2) {
+    hashes.push_back(gcs->HashElement(element));
+  }
+  EXPECT_EQ(gcs->IntersectionSizeOfHashes(hashes), 4);
+}
+
+TEST(GCSTest, TestHash) {
+  // SHA-256 of the input, as a big-endian integer, modulo the hash range.
+  EXPECT_EQ(GCS::Hash("a", 1000003), 695814);
+  EXPECT_EQ(GCS::Hash("Element 1", int64_t{1} << 62), 4320762978856082600);
+
+  std::vector<std::string> elements;
+  for (int i = 0; i < 100; i++) {
+    elements.push_back(absl::StrCat("Element ", i));
+  }
+  std::vector<int64_t> hashes(elements.size());
+  GCS::HashBatch(elements, 1000003, hashes.data());
+  for (size_t i = 0; i < elements.size(); i++) {
+    EXPECT_EQ(hashes[i], GCS::Hash(elements[i], 1000003));
+  }
+}
+
 TEST(GCSTest, TestFPR) {
   for (int max_elements = 1 << 10; max_elements < (1 << 20);
        max_elements *= 2) {
@@ -176,5 +208,35 @@ TEST(GCSTest, TestGolombSize) {
   }
 }
 
+TEST(GCSTest, TestStreamingIntersector) {
+  std::vector<std::string> server, client;
+  for (int i = 0; i < 1000; i++) {
+    server.push_back(absl::StrCat("Element ", 2 * i));
+  }
+  for (int i = 0; i < 200; i++) {
+    client.push_back(absl::StrCat("Element ", i));
+  }
+  PSI_ASSERT_OK_AND_ASSIGN(auto gcs, GCS::Create(1e-6, 200, server));
+  const std::string bits = gcs->Golomb();
+  std::vector<int64_t> expected = gcs->Intersect(client);
+
+  for (size_t chunk_size : {1, 7, 1000000}) {
+    PSI_ASSERT_OK_AND_ASSIGN(auto intersector,
+                             GCSStreamingIntersector::Create(
+                                 gcs->Div(), gcs->HashRange(), client));
+    std::vector<int64_t> res;
+    for (size_t i = 0; i < bits.size() && !intersector->done();
+         i += chunk_size) {
+      std::vector<int64_t> matches =
+          intersector->Push(absl::string_view(bits).substr(i, chunk_size));
+      res.insert(res.end(), matches.begin(), matches.end());
+    }
+    EXPECT_EQ(res, expected);
+  }
+
+  EXPECT_THAT(GCSStreamingIntersector::Create(-1, 100, client),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 }  // namespace
 }  // namespace private_set_intersection
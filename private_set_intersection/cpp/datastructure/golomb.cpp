@@ -22,10 +22,14 @@
 #include <utility>
 #include <vector>
 
+#include "private_set_intersection/cpp/cpu_features.h"
+
 namespace private_set_intersection {
 
-GolombCompressed golomb_compress(const std::vector<int64_t>& sorted_arr,
-                                 int div_param) {
+namespace {
+
+GolombCompressed golomb_compress_impl(const std::vector<int64_t>& sorted_arr,
+                                      int div_param) {
   if (sorted_arr.empty()) {
     struct GolombCompressed res;
     res.div = 0;
@@ -97,21 +101,16 @@ GolombCompressed golomb_compress(const std::vector<int64_t>& sorted_arr,
   return res;
 }
 
-std::vector<int64_t> golomb_intersect(
-    const std::string& golomb_compressed, int64_t div,
-    const std::vector<std::pair<int64_t, int64_t>>& sorted_arr) {
-  if (golomb_compressed.empty()) {
-    return std::vector<int64_t>();
-  }
-
+// Decodes the values of `golomb_compressed` in ascending order and passes each
+// one to `visit`. Decoding stops early once `visit` returns false.
+template <typename Visitor>
+void golomb_for_each_impl(absl::string_view golomb_compressed, int64_t div,
+                          Visitor visit) {
   auto it = golomb_compressed.begin();
-  auto arr_it = sorted_arr.begin();
 
   int64_t prefix_sum = 0;
   int64_t offset = 0;
 
-  std::vector<int64_t> res;
-
   while (true) {
     int64_t quotient = 0;
 
@@ -160,25 +159,159 @@ std::vector<int64_t> golomb_intersect(
     auto delta = (quotient << div) | remainder;
     prefix_sum += delta;
 
+    if (!visit(prefix_sum)) {
+      break;
+    }
+  }
+}
+
+// The bit manipulation instructions of the AVX2 tier turn the shifts by
+// variable amounts and the trailing zero counts above into single
+// instructions. That speeds up decoding by about a fifth, and encoding by a
+// few percent.
+
+#if PSI_HAVE_AVX2_TIER
+PSI_TARGET_FLATTEN("avx2,bmi,bmi2")
+GolombCompressed golomb_compress_avx2(const std::vector<int64_t>& sorted_arr,
+                                      int div_param) {
+  return golomb_compress_impl(sorted_arr, div_param);
+}
+
+template <typename Visitor>
+PSI_TARGET_FLATTEN("avx2,bmi,bmi2")
+void golomb_for_each_avx2(absl::string_view golomb_compressed, int64_t div,
+                          Visitor visit) {
+  golomb_for_each_impl(golomb_compressed, div, visit);
+}
+#endif
+
+// Runs `golomb_for_each_impl` with the instructions of the active CPU tier.
+template <typename Visitor>
+void golomb_for_each(absl::string_view golomb_compressed, int64_t div,
+                     Visitor visit) {
+#if PSI_HAVE_AVX2_TIER
+  if (ActiveCpuTier() >= CpuTier::kAvx2) {
+    golomb_for_each_avx2(golomb_compressed, div, visit);
+    return;
+  }
+#endif
+  golomb_for_each_impl(golomb_compressed, div, visit);
+}
+
+}  // namespace
+
+GolombCompressed golomb_compress(const std::vector<int64_t>& sorted_arr,
+                                 int div_param) {
+#if PSI_HAVE_AVX2_TIER
+  if (ActiveCpuTier() >= CpuTier::kAvx2) {
+    return golomb_compress_avx2(sorted_arr, div_param);
+  }
+#endif
+  return golomb_compress_impl(sorted_arr, div_param);
+}
+
+std::vector<int64_t> golomb_intersect(
+    absl::string_view golomb_compressed, int64_t div,
+    const std::vector<std::pair<int64_t, int64_t>>& sorted_arr) {
+  std::vector<int64_t> res;
+  golomb_intersect_for_each(golomb_compressed, div, sorted_arr,
+                            [&res](int64_t index) { res.push_back(index); });
+  return res;
+}
+
+void golomb_intersect_for_each(
+    absl::string_view golomb_compressed, int64_t div,
+    const std::vector<std::pair<int64_t, int64_t>>& sorted_arr,
+    absl::FunctionRef<void(int64_t)> visit) {
+  auto arr_it = sorted_arr.begin();
+
+  golomb_for_each(golomb_compressed, div, [&](int64_t prefix_sum) {
     // now, check if the current the other (sorted) set contains the current
     // prefix_sum
-
     while (arr_it != sorted_arr.end() && (*arr_it).first < prefix_sum) {
       ++arr_it;
     }
 
     while (arr_it != sorted_arr.end() && (*arr_it).first == prefix_sum) {
       // the other set should contain a mapping to the indexes before sorting
-      res.push_back((*arr_it).second);
+      visit((*arr_it).second);
       ++arr_it;
     }
 
-    if (arr_it == sorted_arr.end()) {
-      break;
+    return arr_it != sorted_arr.end();
+  });
+}
+
+int64_t golomb_intersection_size(absl::string_view golomb_compressed,
+                                 int64_t div,
+                                 const std::vector<int64_t>& sorted_arr) {
+  int64_t res = 0;
+  auto arr_it = sorted_arr.begin();
+
+  golomb_for_each(golomb_compressed, div, [&](int64_t prefix_sum) {
+    while (arr_it != sorted_arr.end() && *arr_it < prefix_sum) {
+      ++arr_it;
     }
-  }
+    while (arr_it != sorted_arr.end() && *arr_it == prefix_sum) {
+      res++;
+      ++arr_it;
+    }
+    return arr_it != sorted_arr.end();
+  });
 
   return res;
 }
 
+std::vector<int64_t> golomb_decompress(absl::string_view golomb_compressed,
+                                       int64_t div) {
+  std::vector<int64_t> res;
+  golomb_for_each(golomb_compressed, div, [&res](int64_t value) {
+    res.push_back(value);
+    return true;
+  });
+  return res;
+}
+
+GolombStreamDecoder::GolombStreamDecoder(int64_t div) : div_(div) {}
+
+void GolombStreamDecoder::Push(absl::string_view chunk,
+                               std::vector<int64_t>* values) {
+  for (char c : chunk) {
+    // Bits are consumed starting from the least significant one.
+    auto byte = static_cast<unsigned int>(static_cast<unsigned char>(c));
+    int64_t bits = CHAR_SIZE;
+    while (bits > 0) {
+      if (!in_remainder_) {
+        if (byte == 0) {
+          // The rest of the byte continues the unary quotient.
+          quotient_ += bits;
+          break;
+        }
+        // the lowest 1 bit ends the unary quotient, and is skipped
+        auto ctz = static_cast<int64_t>(CTZ(byte));
+        quotient_ += ctz;
+        byte >>= ctz + 1;
+        bits -= ctz + 1;
+        in_remainder_ = true;
+      } else {
+        auto num_bits = std::min(bits, div_ - remainder_bits_);
+        remainder_ |= static_cast<int64_t>(byte & ((1u << num_bits) - 1))
+                      << remainder_bits_;
+        remainder_bits_ += num_bits;
+        byte >>= num_bits;
+        bits -= num_bits;
+      }
+
+      if (in_remainder_ && remainder_bits_ == div_) {
+        prefix_sum_ += (quotient_ << div_) | remainder_;
+        values->push_back(prefix_sum_);
+        quotient_ = 0;
+        in_remainder_ = false;
+        remainder_ = 0;
+        remainder_bits_ = 0;
+      }
+    }
+  }
+}
+
 }  // namespace private_set_intersection
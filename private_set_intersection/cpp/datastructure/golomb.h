@@ -21,6 +21,9 @@
 #include <utility>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+
 namespace private_set_intersection {
 
 const int64_t CHAR_SIZE = sizeof(char) * 8;
@@ -49,9 +52,53 @@ GolombCompressed golomb_compress(const std::vector<int64_t>& sorted_arr,
                                  int div_param = -1);
 
 std::vector<int64_t> golomb_intersect(
-    const std::string& golomb_compressed, int64_t div,
+    absl::string_view golomb_compressed, int64_t div,
     const std::vector<std::pair<int64_t, int64_t>>& sorted_arr);
 
+// As `golomb_intersect`, but calls `visit` with each matching index instead of
+// collecting them.
+void golomb_intersect_for_each(
+    absl::string_view golomb_compressed, int64_t div,
+    const std::vector<std::pair<int64_t, int64_t>>& sorted_arr,
+    absl::FunctionRef<void(int64_t)> visit);
+
+// Returns the number of values in `sorted_arr` that occur in
+// `golomb_compressed`, counting repeated values in `sorted_arr` each time.
+// Matches `golomb_intersect(...).size()` without tracking indices.
+int64_t golomb_intersection_size(absl::string_view golomb_compressed,
+                                 int64_t div,
+                                 const std::vector<int64_t>& sorted_arr);
+
+// Decodes all values of `golomb_compressed`, in ascending order.
+std::vector<int64_t> golomb_decompress(absl::string_view golomb_compressed,
+                                       int64_t div);
+
+// Incrementally decodes a Golomb-compressed sequence that is pushed in
+// arbitrary byte chunks, e.g. as they arrive from the network. Decoding state
+// is carried across chunk boundaries, so the concatenation of all pushed
+// chunks decodes to the same values as `golomb_decompress`.
+class GolombStreamDecoder {
+ public:
+  explicit GolombStreamDecoder(int64_t div);
+
+  // Decodes `chunk` and appends the values it completes to `values`, in
+  // ascending order.
+  void Push(absl::string_view chunk, std::vector<int64_t>* values);
+
+ private:
+  const int64_t div_;
+
+  // The last decoded value, since values are stored as deltas.
+  int64_t prefix_sum_ = 0;
+
+  // The value being decoded: its unary quotient, and the bits of its binary
+  // remainder read so far once the quotient is complete.
+  int64_t quotient_ = 0;
+  bool in_remainder_ = false;
+  int64_t remainder_ = 0;
+  int64_t remainder_bits_ = 0;
+};
+
 }  // namespace private_set_intersection
 
 #endif  // PRIVATE_SET_INTERSECTION_CPP_GOLOMB_H_
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "gtest/gtest.h"
+#include "private_set_intersection/cpp/cpu_features.h"
 
 namespace private_set_intersection {
 namespace {
@@ -44,6 +45,15 @@ TEST(GolombTest, TestIntersectShort) {
   EXPECT_EQ(intersect, decoded);
 }
 
+TEST(GolombTest, TestIntersectionSize) {
+  std::vector<int64_t> elements = {3, 6, 10, 200};
+  auto encoded = golomb_compress(elements);
+  std::vector<int64_t> elements2 = {1, 6, 6, 10, 11, 300};
+  EXPECT_EQ(
+      golomb_intersection_size(encoded.compressed, encoded.div, elements2), 3);
+  EXPECT_EQ(golomb_intersection_size(encoded.compressed, encoded.div, {}), 0);
+}
+
 TEST(GolombTest, TestEncodeDecodeLong) {
   std::vector<int64_t> elements = {0, 1, 10, 100};
   auto encoded = golomb_compress(elements);
@@ -56,5 +66,53 @@ TEST(GolombTest, TestEncodeDecodeLong) {
   EXPECT_EQ(intersect, decoded);
 }
 
+TEST(GolombTest, TestDecompress) {
+  std::vector<int64_t> elements = {0, 1, 10, 100, 1000};
+  auto encoded = golomb_compress(elements);
+  EXPECT_EQ(golomb_decompress(encoded.compressed, encoded.div), elements);
+  EXPECT_TRUE(golomb_decompress("", 0).empty());
+}
+
+TEST(GolombTest, TestTiersAgree) {
+  std::vector<int64_t> elements;
+  for (int64_t i = 0; i < 5000; i++) {
+    elements.push_back(i * i * 7919 % 1000003 + i * 1000003);
+  }
+  ForceCpuTier(CpuTier::kScalar);
+  const GolombCompressed expected = golomb_compress(elements);
+  for (CpuTier tier : {CpuTier::kScalar, CpuTier::kAvx2}) {
+    ForceCpuTier(tier);
+    const GolombCompressed encoded = golomb_compress(elements);
+    EXPECT_EQ(encoded.compressed, expected.compressed) << CpuTierName(tier);
+    EXPECT_EQ(encoded.div, expected.div);
+    EXPECT_EQ(golomb_decompress(encoded.compressed, encoded.div), elements)
+        << CpuTierName(tier);
+  }
+  ClearForcedCpuTier();
+}
+
+TEST(GolombTest, TestStreamDecoder) {
+  std::vector<int64_t> sparse, dense;
+  for (int64_t i = 0; i < 1000; i++) {
+    sparse.push_back(i * i * 7 + i);
+    dense.push_back(i);
+  }
+
+  for (const auto& elements : {sparse, dense}) {
+    auto encoded = golomb_compress(elements);
+    // Any split of the input decodes to the same values.
+    for (size_t chunk_size : {1, 3, 64, 100000}) {
+      GolombStreamDecoder decoder(encoded.div);
+      std::vector<int64_t> decoded;
+      for (size_t i = 0; i < encoded.compressed.size(); i += chunk_size) {
+        decoder.Push(
+            absl::string_view(encoded.compressed).substr(i, chunk_size),
+            &decoded);
+      }
+      EXPECT_EQ(decoded, elements);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace private_set_intersection
@@ -0,0 +1,186 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/datastructure/prepared_server_setup.h"
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+
+namespace private_set_intersection {
+
+StatusOr<std::unique_ptr<PreparedServerSetup>> PreparedServerSetup::Create(
+    const psi_proto::ServerSetup& server_setup) {
+  StatusOr<ServerSetupView> view = ServerSetupView::FromProtobuf(server_setup);
+  if (!view.ok()) {
+    return view.status();
+  }
+  auto prepared = absl::WrapUnique(new PreparedServerSetup());
+  absl::Status status = prepared->Prepare(*std::move(view));
+  if (!status.ok()) {
+    return status;
+  }
+  return prepared;
+}
+
+StatusOr<std::unique_ptr<PreparedServerSetup>>
+PreparedServerSetup::CreateFromSerialized(
+    absl::string_view serialized_server_setup) {
+  StatusOr<ServerSetupView> view =
+      ServerSetupView::FromSerialized(serialized_server_setup);
+  if (!view.ok()) {
+    return view.status();
+  }
+  auto prepared = absl::WrapUnique(new PreparedServerSetup());
+  absl::Status status = prepared->Prepare(*std::move(view));
+  if (!status.ok()) {
+    return status;
+  }
+  return prepared;
+}
+
+absl::Status PreparedServerSetup::Prepare(ServerSetupView view) {
+  // The containers are created from `view` pointed at `storage_`, so that they
+  // reference the one copy this object owns.
+  switch (view.data_structure_case) {
+    case psi_proto::ServerSetup::DataStructureCase::kRaw: {
+      size_t size = 0;
+      for (absl::string_view element : view.encrypted_elements) {
+        size += element.size();
+      }
+      // Reserved up front, so that the views below stay valid.
+      storage_.reserve(size);
+      raw_elements_.reserve(view.encrypted_elements.size());
+      for (absl::string_view element : view.encrypted_elements) {
+        const size_t offset = storage_.size();
+        storage_.append(element.data(), element.size());
+        raw_elements_.insert(
+            absl::string_view(storage_).substr(offset, element.size()));
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kGcs: {
+      storage_ = std::string(view.bits);
+      view.bits = storage_;
+      StatusOr<std::unique_ptr<GCS>> gcs = GCS::CreateFromView(view);
+      if (!gcs.ok()) {
+        return gcs.status();
+      }
+      gcs_ = *std::move(gcs);
+      std::vector<int64_t> hashes = gcs_->Decompress();
+      gcs_hashes_.reserve(hashes.size());
+      gcs_hashes_.insert(hashes.begin(), hashes.end());
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kBloomFilter: {
+      storage_ = std::string(view.bits);
+      view.bits = storage_;
+      StatusOr<std::unique_ptr<BloomFilter>> bloom_filter =
+          BloomFilter::CreateFromView(view);
+      if (!bloom_filter.ok()) {
+        return bloom_filter.status();
+      }
+      bloom_filter_ = *std::move(bloom_filter);
+      break;
+    }
+    default: {
+      return absl::InvalidArgumentError("`ServerSetup` holds no container");
+    }
+  }
+
+  data_structure_case_ = view.data_structure_case;
+  hash_to_curve_ = view.hash_to_curve;
+  point_encoding_ = view.point_encoding;
+  curve_ = view.curve;
+  return absl::OkStatus();
+}
+
+std::vector<int64_t> PreparedServerSetup::Intersect(
+    absl::Span<const std::string> elements) const {
+  std::vector<int64_t> res;
+  switch (data_structure_case_) {
+    case psi_proto::ServerSetup::DataStructureCase::kRaw: {
+      for (size_t i = 0; i < elements.size(); i++) {
+        if (raw_elements_.contains(elements[i])) {
+          res.push_back(static_cast<int64_t>(i));
+        }
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kGcs: {
+      std::vector<int64_t> hashes(elements.size());
+      gcs_->HashElements(elements, hashes.data());
+      for (size_t i = 0; i < elements.size(); i++) {
+        if (gcs_hashes_.contains(hashes[i])) {
+          res.push_back(static_cast<int64_t>(i));
+        }
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kBloomFilter: {
+      res = bloom_filter_->Intersect(elements);
+      break;
+    }
+    default:
+      break;
+  }
+  return res;
+}
+
+int64_t PreparedServerSetup::IntersectionSize(
+    absl::Span<const std::string> elements) const {
+  int64_t count = 0;
+  switch (data_structure_case_) {
+    case psi_proto::ServerSetup::DataStructureCase::kRaw: {
+      for (const std::string& element : elements) {
+        count += raw_elements_.contains(element);
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kGcs: {
+      std::vector<int64_t> hashes(elements.size());
+      gcs_->HashElements(elements, hashes.data());
+      for (int64_t hash : hashes) {
+        count += gcs_hashes_.contains(hash);
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kBloomFilter: {
+      count = bloom_filter_->IntersectionSize(elements);
+      break;
+    }
+    default:
+      break;
+  }
+  return count;
+}
+
+psi_proto::ServerSetup::DataStructureCase
+PreparedServerSetup::data_structure_case() const {
+  return data_structure_case_;
+}
+
+psi_proto::HashToCurve PreparedServerSetup::hash_to_curve() const {
+  return hash_to_curve_;
+}
+
+psi_proto::PointEncoding PreparedServerSetup::point_encoding() const {
+  return point_encoding_;
+}
+
+psi_proto::Curve PreparedServerSetup::curve() const { return curve_; }
+
+}  // namespace private_set_intersection
@@ -0,0 +1,117 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_PREPARED_SERVER_SETUP_H_
+#define PRIVATE_SET_INTERSECTION_CPP_PREPARED_SERVER_SETUP_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "private_set_intersection/cpp/datastructure/bloom_filter.h"
+#include "private_set_intersection/cpp/datastructure/gcs.h"
+#include "private_set_intersection/cpp/datastructure/server_setup_view.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+
+using absl::StatusOr;
+
+// A server setup that has been decoded once, so that it can be queried by many
+// client requests. Building it costs time proportional to the size of the
+// setup; each `Intersect` call afterwards only costs time proportional to the
+// number of queried elements:
+//
+// - Raw containers are indexed in a hash set of the encrypted elements.
+// - GCS containers are decompressed into a hash set of hashes.
+// - Bloom filters are queried directly, since each lookup is already O(1).
+//
+// Like the containers it wraps, a PreparedServerSetup is not thread-safe.
+class PreparedServerSetup {
+ public:
+  PreparedServerSetup(const PreparedServerSetup&) = delete;
+  PreparedServerSetup& operator=(const PreparedServerSetup&) = delete;
+
+  // Prepares a copy of `server_setup`. Only the container is copied, not the
+  // whole message.
+  //
+  // Returns INVALID_ARGUMENT if `server_setup` is corrupt or does not hold a
+  // container.
+  static StatusOr<std::unique_ptr<PreparedServerSetup>> Create(
+      const psi_proto::ServerSetup& server_setup);
+
+  // Prepares a copy of the serialized `psi_proto::ServerSetup`, which is
+  // scanned in place. Only the container is copied.
+  //
+  // Returns INVALID_ARGUMENT if `serialized_server_setup` is corrupt or does
+  // not hold a container.
+  static StatusOr<std::unique_ptr<PreparedServerSetup>> CreateFromSerialized(
+      absl::string_view serialized_server_setup);
+
+  // Returns the indices of `elements` that are contained in the setup, in
+  // ascending order.
+  std::vector<int64_t> Intersect(absl::Span<const std::string> elements) const;
+
+  // Returns the number of `elements` that are contained in the setup, i.e. the
+  // size of `Intersect`, without tracking their indices.
+  int64_t IntersectionSize(absl::Span<const std::string> elements) const;
+
+  psi_proto::ServerSetup::DataStructureCase data_structure_case() const;
+
+  psi_proto::HashToCurve hash_to_curve() const;
+
+  psi_proto::PointEncoding point_encoding() const;
+
+  psi_proto::Curve curve() const;
+
+ private:
+  PreparedServerSetup() = default;
+
+  // Copies the container of `view` into `storage_` and indexes it.
+  absl::Status Prepare(ServerSetupView view);
+
+  // The elements of a raw setup back to back, or the bits of a GCS or Bloom
+  // filter. The indexes below reference it.
+  std::string storage_;
+
+  psi_proto::ServerSetup::DataStructureCase data_structure_case_ =
+      psi_proto::ServerSetup::DATA_STRUCTURE_NOT_SET;
+  psi_proto::HashToCurve hash_to_curve_ =
+      psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT;
+  psi_proto::PointEncoding point_encoding_ =
+      psi_proto::POINT_ENCODING_COMPRESSED;
+  psi_proto::Curve curve_ = psi_proto::CURVE_P256;
+
+  // Set for `kRaw`.
+  absl::flat_hash_set<absl::string_view> raw_elements_;
+
+  // Set for `kGcs`. The GCS is kept to hash queried elements.
+  std::unique_ptr<GCS> gcs_;
+  absl::flat_hash_set<int64_t> gcs_hashes_;
+
+  // Set for `kBloomFilter`. The elaborated type specifier keeps this header
+  // usable after datastructure.h, whose `DataStructure::BloomFilter`
+  // enumerator hides the class name.
+  std::unique_ptr<class BloomFilter> bloom_filter_;
+};
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_PREPARED_SERVER_SETUP_H_
@@ -0,0 +1,97 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/datastructure/prepared_server_setup.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "private_set_intersection/cpp/datastructure/bloom_filter.h"
+#include "private_set_intersection/cpp/datastructure/gcs.h"
+#include "private_set_intersection/cpp/datastructure/raw.h"
+#include "private_set_intersection/cpp/util/status_matchers.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+namespace {
+
+std::vector<std::string> MakeElements(int num_elements, int step) {
+  std::vector<std::string> elements(num_elements);
+  for (int i = 0; i < num_elements; i++) {
+    elements[i] = absl::StrCat("Element ", step * i);
+  }
+  return elements;
+}
+
+// Checks that preparing `server_setup` yields the same intersection as the
+// unprepared container, for both the message and its serialized form.
+void ExpectSameIntersection(const psi_proto::ServerSetup& server_setup,
+                            std::vector<int64_t> expected) {
+  std::vector<std::string> client = MakeElements(200, 1);
+  std::sort(expected.begin(), expected.end());
+
+  // The prepared setup holds its own copy of the container, so the message it
+  // was created from can go away.
+  auto copy = std::make_unique<psi_proto::ServerSetup>(server_setup);
+  PSI_ASSERT_OK_AND_ASSIGN(auto prepared, PreparedServerSetup::Create(*copy));
+  copy.reset();
+  EXPECT_EQ(prepared->data_structure_case(),
+            server_setup.data_structure_case());
+  EXPECT_EQ(prepared->Intersect(client), expected);
+  // Queries can be repeated against the same prepared setup.
+  EXPECT_EQ(prepared->Intersect(client), expected);
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto prepared_serialized,
+                           PreparedServerSetup::CreateFromSerialized(
+                               server_setup.SerializeAsString()));
+  EXPECT_EQ(prepared_serialized->Intersect(client), expected);
+  EXPECT_EQ(prepared_serialized->IntersectionSize(client),
+            static_cast<int64_t>(expected.size()));
+}
+
+TEST(PreparedServerSetupTest, TestRaw) {
+  std::vector<std::string> client = MakeElements(200, 1);
+  PSI_ASSERT_OK_AND_ASSIGN(auto raw, Raw::Create(200, MakeElements(100, 3)));
+  ExpectSameIntersection(raw->ToProtobuf(), raw->Intersect(client));
+}
+
+TEST(PreparedServerSetupTest, TestGcs) {
+  std::vector<std::string> client = MakeElements(200, 1);
+  PSI_ASSERT_OK_AND_ASSIGN(auto gcs,
+                           GCS::Create(0.001, 200, MakeElements(100, 3)));
+  ExpectSameIntersection(gcs->ToProtobuf(), gcs->Intersect(client));
+}
+
+TEST(PreparedServerSetupTest, TestBloomFilter) {
+  std::vector<std::string> client = MakeElements(200, 1);
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto bloom_filter, BloomFilter::Create(0.001, 200, MakeElements(100, 3)));
+  ExpectSameIntersection(bloom_filter->ToProtobuf(),
+                         bloom_filter->Intersect(client));
+}
+
+TEST(PreparedServerSetupTest, FailIfSetupHoldsNoContainer) {
+  EXPECT_THAT(PreparedServerSetup::Create(psi_proto::ServerSetup()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`ServerSetup` holds no container"));
+  EXPECT_THAT(PreparedServerSetup::CreateFromSerialized("\xff"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace private_set_intersection
@@ -16,6 +16,7 @@
 
 #include "private_set_intersection/cpp/datastructure/raw.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "absl/memory/memory.h"
@@ -48,14 +49,16 @@ void custom_set_intersection(InputIt1 first1, InputIt1 last1, InputIt2 first2,
   }
 }
 
-Raw::Raw(std::vector<std::string> elements) : encrypted_(std::move(elements)) {}
+Raw::Raw(std::vector<std::string> elements)
+    : storage_(std::move(elements)),
+      encrypted_(storage_.begin(), storage_.end()) {}
 
 StatusOr<std::unique_ptr<Raw>> Raw::Create(int64_t num_client_inputs,
                                            std::vector<std::string> elements) {
   // We sort to make intersections easier to find later
   std::sort(elements.begin(), elements.end());
 
-  return absl::WrapUnique(new Raw(elements));
+  return absl::WrapUnique(new Raw(std::move(elements)));
 }
 
 StatusOr<std::unique_ptr<Raw>> Raw::CreateFromProtobuf(
@@ -71,16 +74,34 @@ StatusOr<std::unique_ptr<Raw>> Raw::CreateFromProtobuf(
   return absl::WrapUnique(new Raw(encrypted_elements));
 }
 
+StatusOr<std::unique_ptr<Raw>> Raw::CreateFromView(
+    const ServerSetupView& setup) {
+  if (setup.data_structure_case != psi_proto::ServerSetup::kRaw) {
+    return absl::InvalidArgumentError(
+        "`ServerSetup` does not hold a Raw container");
+  }
+
+  auto container = absl::WrapUnique(new Raw(std::vector<std::string>()));
+  container->encrypted_ = setup.encrypted_elements;
+  // Servers send sorted elements, so this is usually a linear check.
+  if (!std::is_sorted(container->encrypted_.begin(),
+                      container->encrypted_.end())) {
+    std::sort(container->encrypted_.begin(), container->encrypted_.end());
+  }
+  return container;
+}
+
 std::vector<int64_t> Raw::Intersect(
     absl::Span<const std::string> elements) const {
-  // This implementation creates a copy of `elements`, but the tradeoff is that
-  // we can compute the intersection in O(nlog(n) + max(n, m)) where `n` and `m`
-  // correspond to the number of client and server elements respectively.
-  std::vector<std::pair<std::string, int64_t>> vp(elements.size());
+  // This implementation creates a sorted copy of views into `elements`, but
+  // the tradeoff is that we can compute the intersection in
+  // O(nlog(n) + max(n, m)) where `n` and `m` correspond to the number of client
+  // and server elements respectively.
+  std::vector<std::pair<absl::string_view, int64_t>> vp(elements.size());
 
   // Collect a pair with the index to track the original index after sorting.
   for (size_t i = 0; i < elements.size(); ++i) {
-    vp[i] = make_pair(elements[i], (int64_t)i);
+    vp[i] = std::make_pair(absl::string_view(elements[i]), (int64_t)i);
   }
 
   // Next, we sort the collection. O(nlog(n))
@@ -94,14 +115,67 @@ std::vector<int64_t> Raw::Intersect(
   return res;
 }
 
+int64_t Raw::IntersectionSize(absl::Span<const std::string> elements) const {
+  // For few elements, binary searches are cheaper than a merge with all
+  // encrypted values. O(nlog(m))
+  int64_t res = 0;
+  if (elements.size() * std::log2(encrypted_.size() + 1) < encrypted_.size()) {
+    for (const std::string& element : elements) {
+      if (Contains(element)) {
+        res++;
+      }
+    }
+    return res;
+  }
+
+  // Otherwise, merge the sorted elements with the encrypted values.
+  // O(nlog(n) + max(n, m))
+  std::vector<absl::string_view> sorted(elements.begin(), elements.end());
+  std::sort(sorted.begin(), sorted.end());
+
+  auto client_it = sorted.begin();
+  auto server_it = encrypted_.begin();
+  while (client_it != sorted.end() && server_it != encrypted_.end()) {
+    if (*client_it < *server_it) {
+      ++client_it;
+    } else if (*server_it < *client_it) {
+      ++server_it;
+    } else {
+      // Keep `server_it`, so that repeated elements are all counted, as by
+      // `Contains`.
+      res++;
+      ++client_it;
+    }
+  }
+  return res;
+}
+
+bool Raw::Contains(absl::string_view element) const {
+  return std::binary_search(encrypted_.begin(), encrypted_.end(), element);
+}
+
 size_t Raw::size() const { return encrypted_.size(); }
 
 psi_proto::ServerSetup Raw::ToProtobuf() const {
   psi_proto::ServerSetup server_setup;
-  *server_setup.mutable_raw()->mutable_encrypted_elements() = {
-      encrypted_.begin(), encrypted_.end()};
-
+  ToProtobuf(&server_setup);
   return server_setup;
 }
 
+void Raw::ToProtobuf(psi_proto::ServerSetup* server_setup) const {
+  auto* encrypted_elements =
+      server_setup->mutable_raw()->mutable_encrypted_elements();
+  encrypted_elements->Reserve(static_cast<int>(encrypted_.size()));
+  for (absl::string_view element : encrypted_) {
+    encrypted_elements->Add()->assign(element.data(), element.size());
+  }
+}
+
+ServerSetupView Raw::ToView() const {
+  ServerSetupView view;
+  view.data_structure_case = psi_proto::ServerSetup::kRaw;
+  view.encrypted_elements = encrypted_;
+  return view;
+}
+
 }  // namespace private_set_intersection
@@ -20,8 +20,10 @@
 #include <vector>
 
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "private_join_and_compute/crypto/context.h"
+#include "private_set_intersection/cpp/datastructure/server_setup_view.h"
 #include "private_set_intersection/proto/psi.pb.h"
 
 namespace private_set_intersection {
@@ -41,18 +43,51 @@ class Raw {
   static StatusOr<std::unique_ptr<Raw>> CreateFromProtobuf(
       const psi_proto::ServerSetup& encoded_filter);
 
+  // Creates a container that references the encrypted values in `setup`
+  // without copying them. The buffer underlying `setup` must outlive the
+  // returned container.
+  //
+  // Returns INVALID_ARGUMENT if `setup` does not hold a Raw container.
+  static StatusOr<std::unique_ptr<Raw>> CreateFromView(
+      const ServerSetupView& setup);
+
   // Calculates the intersection
   std::vector<int64_t> Intersect(absl::Span<const std::string> elements) const;
 
+  // Returns the number of `elements` that are among the encrypted values,
+  // without tracking their indices. Repeated elements are counted each time.
+  int64_t IntersectionSize(absl::Span<const std::string> elements) const;
+
+  // Returns true if `element` is one of the encrypted values. Takes
+  // logarithmic time, so that small batches can be checked without the linear
+  // merge of `Intersect`.
+  bool Contains(absl::string_view element) const;
+
   // Returns the size of the encrypted elements
   size_t size() const;
 
   // Returns a protobuf representation of the container
   psi_proto::ServerSetup ToProtobuf() const;
 
+  // Writes the protobuf representation of the container to `server_setup`,
+  // which may live on an arena.
+  void ToProtobuf(psi_proto::ServerSetup* server_setup) const;
+
+  // Returns a view of the container, which is valid as long as the container
+  // is alive and unmodified.
+  ServerSetupView ToView() const;
+
  private:
   Raw(std::vector<std::string> encrypted);
-  const std::vector<std::string> encrypted_;
+  Raw(const Raw&) = delete;
+  Raw& operator=(const Raw&) = delete;
+
+  // Owns the encrypted values unless this container was created from a view.
+  const std::vector<std::string> storage_;
+
+  // Sorted views of the encrypted values, referencing either `storage_` or an
+  // external buffer.
+  std::vector<absl::string_view> encrypted_;
 };
 
 }  // namespace private_set_intersection
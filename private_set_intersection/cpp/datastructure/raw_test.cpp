@@ -58,6 +58,24 @@ TEST_F(RawTest, TestIntersectionLargerClient) {
   EXPECT_EQ(results, expected);
 }
 
+TEST_F(RawTest, TestIntersectionSize) {
+  std::vector<std::string> server(1000);
+  for (int i = 0; i < 1000; i++) {
+    server[i] = absl::StrCat("Element ", 2 * i);
+  }
+  SetUp(1000, server);
+
+  // Few elements are searched, many are merged; both count repeated elements.
+  std::vector<std::string> few = {"Element 0", "Element 1", "Element 0"};
+  EXPECT_EQ(container_->IntersectionSize(few), 2);
+  std::vector<std::string> many(500);
+  for (int i = 0; i < 500; i++) {
+    many[i] = absl::StrCat("Element ", i % 250);
+  }
+  EXPECT_EQ(container_->IntersectionSize(many), 250);
+  EXPECT_EQ(container_->IntersectionSize({}), 0);
+}
+
 TEST_F(RawTest, TestToProtobuf) {
   std::vector<std::string> server = {"b", "a", "c", "d", "e"};
   std::vector<std::string> client = {"b", "c", "d", "z"};
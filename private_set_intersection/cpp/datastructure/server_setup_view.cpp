@@ -0,0 +1,337 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/datastructure/server_setup_view.h"
+
+#include <cstdint>
+#include <utility>
+
+namespace private_set_intersection {
+
+namespace {
+
+// Protobuf wire types, see
+// https://protobuf.dev/programming-guides/encoding/#structure
+constexpr uint32_t kWireTypeVarint = 0;
+constexpr uint32_t kWireTypeFixed64 = 1;
+constexpr uint32_t kWireTypeLengthDelimited = 2;
+constexpr uint32_t kWireTypeFixed32 = 5;
+
+absl::Status CorruptError() {
+  return absl::InvalidArgumentError("`ServerSetup` is corrupt!");
+}
+
+// Minimal reader for the protobuf wire format that returns length-delimited
+// fields as views into the input instead of copying them.
+class WireReader {
+ public:
+  explicit WireReader(absl::string_view data) : data_(data) {}
+
+  bool done() const { return pos_ == data_.size(); }
+
+  bool ReadVarint(uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (pos_ == data_.size()) {
+        return false;
+      }
+      const auto byte = static_cast<uint8_t>(data_[pos_++]);
+      result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ReadTag(uint32_t* field_number, uint32_t* wire_type) {
+    uint64_t tag;
+    if (!ReadVarint(&tag) || (tag >> 3) == 0 || (tag >> 3) > UINT32_MAX) {
+      return false;
+    }
+    *field_number = static_cast<uint32_t>(tag >> 3);
+    *wire_type = static_cast<uint32_t>(tag & 7);
+    return true;
+  }
+
+  bool ReadLengthDelimited(absl::string_view* value) {
+    uint64_t length;
+    if (!ReadVarint(&length) || length > data_.size() - pos_) {
+      return false;
+    }
+    *value = data_.substr(pos_, length);
+    pos_ += length;
+    return true;
+  }
+
+  // Skips a field of the given wire type. Groups are not used by proto3 and
+  // are rejected.
+  bool Skip(uint32_t wire_type) {
+    uint64_t ignored_varint;
+    absl::string_view ignored_bytes;
+    switch (wire_type) {
+      case kWireTypeVarint:
+        return ReadVarint(&ignored_varint);
+      case kWireTypeFixed64:
+        return SkipBytes(8);
+      case kWireTypeLengthDelimited:
+        return ReadLengthDelimited(&ignored_bytes);
+      case kWireTypeFixed32:
+        return SkipBytes(4);
+      default:
+        return false;
+    }
+  }
+
+ private:
+  bool SkipBytes(size_t n) {
+    if (n > data_.size() - pos_) {
+      return false;
+    }
+    pos_ += n;
+    return true;
+  }
+
+  absl::string_view data_;
+  size_t pos_ = 0;
+};
+
+absl::Status ParseRawInfo(absl::string_view data, ServerSetupView* view) {
+  WireReader reader(data);
+  while (!reader.done()) {
+    uint32_t field, wire_type;
+    if (!reader.ReadTag(&field, &wire_type)) {
+      return CorruptError();
+    }
+    if (field ==
+            psi_proto::ServerSetup::RawInfo::kEncryptedElementsFieldNumber &&
+        wire_type == kWireTypeLengthDelimited) {
+      absl::string_view element;
+      if (!reader.ReadLengthDelimited(&element)) {
+        return CorruptError();
+      }
+      view->encrypted_elements.push_back(element);
+    } else if (!reader.Skip(wire_type)) {
+      return CorruptError();
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ParseGcsInfo(absl::string_view data, ServerSetupView* view) {
+  WireReader reader(data);
+  while (!reader.done()) {
+    uint32_t field, wire_type;
+    if (!reader.ReadTag(&field, &wire_type)) {
+      return CorruptError();
+    }
+    uint64_t value;
+    if (field == psi_proto::ServerSetup::GCSInfo::kDivFieldNumber &&
+        wire_type == kWireTypeVarint) {
+      if (!reader.ReadVarint(&value)) {
+        return CorruptError();
+      }
+      view->div = static_cast<int32_t>(value);
+    } else if (field ==
+                   psi_proto::ServerSetup::GCSInfo::kHashRangeFieldNumber &&
+               wire_type == kWireTypeVarint) {
+      if (!reader.ReadVarint(&value)) {
+        return CorruptError();
+      }
+      view->hash_range = static_cast<int64_t>(value);
+    } else if (field == psi_proto::ServerSetup::GCSInfo::kBitsFieldNumber &&
+               wire_type == kWireTypeLengthDelimited) {
+      if (!reader.ReadLengthDelimited(&view->bits)) {
+        return CorruptError();
+      }
+    } else if (!reader.Skip(wire_type)) {
+      return CorruptError();
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ParseBloomFilterInfo(absl::string_view data,
+                                  ServerSetupView* view) {
+  WireReader reader(data);
+  while (!reader.done()) {
+    uint32_t field, wire_type;
+    if (!reader.ReadTag(&field, &wire_type)) {
+      return CorruptError();
+    }
+    uint64_t value;
+    if (field == psi_proto::ServerSetup::BloomFilterInfo::
+                     kNumHashFunctionsFieldNumber &&
+        wire_type == kWireTypeVarint) {
+      if (!reader.ReadVarint(&value)) {
+        return CorruptError();
+      }
+      view->num_hash_functions = static_cast<int32_t>(value);
+    } else if (field ==
+                   psi_proto::ServerSetup::BloomFilterInfo::kBitsFieldNumber &&
+               wire_type == kWireTypeLengthDelimited) {
+      if (!reader.ReadLengthDelimited(&view->bits)) {
+        return CorruptError();
+      }
+    } else if (!reader.Skip(wire_type)) {
+      return CorruptError();
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+StatusOr<ServerSetupView> ServerSetupView::FromProtobuf(
+    const psi_proto::ServerSetup& server_setup) {
+  if (!server_setup.IsInitialized()) {
+    return CorruptError();
+  }
+
+  ServerSetupView view;
+  view.data_structure_case = server_setup.data_structure_case();
+  view.hash_to_curve = server_setup.hash_to_curve();
+  view.point_encoding = server_setup.point_encoding();
+  view.curve = server_setup.curve();
+  switch (view.data_structure_case) {
+    case psi_proto::ServerSetup::kRaw: {
+      const auto& elements = server_setup.raw().encrypted_elements();
+      view.encrypted_elements.assign(elements.begin(), elements.end());
+      break;
+    }
+    case psi_proto::ServerSetup::kGcs:
+      view.div = server_setup.gcs().div();
+      view.hash_range = server_setup.gcs().hash_range();
+      view.bits = server_setup.gcs().bits();
+      break;
+    case psi_proto::ServerSetup::kBloomFilter:
+      view.num_hash_functions =
+          server_setup.bloom_filter().num_hash_functions();
+      view.bits = server_setup.bloom_filter().bits();
+      break;
+    default:
+      break;
+  }
+  return view;
+}
+
+StatusOr<ServerSetupView> ServerSetupView::FromSerialized(
+    absl::string_view serialized) {
+  ServerSetupView view;
+  WireReader reader(serialized);
+  while (!reader.done()) {
+    uint32_t field, wire_type;
+    if (!reader.ReadTag(&field, &wire_type)) {
+      return CorruptError();
+    }
+    if (wire_type == kWireTypeVarint &&
+        (field == psi_proto::ServerSetup::kHashToCurveFieldNumber ||
+         field == psi_proto::ServerSetup::kPointEncodingFieldNumber ||
+         field == psi_proto::ServerSetup::kCurveFieldNumber)) {
+      uint64_t value;
+      if (!reader.ReadVarint(&value)) {
+        return CorruptError();
+      }
+      if (field == psi_proto::ServerSetup::kHashToCurveFieldNumber) {
+        view.hash_to_curve = static_cast<psi_proto::HashToCurve>(value);
+      } else if (field == psi_proto::ServerSetup::kCurveFieldNumber) {
+        view.curve = static_cast<psi_proto::Curve>(value);
+      } else {
+        view.point_encoding = static_cast<psi_proto::PointEncoding>(value);
+      }
+      continue;
+    }
+    if (wire_type != kWireTypeLengthDelimited ||
+        (field != psi_proto::ServerSetup::kRawFieldNumber &&
+         field != psi_proto::ServerSetup::kGcsFieldNumber &&
+         field != psi_proto::ServerSetup::kBloomFilterFieldNumber)) {
+      if (!reader.Skip(wire_type)) {
+        return CorruptError();
+      }
+      continue;
+    }
+
+    absl::string_view data;
+    if (!reader.ReadLengthDelimited(&data)) {
+      return CorruptError();
+    }
+
+    // As in a regular parse, a later member of the oneof replaces an earlier
+    // one, while repeated occurrences of the same member are merged.
+    const auto data_structure_case =
+        static_cast<psi_proto::ServerSetup::DataStructureCase>(field);
+    if (view.data_structure_case != data_structure_case) {
+      ServerSetupView replaced;
+      replaced.data_structure_case = data_structure_case;
+      replaced.hash_to_curve = view.hash_to_curve;
+      replaced.point_encoding = view.point_encoding;
+      replaced.curve = view.curve;
+      view = std::move(replaced);
+    }
+    absl::Status status;
+    switch (data_structure_case) {
+      case psi_proto::ServerSetup::kRaw:
+        status = ParseRawInfo(data, &view);
+        break;
+      case psi_proto::ServerSetup::kGcs:
+        status = ParseGcsInfo(data, &view);
+        break;
+      default:
+        status = ParseBloomFilterInfo(data, &view);
+        break;
+    }
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return view;
+}
+
+void ServerSetupView::ToProtobuf(psi_proto::ServerSetup* server_setup) const {
+  server_setup->set_hash_to_curve(hash_to_curve);
+  server_setup->set_point_encoding(point_encoding);
+  server_setup->set_curve(curve);
+  switch (data_structure_case) {
+    case psi_proto::ServerSetup::kRaw: {
+      auto* elements =
+          server_setup->mutable_raw()->mutable_encrypted_elements();
+      elements->Reserve(static_cast<int>(encrypted_elements.size()));
+      for (absl::string_view element : encrypted_elements) {
+        elements->Add()->assign(element.data(), element.size());
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::kGcs: {
+      auto* gcs = server_setup->mutable_gcs();
+      gcs->set_div(static_cast<int32_t>(div));
+      gcs->set_hash_range(hash_range);
+      gcs->mutable_bits()->assign(bits.data(), bits.size());
+      break;
+    }
+    case psi_proto::ServerSetup::kBloomFilter: {
+      auto* bloom_filter = server_setup->mutable_bloom_filter();
+      bloom_filter->set_num_hash_functions(num_hash_functions);
+      bloom_filter->mutable_bits()->assign(bits.data(), bits.size());
+      break;
+    }
+    default:
+      server_setup->clear_data_structure();
+      break;
+  }
+}
+
+}  // namespace private_set_intersection
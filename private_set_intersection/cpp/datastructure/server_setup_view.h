@@ -0,0 +1,81 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_SERVER_SETUP_VIEW_H_
+#define PRIVATE_SET_INTERSECTION_CPP_SERVER_SETUP_VIEW_H_
+
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+
+using absl::StatusOr;
+
+// A read-only view of a `psi_proto::ServerSetup`. The byte fields reference the
+// buffer or message the view was created from, which must outlive the view
+// and any container created from it. This lets clients query multi-gigabyte
+// setups without copying the bit arrays or elements.
+struct ServerSetupView {
+  // Creates a view referencing the fields of `server_setup`.
+  //
+  // Returns INVALID_ARGUMENT if `server_setup` is corrupt.
+  static StatusOr<ServerSetupView> FromProtobuf(
+      const psi_proto::ServerSetup& server_setup);
+
+  // Creates a view by scanning the wire format of a serialized
+  // `psi_proto::ServerSetup`, without parsing it into a message.
+  //
+  // Returns INVALID_ARGUMENT if `serialized` is not a valid `ServerSetup`.
+  static StatusOr<ServerSetupView> FromSerialized(absl::string_view serialized);
+
+  // Writes a copy of the viewed setup to `server_setup`, which may live on an
+  // arena.
+  void ToProtobuf(psi_proto::ServerSetup* server_setup) const;
+
+  psi_proto::ServerSetup::DataStructureCase data_structure_case =
+      psi_proto::ServerSetup::DATA_STRUCTURE_NOT_SET;
+
+  // How the server mapped its elements to the curve.
+  psi_proto::HashToCurve hash_to_curve =
+      psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT;
+
+  // How the server encoded its encrypted elements.
+  psi_proto::PointEncoding point_encoding =
+      psi_proto::POINT_ENCODING_COMPRESSED;
+
+  // The group the server encrypted its elements in.
+  psi_proto::Curve curve = psi_proto::CURVE_P256;
+
+  // Set for `kRaw`.
+  std::vector<absl::string_view> encrypted_elements;
+
+  // Set for `kGcs`.
+  int64_t div = 0;
+  int64_t hash_range = 0;
+
+  // Set for `kBloomFilter`.
+  int num_hash_functions = 0;
+
+  // Set for `kGcs` and `kBloomFilter`.
+  absl::string_view bits;
+};
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_SERVER_SETUP_VIEW_H_
@@ -0,0 +1,175 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/datastructure/server_setup_view.h"
+
+#include "gtest/gtest.h"
+#include "private_set_intersection/cpp/util/status_matchers.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+namespace {
+
+// Returns true if `view` points into `buffer`.
+bool PointsInto(absl::string_view view, absl::string_view buffer) {
+  return view.data() >= buffer.data() &&
+         view.data() + view.size() <= buffer.data() + buffer.size();
+}
+
+TEST(ServerSetupViewTest, TestGcsFromSerialized) {
+  psi_proto::ServerSetup setup;
+  setup.mutable_gcs()->set_div(7);
+  setup.mutable_gcs()->set_hash_range(123456789012);
+  setup.mutable_gcs()->set_bits(std::string(1000, '\x5a'));
+  const std::string serialized = setup.SerializeAsString();
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto view,
+                           ServerSetupView::FromSerialized(serialized));
+  EXPECT_EQ(view.data_structure_case, psi_proto::ServerSetup::kGcs);
+  EXPECT_EQ(view.div, 7);
+  EXPECT_EQ(view.hash_range, 123456789012);
+  EXPECT_EQ(view.bits, setup.gcs().bits());
+  EXPECT_TRUE(PointsInto(view.bits, serialized));
+}
+
+TEST(ServerSetupViewTest, TestBloomFilterFromSerialized) {
+  psi_proto::ServerSetup setup;
+  setup.mutable_bloom_filter()->set_num_hash_functions(13);
+  setup.mutable_bloom_filter()->set_bits("bloom bits");
+  const std::string serialized = setup.SerializeAsString();
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto view,
+                           ServerSetupView::FromSerialized(serialized));
+  EXPECT_EQ(view.data_structure_case, psi_proto::ServerSetup::kBloomFilter);
+  EXPECT_EQ(view.num_hash_functions, 13);
+  EXPECT_EQ(view.bits, "bloom bits");
+  EXPECT_TRUE(PointsInto(view.bits, serialized));
+}
+
+TEST(ServerSetupViewTest, TestRawFromSerializedAndProtobuf) {
+  psi_proto::ServerSetup setup;
+  setup.mutable_raw()->add_encrypted_elements("a");
+  setup.mutable_raw()->add_encrypted_elements("b");
+  setup.mutable_raw()->add_encrypted_elements("");
+  const std::string serialized = setup.SerializeAsString();
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto view,
+                           ServerSetupView::FromSerialized(serialized));
+  EXPECT_EQ(view.data_structure_case, psi_proto::ServerSetup::kRaw);
+  ASSERT_EQ(view.encrypted_elements.size(), 3);
+  EXPECT_EQ(view.encrypted_elements[0], "a");
+  EXPECT_EQ(view.encrypted_elements[1], "b");
+  EXPECT_EQ(view.encrypted_elements[2], "");
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto view2, ServerSetupView::FromProtobuf(setup));
+  EXPECT_EQ(view2.encrypted_elements, view.encrypted_elements);
+  EXPECT_EQ(view2.encrypted_elements[0].data(),
+            setup.raw().encrypted_elements(0).data());
+}
+
+TEST(ServerSetupViewTest, TestToProtobufRoundTrips) {
+  psi_proto::ServerSetup gcs;
+  gcs.mutable_gcs()->set_div(3);
+  gcs.mutable_gcs()->set_hash_range(1000);
+  gcs.mutable_gcs()->set_bits("gcs bits");
+  psi_proto::ServerSetup raw;
+  raw.mutable_raw()->add_encrypted_elements("a");
+  raw.mutable_raw()->add_encrypted_elements("b");
+
+  for (const auto& setup : {gcs, raw}) {
+    PSI_ASSERT_OK_AND_ASSIGN(auto view, ServerSetupView::FromProtobuf(setup));
+    psi_proto::ServerSetup copy;
+    view.ToProtobuf(&copy);
+    EXPECT_EQ(copy.SerializeAsString(), setup.SerializeAsString());
+  }
+}
+
+TEST(ServerSetupViewTest, TestHashToCurvePointEncodingAndCurve) {
+  psi_proto::ServerSetup setup;
+  setup.mutable_bloom_filter()->set_bits("bloom");
+  setup.set_hash_to_curve(psi_proto::HASH_TO_CURVE_P256_SSWU);
+  setup.set_point_encoding(psi_proto::POINT_ENCODING_X_ONLY);
+  setup.set_curve(psi_proto::CURVE_RISTRETTO255);
+  psi_proto::ServerSetup gcs;
+  gcs.mutable_gcs()->set_bits("gcs");
+  // All three are kept when a later oneof member replaces an earlier one.
+  const std::string serialized =
+      setup.SerializeAsString() + gcs.SerializeAsString();
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto view,
+                           ServerSetupView::FromSerialized(serialized));
+  EXPECT_EQ(view.data_structure_case, psi_proto::ServerSetup::kGcs);
+  EXPECT_EQ(view.hash_to_curve, psi_proto::HASH_TO_CURVE_P256_SSWU);
+  EXPECT_EQ(view.point_encoding, psi_proto::POINT_ENCODING_X_ONLY);
+  EXPECT_EQ(view.curve, psi_proto::CURVE_RISTRETTO255);
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto view2, ServerSetupView::FromProtobuf(setup));
+  EXPECT_EQ(view2.hash_to_curve, psi_proto::HASH_TO_CURVE_P256_SSWU);
+  EXPECT_EQ(view2.point_encoding, psi_proto::POINT_ENCODING_X_ONLY);
+  EXPECT_EQ(view2.curve, psi_proto::CURVE_RISTRETTO255);
+  psi_proto::ServerSetup copy;
+  view2.ToProtobuf(&copy);
+  EXPECT_EQ(copy.hash_to_curve(), psi_proto::HASH_TO_CURVE_P256_SSWU);
+  EXPECT_EQ(copy.point_encoding(), psi_proto::POINT_ENCODING_X_ONLY);
+  EXPECT_EQ(copy.curve(), psi_proto::CURVE_RISTRETTO255);
+}
+
+TEST(ServerSetupViewTest, TestLastOneofMemberWins) {
+  psi_proto::ServerSetup gcs;
+  gcs.mutable_gcs()->set_bits("gcs");
+  psi_proto::ServerSetup bloom_filter;
+  bloom_filter.mutable_bloom_filter()->set_bits("bloom");
+  const std::string serialized =
+      gcs.SerializeAsString() + bloom_filter.SerializeAsString();
+
+  psi_proto::ServerSetup parsed;
+  ASSERT_TRUE(parsed.ParseFromString(serialized));
+  PSI_ASSERT_OK_AND_ASSIGN(auto view,
+                           ServerSetupView::FromSerialized(serialized));
+  EXPECT_EQ(view.data_structure_case, parsed.data_structure_case());
+  EXPECT_EQ(view.bits, parsed.bloom_filter().bits());
+}
+
+TEST(ServerSetupViewTest, TestSkipsUnknownFields) {
+  psi_proto::ServerSetup setup;
+  setup.mutable_gcs()->set_bits("gcs");
+  // Field 15 as a varint, and field 16 as a fixed32.
+  const std::string serialized = std::string("\x78\x01", 2) +
+                                 setup.SerializeAsString() +
+                                 std::string("\x85\x01\x01\x02\x03\x04", 6);
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto view,
+                           ServerSetupView::FromSerialized(serialized));
+  EXPECT_EQ(view.data_structure_case, psi_proto::ServerSetup::kGcs);
+  EXPECT_EQ(view.bits, "gcs");
+}
+
+TEST(ServerSetupViewTest, FailIfCorrupt) {
+  psi_proto::ServerSetup setup;
+  setup.mutable_gcs()->set_bits(std::string(100, 'x'));
+  const std::string serialized = setup.SerializeAsString();
+
+  EXPECT_THAT(ServerSetupView::FromSerialized(
+                  absl::string_view(serialized).substr(0, 50)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`ServerSetup` is corrupt!"));
+  EXPECT_THAT(ServerSetupView::FromSerialized(std::string("\x12\xff", 2)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`ServerSetup` is corrupt!"));
+}
+
+}  // namespace
+}  // namespace private_set_intersection
@@ -0,0 +1,568 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/datastructure/setup_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PSI_HAVE_MMAP 1
+#endif
+
+namespace private_set_intersection {
+
+namespace {
+
+constexpr char kMagic[] = "PSISETUP";
+constexpr size_t kMagicSize = sizeof(kMagic) - 1;
+
+void StoreLittleEndian(uint64_t value, size_t size, char* out) {
+  for (size_t i = 0; i < size; i++) {
+    out[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint64_t LoadLittleEndian(const char* in, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; i++) {
+    value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+size_t AlignUp(size_t offset) {
+  return (offset + kSetupFileAlignment - 1) / kSetupFileAlignment *
+         kSetupFileAlignment;
+}
+
+absl::Status CorruptError() {
+  return absl::InvalidArgumentError("Setup file is corrupt!");
+}
+
+absl::Status OsError(absl::string_view operation, const std::string& path) {
+  const int error_number = errno;
+  return absl::Status(
+      absl::ErrnoToStatusCode(error_number),
+      absl::StrCat(operation, " `", path, "`: ", std::strerror(error_number)));
+}
+
+// Header field offsets, see setup_file.h.
+constexpr size_t kVersionOffset = 8;
+constexpr size_t kDataStructureOffset = 12;
+constexpr size_t kParam0Offset = 16;
+constexpr size_t kHashRangeOffset = 24;
+constexpr size_t kElementWidthOffset = 32;
+constexpr size_t kNumEntriesOffset = 40;
+constexpr size_t kDataOffsetOffset = 48;
+constexpr size_t kDataSizeOffset = 56;
+constexpr size_t kIndexOffsetOffset = 64;
+constexpr size_t kIndexSizeOffset = 72;
+constexpr size_t kHashToCurveOffset = 80;
+constexpr size_t kPointEncodingOffset = 84;
+constexpr size_t kCurveOffset = 88;
+constexpr size_t kReservedOffset = 92;
+
+}  // namespace
+
+/**
+ * @brief Encode a server setup in the native file format
+ *
+ * @param setup A view of the server setup
+ * @param include_index Whether to store the decompressed index of a GCS
+ *
+ * @return StatusOr<std::string>
+ */
+StatusOr<std::string> EncodeSetupFile(const ServerSetupView& setup,
+                                      bool include_index) {
+  uint64_t param0 = 0;
+  uint64_t element_width = 0;
+  uint64_t num_entries = 0;
+  std::vector<absl::string_view> sorted_elements;
+  std::vector<int64_t> index;
+
+  switch (setup.data_structure_case) {
+    case psi_proto::ServerSetup::DataStructureCase::kRaw: {
+      sorted_elements = setup.encrypted_elements;
+      std::sort(sorted_elements.begin(), sorted_elements.end());
+      if (!sorted_elements.empty()) {
+        element_width = sorted_elements[0].size();
+      }
+      for (absl::string_view element : sorted_elements) {
+        if (element.size() != element_width) {
+          return absl::InvalidArgumentError("Raw elements differ in width");
+        }
+      }
+      num_entries = sorted_elements.size();
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kGcs: {
+      param0 = static_cast<uint64_t>(setup.div);
+      if (include_index) {
+        StatusOr<std::unique_ptr<GCS>> gcs = GCS::CreateFromView(setup);
+        if (!gcs.ok()) {
+          return gcs.status();
+        }
+        index = (*gcs)->Decompress();
+        num_entries = index.size();
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kBloomFilter: {
+      param0 = static_cast<uint64_t>(setup.num_hash_functions);
+      break;
+    }
+    default: {
+      return absl::InvalidArgumentError("`ServerSetup` holds no container");
+    }
+  }
+
+  const size_t data_offset = kSetupFileHeaderSize;
+  const size_t data_size =
+      setup.data_structure_case == psi_proto::ServerSetup::kRaw
+          ? element_width * num_entries
+          : setup.bits.size();
+  const size_t index_offset =
+      index.empty() ? 0 : AlignUp(data_offset + data_size);
+  const size_t index_size = index.size() * sizeof(uint64_t);
+  const size_t file_size =
+      index.empty() ? data_offset + data_size : index_offset + index_size;
+
+  std::string file(file_size, '\0');
+  std::memcpy(&file[0], kMagic, kMagicSize);
+  StoreLittleEndian(kSetupFileVersion, 4, &file[kVersionOffset]);
+  StoreLittleEndian(setup.data_structure_case, 4, &file[kDataStructureOffset]);
+  StoreLittleEndian(param0, 8, &file[kParam0Offset]);
+  StoreLittleEndian(static_cast<uint64_t>(setup.hash_range), 8,
+                    &file[kHashRangeOffset]);
+  StoreLittleEndian(element_width, 8, &file[kElementWidthOffset]);
+  StoreLittleEndian(num_entries, 8, &file[kNumEntriesOffset]);
+  StoreLittleEndian(data_offset, 8, &file[kDataOffsetOffset]);
+  StoreLittleEndian(data_size, 8, &file[kDataSizeOffset]);
+  StoreLittleEndian(index_offset, 8, &file[kIndexOffsetOffset]);
+  StoreLittleEndian(index_size, 8, &file[kIndexSizeOffset]);
+  StoreLittleEndian(static_cast<uint32_t>(setup.hash_to_curve), 4,
+                    &file[kHashToCurveOffset]);
+  StoreLittleEndian(static_cast<uint32_t>(setup.point_encoding), 4,
+                    &file[kPointEncodingOffset]);
+  StoreLittleEndian(static_cast<uint32_t>(setup.curve), 4,
+                    &file[kCurveOffset]);
+
+  char* data = &file[data_offset];
+  if (setup.data_structure_case == psi_proto::ServerSetup::kRaw) {
+    for (absl::string_view element : sorted_elements) {
+      std::memcpy(data, element.data(), element.size());
+      data += element.size();
+    }
+  } else if (!setup.bits.empty()) {
+    std::memcpy(data, setup.bits.data(), setup.bits.size());
+  }
+  for (size_t i = 0; i < index.size(); i++) {
+    StoreLittleEndian(static_cast<uint64_t>(index[i]), 8,
+                      &file[index_offset + i * sizeof(uint64_t)]);
+  }
+  return file;
+}
+
+/**
+ * @brief Write a server setup to a file in the native file format
+ *
+ * @param setup A view of the server setup
+ * @param path The path of the file to write
+ * @param include_index Whether to store the decompressed index of a GCS
+ *
+ * @return absl::Status
+ */
+absl::Status WriteSetupFile(const ServerSetupView& setup,
+                            const std::string& path, bool include_index) {
+  StatusOr<std::string> file = EncodeSetupFile(setup, include_index);
+  if (!file.ok()) {
+    return file.status();
+  }
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    return OsError("Failed to open", path);
+  }
+  out.write(file->data(), static_cast<std::streamsize>(file->size()));
+  out.close();
+  if (!out) {
+    return OsError("Failed to write", path);
+  }
+  return absl::OkStatus();
+}
+
+SetupFile::~SetupFile() {
+#ifdef PSI_HAVE_MMAP
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+#endif
+}
+
+/**
+ * @brief Open a setup file, mapping it into memory where supported
+ *
+ * @param path The path of the setup file
+ *
+ * @return StatusOr<std::unique_ptr<SetupFile>>
+ */
+StatusOr<std::unique_ptr<SetupFile>> SetupFile::Open(const std::string& path) {
+  auto setup_file = absl::WrapUnique(new SetupFile());
+#ifdef PSI_HAVE_MMAP
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return OsError("Failed to open", path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    absl::Status status = OsError("Failed to stat", path);
+    close(fd);
+    return status;
+  }
+  const auto size = static_cast<size_t>(st.st_size);
+  if (size < kSetupFileHeaderSize) {
+    close(fd);
+    return CorruptError();
+  }
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid after its file descriptor is closed.
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return OsError("Failed to map", path);
+  }
+  setup_file->mapping_ = mapping;
+  setup_file->mapping_size_ = size;
+  setup_file->file_ =
+      absl::string_view(static_cast<const char*>(mapping), size);
+#else
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return OsError("Failed to open", path);
+  }
+  setup_file->storage_.assign(std::istreambuf_iterator<char>(in),
+                              std::istreambuf_iterator<char>());
+  setup_file->file_ = setup_file->storage_;
+#endif
+
+  absl::Status status = setup_file->Parse();
+  if (!status.ok()) {
+    return status;
+  }
+#if defined(PSI_HAVE_MMAP) && defined(MADV_RANDOM)
+  // Lookups touch a few scattered pages, so readahead would only waste I/O.
+  // A GCS without index is scanned sequentially instead.
+  if (setup_file->data_structure_case_ != psi_proto::ServerSetup::kGcs ||
+      setup_file->has_index()) {
+    madvise(setup_file->mapping_, setup_file->mapping_size_, MADV_RANDOM);
+  }
+#endif
+  return setup_file;
+}
+
+/**
+ * @brief Wrap a setup file held in memory
+ *
+ * @param buffer The encoded setup file
+ *
+ * @return StatusOr<std::unique_ptr<SetupFile>>
+ */
+StatusOr<std::unique_ptr<SetupFile>> SetupFile::FromBuffer(
+    absl::string_view buffer) {
+  auto setup_file = absl::WrapUnique(new SetupFile());
+  setup_file->file_ = buffer;
+  absl::Status status = setup_file->Parse();
+  if (!status.ok()) {
+    return status;
+  }
+  return setup_file;
+}
+
+absl::Status SetupFile::Parse() {
+  if (file_.size() < kSetupFileHeaderSize ||
+      file_.substr(0, kMagicSize) != kMagic) {
+    return CorruptError();
+  }
+  const uint64_t version =
+      LoadLittleEndian(file_.data() + kVersionOffset, 4);
+  if (version != kSetupFileVersion) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unsupported setup file version ", version));
+  }
+  for (size_t i = kReservedOffset; i < kSetupFileHeaderSize; i++) {
+    if (file_[i] != 0) {
+      return CorruptError();
+    }
+  }
+
+  const uint64_t param0 = LoadLittleEndian(file_.data() + kParam0Offset, 8);
+  const uint64_t hash_range =
+      LoadLittleEndian(file_.data() + kHashRangeOffset, 8);
+  const uint64_t element_width =
+      LoadLittleEndian(file_.data() + kElementWidthOffset, 8);
+  const uint64_t num_entries =
+      LoadLittleEndian(file_.data() + kNumEntriesOffset, 8);
+  const uint64_t data_offset =
+      LoadLittleEndian(file_.data() + kDataOffsetOffset, 8);
+  const uint64_t data_size =
+      LoadLittleEndian(file_.data() + kDataSizeOffset, 8);
+  const uint64_t index_offset =
+      LoadLittleEndian(file_.data() + kIndexOffsetOffset, 8);
+  const uint64_t index_size =
+      LoadLittleEndian(file_.data() + kIndexSizeOffset, 8);
+  hash_to_curve_ = static_cast<psi_proto::HashToCurve>(
+      LoadLittleEndian(file_.data() + kHashToCurveOffset, 4));
+  point_encoding_ = static_cast<psi_proto::PointEncoding>(
+      LoadLittleEndian(file_.data() + kPointEncodingOffset, 4));
+  curve_ = static_cast<psi_proto::Curve>(
+      LoadLittleEndian(file_.data() + kCurveOffset, 4));
+
+  if (data_offset < kSetupFileHeaderSize || data_offset > file_.size() ||
+      data_size > file_.size() - data_offset) {
+    return CorruptError();
+  }
+  data_ = file_.substr(data_offset, data_size);
+  if (index_offset != 0) {
+    if (index_offset < kSetupFileHeaderSize || index_offset > file_.size() ||
+        index_size > file_.size() - index_offset ||
+        index_size % sizeof(uint64_t) != 0 ||
+        index_size / sizeof(uint64_t) != num_entries) {
+      return CorruptError();
+    }
+    index_ = file_.substr(index_offset, index_size);
+  } else if (index_size != 0) {
+    return CorruptError();
+  }
+
+  const uint64_t data_structure =
+      LoadLittleEndian(file_.data() + kDataStructureOffset, 4);
+  switch (data_structure) {
+    case psi_proto::ServerSetup::DataStructureCase::kRaw: {
+      if (!index_.empty() ||
+          (num_entries != 0 && data_size / num_entries != element_width) ||
+          data_size != element_width * num_entries) {
+        return CorruptError();
+      }
+      data_structure_case_ = psi_proto::ServerSetup::kRaw;
+      element_width_ = element_width;
+      num_entries_ = num_entries;
+      return absl::OkStatus();
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kGcs: {
+      if (param0 > 64 || hash_range > INT64_MAX) {
+        return CorruptError();
+      }
+      data_structure_case_ = psi_proto::ServerSetup::kGcs;
+      div_ = static_cast<int64_t>(param0);
+      hash_range_ = static_cast<int64_t>(hash_range);
+      num_entries_ = index_.empty() ? 0 : num_entries;
+      StatusOr<std::unique_ptr<GCS>> gcs = GCS::CreateFromView(ToView());
+      if (!gcs.ok()) {
+        return gcs.status();
+      }
+      gcs_ = *std::move(gcs);
+      return absl::OkStatus();
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kBloomFilter: {
+      if (!index_.empty() || param0 > INT32_MAX) {
+        return CorruptError();
+      }
+      data_structure_case_ = psi_proto::ServerSetup::kBloomFilter;
+      num_hash_functions_ = static_cast<int>(param0);
+      StatusOr<std::unique_ptr<BloomFilter>> bloom_filter =
+          BloomFilter::CreateFromView(ToView());
+      if (!bloom_filter.ok()) {
+        return bloom_filter.status();
+      }
+      bloom_filter_ = *std::move(bloom_filter);
+      return absl::OkStatus();
+    }
+    default: {
+      return CorruptError();
+    }
+  }
+}
+
+std::vector<int64_t> SetupFile::Intersect(
+    absl::Span<const std::string> elements) const {
+  std::vector<int64_t> res;
+  switch (data_structure_case_) {
+    case psi_proto::ServerSetup::DataStructureCase::kRaw: {
+      for (size_t i = 0; i < elements.size(); i++) {
+        if (ContainsRaw(elements[i])) {
+          res.push_back(static_cast<int64_t>(i));
+        }
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kGcs: {
+      if (!has_index()) {
+        res = gcs_->Intersect(elements);
+        std::sort(res.begin(), res.end());
+        break;
+      }
+      std::vector<int64_t> hashes(elements.size());
+      gcs_->HashElements(elements, hashes.data());
+      for (size_t i = 0; i < elements.size(); i++) {
+        if (ContainsIndexedHash(hashes[i])) {
+          res.push_back(static_cast<int64_t>(i));
+        }
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kBloomFilter: {
+      res = bloom_filter_->Intersect(elements);
+      break;
+    }
+    default:
+      break;
+  }
+  return res;
+}
+
+int64_t SetupFile::IntersectionSize(
+    absl::Span<const std::string> elements) const {
+  int64_t count = 0;
+  switch (data_structure_case_) {
+    case psi_proto::ServerSetup::DataStructureCase::kRaw: {
+      for (const std::string& element : elements) {
+        count += ContainsRaw(element);
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kGcs: {
+      if (!has_index()) {
+        count = gcs_->IntersectionSize(elements);
+        break;
+      }
+      std::vector<int64_t> hashes(elements.size());
+      gcs_->HashElements(elements, hashes.data());
+      for (int64_t hash : hashes) {
+        count += ContainsIndexedHash(hash);
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kBloomFilter: {
+      count = bloom_filter_->IntersectionSize(elements);
+      break;
+    }
+    default:
+      break;
+  }
+  return count;
+}
+
+bool SetupFile::ContainsRaw(absl::string_view element) const {
+  if (element.size() != element_width_) {
+    return false;
+  }
+  size_t lo = 0, hi = num_entries_;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    const int cmp =
+        data_.substr(mid * element_width_, element_width_).compare(element);
+    if (cmp == 0) {
+      return true;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return false;
+}
+
+bool SetupFile::ContainsIndexedHash(int64_t hash) const {
+  const auto target = static_cast<uint64_t>(hash);
+  size_t lo = 0, hi = num_entries_;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    const uint64_t value =
+        LoadLittleEndian(index_.data() + mid * sizeof(uint64_t), 8);
+    if (value == target) {
+      return true;
+    }
+    if (value < target) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return false;
+}
+
+ServerSetupView SetupFile::ToView() const {
+  ServerSetupView view;
+  view.data_structure_case = data_structure_case_;
+  view.hash_to_curve = hash_to_curve_;
+  view.point_encoding = point_encoding_;
+  view.curve = curve_;
+  switch (data_structure_case_) {
+    case psi_proto::ServerSetup::DataStructureCase::kRaw: {
+      view.encrypted_elements.reserve(num_entries_);
+      for (size_t i = 0; i < num_entries_; i++) {
+        view.encrypted_elements.push_back(
+            data_.substr(i * element_width_, element_width_));
+      }
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kGcs: {
+      view.div = div_;
+      view.hash_range = hash_range_;
+      view.bits = data_;
+      break;
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kBloomFilter: {
+      view.num_hash_functions = num_hash_functions_;
+      view.bits = data_;
+      break;
+    }
+    default:
+      break;
+  }
+  return view;
+}
+
+psi_proto::ServerSetup::DataStructureCase SetupFile::data_structure_case()
+    const {
+  return data_structure_case_;
+}
+
+psi_proto::HashToCurve SetupFile::hash_to_curve() const {
+  return hash_to_curve_;
+}
+
+psi_proto::PointEncoding SetupFile::point_encoding() const {
+  return point_encoding_;
+}
+
+psi_proto::Curve SetupFile::curve() const { return curve_; }
+
+bool SetupFile::has_index() const { return !index_.empty(); }
+
+}  // namespace private_set_intersection
@@ -0,0 +1,174 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_SETUP_FILE_H_
+#define PRIVATE_SET_INTERSECTION_CPP_SETUP_FILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "private_set_intersection/cpp/datastructure/bloom_filter.h"
+#include "private_set_intersection/cpp/datastructure/gcs.h"
+#include "private_set_intersection/cpp/datastructure/server_setup_view.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+
+using absl::StatusOr;
+
+// Native on-disk format for server setups, designed to be memory-mapped and
+// queried in place. All integers are little-endian. A file consists of:
+//
+//   offset  size  field
+//   0       8     magic "PSISETUP"
+//   8       4     format version (kSetupFileVersion)
+//   12      4     data structure, as a `ServerSetup::DataStructureCase`
+//   16      8     GCS `div`, or the Bloom filter's number of hash functions
+//   24      8     GCS `hash_range`
+//   32      8     width in bytes of each Raw element
+//   40      8     number of Raw elements, or of entries in the index
+//   48      8     offset of the data section
+//   56      8     size of the data section
+//   64      8     offset of the index section, 0 if absent
+//   72      8     size of the index section
+//   80      4     hash-to-curve method, as a `psi_proto::HashToCurve`
+//   84      4     point encoding, as a `psi_proto::PointEncoding`
+//   88      4     curve, as a `psi_proto::Curve`
+//   92      36    reserved, must be zero
+//
+// The data section holds the GCS or Bloom filter bits, or the Raw elements
+// sorted and packed at a fixed width. The optional index section holds the
+// decompressed GCS hashes as sorted 64-bit integers, so that lookups can
+// binary-search instead of scanning the compressed set. Sections start at
+// multiples of kSetupFileAlignment.
+inline constexpr uint32_t kSetupFileVersion = 1;
+inline constexpr size_t kSetupFileHeaderSize = 128;
+inline constexpr size_t kSetupFileAlignment = 64;
+
+// Encodes `setup` in the native file format. If `include_index` is true, a
+// GCS setup is stored with its decompressed index.
+//
+// Returns INVALID_ARGUMENT if `setup` holds no container, or if Raw elements
+// differ in width.
+StatusOr<std::string> EncodeSetupFile(const ServerSetupView& setup,
+                                      bool include_index = false);
+
+// As `EncodeSetupFile`, but writes the result to the file at `path`.
+absl::Status WriteSetupFile(const ServerSetupView& setup,
+                            const std::string& path,
+                            bool include_index = false);
+
+// A setup in the native file format, queried in place. When opened from a
+// path, the file is mapped read-only, so its pages are loaded lazily on first
+// access and shared between all processes that map the same file, e.g.
+// pre-forked workers.
+//
+// Like the containers it wraps, a SetupFile is not thread-safe.
+class SetupFile {
+ public:
+  SetupFile(const SetupFile&) = delete;
+  SetupFile& operator=(const SetupFile&) = delete;
+  ~SetupFile();
+
+  // Maps the file at `path` read-only. Where memory mapping is unavailable,
+  // the file is read into memory instead.
+  //
+  // Returns INVALID_ARGUMENT if the file is not a valid setup file, or the
+  // error reported by the operating system if it cannot be opened.
+  static StatusOr<std::unique_ptr<SetupFile>> Open(const std::string& path);
+
+  // Wraps an encoded setup file held in memory. `buffer` must outlive the
+  // returned SetupFile.
+  //
+  // Returns INVALID_ARGUMENT if `buffer` is not a valid setup file.
+  static StatusOr<std::unique_ptr<SetupFile>> FromBuffer(
+      absl::string_view buffer);
+
+  // Returns the indices of `elements` that are contained in the setup, in
+  // ascending order.
+  std::vector<int64_t> Intersect(absl::Span<const std::string> elements) const;
+
+  // Returns the number of `elements` that are contained in the setup, i.e. the
+  // size of `Intersect`, without tracking their indices.
+  int64_t IntersectionSize(absl::Span<const std::string> elements) const;
+
+  // Returns a view of the setup, to be used with the containers'
+  // `CreateFromView`. For Raw setups this allocates a view per element.
+  ServerSetupView ToView() const;
+
+  psi_proto::ServerSetup::DataStructureCase data_structure_case() const;
+
+  psi_proto::HashToCurve hash_to_curve() const;
+
+  psi_proto::PointEncoding point_encoding() const;
+
+  psi_proto::Curve curve() const;
+
+  // Returns true if the file holds an index for fast lookups.
+  bool has_index() const;
+
+ private:
+  SetupFile() = default;
+
+  // Parses and validates the header of `file_`, and sets up the containers.
+  absl::Status Parse();
+
+  // Returns true if the sorted Raw elements contain `element`.
+  bool ContainsRaw(absl::string_view element) const;
+
+  // Returns true if the GCS index contains `hash`.
+  bool ContainsIndexedHash(int64_t hash) const;
+
+  // Set if the file is memory-mapped.
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+
+  // Set if the file was read into memory.
+  std::string storage_;
+
+  // The encoded file.
+  absl::string_view file_;
+
+  psi_proto::ServerSetup::DataStructureCase data_structure_case_ =
+      psi_proto::ServerSetup::DATA_STRUCTURE_NOT_SET;
+  psi_proto::HashToCurve hash_to_curve_ =
+      psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT;
+  psi_proto::PointEncoding point_encoding_ =
+      psi_proto::POINT_ENCODING_COMPRESSED;
+  psi_proto::Curve curve_ = psi_proto::CURVE_P256;
+  int64_t div_ = 0;
+  int64_t hash_range_ = 0;
+  int num_hash_functions_ = 0;
+  size_t element_width_ = 0;
+  size_t num_entries_ = 0;
+  absl::string_view data_;
+  absl::string_view index_;
+
+  // Containers referencing `data_`, set for GCS and Bloom filter setups.
+  std::unique_ptr<GCS> gcs_;
+  // `class` disambiguates from the `DataStructure::BloomFilter` enumerator.
+  std::unique_ptr<class BloomFilter> bloom_filter_;
+};
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_SETUP_FILE_H_
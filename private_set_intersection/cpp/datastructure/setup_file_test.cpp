@@ -0,0 +1,189 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/datastructure/setup_file.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "private_set_intersection/cpp/datastructure/bloom_filter.h"
+#include "private_set_intersection/cpp/datastructure/gcs.h"
+#include "private_set_intersection/cpp/datastructure/raw.h"
+#include "private_set_intersection/cpp/util/status_matchers.h"
+#include "private_set_intersection/proto/psi.pb.h"
+
+namespace private_set_intersection {
+namespace {
+
+std::vector<std::string> MakeElements(int num_elements, int step) {
+  std::vector<std::string> elements(num_elements);
+  for (int i = 0; i < num_elements; i++) {
+    elements[i] = absl::StrCat("Element ", 100000 + step * i);
+  }
+  return elements;
+}
+
+// Checks that the setup file encoding `server_setup` yields the same
+// intersection as the container.
+void ExpectSameIntersection(const psi_proto::ServerSetup& server_setup,
+                            std::vector<int64_t> expected,
+                            bool include_index = false) {
+  std::vector<std::string> client = MakeElements(200, 1);
+  std::sort(expected.begin(), expected.end());
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto view,
+                           ServerSetupView::FromProtobuf(server_setup));
+  PSI_ASSERT_OK_AND_ASSIGN(std::string encoded,
+                           EncodeSetupFile(view, include_index));
+  EXPECT_EQ(encoded.substr(0, 8), "PSISETUP");
+  PSI_ASSERT_OK_AND_ASSIGN(auto setup_file, SetupFile::FromBuffer(encoded));
+  EXPECT_EQ(setup_file->data_structure_case(),
+            server_setup.data_structure_case());
+  EXPECT_EQ(setup_file->hash_to_curve(), server_setup.hash_to_curve());
+  EXPECT_EQ(setup_file->ToView().hash_to_curve, server_setup.hash_to_curve());
+  EXPECT_EQ(setup_file->point_encoding(), server_setup.point_encoding());
+  EXPECT_EQ(setup_file->ToView().point_encoding,
+            server_setup.point_encoding());
+  EXPECT_EQ(setup_file->curve(), server_setup.curve());
+  EXPECT_EQ(setup_file->ToView().curve, server_setup.curve());
+  EXPECT_EQ(setup_file->Intersect(client), expected);
+  EXPECT_EQ(setup_file->IntersectionSize(client),
+            static_cast<int64_t>(expected.size()));
+}
+
+TEST(SetupFileTest, TestRaw) {
+  std::vector<std::string> client = MakeElements(200, 1);
+  PSI_ASSERT_OK_AND_ASSIGN(auto raw, Raw::Create(200, MakeElements(100, 3)));
+  ExpectSameIntersection(raw->ToProtobuf(), raw->Intersect(client));
+}
+
+TEST(SetupFileTest, TestGcs) {
+  std::vector<std::string> client = MakeElements(200, 1);
+  PSI_ASSERT_OK_AND_ASSIGN(auto gcs,
+                           GCS::Create(0.001, 200, MakeElements(100, 3)));
+  ExpectSameIntersection(gcs->ToProtobuf(), gcs->Intersect(client));
+  ExpectSameIntersection(gcs->ToProtobuf(), gcs->Intersect(client),
+                         /*include_index=*/true);
+}
+
+TEST(SetupFileTest, TestBloomFilter) {
+  std::vector<std::string> client = MakeElements(200, 1);
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto bloom_filter, BloomFilter::Create(0.001, 200, MakeElements(100, 3)));
+  psi_proto::ServerSetup server_setup = bloom_filter->ToProtobuf();
+  ExpectSameIntersection(server_setup, bloom_filter->Intersect(client));
+  server_setup.set_hash_to_curve(psi_proto::HASH_TO_CURVE_P256_SSWU);
+  ExpectSameIntersection(server_setup, bloom_filter->Intersect(client));
+  server_setup.set_point_encoding(psi_proto::POINT_ENCODING_X_ONLY);
+  ExpectSameIntersection(server_setup, bloom_filter->Intersect(client));
+  server_setup.set_curve(psi_proto::CURVE_RISTRETTO255);
+  ExpectSameIntersection(server_setup, bloom_filter->Intersect(client));
+}
+
+TEST(SetupFileTest, TestWriteAndOpen) {
+  std::vector<std::string> client = MakeElements(200, 1);
+  PSI_ASSERT_OK_AND_ASSIGN(auto gcs,
+                           GCS::Create(0.001, 200, MakeElements(100, 3)));
+  psi_proto::ServerSetup server_setup = gcs->ToProtobuf();
+  PSI_ASSERT_OK_AND_ASSIGN(auto view,
+                           ServerSetupView::FromProtobuf(server_setup));
+
+  const std::string path = ::testing::TempDir() + "/setup_file_test.psi";
+  ASSERT_TRUE(WriteSetupFile(view, path, /*include_index=*/true).ok());
+  PSI_ASSERT_OK_AND_ASSIGN(auto setup_file, SetupFile::Open(path));
+  EXPECT_TRUE(setup_file->has_index());
+
+  std::vector<int64_t> expected = gcs->Intersect(client);
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(setup_file->Intersect(client), expected);
+
+  // The view references the mapped bits.
+  ServerSetupView file_view = setup_file->ToView();
+  EXPECT_EQ(file_view.bits, server_setup.gcs().bits());
+  EXPECT_EQ(file_view.div, server_setup.gcs().div());
+  EXPECT_EQ(file_view.hash_range, server_setup.gcs().hash_range());
+}
+
+TEST(SetupFileTest, TestRawToView) {
+  std::vector<std::string> server = {"d", "a", "c"};
+  PSI_ASSERT_OK_AND_ASSIGN(auto raw, Raw::Create(3, server));
+  PSI_ASSERT_OK_AND_ASSIGN(auto view,
+                           ServerSetupView::FromProtobuf(raw->ToProtobuf()));
+  PSI_ASSERT_OK_AND_ASSIGN(std::string encoded, EncodeSetupFile(view));
+  PSI_ASSERT_OK_AND_ASSIGN(auto setup_file, SetupFile::FromBuffer(encoded));
+
+  std::vector<absl::string_view> expected = {"a", "c", "d"};
+  EXPECT_EQ(setup_file->ToView().encrypted_elements, expected);
+}
+
+TEST(SetupFileTest, FailIfRawElementsDifferInWidth) {
+  ServerSetupView view;
+  view.data_structure_case = psi_proto::ServerSetup::kRaw;
+  view.encrypted_elements = {"a", "bc"};
+  EXPECT_THAT(EncodeSetupFile(view),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Raw elements differ in width"));
+}
+
+TEST(SetupFileTest, FailIfCorrupt) {
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto bloom_filter, BloomFilter::Create(0.001, 10, MakeElements(10, 1)));
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto view, ServerSetupView::FromProtobuf(bloom_filter->ToProtobuf()));
+  PSI_ASSERT_OK_AND_ASSIGN(std::string encoded, EncodeSetupFile(view));
+
+  EXPECT_THAT(SetupFile::FromBuffer(encoded.substr(0, 64)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(SetupFile::FromBuffer(encoded.substr(0, encoded.size() - 1)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  std::string bad_magic = encoded;
+  bad_magic[0] = 'X';
+  EXPECT_THAT(SetupFile::FromBuffer(bad_magic),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  std::string bad_version = encoded;
+  bad_version[8] = 2;
+  EXPECT_THAT(SetupFile::FromBuffer(bad_version),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Unsupported setup file version 2"));
+
+  EXPECT_FALSE(SetupFile::Open(::testing::TempDir() + "/does_not_exist").ok());
+}
+
+TEST(SetupFileTest, FailIfIndexSizeDoesNotMatchEntries) {
+  PSI_ASSERT_OK_AND_ASSIGN(auto gcs,
+                           GCS::Create(0.001, 10, MakeElements(10, 1)));
+  PSI_ASSERT_OK_AND_ASSIGN(auto view,
+                           ServerSetupView::FromProtobuf(gcs->ToProtobuf()));
+  PSI_ASSERT_OK_AND_ASSIGN(std::string encoded,
+                           EncodeSetupFile(view, /*include_index=*/true));
+
+  // 2^61 + 1 entries of 8 bytes each wrap around to an index of 8 bytes.
+  std::string wrapped = encoded;
+  const uint64_t num_entries = (uint64_t{1} << 61) + 1;
+  for (int i = 0; i < 8; i++) {
+    wrapped[40 + i] = static_cast<char>(num_entries >> (8 * i));
+    wrapped[72 + i] = static_cast<char>(i == 0 ? 8 : 0);
+  }
+  EXPECT_THAT(SetupFile::FromBuffer(wrapped),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace private_set_intersection
@@ -0,0 +1,238 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/intersection_result.h"
+
+#include <utility>
+
+namespace private_set_intersection {
+
+namespace {
+
+// Returns the number of bytes of `value` as an unsigned LEB128 varint.
+size_t VarintLength(uint64_t value) {
+  size_t length = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    length++;
+  }
+  return length;
+}
+
+void AppendVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// Decodes the varint at `*position` and advances past it.
+uint64_t ReadVarint(absl::string_view data, size_t* position) {
+  uint64_t value = 0;
+  int shift = 0;
+  while (*position < data.size()) {
+    const auto byte = static_cast<uint8_t>(data[(*position)++]);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+    shift += 7;
+  }
+  return value;
+}
+
+// Returns the first set bit of `bitmap` at or after `position`, or `num_bits`
+// if there is none.
+size_t NextSetBit(absl::string_view bitmap, size_t num_bits, size_t position) {
+  while (position < num_bits) {
+    const auto byte = static_cast<uint8_t>(bitmap[position / 8]) >>
+                      (position % 8);
+    if (byte == 0) {
+      // Skip the rest of the byte at once.
+      position = (position / 8 + 1) * 8;
+      continue;
+    }
+    if (byte & 1) {
+      return position;
+    }
+    position++;
+  }
+  return num_bits;
+}
+
+}  // namespace
+
+IntersectionResult::IntersectionResult(Encoding encoding, int64_t size,
+                                       int64_t num_client_inputs,
+                                       std::string data)
+    : encoding_(encoding),
+      size_(size),
+      num_client_inputs_(num_client_inputs),
+      data_(std::move(data)) {}
+
+IntersectionResult::Builder::Builder(int64_t num_client_inputs)
+    : num_client_inputs_(num_client_inputs),
+      bitmap_(static_cast<size_t>((num_client_inputs + 7) / 8), '\0') {}
+
+void IntersectionResult::Builder::Add(int64_t index) {
+  const auto bit = static_cast<char>(1 << (index % 8));
+  char& byte = bitmap_[index / 8];
+  size_ += (byte & bit) == 0;
+  byte |= bit;
+}
+
+IntersectionResult IntersectionResult::Builder::Finish(
+    absl::optional<Encoding> encoding) && {
+  IntersectionResult bitmap(Encoding::kBitmap, size_, num_client_inputs_,
+                            std::move(bitmap_));
+  if (!encoding.has_value()) {
+    size_t delta_length = 0;
+    int64_t previous = -1;
+    for (int64_t index : bitmap) {
+      delta_length +=
+          VarintLength(static_cast<uint64_t>(index - previous - 1));
+      previous = index;
+    }
+    encoding = delta_length < bitmap.data_.size() ? Encoding::kDeltaVarint
+                                                  : Encoding::kBitmap;
+  }
+  if (*encoding == Encoding::kBitmap) {
+    return bitmap;
+  }
+  std::string data;
+  int64_t previous = -1;
+  for (int64_t index : bitmap) {
+    AppendVarint(static_cast<uint64_t>(index - previous - 1), &data);
+    previous = index;
+  }
+  return IntersectionResult(Encoding::kDeltaVarint, size_, num_client_inputs_,
+                            std::move(data));
+}
+
+IntersectionResult IntersectionResult::Create(
+    const std::vector<int64_t>& indices, int64_t num_client_inputs,
+    Encoding encoding) {
+  Builder builder(num_client_inputs);
+  for (int64_t index : indices) {
+    builder.Add(index);
+  }
+  return std::move(builder).Finish(encoding);
+}
+
+IntersectionResult IntersectionResult::CreateCompact(
+    const std::vector<int64_t>& indices, int64_t num_client_inputs) {
+  Builder builder(num_client_inputs);
+  for (int64_t index : indices) {
+    builder.Add(index);
+  }
+  return std::move(builder).Finish(absl::nullopt);
+}
+
+bool IntersectionResult::Contains(int64_t index) const {
+  if (index < 0 || index >= num_client_inputs_) {
+    return false;
+  }
+  if (encoding_ == Encoding::kBitmap) {
+    return (static_cast<uint8_t>(data_[index / 8]) >> (index % 8)) & 1;
+  }
+  for (int64_t element : *this) {
+    if (element >= index) {
+      return element == index;
+    }
+  }
+  return false;
+}
+
+IntersectionResult::const_iterator IntersectionResult::begin() const {
+  return const_iterator(this, 0);
+}
+
+IntersectionResult::const_iterator IntersectionResult::end() const {
+  return const_iterator(this, encoding_ == Encoding::kBitmap
+                                  ? static_cast<size_t>(num_client_inputs_)
+                                  : data_.size() + 1);
+}
+
+std::vector<int64_t> IntersectionResult::ToIndices() const {
+  std::vector<int64_t> indices;
+  indices.reserve(size_);
+  indices.insert(indices.end(), begin(), end());
+  return indices;
+}
+
+bool IntersectionResult::Next(Cursor* cursor, int64_t* index) const {
+  if (encoding_ == Encoding::kBitmap) {
+    const auto num_bits = static_cast<size_t>(num_client_inputs_);
+    cursor->offset = NextSetBit(data_, num_bits, cursor->offset);
+    if (cursor->offset >= num_bits) {
+      return false;
+    }
+    *index = static_cast<int64_t>(cursor->offset++);
+    return true;
+  }
+  if (cursor->offset >= data_.size()) {
+    return false;
+  }
+  *index = cursor->base +
+           static_cast<int64_t>(ReadVarint(data_, &cursor->offset));
+  cursor->base = *index + 1;
+  return true;
+}
+
+IntersectionResult::const_iterator::const_iterator(
+    const IntersectionResult* result, size_t position)
+    : result_(result), position_(position) {
+  if (result_->encoding_ == Encoding::kBitmap) {
+    Seek();
+  } else if (position_ == 0) {
+    // Delta-coded iterators point past the varint of the current index, and
+    // the end is one past the last byte.
+    ++*this;
+  }
+}
+
+void IntersectionResult::const_iterator::Seek() {
+  const auto num_bits = static_cast<size_t>(result_->num_client_inputs_);
+  position_ = NextSetBit(result_->data_, num_bits, position_);
+  if (position_ < num_bits) {
+    index_ = static_cast<int64_t>(position_);
+  }
+}
+
+IntersectionResult::const_iterator&
+IntersectionResult::const_iterator::operator++() {
+  if (result_->encoding_ == Encoding::kBitmap) {
+    position_++;
+    Seek();
+    return *this;
+  }
+  if (position_ >= result_->data_.size()) {
+    position_ = result_->data_.size() + 1;
+    return *this;
+  }
+  index_ += static_cast<int64_t>(ReadVarint(result_->data_, &position_)) + 1;
+  return *this;
+}
+
+IntersectionResult::const_iterator
+IntersectionResult::const_iterator::operator++(int) {
+  const_iterator copy = *this;
+  ++*this;
+  return copy;
+}
+
+}  // namespace private_set_intersection
@@ -0,0 +1,161 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_INTERSECTION_RESULT_H_
+#define PRIVATE_SET_INTERSECTION_CPP_INTERSECTION_RESULT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+namespace private_set_intersection {
+
+// A compact encoding of the client indices in an intersection, as an
+// alternative to a vector of 8-byte indices.
+//
+// - `kBitmap` stores one bit per client input: bit `i % 8` of byte `i / 8` is
+//   set iff index `i` is in the intersection. It takes
+//   `ceil(num_client_inputs / 8)` bytes, which is best for large overlaps.
+// - `kDeltaVarint` stores the indices in ascending order as unsigned LEB128
+//   varints of the gap to the previous index minus one (the first index is
+//   stored as is). Small overlaps take about one byte per index.
+//
+// The encoded bytes are exposed by `data()` so that they can be handed to
+// other languages without copying.
+class IntersectionResult {
+ public:
+  enum class Encoding {
+    kBitmap = 0,
+    kDeltaVarint = 1,
+  };
+
+  // Iterates over the indices in ascending order.
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = int64_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const int64_t*;
+    using reference = int64_t;
+
+    int64_t operator*() const { return index_; }
+    const_iterator& operator++();
+    const_iterator operator++(int);
+    bool operator==(const const_iterator& other) const {
+      return position_ == other.position_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class IntersectionResult;
+
+    const_iterator(const IntersectionResult* result, size_t position);
+
+    // Moves to the next index at or after `position_`, or to the end.
+    void Seek();
+
+    const IntersectionResult* result_;
+    // The bit position in a bitmap, or the byte offset of the next varint.
+    size_t position_;
+    int64_t index_ = -1;
+  };
+
+  // Collects indices as they are found, without holding them in a vector. The
+  // indices are marked in a bitmap of `num_client_inputs` bits, which `Finish`
+  // converts to the final encoding.
+  class Builder {
+   public:
+    explicit Builder(int64_t num_client_inputs);
+
+    // Adds `index`, which must be in [0, num_client_inputs). Indices may be
+    // added in any order, and adding one again has no effect.
+    void Add(int64_t index);
+
+    // Returns the result in `encoding`, or in the one that takes fewer bytes
+    // if `encoding` is nullopt.
+    IntersectionResult Finish(absl::optional<Encoding> encoding) &&;
+
+   private:
+    int64_t num_client_inputs_;
+    int64_t size_ = 0;
+    std::string bitmap_;
+  };
+
+  // Encodes `indices`, which may be in any order but must be distinct and in
+  // [0, num_client_inputs).
+  static IntersectionResult Create(const std::vector<int64_t>& indices,
+                                   int64_t num_client_inputs,
+                                   Encoding encoding);
+
+  // As `Create`, but picks the encoding that takes fewer bytes.
+  static IntersectionResult CreateCompact(const std::vector<int64_t>& indices,
+                                          int64_t num_client_inputs);
+
+  Encoding encoding() const { return encoding_; }
+
+  // Returns the number of indices in the intersection.
+  int64_t size() const { return size_; }
+
+  // Returns the number of client inputs that the indices refer to.
+  int64_t num_client_inputs() const { return num_client_inputs_; }
+
+  // Returns the encoded indices, see `Encoding`.
+  absl::string_view data() const { return data_; }
+
+  // Returns true if `index` is in the intersection. Takes constant time for
+  // bitmaps and linear time for delta-coded indices.
+  bool Contains(int64_t index) const;
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  // A position in the indices that can be held outside of C++, e.g. by callers
+  // of the C API. A value-initialized cursor points to the first index.
+  struct Cursor {
+    // The bit position in a bitmap, or the byte offset of the next varint.
+    size_t offset = 0;
+    // One past the previous index, for delta-coded indices.
+    int64_t base = 0;
+  };
+
+  // Writes the index at `*cursor` to `*index` and advances `*cursor` past it.
+  // Returns false, leaving `*index` unchanged, once all indices have been
+  // visited.
+  bool Next(Cursor* cursor, int64_t* index) const;
+
+  // Decodes the indices, in ascending order.
+  std::vector<int64_t> ToIndices() const;
+
+ private:
+  IntersectionResult(Encoding encoding, int64_t size,
+                     int64_t num_client_inputs, std::string data);
+
+  Encoding encoding_;
+  int64_t size_;
+  int64_t num_client_inputs_;
+  std::string data_;
+};
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_INTERSECTION_RESULT_H_
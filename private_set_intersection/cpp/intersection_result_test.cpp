@@ -0,0 +1,114 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/intersection_result.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace private_set_intersection {
+namespace {
+
+TEST(IntersectionResultTest, TestEncodingsRoundTrip) {
+  std::vector<int64_t> indices = {1000, 3, 0, 7, 8, 130, 131, 999};
+  std::vector<int64_t> sorted = {0, 3, 7, 8, 130, 131, 999, 1000};
+
+  for (auto encoding : {IntersectionResult::Encoding::kBitmap,
+                        IntersectionResult::Encoding::kDeltaVarint}) {
+    auto result = IntersectionResult::Create(indices, 1001, encoding);
+    EXPECT_EQ(result.encoding(), encoding);
+    EXPECT_EQ(result.size(), 8);
+    EXPECT_EQ(result.num_client_inputs(), 1001);
+    EXPECT_EQ(result.ToIndices(), sorted);
+
+    IntersectionResult::Cursor cursor;
+    std::vector<int64_t> visited;
+    int64_t index = -1;
+    while (result.Next(&cursor, &index)) {
+      visited.push_back(index);
+    }
+    EXPECT_EQ(visited, sorted);
+    EXPECT_FALSE(result.Next(&cursor, &index));
+
+    for (int64_t i = -1; i <= 1001; i++) {
+      EXPECT_EQ(result.Contains(i),
+                std::find(sorted.begin(), sorted.end(), i) != sorted.end());
+    }
+  }
+}
+
+TEST(IntersectionResultTest, TestEncodedBytes) {
+  auto bitmap = IntersectionResult::Create(
+      {0, 9, 10}, 12, IntersectionResult::Encoding::kBitmap);
+  EXPECT_EQ(bitmap.data(), std::string("\x01\x06", 2));
+
+  // Gaps minus one: 0, 8, 0, then 200 as a two-byte varint.
+  auto delta = IntersectionResult::Create(
+      {0, 9, 10, 211}, 1000, IntersectionResult::Encoding::kDeltaVarint);
+  EXPECT_EQ(delta.data(), std::string("\x00\x08\x00\xc8\x01", 5));
+}
+
+TEST(IntersectionResultTest, TestEmpty) {
+  for (auto encoding : {IntersectionResult::Encoding::kBitmap,
+                        IntersectionResult::Encoding::kDeltaVarint}) {
+    auto result = IntersectionResult::Create({}, 100, encoding);
+    EXPECT_EQ(result.size(), 0);
+    EXPECT_TRUE(result.begin() == result.end());
+    EXPECT_TRUE(result.ToIndices().empty());
+    IntersectionResult::Cursor cursor;
+    int64_t index = -1;
+    EXPECT_FALSE(result.Next(&cursor, &index));
+    EXPECT_EQ(index, -1);
+  }
+}
+
+TEST(IntersectionResultTest, TestBuilder) {
+  // Indices may come in any order and repeat.
+  for (auto encoding : {IntersectionResult::Encoding::kBitmap,
+                        IntersectionResult::Encoding::kDeltaVarint}) {
+    IntersectionResult::Builder builder(100);
+    for (int64_t index : {42, 7, 99, 7, 0}) {
+      builder.Add(index);
+    }
+    auto result = std::move(builder).Finish(encoding);
+    EXPECT_EQ(result.encoding(), encoding);
+    EXPECT_EQ(result.size(), 4);
+    EXPECT_EQ(result.ToIndices(), std::vector<int64_t>({0, 7, 42, 99}));
+  }
+}
+
+TEST(IntersectionResultTest, TestCompactPicksSmallerEncoding) {
+  // A sparse result is delta coded, and a dense one is a bitmap.
+  auto sparse = IntersectionResult::CreateCompact({5, 50000}, 100000);
+  EXPECT_EQ(sparse.encoding(), IntersectionResult::Encoding::kDeltaVarint);
+  EXPECT_LT(sparse.data().size(), 10);
+
+  std::vector<int64_t> dense;
+  for (int64_t i = 0; i < 100000; i += 2) {
+    dense.push_back(i);
+  }
+  auto result = IntersectionResult::CreateCompact(dense, 100000);
+  EXPECT_EQ(result.encoding(), IntersectionResult::Encoding::kBitmap);
+  EXPECT_EQ(result.data().size(), 12500);
+  EXPECT_EQ(result.ToIndices(), dense);
+}
+
+}  // namespace
+}  // namespace private_set_intersection
@@ -0,0 +1,57 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/packed_elements.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+
+namespace private_set_intersection {
+
+StatusOr<int64_t> NumPackedElements(absl::string_view packed, int32_t width) {
+  if (width <= 0) {
+    return absl::InvalidArgumentError("`element_width` must be positive");
+  }
+  if (packed.size() % width != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Packed elements of length ", packed.size(),
+                     " are not a multiple of `element_width` = ", width));
+  }
+  return static_cast<int64_t>(packed.size() / width);
+}
+
+void SortPackedElements(int32_t width, std::string* packed) {
+  const int64_t num_elements = static_cast<int64_t>(packed->size() / width);
+
+  // Sort views into the buffer, then write the elements back in order. This
+  // moves each element exactly once instead of swapping whole records.
+  std::vector<absl::string_view> views(num_elements);
+  for (int64_t i = 0; i < num_elements; i++) {
+    views[i] = PackedElement(*packed, width, i);
+  }
+  std::sort(views.begin(), views.end());
+
+  std::string sorted;
+  sorted.reserve(packed->size());
+  for (absl::string_view view : views) {
+    sorted.append(view.data(), view.size());
+  }
+  packed->swap(sorted);
+}
+
+}  // namespace private_set_intersection
@@ -0,0 +1,54 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_PACKED_ELEMENTS_H_
+#define PRIVATE_SET_INTERSECTION_CPP_PACKED_ELEMENTS_H_
+
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace private_set_intersection {
+
+using absl::StatusOr;
+
+// Helpers for the packed element encoding of `psi_proto::Request` and
+// `psi_proto::Response`, where all elements are stored back to back in a single
+// `bytes` field with a fixed width per element.
+
+// Width in bytes of a compressed P-256 point, as produced by the commutative
+// cipher.
+constexpr int32_t kCompressedPointWidth = 33;
+
+// Returns the number of `width`-byte elements stored in `packed`.
+//
+// Returns INVALID_ARGUMENT if `width` is not positive or the length of
+// `packed` is not a multiple of `width`.
+StatusOr<int64_t> NumPackedElements(absl::string_view packed, int32_t width);
+
+// Returns a view of the `index`-th element in `packed`. Does not check bounds.
+inline absl::string_view PackedElement(absl::string_view packed, int32_t width,
+                                       int64_t index) {
+  return packed.substr(static_cast<size_t>(index) * width, width);
+}
+
+// Sorts the `width`-byte elements in `packed` lexicographically, in place.
+void SortPackedElements(int32_t width, std::string* packed);
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_PACKED_ELEMENTS_H_
@@ -1,7 +1,13 @@
+#include <algorithm>
+#include <random>
+
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "benchmark/benchmark.h"
+#include "private_set_intersection/cpp/packed_elements.h"
 #include "private_set_intersection/cpp/psi_client.h"
 #include "private_set_intersection/cpp/psi_server.h"
+#include "private_set_intersection/cpp/shuffle.h"
 
 namespace private_set_intersection {
 namespace {
@@ -81,8 +87,78 @@ BENCHMARK_CAPTURE(BM_ServerSetup, 0.000001 intersection bloom, 0.000001, true,
     ->RangeMultiplier(10)
     ->Range(1, 100000);
 
-void BM_ClientCreateRequest(benchmark::State& state, bool reveal_intersection) {
-  auto client = PsiClient::CreateWithNewKey(reveal_intersection).value();
+void BM_ServerSetupThreads(benchmark::State& state, DataStructure ds) {
+  auto server = PsiServer::CreateWithNewKey(false).value();
+  server->set_num_setup_threads(static_cast<int>(state.range(1)));
+  int num_inputs = state.range(0);
+  int num_client_inputs = 10000;
+  std::vector<std::string> inputs(num_inputs);
+  for (int i = 0; i < num_inputs; i++) {
+    inputs[i] = absl::StrCat("Element", i);
+  }
+  psi_proto::ServerSetup setup;
+  int64_t elements_processed = 0;
+  for (auto _ : state) {
+    setup = server->CreateSetupMessage(0.000001, num_client_inputs, inputs, ds)
+                .value();
+    ::benchmark::DoNotOptimize(setup);
+    elements_processed += num_inputs;
+  }
+  state.counters["ElementsProcessed"] = benchmark::Counter(
+      static_cast<double>(elements_processed), benchmark::Counter::kIsRate);
+}
+// The first range is the number of inputs, and the second one the number of
+// encryption threads, where 0 encrypts and builds on the calling thread.
+BENCHMARK_CAPTURE(BM_ServerSetupThreads, gcs, DataStructure::Gcs)
+    ->ArgsProduct({{100000}, {0, 1, 2, 4}})
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_ServerSetupThreads, bloom, DataStructure::BloomFilter)
+    ->ArgsProduct({{100000}, {0, 1, 2, 4}})
+    ->UseRealTime();
+
+// Creating a keyed server or client per session, as with fresh keys for
+// every client.
+void BM_CreateWithNewKey(benchmark::State& state, bool server,
+                         psi_proto::HashToCurve hash_to_curve,
+                         psi_proto::Curve curve) {
+  for (auto _ : state) {
+    if (server) {
+      auto created =
+          PsiServer::CreateWithNewKey(true, hash_to_curve,
+                                      psi_proto::POINT_ENCODING_COMPRESSED,
+                                      curve)
+              .value();
+      ::benchmark::DoNotOptimize(created);
+    } else {
+      auto created =
+          PsiClient::CreateWithNewKey(true, hash_to_curve,
+                                      psi_proto::POINT_ENCODING_COMPRESSED,
+                                      curve)
+              .value();
+      ::benchmark::DoNotOptimize(created);
+    }
+  }
+}
+BENCHMARK_CAPTURE(BM_CreateWithNewKey, server, true,
+                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                  psi_proto::CURVE_P256);
+BENCHMARK_CAPTURE(BM_CreateWithNewKey, client, false,
+                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                  psi_proto::CURVE_P256);
+BENCHMARK_CAPTURE(BM_CreateWithNewKey, server sswu, true,
+                  psi_proto::HASH_TO_CURVE_P256_SSWU, psi_proto::CURVE_P256);
+BENCHMARK_CAPTURE(BM_CreateWithNewKey, server ristretto255, true,
+                  psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP,
+                  psi_proto::CURVE_RISTRETTO255);
+BENCHMARK_CAPTURE(BM_CreateWithNewKey, server secp256k1, true,
+                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                  psi_proto::CURVE_SECP256K1);
+
+void BM_ClientCreateRequest(benchmark::State& state, bool reveal_intersection,
+                            psi_proto::HashToCurve hash_to_curve =
+                                psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT) {
+  auto client =
+      PsiClient::CreateWithNewKey(reveal_intersection, hash_to_curve).value();
   int num_inputs = state.range(0);
   std::vector<std::string> inputs(num_inputs);
   for (int i = 0; i < num_inputs; i++) {
@@ -108,11 +184,24 @@ BENCHMARK_CAPTURE(BM_ClientCreateRequest, size, false)
 BENCHMARK_CAPTURE(BM_ClientCreateRequest, intersection, true)
     ->RangeMultiplier(10)
     ->Range(1, 10000);
+BENCHMARK_CAPTURE(BM_ClientCreateRequest, intersection sswu, true,
+                  psi_proto::HASH_TO_CURVE_P256_SSWU)
+    ->RangeMultiplier(10)
+    ->Range(1, 10000);
 
-void BM_ServerProcessRequest(benchmark::State& state,
-                             bool reveal_intersection) {
-  auto client = PsiClient::CreateWithNewKey(reveal_intersection).value();
-  auto server = PsiServer::CreateWithNewKey(reveal_intersection).value();
+void BM_ServerProcessRequest(
+    benchmark::State& state, bool reveal_intersection,
+    psi_proto::PointEncoding point_encoding =
+        psi_proto::POINT_ENCODING_COMPRESSED,
+    psi_proto::HashToCurve hash_to_curve =
+        psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+    psi_proto::Curve curve = psi_proto::CURVE_P256) {
+  auto client = PsiClient::CreateWithNewKey(reveal_intersection, hash_to_curve,
+                                            point_encoding, curve)
+                    .value();
+  auto server = PsiServer::CreateWithNewKey(reveal_intersection, hash_to_curve,
+                                            point_encoding, curve)
+                    .value();
   int num_inputs = state.range(0);
   std::vector<std::string> inputs(num_inputs);
   for (int i = 0; i < num_inputs; i++) {
@@ -139,6 +228,77 @@ BENCHMARK_CAPTURE(BM_ServerProcessRequest, size, false)
 BENCHMARK_CAPTURE(BM_ServerProcessRequest, intersection, true)
     ->RangeMultiplier(10)
     ->Range(1, 10000);
+BENCHMARK_CAPTURE(BM_ServerProcessRequest, intersection x-only, true,
+                  psi_proto::POINT_ENCODING_X_ONLY)
+    ->RangeMultiplier(10)
+    ->Range(1, 10000);
+BENCHMARK_CAPTURE(BM_ServerProcessRequest, intersection ristretto255, true,
+                  psi_proto::POINT_ENCODING_COMPRESSED,
+                  psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP,
+                  psi_proto::CURVE_RISTRETTO255)
+    ->RangeMultiplier(10)
+    ->Range(1, 10000);
+
+void BM_ServerUnlinkResponse(benchmark::State& state,
+                             ResponseUnlinking unlinking, bool packed) {
+  // Only the unlinking step is timed, on random stand-ins for ciphertexts of
+  // the width the server produces.
+  int num_inputs = state.range(0);
+  const int32_t width = kCompressedPointWidth;
+  std::mt19937_64 rng(42);
+  std::vector<std::string> response(num_inputs);
+  for (std::string& element : response) {
+    element.resize(width);
+    for (char& c : element) {
+      c = static_cast<char>(rng());
+    }
+  }
+  const std::string packed_elements = absl::StrJoin(response, "");
+  int64_t elements_processed = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<std::string> elements = response;
+    std::string packed_copy = packed_elements;
+    state.ResumeTiming();
+    if (packed) {
+      if (unlinking == ResponseUnlinking::kShuffle) {
+        ShufflePackedElements(width, &packed_copy).IgnoreError();
+      } else {
+        SortPackedElements(width, &packed_copy);
+      }
+      ::benchmark::DoNotOptimize(packed_copy);
+    } else {
+      if (unlinking == ResponseUnlinking::kShuffle) {
+        SecureShuffle(num_inputs, [&elements](int64_t i, int64_t j) {
+          elements[i].swap(elements[j]);
+        }).IgnoreError();
+      } else {
+        std::sort(elements.begin(), elements.end());
+      }
+      ::benchmark::DoNotOptimize(elements);
+    }
+    elements_processed += num_inputs;
+  }
+  state.counters["ElementsProcessed"] = benchmark::Counter(
+      static_cast<double>(elements_processed), benchmark::Counter::kIsRate);
+}
+// Range is for the number of response elements.
+BENCHMARK_CAPTURE(BM_ServerUnlinkResponse, sort, ResponseUnlinking::kSort,
+                  false)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000);
+BENCHMARK_CAPTURE(BM_ServerUnlinkResponse, shuffle,
+                  ResponseUnlinking::kShuffle, false)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000);
+BENCHMARK_CAPTURE(BM_ServerUnlinkResponse, sort packed,
+                  ResponseUnlinking::kSort, true)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000);
+BENCHMARK_CAPTURE(BM_ServerUnlinkResponse, shuffle packed,
+                  ResponseUnlinking::kShuffle, true)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000);
 
 void BM_ClientProcessResponse(benchmark::State& state, bool reveal_intersection,
                               DataStructure ds, double percentClientSize) {
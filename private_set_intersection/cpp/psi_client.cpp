@@ -16,12 +16,14 @@
 
 #include "private_set_intersection/cpp/psi_client.h"
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
-#include "openssl/obj_mac.h"
+#include "private_set_intersection/cpp/packed_elements.h"
 #include "private_set_intersection/cpp/datastructure/bloom_filter.h"
 #include "private_set_intersection/cpp/datastructure/gcs.h"
 #include "private_set_intersection/cpp/datastructure/raw.h"
@@ -32,90 +34,157 @@ namespace private_set_intersection {
 /**
  * @brief Construct a new Psi Client:: Psi Client object
  *
- * @param ec_cipher A unique pointer to a commutative , which is used for
- * encryption and decryption in the Private Set Intersection (PSI) protocol.
+ * @param cipher The commutative cipher with the client's key, which is used
+ * for encryption and decryption in the Private Set Intersection (PSI)
+ * protocol.
  * @param reveal_intersection A boolean value indicating whether the
  * intersection of the two sets should be revealed after the PSI protocol is
  * completed.
+ * @param hash_to_curve The method that maps inputs to the curve
+ * @param point_encoding The encoding of encrypted elements
+ * @param curve The group that `cipher` encrypts in
  */
-PsiClient::PsiClient(
-    std::unique_ptr<::private_join_and_compute::ECCommutativeCipher> ec_cipher,
-    bool reveal_intersection)
-    : ec_cipher_(std::move(ec_cipher)),
-      reveal_intersection(reveal_intersection) {}
+PsiClient::PsiClient(std::unique_ptr<CurveCipher> cipher,
+                     bool reveal_intersection,
+                     psi_proto::HashToCurve hash_to_curve,
+                     psi_proto::PointEncoding point_encoding,
+                     psi_proto::Curve curve)
+    : cipher_(std::move(cipher)),
+      reveal_intersection(reveal_intersection),
+      hash_to_curve_(hash_to_curve),
+      point_encoding_(point_encoding),
+      curve_(curve) {}
 
 /**
- * @brief Creates a new instance of the PsiClient class with a new key pair for
- * encryption and decryption using ECCommutativeCipher.
+ * @brief Creates a new instance of the PsiClient class with a new key for
+ * encryption and decryption in the selected group.
  *
  * @param reveal_intersection A boolean indicating whether the client wants to
  * learn the intersection values or only its size (cardinality).
+ * @param hash_to_curve The method that maps inputs to the curve
+ * @param point_encoding The encoding of encrypted elements
+ * @param curve The group in which elements are encrypted
  * @return StatusOr<std::unique_ptr<PsiClient>>
  */
 StatusOr<std::unique_ptr<PsiClient>> PsiClient::CreateWithNewKey(
-    bool reveal_intersection) {
-  // Create an EC cipher with curve P-256. This gives 128 bits of security.
-  ASSIGN_OR_RETURN(
-      auto ec_cipher,
-      ::private_join_and_compute::ECCommutativeCipher::CreateWithNewKey(
-          NID_X9_62_prime256v1,
-          ::private_join_and_compute::ECCommutativeCipher::HashType::SHA256));
-
-  // Create a new instance of the PsiClient class using the ECCommutativeCipher
-  // object and the reveal_intersection boolean.
-  return absl::WrapUnique(
-      new PsiClient(std::move(ec_cipher), reveal_intersection));
+    bool reveal_intersection, psi_proto::HashToCurve hash_to_curve,
+    psi_proto::PointEncoding point_encoding, psi_proto::Curve curve) {
+  ASSIGN_OR_RETURN(auto cipher, CurveCipher::CreateWithNewKey(
+                                    curve, hash_to_curve, point_encoding));
+  return absl::WrapUnique(new PsiClient(std::move(cipher), reveal_intersection,
+                                        hash_to_curve, point_encoding, curve));
 }
 
 /**
- * @brief Creates a new PsiClient instance using an EC cipher created from the
+ * @brief Creates a new PsiClient instance using a cipher created from the
  * provided key.
  *
- * @param key_bytes The bytes representing the key for the EC cipher.
+ * @param key_bytes The bytes representing the key for the cipher.
  * @param reveal_intersection A boolean flag indicating whether the intersection
  * should be revealed.
+ * @param hash_to_curve The method that maps inputs to the curve
+ * @param point_encoding The encoding of encrypted elements
+ * @param curve The group in which elements are encrypted
  * @return StatusOr<std::unique_ptr<PsiClient>>
  */
 StatusOr<std::unique_ptr<PsiClient>> PsiClient::CreateFromKey(
-    const std::string& key_bytes, bool reveal_intersection) {
-  // Create an EC cipher with curve P-256. This gives 128 bits of security.
-  ASSIGN_OR_RETURN(
-      auto ec_cipher,
-      ::private_join_and_compute::ECCommutativeCipher::CreateFromKey(
-          NID_X9_62_prime256v1, key_bytes,
-          ::private_join_and_compute::ECCommutativeCipher::HashType::SHA256));
-  return absl::WrapUnique(
-      new PsiClient(std::move(ec_cipher), reveal_intersection));
+    const std::string& key_bytes, bool reveal_intersection,
+    psi_proto::HashToCurve hash_to_curve,
+    psi_proto::PointEncoding point_encoding, psi_proto::Curve curve) {
+  ASSIGN_OR_RETURN(auto cipher,
+                   CurveCipher::CreateFromKey(curve, key_bytes, hash_to_curve,
+                                              point_encoding));
+  return absl::WrapUnique(new PsiClient(std::move(cipher), reveal_intersection,
+                                        hash_to_curve, point_encoding, curve));
 }
 
 /**
  * @brief Creates a request protobuf with encrypted inputs and a reveal flag.
  *
  * @param inputs The inputs to encrypt and add to the request protobuf.
+ * @param packed Whether to use the packed encoding for the encrypted inputs.
  *
  * @return StatusOr<psi_proto::Request>
  */
 StatusOr<psi_proto::Request> PsiClient::CreateRequest(
-    absl::Span<const std::string> inputs) const {
-  // Encrypt inputs one by one.
-  int64_t input_size = static_cast<int64_t>(inputs.size());
-  std::vector<std::string> encrypted_inputs(input_size);
-  for (int64_t i = 0; i < input_size; i++) {
-    ASSIGN_OR_RETURN(encrypted_inputs[i], ec_cipher_->Encrypt(inputs[i]));
+    absl::Span<const std::string> inputs, bool packed) const {
+  psi_proto::Request request;
+  RETURN_IF_ERROR(FillRequest(inputs, packed, &request));
+  return request;
+}
+
+/**
+ * @brief Creates a request protobuf on the given arena.
+ *
+ * @param arena The arena that owns the returned message.
+ * @param inputs The inputs to encrypt and add to the request protobuf.
+ * @param packed Whether to use the packed encoding for the encrypted inputs.
+ *
+ * @return StatusOr<psi_proto::Request*>
+ */
+StatusOr<psi_proto::Request*> PsiClient::CreateRequest(
+    google::protobuf::Arena* arena, absl::Span<const std::string> inputs,
+    bool packed) const {
+  if (arena == nullptr) {
+    return absl::InvalidArgumentError("`arena` must not be null");
   }
+  auto* request = google::protobuf::Arena::Create<psi_proto::Request>(arena);
+  RETURN_IF_ERROR(FillRequest(inputs, packed, request));
+  return request;
+}
 
-  // Create a request protobuf
-  psi_proto::Request request;
+/**
+ * @brief Encrypts the inputs and writes them to `request`.
+ *
+ * @param inputs The inputs to encrypt and add to the request protobuf.
+ * @param packed Whether to use the packed encoding for the encrypted inputs.
+ * @param request The message to write the encrypted inputs to.
+ *
+ * @return absl::Status
+ */
+absl::Status PsiClient::FillRequest(absl::Span<const std::string> inputs,
+                                    bool packed,
+                                    psi_proto::Request* request) const {
+  // Set the reveal flag, the hash-to-curve method, the point encoding and the
+  // curve.
+  request->set_reveal_intersection(reveal_intersection);
+  request->set_hash_to_curve(hash_to_curve_);
+  request->set_point_encoding(point_encoding_);
+  request->set_curve(curve_);
 
-  // Set the reveal flag
-  request.set_reveal_intersection(reveal_intersection);
+  if (packed) {
+    return FillPackedRequest(inputs, request);
+  }
 
-  // Add the encrypted elements
+  // Encrypt the inputs as one batch and add them to the request.
+  int64_t input_size = static_cast<int64_t>(inputs.size());
+  std::string encrypted;
+  RETURN_IF_ERROR(cipher_->Encrypt(inputs, &encrypted));
+  const size_t width = cipher_->element_size();
+  request->mutable_encrypted_elements()->Reserve(static_cast<int>(input_size));
   for (int64_t i = 0; i < input_size; i++) {
-    request.add_encrypted_elements(encrypted_inputs[i]);
+    request->add_encrypted_elements(encrypted.substr(i * width, width));
   }
 
-  return request;
+  return absl::OkStatus();
+}
+
+/**
+ * @brief Encrypts the inputs and writes them to `request` in the packed
+ * encoding.
+ *
+ * @param inputs The inputs to encrypt and add to the request protobuf.
+ * @param request The message to write the encrypted inputs to.
+ *
+ * @return absl::Status
+ */
+absl::Status PsiClient::FillPackedRequest(absl::Span<const std::string> inputs,
+                                          psi_proto::Request* request) const {
+  // Encrypted elements all have the same width in either point encoding. An
+  // empty request still needs the width to signal the packed encoding.
+  RETURN_IF_ERROR(cipher_->Encrypt(inputs, request->mutable_packed_elements()));
+  request->set_element_width(static_cast<int32_t>(cipher_->element_size()));
+  return absl::OkStatus();
 }
 
 /**
@@ -129,6 +198,60 @@ StatusOr<psi_proto::Request> PsiClient::CreateRequest(
 StatusOr<std::vector<int64_t>> PsiClient::GetIntersection(
     const psi_proto::ServerSetup& server_setup,
     const psi_proto::Response& server_response) const {
+  ASSIGN_OR_RETURN(auto setup_view,
+                   ServerSetupView::FromProtobuf(server_setup));
+  return GetIntersection(setup_view, server_response);
+}
+
+/**
+ * @brief Compute the intersection from a serialized server setup
+ *
+ * @param serialized_server_setup The original server's serialized setup
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<std::vector<int64_t>>
+ */
+StatusOr<std::vector<int64_t>> PsiClient::GetIntersection(
+    absl::string_view serialized_server_setup,
+    const psi_proto::Response& server_response) const {
+  ASSIGN_OR_RETURN(auto setup_view,
+                   ServerSetupView::FromSerialized(serialized_server_setup));
+  return GetIntersection(setup_view, server_response);
+}
+
+/**
+ * @brief Compute the intersection against a prepared server setup
+ *
+ * @param server_setup The original server's prepared setup
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<std::vector<int64_t>>
+ */
+StatusOr<std::vector<int64_t>> PsiClient::GetIntersection(
+    const PreparedServerSetup& server_setup,
+    const psi_proto::Response& server_response) const {
+  if (!reveal_intersection) {
+    return absl::InvalidArgumentError(
+        "GetIntersection called on PsiClient with reveal_intersection == "
+        "false");
+  }
+  ASSIGN_OR_RETURN(std::vector<int64_t> intersection,
+                   ProcessResponse(server_setup, server_response));
+  intersection.shrink_to_fit();
+  return intersection;
+}
+
+/**
+ * @brief Compute the intersection against a setup file
+ *
+ * @param server_setup The original server's setup file
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<std::vector<int64_t>>
+ */
+StatusOr<std::vector<int64_t>> PsiClient::GetIntersection(
+    const SetupFile& server_setup,
+    const psi_proto::Response& server_response) const {
   if (!reveal_intersection) {
     return absl::InvalidArgumentError(
         "GetIntersection called on PsiClient with reveal_intersection == "
@@ -140,6 +263,80 @@ StatusOr<std::vector<int64_t>> PsiClient::GetIntersection(
   return intersection;
 }
 
+/**
+ * @brief Compute the intersection
+ *
+ * @param server_setup A view of the original server's setup
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<std::vector<int64_t>>
+ */
+StatusOr<std::vector<int64_t>> PsiClient::GetIntersection(
+    const ServerSetupView& server_setup,
+    const psi_proto::Response& server_response) const {
+  if (!reveal_intersection) {
+    return absl::InvalidArgumentError(
+        "GetIntersection called on PsiClient with reveal_intersection == "
+        "false");
+  }
+  ASSIGN_OR_RETURN(std::vector<int64_t> intersection,
+                   ProcessResponse(server_setup, server_response));
+  intersection.shrink_to_fit();
+  return intersection;
+}
+
+/**
+ * @brief Compute the intersection in a compact encoding
+ *
+ * @param server_setup A view of the original server's setup
+ * @param server_response The previous server's response
+ * @param encoding The encoding of the result, or nullopt for the smaller one
+ *
+ * @return StatusOr<IntersectionResult>
+ */
+StatusOr<IntersectionResult> PsiClient::GetCompactIntersection(
+    const ServerSetupView& server_setup,
+    const psi_proto::Response& server_response,
+    absl::optional<IntersectionResult::Encoding> encoding) const {
+  if (!reveal_intersection) {
+    return absl::InvalidArgumentError(
+        "GetCompactIntersection called on PsiClient with reveal_intersection "
+        "== false");
+  }
+  int64_t num_client_inputs = server_response.encrypted_elements_size();
+  if (server_response.element_width() != 0) {
+    ASSIGN_OR_RETURN(num_client_inputs,
+                     NumPackedElements(server_response.packed_elements(),
+                                       server_response.element_width()));
+  }
+  // The indices are marked in a bitmap as they are found, so that they are
+  // never held as a vector.
+  IntersectionResult::Builder builder(num_client_inputs);
+  RETURN_IF_ERROR(ForEachIntersectingIndex(
+      server_setup, server_response,
+      [&builder](int64_t index) { builder.Add(index); }));
+  return std::move(builder).Finish(encoding);
+}
+
+/**
+ * @brief Compute the intersection in a compact encoding from a serialized
+ * server setup
+ *
+ * @param serialized_server_setup The original server's serialized setup
+ * @param server_response The previous server's response
+ * @param encoding The encoding of the result, or nullopt for the smaller one
+ *
+ * @return StatusOr<IntersectionResult>
+ */
+StatusOr<IntersectionResult> PsiClient::GetCompactIntersection(
+    absl::string_view serialized_server_setup,
+    const psi_proto::Response& server_response,
+    absl::optional<IntersectionResult::Encoding> encoding) const {
+  ASSIGN_OR_RETURN(auto setup_view,
+                   ServerSetupView::FromSerialized(serialized_server_setup));
+  return GetCompactIntersection(setup_view, server_response, encoding);
+}
+
 /**
  * @brief Compute the intersection (cardinality)
  *
@@ -151,59 +348,283 @@ StatusOr<std::vector<int64_t>> PsiClient::GetIntersection(
 StatusOr<int64_t> PsiClient::GetIntersectionSize(
     const psi_proto::ServerSetup& server_setup,
     const psi_proto::Response& server_response) const {
-  ASSIGN_OR_RETURN(std::vector<int64_t> intersection,
-                   ProcessResponse(server_setup, server_response));
-  return static_cast<int64_t>(intersection.size());
+  ASSIGN_OR_RETURN(auto setup_view,
+                   ServerSetupView::FromProtobuf(server_setup));
+  return GetIntersectionSize(setup_view, server_response);
+}
+
+/**
+ * @brief Compute the intersection (cardinality) from a serialized server setup
+ *
+ * @param serialized_server_setup The original server's serialized setup
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<int64_t>
+ */
+StatusOr<int64_t> PsiClient::GetIntersectionSize(
+    absl::string_view serialized_server_setup,
+    const psi_proto::Response& server_response) const {
+  ASSIGN_OR_RETURN(auto setup_view,
+                   ServerSetupView::FromSerialized(serialized_server_setup));
+  return GetIntersectionSize(setup_view, server_response);
+}
+
+/**
+ * @brief Compute the intersection (cardinality) against a prepared server
+ * setup
+ *
+ * @param server_setup The original server's prepared setup
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<int64_t>
+ */
+StatusOr<int64_t> PsiClient::GetIntersectionSize(
+    const PreparedServerSetup& server_setup,
+    const psi_proto::Response& server_response) const {
+  return CountResponse(server_setup, server_response);
+}
+
+/**
+ * @brief Compute the intersection (cardinality) against a setup file
+ *
+ * @param server_setup The original server's setup file
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<int64_t>
+ */
+StatusOr<int64_t> PsiClient::GetIntersectionSize(
+    const SetupFile& server_setup,
+    const psi_proto::Response& server_response) const {
+  return CountResponse(server_setup, server_response);
+}
+
+/**
+ * @brief Compute the intersection (cardinality)
+ *
+ * @param server_setup A view of the original server's setup
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<int64_t>
+ */
+StatusOr<int64_t> PsiClient::GetIntersectionSize(
+    const ServerSetupView& server_setup,
+    const psi_proto::Response& server_response) const {
+  return CountResponse(server_setup, server_response);
+}
+
+/**
+ * @brief Start intersecting the server's response with a GCS setup that is
+ * still being received
+ *
+ * @param setup_parameters The parameters of the original server's GCS setup
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<std::unique_ptr<GCSStreamingIntersector>>
+ */
+StatusOr<std::unique_ptr<GCSStreamingIntersector>>
+PsiClient::CreateStreamingIntersector(
+    const psi_proto::ServerSetup& setup_parameters,
+    const psi_proto::Response& server_response) const {
+  if (!setup_parameters.has_gcs()) {
+    return absl::InvalidArgumentError("`ServerSetup` does not hold a GCS");
+  }
+  RETURN_IF_ERROR(CheckCurve(setup_parameters.curve()));
+  RETURN_IF_ERROR(CheckHashToCurve(setup_parameters.hash_to_curve()));
+  RETURN_IF_ERROR(CheckPointEncoding(setup_parameters.point_encoding()));
+  ASSIGN_OR_RETURN(std::vector<std::string> decrypted,
+                   DecryptResponse(server_response));
+  return GCSStreamingIntersector::Create(setup_parameters.gcs().div(),
+                                         setup_parameters.gcs().hash_range(),
+                                         absl::MakeConstSpan(decrypted));
 }
 
 /**
  * @brief Process the server's response to obtain the intersection
  *
- * @param server_setup The original server's setup
+ * @param server_setup A view of the original server's setup
  * @param server_response The previous server's response
  *
  * @return StatusOr<std::vector<int64_t>>
  */
 StatusOr<std::vector<int64_t>> PsiClient::ProcessResponse(
-    const psi_proto::ServerSetup& server_setup,
+    const ServerSetupView& server_setup,
     const psi_proto::Response& server_response) const {
-  // Ensure both items are valid
-  if (!server_setup.IsInitialized()) {
-    return absl::InvalidArgumentError("`server_setup` is corrupt!");
-  }
+  std::vector<int64_t> intersection;
+  RETURN_IF_ERROR(ForEachIntersectingIndex(
+      server_setup, server_response,
+      [&intersection](int64_t index) { intersection.push_back(index); }));
+  return intersection;
+}
 
-  if (!server_response.IsInitialized()) {
-    return absl::InvalidArgumentError("`server_response` is corrupt!");
+/**
+ * @brief Visit the indices of the server's response that are in the setup
+ *
+ * @param server_setup A view of the original server's setup
+ * @param server_response The previous server's response
+ * @param visit Called with each index in the intersection
+ *
+ * @return absl::Status
+ */
+absl::Status PsiClient::ForEachIntersectingIndex(
+    const ServerSetupView& server_setup,
+    const psi_proto::Response& server_response,
+    absl::FunctionRef<void(int64_t)> visit) const {
+  RETURN_IF_ERROR(CheckCurve(server_setup.curve));
+  RETURN_IF_ERROR(CheckHashToCurve(server_setup.hash_to_curve));
+  RETURN_IF_ERROR(CheckPointEncoding(server_setup.point_encoding));
+  // Each batch of decrypted elements is looked up as soon as it is decrypted
+  // and then discarded, so the decrypted response is never held in memory as
+  // a whole. The containers reference the setup's buffers instead of copying
+  // them.
+  switch (server_setup.data_structure_case) {
+    case psi_proto::ServerSetup::DataStructureCase::kRaw: {
+      ASSIGN_OR_RETURN(auto container, Raw::CreateFromView(server_setup));
+      return DecryptResponseInBatches(
+          server_response,
+          [&](absl::Span<const std::string> batch, int64_t offset) {
+            for (size_t i = 0; i < batch.size(); i++) {
+              if (container->Contains(batch[i])) {
+                visit(offset + i);
+              }
+            }
+          });
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kGcs: {
+      // Only the hashes are kept across batches, so that the compressed set
+      // is still decoded in a single pass.
+      ASSIGN_OR_RETURN(auto container, GCS::CreateFromView(server_setup));
+      std::vector<std::pair<int64_t, int64_t>> hashes;
+      RETURN_IF_ERROR(DecryptResponseInBatches(
+          server_response,
+          [&](absl::Span<const std::string> batch, int64_t offset) {
+            std::vector<int64_t> batch_hashes(batch.size());
+            container->HashElements(batch, batch_hashes.data());
+            for (size_t i = 0; i < batch.size(); i++) {
+              hashes.emplace_back(batch_hashes[i], offset + i);
+            }
+          }));
+      container->ForEachIntersectingHash(std::move(hashes), visit);
+      return absl::OkStatus();
+    }
+    case psi_proto::ServerSetup::DataStructureCase::kBloomFilter: {
+      ASSIGN_OR_RETURN(auto container,
+                       BloomFilter::CreateFromView(server_setup));
+      return DecryptResponseInBatches(
+          server_response,
+          [&](absl::Span<const std::string> batch, int64_t offset) {
+            for (int64_t index : container->Intersect(batch)) {
+              visit(offset + index);
+            }
+          });
+    }
+    default: {
+      return absl::InvalidArgumentError("Impossible");
+    }
   }
+}
 
-  const auto& response_array = server_response.encrypted_elements();
-  const std::int64_t response_size =
-      static_cast<std::int64_t>(response_array.size());
-  std::vector<std::string> decrypted;
-  decrypted.reserve(response_size);
+/**
+ * @brief Process the server's response against a prepared setup
+ *
+ * @param server_setup The original server's prepared setup
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<std::vector<int64_t>>
+ */
+StatusOr<std::vector<int64_t>> PsiClient::ProcessResponse(
+    const PreparedServerSetup& server_setup,
+    const psi_proto::Response& server_response) const {
+  RETURN_IF_ERROR(CheckCurve(server_setup.curve()));
+  RETURN_IF_ERROR(CheckHashToCurve(server_setup.hash_to_curve()));
+  RETURN_IF_ERROR(CheckPointEncoding(server_setup.point_encoding()));
+  std::vector<int64_t> intersection;
+  RETURN_IF_ERROR(DecryptResponseInBatches(
+      server_response,
+      [&](absl::Span<const std::string> batch, int64_t offset) {
+        for (int64_t index : server_setup.Intersect(batch)) {
+          intersection.push_back(offset + index);
+        }
+      }));
+  return intersection;
+}
 
-  for (int64_t i = 0; i < response_size; i++) {
-    ASSIGN_OR_RETURN(std::string element,
-                     ec_cipher_->Decrypt(response_array[i]));
-    decrypted.push_back(element);
+/**
+ * @brief Process the server's response against a setup file
+ *
+ * @param server_setup The original server's setup file
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<std::vector<int64_t>>
+ */
+StatusOr<std::vector<int64_t>> PsiClient::ProcessResponse(
+    const SetupFile& server_setup,
+    const psi_proto::Response& server_response) const {
+  RETURN_IF_ERROR(CheckCurve(server_setup.curve()));
+  RETURN_IF_ERROR(CheckHashToCurve(server_setup.hash_to_curve()));
+  RETURN_IF_ERROR(CheckPointEncoding(server_setup.point_encoding()));
+  // Without an index, every lookup into a GCS decodes the whole set. Collect
+  // the hashes of all batches first instead.
+  if (server_setup.data_structure_case() ==
+          psi_proto::ServerSetup::DataStructureCase::kGcs &&
+      !server_setup.has_index()) {
+    return ProcessResponse(server_setup.ToView(), server_response);
   }
+  std::vector<int64_t> intersection;
+  RETURN_IF_ERROR(DecryptResponseInBatches(
+      server_response,
+      [&](absl::Span<const std::string> batch, int64_t offset) {
+        for (int64_t index : server_setup.Intersect(batch)) {
+          intersection.push_back(offset + index);
+        }
+      }));
+  return intersection;
+}
 
-  switch (server_setup.data_structure_case()) {
+/**
+ * @brief Count the elements of the server's response that are in the setup
+ *
+ * @param server_setup A view of the original server's setup
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<int64_t>
+ */
+StatusOr<int64_t> PsiClient::CountResponse(
+    const ServerSetupView& server_setup,
+    const psi_proto::Response& server_response) const {
+  RETURN_IF_ERROR(CheckCurve(server_setup.curve));
+  RETURN_IF_ERROR(CheckHashToCurve(server_setup.hash_to_curve));
+  RETURN_IF_ERROR(CheckPointEncoding(server_setup.point_encoding));
+  // As `ProcessResponse`, but only counts the matches of each batch.
+  int64_t count = 0;
+  switch (server_setup.data_structure_case) {
     case psi_proto::ServerSetup::DataStructureCase::kRaw: {
-      // Decode Bloom Filter from the server setup.
-      ASSIGN_OR_RETURN(auto container, Raw::CreateFromProtobuf(server_setup));
-      return container->Intersect(absl::MakeConstSpan(decrypted));
+      ASSIGN_OR_RETURN(auto container, Raw::CreateFromView(server_setup));
+      RETURN_IF_ERROR(DecryptResponseInBatches(
+          server_response, [&](absl::Span<const std::string> batch, int64_t) {
+            count += container->IntersectionSize(batch);
+          }));
+      return count;
     }
     case psi_proto::ServerSetup::DataStructureCase::kGcs: {
-      // Decode GCS from the server setup.
-      ASSIGN_OR_RETURN(auto container, GCS::CreateFromProtobuf(server_setup));
-      return container->Intersect(absl::MakeConstSpan(decrypted));
+      // Bare hashes suffice, since their order does not matter.
+      ASSIGN_OR_RETURN(auto container, GCS::CreateFromView(server_setup));
+      std::vector<int64_t> hashes;
+      RETURN_IF_ERROR(DecryptResponseInBatches(
+          server_response, [&](absl::Span<const std::string> batch, int64_t) {
+            const size_t offset = hashes.size();
+            hashes.resize(offset + batch.size());
+            container->HashElements(batch, &hashes[offset]);
+          }));
+      return container->IntersectionSizeOfHashes(std::move(hashes));
     }
     case psi_proto::ServerSetup::DataStructureCase::kBloomFilter: {
-      // Decode Bloom Filter from the server setup.
       ASSIGN_OR_RETURN(auto container,
-                       BloomFilter::CreateFromProtobuf(server_setup));
-      return container->Intersect(absl::MakeConstSpan(decrypted));
+                       BloomFilter::CreateFromView(server_setup));
+      RETURN_IF_ERROR(DecryptResponseInBatches(
+          server_response, [&](absl::Span<const std::string> batch, int64_t) {
+            count += container->IntersectionSize(batch);
+          }));
+      return count;
     }
     default: {
       return absl::InvalidArgumentError("Impossible");
@@ -211,15 +632,264 @@ StatusOr<std::vector<int64_t>> PsiClient::ProcessResponse(
   }
 }
 
+/**
+ * @brief Count the elements of the server's response that are in a prepared
+ * setup
+ *
+ * @param server_setup The original server's prepared setup
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<int64_t>
+ */
+StatusOr<int64_t> PsiClient::CountResponse(
+    const PreparedServerSetup& server_setup,
+    const psi_proto::Response& server_response) const {
+  RETURN_IF_ERROR(CheckCurve(server_setup.curve()));
+  RETURN_IF_ERROR(CheckHashToCurve(server_setup.hash_to_curve()));
+  RETURN_IF_ERROR(CheckPointEncoding(server_setup.point_encoding()));
+  int64_t count = 0;
+  RETURN_IF_ERROR(DecryptResponseInBatches(
+      server_response, [&](absl::Span<const std::string> batch, int64_t) {
+        count += server_setup.IntersectionSize(batch);
+      }));
+  return count;
+}
+
+/**
+ * @brief Count the elements of the server's response that are in a setup file
+ *
+ * @param server_setup The original server's setup file
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<int64_t>
+ */
+StatusOr<int64_t> PsiClient::CountResponse(
+    const SetupFile& server_setup,
+    const psi_proto::Response& server_response) const {
+  RETURN_IF_ERROR(CheckCurve(server_setup.curve()));
+  RETURN_IF_ERROR(CheckHashToCurve(server_setup.hash_to_curve()));
+  RETURN_IF_ERROR(CheckPointEncoding(server_setup.point_encoding()));
+  // Raw setups and GCS indexes are searched per batch, see `ProcessResponse`.
+  if (server_setup.data_structure_case() !=
+          psi_proto::ServerSetup::DataStructureCase::kRaw &&
+      !server_setup.has_index()) {
+    return CountResponse(server_setup.ToView(), server_response);
+  }
+  int64_t count = 0;
+  RETURN_IF_ERROR(DecryptResponseInBatches(
+      server_response, [&](absl::Span<const std::string> batch, int64_t) {
+        count += server_setup.IntersectionSize(batch);
+      }));
+  return count;
+}
+
+/**
+ * @brief Check that the server encrypted its elements in the client's group
+ *
+ * @param server_curve The curve recorded in the server's setup
+ *
+ * @return absl::Status
+ */
+absl::Status PsiClient::CheckCurve(psi_proto::Curve server_curve) const {
+  if (server_curve != curve_) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Server uses curve ", server_curve,
+                     ", but the client uses ", curve_));
+  }
+  return absl::OkStatus();
+}
+
+/**
+ * @brief Check that the server mapped its elements to the curve like the client
+ *
+ * @param server_hash_to_curve The method recorded in the server's setup
+ *
+ * @return absl::Status
+ */
+absl::Status PsiClient::CheckHashToCurve(
+    psi_proto::HashToCurve server_hash_to_curve) const {
+  if (server_hash_to_curve != hash_to_curve_) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Server uses hash-to-curve method ", server_hash_to_curve,
+        ", but the client uses ", hash_to_curve_));
+  }
+  return absl::OkStatus();
+}
+
+/**
+ * @brief Check that the server encoded its elements like the client
+ *
+ * @param server_point_encoding The encoding recorded in the server's setup
+ *
+ * @return absl::Status
+ */
+absl::Status PsiClient::CheckPointEncoding(
+    psi_proto::PointEncoding server_point_encoding) const {
+  if (server_point_encoding != point_encoding_) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Server uses point encoding ", server_point_encoding,
+        ", but the client uses ", point_encoding_));
+  }
+  return absl::OkStatus();
+}
+
+/**
+ * @brief Decrypt the elements of the server's response
+ *
+ * @param server_response The previous server's response
+ *
+ * @return StatusOr<std::vector<std::string>>
+ */
+StatusOr<std::vector<std::string>> PsiClient::DecryptResponse(
+    const psi_proto::Response& server_response) const {
+  std::vector<std::string> decrypted;
+  RETURN_IF_ERROR(DecryptResponseInBatches(
+      server_response, [&](absl::Span<const std::string> batch, int64_t) {
+        decrypted.insert(decrypted.end(), batch.begin(), batch.end());
+      }));
+  return decrypted;
+}
+
+/**
+ * @brief Decrypt the elements of the server's response batch by batch
+ *
+ * @param server_response The previous server's response
+ * @param visit Called with each batch of decrypted elements and the index of
+ * its first element
+ *
+ * @return absl::Status
+ */
+absl::Status PsiClient::DecryptResponseInBatches(
+    const psi_proto::Response& server_response,
+    absl::FunctionRef<void(absl::Span<const std::string> batch,
+                           int64_t offset)>
+        visit) const {
+  if (!server_response.IsInitialized()) {
+    return absl::InvalidArgumentError("`server_response` is corrupt!");
+  }
+
+  const bool packed = server_response.element_width() != 0;
+  const std::string& packed_elements = server_response.packed_elements();
+  const int32_t width = server_response.element_width();
+  int64_t response_size;
+  if (packed) {
+    if (!server_response.encrypted_elements().empty()) {
+      return absl::InvalidArgumentError(
+          "`server_response` mixes packed and repeated elements");
+    }
+    ASSIGN_OR_RETURN(response_size,
+                     NumPackedElements(packed_elements, width));
+  } else {
+    response_size = server_response.encrypted_elements_size();
+  }
+
+  // The batch and the buffers of the batch cipher are reused, so their
+  // capacity is only allocated once.
+  const auto max_batch_size =
+      static_cast<size_t>(std::min(response_size, kDecryptBatchSize));
+  std::vector<std::string> batch(max_batch_size);
+  std::vector<absl::string_view> views(max_batch_size);
+  std::string decrypted;
+  for (int64_t offset = 0; offset < response_size;
+       offset += kDecryptBatchSize) {
+    const int64_t batch_size =
+        std::min(kDecryptBatchSize, response_size - offset);
+    for (int64_t i = 0; i < batch_size; i++) {
+      views[i] =
+          packed ? PackedElement(packed_elements, width, offset + i)
+                 : absl::string_view(server_response.encrypted_elements(
+                       static_cast<int>(offset + i)));
+    }
+    decrypted.clear();
+    RETURN_IF_ERROR(cipher_->Decrypt(
+        absl::MakeConstSpan(views).subspan(0, batch_size), &decrypted));
+    const size_t element_size = cipher_->element_size();
+    for (int64_t i = 0; i < batch_size; i++) {
+      batch[i].assign(decrypted, i * element_size, element_size);
+    }
+    visit(absl::MakeConstSpan(batch).subspan(0, batch_size), offset);
+  }
+  return absl::OkStatus();
+}
+
 /**
  * @brief Get the client's private key
  *
  * @return The private key as a null-terminated binary string
  */
 std::string PsiClient::GetPrivateKeyBytes() const {
-  std::string key = ec_cipher_->GetPrivateKeyBytes();
-  key.insert(key.begin(), 32 - key.length(), '\0');
-  return key;
+  return cipher_->GetPrivateKeyBytes();
+}
+
+/**
+ * @brief Start reading a response that is streamed in chunks
+ *
+ * @param server_setup The prepared server's setup
+ *
+ * @return std::unique_ptr<ResponseReader>
+ */
+std::unique_ptr<ResponseReader> PsiClient::CreateResponseReader(
+    const PreparedServerSetup& server_setup) const {
+  return absl::WrapUnique(new ResponseReader(this, &server_setup));
+}
+
+ResponseReader::ResponseReader(const PsiClient* client,
+                               const PreparedServerSetup* server_setup)
+    : client_(client), server_setup_(server_setup) {}
+
+/**
+ * @brief Decrypt the next response chunk and intersect it with the setup
+ *
+ * @param response_chunk The next chunk of the server's response
+ *
+ * @return absl::Status
+ */
+absl::Status ResponseReader::AddChunk(
+    const psi_proto::Response& response_chunk) {
+  RETURN_IF_ERROR(client_->CheckCurve(server_setup_->curve()));
+  RETURN_IF_ERROR(client_->CheckHashToCurve(server_setup_->hash_to_curve()));
+  RETURN_IF_ERROR(
+      client_->CheckPointEncoding(server_setup_->point_encoding()));
+  int64_t chunk_size = 0;
+  // Indices are relative to the batch; shift them past the earlier batches and
+  // chunks. They are only kept once the whole chunk has been decrypted, so
+  // that a failed chunk leaves the reader as it was.
+  std::vector<int64_t> chunk_intersection;
+  RETURN_IF_ERROR(client_->DecryptResponseInBatches(
+      response_chunk,
+      [&](absl::Span<const std::string> batch, int64_t offset) {
+        for (int64_t index : server_setup_->Intersect(batch)) {
+          chunk_intersection.push_back(num_elements_ + offset + index);
+        }
+        chunk_size = offset + static_cast<int64_t>(batch.size());
+      }));
+  intersection_.insert(intersection_.end(), chunk_intersection.begin(),
+                       chunk_intersection.end());
+  num_elements_ += chunk_size;
+  return absl::OkStatus();
+}
+
+/**
+ * @brief Get the intersection of the chunks added so far
+ *
+ * @return StatusOr<std::vector<int64_t>>
+ */
+StatusOr<std::vector<int64_t>> ResponseReader::GetIntersection() const {
+  if (!client_->reveal_intersection) {
+    return absl::InvalidArgumentError(
+        "GetIntersection called on PsiClient with reveal_intersection == "
+        "false");
+  }
+  return intersection_;
+}
+
+/**
+ * @brief Get the intersection size of the chunks added so far
+ *
+ * @return int64_t
+ */
+int64_t ResponseReader::GetIntersectionSize() const {
+  return static_cast<int64_t>(intersection_.size());
 }
 
 }  // namespace private_set_intersection
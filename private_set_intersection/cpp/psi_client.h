@@ -17,15 +17,26 @@
 #ifndef PRIVATE_SET_INTERSECTION_CPP_PSI_CLIENT_H_
 #define PRIVATE_SET_INTERSECTION_CPP_PSI_CLIENT_H_
 
+#include "absl/functional/function_ref.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
-#include "private_join_and_compute/crypto/ec_commutative_cipher.h"
+#include "google/protobuf/arena.h"
+#include "private_set_intersection/cpp/crypto/curve_cipher.h"
+#include "private_set_intersection/cpp/datastructure/gcs.h"
+#include "private_set_intersection/cpp/datastructure/prepared_server_setup.h"
+#include "private_set_intersection/cpp/datastructure/server_setup_view.h"
+#include "private_set_intersection/cpp/datastructure/setup_file.h"
+#include "private_set_intersection/cpp/intersection_result.h"
 #include "private_set_intersection/proto/psi.pb.h"
 
 namespace private_set_intersection {
 
 using absl::StatusOr;
 
+class ResponseReader;
+
 // Client side of a Private Set Intersection protocol. In PSI, two parties
 // (client and server) each hold a dataset, and at the end of the protocol the
 // client learns the size of the intersection of both datasets, while no party
@@ -96,11 +107,22 @@ class PsiClient {
   // Creates and returns a new client instance with a fresh private key. If
   // `reveal_intersection` is true, the client learns the elements in the
   // intersection of the two datasets. Otherwise, only the intersection size is
-  // learned.
+  // learned. `hash_to_curve` selects how inputs are mapped to the curve,
+  // `point_encoding` how encrypted elements are encoded, and `curve` the group
+  // they are encrypted in. All three must match the server's, which are
+  // recorded in its setup; setups created with a different method, encoding
+  // or curve are rejected with INVALID_ARGUMENT.
   //
-  // Returns INTERNAL if any OpenSSL crypto operations fail.
+  // Returns INVALID_ARGUMENT if `hash_to_curve`, `point_encoding` or `curve`
+  // is unknown or they cannot be combined, or INTERNAL if any OpenSSL crypto
+  // operations fail.
   static StatusOr<std::unique_ptr<PsiClient>> CreateWithNewKey(
-      bool reveal_intersection);
+      bool reveal_intersection,
+      psi_proto::HashToCurve hash_to_curve =
+          psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+      psi_proto::PointEncoding point_encoding =
+          psi_proto::POINT_ENCODING_COMPRESSED,
+      psi_proto::Curve curve = psi_proto::CURVE_P256);
 
   // Creates and returns a new client instance with the provided private key. If
   // `reveal_intersection` is true, the client learns the elements in the
@@ -112,17 +134,40 @@ class PsiClient {
   // requests can reveal information about the input sets. If in doubt, use
   // `CreateWithNewKey`.
   //
-  // Returns INTERNAL if any OpenSSL crypto operations fail.
+  // Returns INVALID_ARGUMENT if `hash_to_curve`, `point_encoding` or `curve`
+  // is unknown or they cannot be combined, or INTERNAL if any OpenSSL crypto
+  // operations fail.
   static StatusOr<std::unique_ptr<PsiClient>> CreateFromKey(
-      const std::string& key_bytes, bool reveal_intersection);
+      const std::string& key_bytes, bool reveal_intersection,
+      psi_proto::HashToCurve hash_to_curve =
+          psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+      psi_proto::PointEncoding point_encoding =
+          psi_proto::POINT_ENCODING_COMPRESSED,
+      psi_proto::Curve curve = psi_proto::CURVE_P256);
 
   // Creates a request protobuf to be serialized and sent to the server. For
   // each input element x, computes H(x)^c, where c is the secret key of
-  // ec_cipher_.
+  // cipher_.
+  //
+  // If `packed` is true, the encrypted elements are concatenated into the
+  // `packed_elements` field instead of being sent as separate strings, which
+  // saves the per-element framing and allocations when (de)serializing. The
+  // server will answer with a packed response. Only enable this if the server
+  // supports the packed encoding.
   //
   // Returns INTERNAL if encryption fails.
   StatusOr<psi_proto::Request> CreateRequest(
-      absl::Span<const std::string> inputs) const;
+      absl::Span<const std::string> inputs, bool packed = false) const;
+
+  // As `CreateRequest`, but allocates the request and all encrypted elements on
+  // `arena`, so that they are freed together when the arena is destroyed. The
+  // returned message is owned by `arena`.
+  //
+  // Returns INVALID_ARGUMENT if `arena` is null, or INTERNAL if encryption
+  // fails.
+  StatusOr<psi_proto::Request*> CreateRequest(
+      google::protobuf::Arena* arena, absl::Span<const std::string> inputs,
+      bool packed = false) const;
 
   // Processes the server's response and returns the intersection of the client
   // and server inputs. Use this function if this instance was created with
@@ -140,6 +185,68 @@ class PsiClient {
       const psi_proto::ServerSetup& server_setup,
       const psi_proto::Response& server_response) const;
 
+  // As `GetIntersection`, but takes the serialized `psi_proto::ServerSetup` as
+  // received from the server. The setup is queried in place, without parsing
+  // it into a message or copying its bit arrays or elements.
+  //
+  // Returns INVALID_ARGUMENT if any input messages are malformed, or INTERNAL
+  // if decryption fails.
+  StatusOr<std::vector<int64_t>> GetIntersection(
+      absl::string_view serialized_server_setup,
+      const psi_proto::Response& server_response) const;
+
+  // As `GetIntersection`, but queries a setup that was prepared once with
+  // `PreparedServerSetup::Create`. Use this when issuing many requests
+  // against the same setup: each call then only costs time proportional to
+  // the size of `server_response`.
+  //
+  // Returns INVALID_ARGUMENT if `server_response` is malformed, or INTERNAL if
+  // decryption fails.
+  StatusOr<std::vector<int64_t>> GetIntersection(
+      const PreparedServerSetup& server_setup,
+      const psi_proto::Response& server_response) const;
+
+  // As `GetIntersection`, but queries a view of the setup, e.g. one assembled
+  // from chunks by a `ServerSetupAssembler`. The buffers referenced by
+  // `server_setup` must stay alive for the duration of the call.
+  //
+  // Returns INVALID_ARGUMENT if `server_response` is malformed, or INTERNAL if
+  // decryption fails.
+  StatusOr<std::vector<int64_t>> GetIntersection(
+      const ServerSetupView& server_setup,
+      const psi_proto::Response& server_response) const;
+
+  // As `GetIntersection`, but queries a setup file in place, see
+  // `SetupFile::Open`.
+  //
+  // Returns INVALID_ARGUMENT if `server_response` is malformed, or INTERNAL if
+  // decryption fails.
+  StatusOr<std::vector<int64_t>> GetIntersection(
+      const SetupFile& server_setup,
+      const psi_proto::Response& server_response) const;
+
+  // As `GetIntersection`, but returns the indices as an `IntersectionResult`
+  // in `encoding`, or in whichever encoding is smaller if `encoding` is not
+  // set. For large intersections this takes a fraction of the memory of a
+  // vector of indices. The bitmap encoding covers all elements of
+  // `server_response`.
+  //
+  // Returns INVALID_ARGUMENT if any input messages are malformed, or INTERNAL
+  // if decryption fails.
+  StatusOr<IntersectionResult> GetCompactIntersection(
+      const ServerSetupView& server_setup,
+      const psi_proto::Response& server_response,
+      absl::optional<IntersectionResult::Encoding> encoding =
+          absl::nullopt) const;
+
+  // As `GetCompactIntersection`, but takes the serialized
+  // `psi_proto::ServerSetup` and queries it in place.
+  StatusOr<IntersectionResult> GetCompactIntersection(
+      absl::string_view serialized_server_setup,
+      const psi_proto::Response& server_response,
+      absl::optional<IntersectionResult::Encoding> encoding =
+          absl::nullopt) const;
+
   // As `GetIntersection`, but only reveals the size of the intersection. Use
   // this function if this instance was created with `reveal_intersection =
   // false`.
@@ -150,25 +257,184 @@ class PsiClient {
       const psi_proto::ServerSetup& server_setup,
       const psi_proto::Response& server_response) const;
 
+  // As `GetIntersectionSize`, but takes the serialized
+  // `psi_proto::ServerSetup` and queries it in place.
+  //
+  // Returns INVALID_ARGUMENT if any input messages are malformed, or INTERNAL
+  // if decryption fails.
+  StatusOr<int64_t> GetIntersectionSize(
+      absl::string_view serialized_server_setup,
+      const psi_proto::Response& server_response) const;
+
+  // As `GetIntersectionSize`, but queries a prepared setup.
+  //
+  // Returns INVALID_ARGUMENT if `server_response` is malformed, or INTERNAL if
+  // decryption fails.
+  StatusOr<int64_t> GetIntersectionSize(
+      const PreparedServerSetup& server_setup,
+      const psi_proto::Response& server_response) const;
+
+  // As `GetIntersectionSize`, but queries a view of the setup.
+  //
+  // Returns INVALID_ARGUMENT if `server_response` is malformed, or INTERNAL if
+  // decryption fails.
+  StatusOr<int64_t> GetIntersectionSize(
+      const ServerSetupView& server_setup,
+      const psi_proto::Response& server_response) const;
+
+  // As `GetIntersectionSize`, but queries a setup file in place.
+  //
+  // Returns INVALID_ARGUMENT if `server_response` is malformed, or INTERNAL if
+  // decryption fails.
+  StatusOr<int64_t> GetIntersectionSize(
+      const SetupFile& server_setup,
+      const psi_proto::Response& server_response) const;
+
+  // Starts intersecting `server_response` with a GCS setup whose bits are
+  // still being received, so that decoding overlaps with the download.
+  // `setup_parameters` must hold the GCS parameters, and its bits are ignored;
+  // the `parameters` of a `ServerSetupManifest` can be passed directly. The
+  // bits must then be pushed to the returned intersector in order.
+  //
+  // Returns INVALID_ARGUMENT if `setup_parameters` does not hold a GCS or if
+  // `server_response` is malformed, or INTERNAL if decryption fails.
+  StatusOr<std::unique_ptr<GCSStreamingIntersector>>
+  CreateStreamingIntersector(const psi_proto::ServerSetup& setup_parameters,
+                             const psi_proto::Response& server_response) const;
+
+  // Starts reading a response that the server streams in chunks, see
+  // `PsiServer::CreateResponseStream`. The request is sent in chunks by calling
+  // `CreateRequest` on consecutive slices of the inputs. Each response chunk
+  // is decrypted and intersected with `server_setup` as soon as it is added to
+  // the returned reader. This instance and `server_setup` must outlive it.
+  std::unique_ptr<ResponseReader> CreateResponseReader(
+      const PreparedServerSetup& server_setup) const;
+
   // Returns this instance's private key. This key should only be used to create
   // other client instances. DO NOT SEND THIS KEY TO ANY OTHER PARTY!
   std::string GetPrivateKeyBytes() const;
 
  private:
-  explicit PsiClient(
-      std::unique_ptr<::private_join_and_compute::ECCommutativeCipher>
-          ec_cipher,
-      bool reveal_intersection);
+  PsiClient(std::unique_ptr<CurveCipher> cipher, bool reveal_intersection,
+            psi_proto::HashToCurve hash_to_curve,
+            psi_proto::PointEncoding point_encoding, psi_proto::Curve curve);
+
+  // Returns INVALID_ARGUMENT if the server encrypted its elements in a
+  // different group than the client.
+  absl::Status CheckCurve(psi_proto::Curve server_curve) const;
+
+  // Returns INVALID_ARGUMENT if the server mapped its elements to the curve
+  // with a different method than the client.
+  absl::Status CheckHashToCurve(
+      psi_proto::HashToCurve server_hash_to_curve) const;
+
+  // Returns INVALID_ARGUMENT if the server encoded its elements differently
+  // than the client.
+  absl::Status CheckPointEncoding(
+      psi_proto::PointEncoding server_point_encoding) const;
+
+  // Implements `CreateRequest` by writing to `request`.
+  absl::Status FillRequest(absl::Span<const std::string> inputs, bool packed,
+                           psi_proto::Request* request) const;
+
+  // Implements `FillRequest` for the packed encoding.
+  absl::Status FillPackedRequest(absl::Span<const std::string> inputs,
+                                 psi_proto::Request* request) const;
 
   // Processes the `server_response` and returns the indices that are present in
-  // the bloom filter encoded by `server_setup`. This method is called by
+  // the container referenced by `server_setup`. This method is called by
   // GetIntersection and GetIntersectionSize internally.
   StatusOr<std::vector<int64_t>> ProcessResponse(
-      const psi_proto::ServerSetup& server_setup,
+      const ServerSetupView& server_setup,
+      const psi_proto::Response& server_response) const;
+  StatusOr<std::vector<int64_t>> ProcessResponse(
+      const PreparedServerSetup& server_setup,
+      const psi_proto::Response& server_response) const;
+  StatusOr<std::vector<int64_t>> ProcessResponse(
+      const SetupFile& server_setup,
+      const psi_proto::Response& server_response) const;
+
+  // As `ProcessResponse`, but calls `visit` with each index instead of
+  // collecting them. Indices are visited in ascending order, except for GCS
+  // setups.
+  absl::Status ForEachIntersectingIndex(
+      const ServerSetupView& server_setup,
+      const psi_proto::Response& server_response,
+      absl::FunctionRef<void(int64_t)> visit) const;
+
+  // As `ProcessResponse`, but only returns the number of indices. This never
+  // materializes the indices, and for GCS only keeps bare hashes.
+  StatusOr<int64_t> CountResponse(
+      const ServerSetupView& server_setup,
+      const psi_proto::Response& server_response) const;
+  StatusOr<int64_t> CountResponse(
+      const PreparedServerSetup& server_setup,
+      const psi_proto::Response& server_response) const;
+  StatusOr<int64_t> CountResponse(
+      const SetupFile& server_setup,
+      const psi_proto::Response& server_response) const;
+
+  // Decrypts the elements of `server_response`, in either encoding.
+  StatusOr<std::vector<std::string>> DecryptResponse(
       const psi_proto::Response& server_response) const;
 
-  std::unique_ptr<::private_join_and_compute::ECCommutativeCipher> ec_cipher_;
+  // Decrypts the elements of `server_response` in batches of at most
+  // `kDecryptBatchSize` and passes each batch to `visit`, together with the
+  // index of its first element. A batch is only valid during the call, so at
+  // most one batch of decrypted elements is alive at a time.
+  absl::Status DecryptResponseInBatches(
+      const psi_proto::Response& server_response,
+      absl::FunctionRef<void(absl::Span<const std::string> batch,
+                             int64_t offset)>
+          visit) const;
+
+  // Number of elements decrypted per batch by `DecryptResponseInBatches`.
+  static constexpr int64_t kDecryptBatchSize = 1024;
+
+  friend class ResponseReader;
+
+  std::unique_ptr<CurveCipher> cipher_;
   bool reveal_intersection;
+  psi_proto::HashToCurve hash_to_curve_;
+  psi_proto::PointEncoding point_encoding_;
+  psi_proto::Curve curve_;
+};
+
+// Client side of a chunked request/response exchange, created by
+// `PsiClient::CreateResponseReader`. Response chunks must be added in the order
+// the server produced them.
+class ResponseReader {
+ public:
+  ResponseReader(const ResponseReader&) = delete;
+  ResponseReader& operator=(const ResponseReader&) = delete;
+
+  // Decrypts the next response chunk and intersects it with the setup.
+  //
+  // Returns INVALID_ARGUMENT if `response_chunk` is malformed, or INTERNAL if
+  // decryption fails. On error, the chunk is dropped as a whole.
+  absl::Status AddChunk(const psi_proto::Response& response_chunk);
+
+  // Returns the indices of the inputs, counted across all request chunks, that
+  // are in the intersection of the chunks added so far. The indices are in
+  // ascending order.
+  //
+  // Returns INVALID_ARGUMENT if the client was created with
+  // `reveal_intersection` == false.
+  StatusOr<std::vector<int64_t>> GetIntersection() const;
+
+  // Returns the size of the intersection of the chunks added so far.
+  int64_t GetIntersectionSize() const;
+
+ private:
+  friend class PsiClient;
+
+  ResponseReader(const PsiClient* client,
+                 const PreparedServerSetup* server_setup);
+
+  const PsiClient* client_;
+  const PreparedServerSetup* server_setup_;
+  int64_t num_elements_ = 0;
+  std::vector<int64_t> intersection_;
 };
 
 }  // namespace private_set_intersection
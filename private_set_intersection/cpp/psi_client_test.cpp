@@ -18,12 +18,16 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "gtest/gtest.h"
 #include "private_join_and_compute/crypto/ec_commutative_cipher.h"
+#include "private_set_intersection/cpp/datastructure/bloom_filter.h"
 #include "private_set_intersection/cpp/datastructure/gcs.h"
+#include "private_set_intersection/cpp/datastructure/raw.h"
 #include "util/status_matchers.h"
 
 namespace private_set_intersection {
@@ -148,6 +152,32 @@ TEST_F(PsiClientTest, TestCreatingFromKey) {
   }
 }
 
+TEST_F(PsiClientTest, TestPackedRequestMatchesRepeatedRequest) {
+  const std::string key_bytes(32, '\x01');
+  PSI_ASSERT_OK_AND_ASSIGN(auto client,
+                           PsiClient::CreateFromKey(key_bytes, true));
+  int num_client_elements = 100;
+  std::vector<std::string> client_elements(num_client_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto repeated_request,
+                           client->CreateRequest(client_elements));
+  PSI_ASSERT_OK_AND_ASSIGN(auto packed_request,
+                           client->CreateRequest(client_elements, true));
+
+  // The packed buffer is the concatenation of the repeated elements.
+  EXPECT_EQ(repeated_request.element_width(), 0);
+  EXPECT_EQ(packed_request.element_width(), 33);
+  EXPECT_TRUE(packed_request.encrypted_elements().empty());
+  std::string concatenated;
+  for (const auto& element : repeated_request.encrypted_elements()) {
+    concatenated += element;
+  }
+  EXPECT_EQ(packed_request.packed_elements(), concatenated);
+}
+
 TEST_F(PsiClientTest, TestCorrectnessIntersection) {
   SetUp(true);
   int num_client_elements = 1000, num_server_elements = 10000;
@@ -228,6 +258,183 @@ TEST_F(PsiClientTest, TestCorrectnessIntersectionSize) {
             ceil(((double)num_client_elements / 2.0) * 1.1));
 }
 
+TEST_F(PsiClientTest, TestSerializedSetupMatchesProtobufSetup) {
+  SetUp(true);
+  int num_client_elements = 100, num_server_elements = 1000;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+  psi_proto::ServerSetup server_setup;
+  CreateDummySetupMessage(server_elements, 1e-9, &server_setup);
+  std::string serialized_setup = server_setup.SerializeAsString();
+
+  PSI_ASSERT_OK_AND_ASSIGN(psi_proto::Request client_request,
+                           client_->CreateRequest(client_elements));
+  psi_proto::Response server_response;
+  CreateDummyResponse(client_request, &server_response);
+
+  PSI_ASSERT_OK_AND_ASSIGN(
+      std::vector<int64_t> expected,
+      client_->GetIntersection(server_setup, server_response));
+  PSI_ASSERT_OK_AND_ASSIGN(
+      std::vector<int64_t> intersection,
+      client_->GetIntersection(serialized_setup, server_response));
+  EXPECT_EQ(intersection, expected);
+  PSI_ASSERT_OK_AND_ASSIGN(
+      int64_t intersection_size,
+      client_->GetIntersectionSize(serialized_setup, server_response));
+  EXPECT_EQ(intersection_size, static_cast<int64_t>(expected.size()));
+
+  EXPECT_THAT(client_->GetIntersection("\xff", server_response),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(PsiClientTest, TestPreparedSetupMatchesProtobufSetup) {
+  SetUp(true);
+  int num_client_elements = 100, num_server_elements = 1000;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+  psi_proto::ServerSetup server_setup;
+  CreateDummySetupMessage(server_elements, 1e-9, &server_setup);
+  PSI_ASSERT_OK_AND_ASSIGN(auto prepared_setup,
+                           PreparedServerSetup::Create(server_setup));
+
+  // Issue several requests against the same prepared setup.
+  for (int round = 0; round < 3; round++) {
+    std::vector<std::string> round_elements(
+        client_elements.begin() + round, client_elements.end());
+    PSI_ASSERT_OK_AND_ASSIGN(psi_proto::Request client_request,
+                             client_->CreateRequest(round_elements));
+    psi_proto::Response server_response;
+    CreateDummyResponse(client_request, &server_response);
+
+    PSI_ASSERT_OK_AND_ASSIGN(
+        std::vector<int64_t> expected,
+        client_->GetIntersection(server_setup, server_response));
+    std::sort(expected.begin(), expected.end());
+    PSI_ASSERT_OK_AND_ASSIGN(
+        std::vector<int64_t> intersection,
+        client_->GetIntersection(*prepared_setup, server_response));
+    EXPECT_EQ(intersection, expected);
+    PSI_ASSERT_OK_AND_ASSIGN(
+        int64_t intersection_size,
+        client_->GetIntersectionSize(*prepared_setup, server_response));
+    EXPECT_EQ(intersection_size, static_cast<int64_t>(expected.size()));
+  }
+}
+
+TEST_F(PsiClientTest, TestSetupFileMatchesProtobufSetup) {
+  SetUp(true);
+  int num_client_elements = 100, num_server_elements = 1000;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+  psi_proto::ServerSetup server_setup;
+  CreateDummySetupMessage(server_elements, 1e-9, &server_setup);
+  PSI_ASSERT_OK_AND_ASSIGN(auto setup_view,
+                           ServerSetupView::FromProtobuf(server_setup));
+  PSI_ASSERT_OK_AND_ASSIGN(std::string encoded,
+                           EncodeSetupFile(setup_view, true));
+  PSI_ASSERT_OK_AND_ASSIGN(auto setup_file, SetupFile::FromBuffer(encoded));
+
+  PSI_ASSERT_OK_AND_ASSIGN(psi_proto::Request client_request,
+                           client_->CreateRequest(client_elements));
+  psi_proto::Response server_response;
+  CreateDummyResponse(client_request, &server_response);
+
+  PSI_ASSERT_OK_AND_ASSIGN(
+      std::vector<int64_t> expected,
+      client_->GetIntersection(server_setup, server_response));
+  std::sort(expected.begin(), expected.end());
+  PSI_ASSERT_OK_AND_ASSIGN(
+      std::vector<int64_t> intersection,
+      client_->GetIntersection(*setup_file, server_response));
+  EXPECT_EQ(intersection, expected);
+  PSI_ASSERT_OK_AND_ASSIGN(
+      int64_t intersection_size,
+      client_->GetIntersectionSize(*setup_file, server_response));
+  EXPECT_EQ(intersection_size, static_cast<int64_t>(expected.size()));
+}
+
+TEST_F(PsiClientTest, TestIntersectionAcrossDecryptBatches) {
+  SetUp(true);
+  // Spans several decryption batches, with a partial last batch.
+  int num_client_elements = 2500, num_server_elements = 2000;
+  double fpr = 1e-12;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> encrypted_server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    PSI_ASSERT_OK_AND_ASSIGN(
+        encrypted_server_elements[i],
+        server_ec_cipher_->Encrypt(absl::StrCat("Element ", 2 * i)));
+  }
+
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto raw, Raw::Create(num_client_elements, encrypted_server_elements));
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto gcs,
+      GCS::Create(fpr, num_client_elements, encrypted_server_elements));
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto bloom_filter,
+      BloomFilter::Create(fpr, num_client_elements,
+                          encrypted_server_elements));
+
+  PSI_ASSERT_OK_AND_ASSIGN(psi_proto::Request client_request,
+                           client_->CreateRequest(client_elements));
+  psi_proto::Response repeated_response;
+  CreateDummyResponse(client_request, &repeated_response);
+  psi_proto::Response packed_response;
+  packed_response.set_element_width(
+      static_cast<int32_t>(repeated_response.encrypted_elements(0).size()));
+  for (const std::string& element : repeated_response.encrypted_elements()) {
+    packed_response.mutable_packed_elements()->append(element);
+  }
+
+  for (const auto& server_response : {repeated_response, packed_response}) {
+    for (const auto& server_setup :
+         {raw->ToProtobuf(), gcs->ToProtobuf(), bloom_filter->ToProtobuf()}) {
+      PSI_ASSERT_OK_AND_ASSIGN(
+          std::vector<int64_t> intersection,
+          client_->GetIntersection(server_setup, server_response));
+      std::sort(intersection.begin(), intersection.end());
+      std::vector<int64_t> expected;
+      for (int64_t i = 0; i < num_client_elements; i += 2) {
+        expected.push_back(i);
+      }
+      EXPECT_EQ(intersection, expected);
+      PSI_ASSERT_OK_AND_ASSIGN(
+          int64_t intersection_size,
+          client_->GetIntersectionSize(server_setup, server_response));
+      EXPECT_EQ(intersection_size, expected.size());
+      PSI_ASSERT_OK_AND_ASSIGN(
+          auto compact,
+          client_->GetCompactIntersection(server_setup.SerializeAsString(),
+                                          server_response));
+      EXPECT_EQ(compact.encoding(), IntersectionResult::Encoding::kBitmap);
+      EXPECT_EQ(compact.ToIndices(), expected);
+    }
+  }
+}
+
 TEST_F(PsiClientTest, FailIfRevealIntersectionDoesntMatch) {
   SetUp(false);
   psi_proto::ServerSetup server_setup;
@@ -238,6 +445,11 @@ TEST_F(PsiClientTest, FailIfRevealIntersectionDoesntMatch) {
           absl::StatusCode::kInvalidArgument,
           "GetIntersection called on PsiClient with reveal_intersection == "
           "false"));
+  EXPECT_THAT(client_->GetCompactIntersection(server_setup.SerializeAsString(),
+                                              response),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "GetCompactIntersection called on PsiClient with "
+                       "reveal_intersection == false"));
 }
 
 }  // namespace
@@ -16,12 +16,18 @@
 
 #include "private_set_intersection/cpp/psi_server.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
-#include "openssl/obj_mac.h"
+#include "private_set_intersection/cpp/packed_elements.h"
+#include "private_set_intersection/cpp/shuffle.h"
+#include "private_set_intersection/cpp/spsc_queue.h"
 #include "private_set_intersection/cpp/datastructure/bloom_filter.h"
 #include "private_set_intersection/cpp/datastructure/gcs.h"
 #include "private_set_intersection/cpp/datastructure/raw.h"
@@ -29,60 +35,85 @@
 
 namespace private_set_intersection {
 
+namespace {
+
+// Number of inputs encrypted per batch during setup.
+constexpr int64_t kSetupBatchSize = 1024;
+
+// Number of encrypted batches each setup thread may queue up ahead of the
+// container build.
+constexpr size_t kSetupQueueCapacity = 4;
+
+// Number of encrypted elements collected before they are added to a Bloom
+// filter during setup.
+constexpr int64_t kBloomFilterAddSize = int64_t{1} << 16;
+
+}  // namespace
+
 /**
  * @brief Construct a new Psi Server:: Psi Server object
  *
- * @param ec_cipher A unique pointer to a commutative , which is used for
- * encryption and decryption in the Private Set Intersection (PSI) protocol.
+ * @param cipher The commutative cipher with the server's key, which is used
+ * for encryption in the Private Set Intersection (PSI) protocol.
  * @param reveal_intersection A boolean value indicating whether the
  * intersection of the two sets should be revealed after the PSI protocol is
  * completed.
+ * @param hash_to_curve The method that maps inputs to the curve
+ * @param point_encoding The encoding of encrypted elements
+ * @param curve The group that `cipher` encrypts in
  */
-PsiServer::PsiServer(
-    std::unique_ptr<::private_join_and_compute::ECCommutativeCipher> ec_cipher,
-    bool reveal_intersection)
-    : ec_cipher_(std::move(ec_cipher)),
-      reveal_intersection(reveal_intersection) {}
+PsiServer::PsiServer(std::unique_ptr<CurveCipher> cipher,
+                     bool reveal_intersection,
+                     psi_proto::HashToCurve hash_to_curve,
+                     psi_proto::PointEncoding point_encoding,
+                     psi_proto::Curve curve)
+    : cipher_(std::move(cipher)),
+      reveal_intersection(reveal_intersection),
+      hash_to_curve_(hash_to_curve),
+      point_encoding_(point_encoding),
+      curve_(curve) {}
 
 /**
- * @brief Creates a new instance of the PsiServer class with a new key pair for
- * encryption and decryption using ECCommutativeCipher.
+ * @brief Creates a new instance of the PsiServer class with a new key for
+ * encryption and decryption in the selected group.
  *
  * @param reveal_intersection A boolean indicating whether the client wants to
  * learn the intersection values or only its size (cardinality).
+ * @param hash_to_curve The method that maps inputs to the curve
+ * @param point_encoding The encoding of encrypted elements
+ * @param curve The group in which elements are encrypted
  * @return StatusOr<std::unique_ptr<PsiServer>>
  */
 StatusOr<std::unique_ptr<PsiServer>> PsiServer::CreateWithNewKey(
-    bool reveal_intersection) {
-  // Create an EC cipher with curve P-256. This gives 128 bits of security.
-  ASSIGN_OR_RETURN(
-      auto ec_cipher,
-      ::private_join_and_compute::ECCommutativeCipher::CreateWithNewKey(
-          NID_X9_62_prime256v1,
-          ::private_join_and_compute::ECCommutativeCipher::HashType::SHA256));
-  return absl::WrapUnique(
-      new PsiServer(std::move(ec_cipher), reveal_intersection));
+    bool reveal_intersection, psi_proto::HashToCurve hash_to_curve,
+    psi_proto::PointEncoding point_encoding, psi_proto::Curve curve) {
+  ASSIGN_OR_RETURN(auto cipher, CurveCipher::CreateWithNewKey(
+                                    curve, hash_to_curve, point_encoding));
+  return absl::WrapUnique(new PsiServer(std::move(cipher), reveal_intersection,
+                                        hash_to_curve, point_encoding, curve));
 }
 
 /**
- * @brief Creates a new PsiServer instance using an EC cipher created from the
+ * @brief Creates a new PsiServer instance using a cipher created from the
  * provided key.
  *
- * @param key_bytes The bytes representing the key for the EC cipher.
+ * @param key_bytes The bytes representing the key for the cipher.
  * @param reveal_intersection A boolean flag indicating whether the intersection
  * should be revealed.
+ * @param hash_to_curve The method that maps inputs to the curve
+ * @param point_encoding The encoding of encrypted elements
+ * @param curve The group in which elements are encrypted
  * @return StatusOr<std::unique_ptr<PsiServer>>
  */
 StatusOr<std::unique_ptr<PsiServer>> PsiServer::CreateFromKey(
-    const std::string& key_bytes, bool reveal_intersection) {
-  // Create an EC cipher with curve P-256. This gives 128 bits of security.
-  ASSIGN_OR_RETURN(
-      auto ec_cipher,
-      ::private_join_and_compute::ECCommutativeCipher::CreateFromKey(
-          NID_X9_62_prime256v1, key_bytes,
-          ::private_join_and_compute::ECCommutativeCipher::HashType::SHA256));
-  return absl::WrapUnique(
-      new PsiServer(std::move(ec_cipher), reveal_intersection));
+    const std::string& key_bytes, bool reveal_intersection,
+    psi_proto::HashToCurve hash_to_curve,
+    psi_proto::PointEncoding point_encoding, psi_proto::Curve curve) {
+  ASSIGN_OR_RETURN(auto cipher,
+                   CurveCipher::CreateFromKey(curve, key_bytes, hash_to_curve,
+                                              point_encoding));
+  return absl::WrapUnique(new PsiServer(std::move(cipher), reveal_intersection,
+                                        hash_to_curve, point_encoding, curve));
 }
 
 /**
@@ -100,50 +131,317 @@ StatusOr<std::unique_ptr<PsiServer>> PsiServer::CreateFromKey(
 StatusOr<psi_proto::ServerSetup> PsiServer::CreateSetupMessage(
     double fpr, int64_t num_client_inputs, absl::Span<const std::string> inputs,
     DataStructure ds) const {
+  psi_proto::ServerSetup server_setup;
+  RETURN_IF_ERROR(
+      FillSetupMessage(fpr, num_client_inputs, inputs, ds, &server_setup));
+  return server_setup;
+}
+
+/**
+ * @brief Create a server setup message on the given arena
+ *
+ * @param arena The arena that owns the returned message
+ * @param fpr A double representing the false positive rate of the chosen data
+ * structure (This is ignored for the `Raw` datastructure)
+ * @param num_client_inputs The number of client inputs to the PSI protocol
+ * @param inputs The server inputs to the PSI protocol
+ * @param ds A datastructure enum indicating the type of data structure to use
+ * for the PSI protocol
+ * @return StatusOr<psi_proto::ServerSetup*>
+ */
+StatusOr<psi_proto::ServerSetup*> PsiServer::CreateSetupMessage(
+    google::protobuf::Arena* arena, double fpr, int64_t num_client_inputs,
+    absl::Span<const std::string> inputs, DataStructure ds) const {
+  if (arena == nullptr) {
+    return absl::InvalidArgumentError("`arena` must not be null");
+  }
+  auto* server_setup =
+      google::protobuf::Arena::Create<psi_proto::ServerSetup>(arena);
+  RETURN_IF_ERROR(
+      FillSetupMessage(fpr, num_client_inputs, inputs, ds, server_setup));
+  return server_setup;
+}
+
+/**
+ * @brief Create a server setup split into a manifest and chunks
+ *
+ * @param fpr A double representing the false positive rate of the chosen data
+ * structure (This is ignored for the `Raw` datastructure)
+ * @param num_client_inputs The number of client inputs to the PSI protocol
+ * @param inputs The server inputs to the PSI protocol
+ * @param max_chunk_size The maximum payload size of each chunk in bytes
+ * @param ds A datastructure enum indicating the type of data structure to use
+ * for the PSI protocol
+ * @return StatusOr<ChunkedServerSetup>
+ */
+StatusOr<ChunkedServerSetup> PsiServer::CreateChunkedSetupMessage(
+    double fpr, int64_t num_client_inputs, absl::Span<const std::string> inputs,
+    int64_t max_chunk_size, DataStructure ds) const {
+  if (max_chunk_size <= 0) {
+    return absl::InvalidArgumentError("`max_chunk_size` must be positive");
+  }
+  ChunkedServerSetup chunked;
+  RETURN_IF_ERROR(BuildSetup(
+      fpr, num_client_inputs, inputs, ds,
+      [&chunked, max_chunk_size](const ServerSetupView& setup) -> absl::Status {
+        ASSIGN_OR_RETURN(chunked, SplitServerSetup(setup, max_chunk_size));
+        return absl::OkStatus();
+      }));
+  return chunked;
+}
+
+/**
+ * @brief Encrypts the server's inputs and writes the chosen data structure to
+ * `server_setup`
+ *
+ * @param fpr The false positive rate of the chosen data structure
+ * @param num_client_inputs The number of client inputs to the PSI protocol
+ * @param inputs The server inputs to the PSI protocol
+ * @param ds The type of data structure to use
+ * @param server_setup The message to write the setup to
+ * @return absl::Status
+ */
+absl::Status PsiServer::FillSetupMessage(
+    double fpr, int64_t num_client_inputs, absl::Span<const std::string> inputs,
+    DataStructure ds, psi_proto::ServerSetup* server_setup) const {
+  return BuildSetup(fpr, num_client_inputs, inputs, ds,
+                    [server_setup](const ServerSetupView& setup) {
+                      setup.ToProtobuf(server_setup);
+                      return absl::OkStatus();
+                    });
+}
+
+/**
+ * @brief Encrypts the server's inputs, builds the chosen data structure and
+ * passes a view of it to `visit`
+ *
+ * @param fpr The false positive rate of the chosen data structure
+ * @param num_client_inputs The number of client inputs to the PSI protocol
+ * @param inputs The server inputs to the PSI protocol
+ * @param ds The type of data structure to use
+ * @param visit Called with a view of the data structure while it is alive
+ * @return absl::Status
+ */
+absl::Status PsiServer::BuildSetup(
+    double fpr, int64_t num_client_inputs, absl::Span<const std::string> inputs,
+    DataStructure ds,
+    absl::FunctionRef<absl::Status(const ServerSetupView&)> visit) const {
   auto num_inputs = static_cast<int64_t>(inputs.size());
   // Correct fpr to account for multiple client queries.
   double corrected_fpr = fpr / num_client_inputs;
-  std::vector<std::string> encrypted;
-  encrypted.reserve(num_inputs);
 
-  for (int i = 0; i < num_inputs; i++) {
-    ASSIGN_OR_RETURN(std::string encrypted_element,
-                     ec_cipher_->Encrypt(inputs[i]));
-    encrypted.push_back(encrypted_element);
-  }
+  // The setup records the group, and how the elements were mapped to it and
+  // encoded.
+  auto visit_container = [this, visit](ServerSetupView setup) {
+    setup.hash_to_curve = hash_to_curve_;
+    setup.point_encoding = point_encoding_;
+    setup.curve = curve_;
+    return visit(setup);
+  };
 
+  // Each container consumes batches of encrypted elements as they are
+  // produced, so that building it overlaps with encryption. The parameters are
+  // validated before anything is encrypted.
   switch (ds) {
     case DataStructure::Gcs: {
-      // Create a GCS and insert elements into it.
-      ASSIGN_OR_RETURN(auto container,
-                       GCS::Create(corrected_fpr, num_client_inputs,
-                                   absl::MakeConstSpan(encrypted)));
-
-      // Return the GCS as a Protobuf
-      return container->ToProtobuf();
+      // Only the hashes are kept; sorting and compressing them has to wait for
+      // the last batch.
+      ASSIGN_OR_RETURN(int64_t hash_range,
+                       GCS::ComputeHashRange(corrected_fpr, num_client_inputs,
+                                             num_inputs));
+      std::vector<int64_t> hashes;
+      hashes.reserve(num_inputs);
+      RETURN_IF_ERROR(EncryptInBatches(
+          inputs, [&](std::vector<std::string> batch) {
+            const size_t offset = hashes.size();
+            hashes.resize(offset + batch.size());
+            GCS::HashBatch(batch, hash_range, &hashes[offset]);
+          }));
+      auto container = GCS::CreateFromHashes(hash_range, std::move(hashes));
+      return visit_container(container->ToView());
     }
     case DataStructure::BloomFilter: {
-      // Create a Bloom Filter and insert elements into it.
-      ASSIGN_OR_RETURN(auto container,
-                       BloomFilter::Create(corrected_fpr, num_client_inputs,
-                                           absl::MakeConstSpan(encrypted)));
-
-      // Return the Bloom Filter as a Protobuf
-      return container->ToProtobuf();
+      // Create a Bloom Filter and insert the batches into it in larger groups,
+      // so that its partitioned bulk insertion has enough writes per region of
+      // the filter to work with.
+      ASSIGN_OR_RETURN(
+          auto container,
+          BloomFilter::CreateEmpty(corrected_fpr,
+                                   std::max(num_client_inputs, num_inputs)));
+      std::vector<std::string> pending;
+      RETURN_IF_ERROR(EncryptInBatches(
+          inputs, [&container, &pending](std::vector<std::string> batch) {
+            for (std::string& element : batch) {
+              pending.push_back(std::move(element));
+            }
+            if (static_cast<int64_t>(pending.size()) >= kBloomFilterAddSize) {
+              container->Add(absl::MakeConstSpan(pending));
+              pending.clear();
+            }
+          }));
+      container->Add(absl::MakeConstSpan(pending));
+      return visit_container(container->ToView());
     }
     case DataStructure::Raw: {
-      // Create a Raw container and insert elements into it.
+      // Collect the elements; the Raw container sorts them.
+      std::vector<std::string> encrypted;
+      encrypted.reserve(num_inputs);
+      RETURN_IF_ERROR(EncryptInBatches(
+          inputs, [&encrypted](std::vector<std::string> batch) {
+            for (std::string& element : batch) {
+              encrypted.push_back(std::move(element));
+            }
+          }));
       ASSIGN_OR_RETURN(auto container,
                        Raw::Create(num_client_inputs, std::move(encrypted)));
-
-      // Return the Raw container as a Protobuf
-      return container->ToProtobuf();
+      return visit_container(container->ToView());
     }
     default:
       return absl::InvalidArgumentError("Impossible");
   }
 }
 
+/**
+ * @brief Encrypts the server's inputs in batches and passes each batch to
+ * `consume` on the calling thread
+ *
+ * If `num_setup_threads_` is positive, each encryption thread uses its own
+ * copy of the cipher and claims batches from a shared counter. Finished batches
+ * travel to the calling thread through one lock-free queue per thread, so
+ * `consume` runs while the threads keep encrypting.
+ *
+ * @param inputs The server inputs to the PSI protocol
+ * @param consume Called with each batch of encrypted elements
+ * @return absl::Status
+ */
+absl::Status PsiServer::EncryptInBatches(
+    absl::Span<const std::string> inputs,
+    absl::FunctionRef<void(std::vector<std::string> batch)> consume) const {
+  const auto num_inputs = static_cast<int64_t>(inputs.size());
+  const int64_t num_batches =
+      (num_inputs + kSetupBatchSize - 1) / kSetupBatchSize;
+  auto encrypt_batch =
+      [inputs, num_inputs](
+          CurveCipher& cipher,
+          int64_t batch_index) -> StatusOr<std::vector<std::string>> {
+    const int64_t begin = batch_index * kSetupBatchSize;
+    const int64_t end = std::min(num_inputs, begin + kSetupBatchSize);
+    std::string encrypted;
+    RETURN_IF_ERROR(
+        cipher.Encrypt(inputs.subspan(begin, end - begin), &encrypted));
+    const size_t width = cipher.element_size();
+    std::vector<std::string> batch;
+    batch.reserve(end - begin);
+    for (int64_t i = 0; i < end - begin; i++) {
+      batch.push_back(encrypted.substr(i * width, width));
+    }
+    return batch;
+  };
+
+  if (num_setup_threads_ <= 0 || num_batches <= 1) {
+    for (int64_t b = 0; b < num_batches; b++) {
+      ASSIGN_OR_RETURN(std::vector<std::string> batch,
+                       encrypt_batch(*cipher_, b));
+      consume(std::move(batch));
+    }
+    return absl::OkStatus();
+  }
+
+  // Encryption may keep scratch state, so each thread needs its own clone of
+  // the cipher.
+  const int num_threads = static_cast<int>(
+      std::min<int64_t>(num_setup_threads_, num_batches));
+  std::vector<std::unique_ptr<CurveCipher>> ciphers;
+  for (int t = 0; t < num_threads; t++) {
+    ASSIGN_OR_RETURN(auto cipher, cipher_->Clone());
+    ciphers.push_back(std::move(cipher));
+  }
+
+  struct Worker {
+    Worker() : queue(kSetupQueueCapacity) {}
+
+    SpscQueue<std::vector<std::string>> queue;
+    absl::Status status;
+    std::atomic<bool> done{false};
+  };
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<int64_t> next_batch{0};
+  std::atomic<bool> failed{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    workers.push_back(absl::make_unique<Worker>());
+    threads.emplace_back([&, t]() {
+      Worker& worker = *workers[t];
+      while (!failed.load(std::memory_order_relaxed)) {
+        const int64_t b = next_batch.fetch_add(1, std::memory_order_relaxed);
+        if (b >= num_batches) {
+          break;
+        }
+        auto batch = encrypt_batch(*ciphers[t], b);
+        if (!batch.ok()) {
+          worker.status = batch.status();
+          failed.store(true, std::memory_order_relaxed);
+          break;
+        }
+        while (!worker.queue.TryPush(*std::move(batch))) {
+          if (failed.load(std::memory_order_relaxed)) {
+            break;
+          }
+          std::this_thread::yield();
+        }
+      }
+      worker.done.store(true, std::memory_order_release);
+    });
+  }
+
+  // Consume batches until every thread is done and its queue is drained. A
+  // queue must be checked once more after its thread is seen done, since the
+  // last batch may have been pushed in between.
+  std::vector<std::string> batch;
+  int num_done = 0;
+  std::vector<bool> drained(num_threads, false);
+  while (num_done < num_threads) {
+    bool progress = false;
+    for (int t = 0; t < num_threads; t++) {
+      if (drained[t]) {
+        continue;
+      }
+      const bool done = workers[t]->done.load(std::memory_order_acquire);
+      while (workers[t]->queue.TryPop(&batch)) {
+        if (!failed.load(std::memory_order_relaxed)) {
+          consume(std::move(batch));
+        }
+        progress = true;
+      }
+      if (done) {
+        drained[t] = true;
+        num_done++;
+      }
+    }
+    if (!progress) {
+      std::this_thread::yield();
+    }
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& worker : workers) {
+    RETURN_IF_ERROR(worker->status);
+  }
+  return absl::OkStatus();
+}
+
+/**
+ * @brief Sets the number of threads that encrypt the setup's inputs
+ *
+ * @param num_threads The number of encryption threads, or 0 to encrypt on the
+ * calling thread
+ */
+void PsiServer::set_num_setup_threads(int num_threads) {
+  num_setup_threads_ = num_threads;
+}
+
 /**
  * @brief Processes a client's request by re-encrypting the request's elements
  * and creating a response
@@ -153,6 +451,52 @@ StatusOr<psi_proto::ServerSetup> PsiServer::CreateSetupMessage(
  */
 StatusOr<psi_proto::Response> PsiServer::ProcessRequest(
     const psi_proto::Request& client_request) const {
+  psi_proto::Response response;
+  RETURN_IF_ERROR(
+      FillResponse(client_request, !reveal_intersection, &response));
+  return response;
+}
+
+/**
+ * @brief Processes a client's request and creates the response on the given
+ * arena
+ *
+ * @param arena The arena that owns the returned message
+ * @param client_request The request containing the elements to re-encrypt
+ * @return StatusOr<psi_proto::Response*>
+ */
+StatusOr<psi_proto::Response*> PsiServer::ProcessRequest(
+    google::protobuf::Arena* arena,
+    const psi_proto::Request& client_request) const {
+  if (arena == nullptr) {
+    return absl::InvalidArgumentError("`arena` must not be null");
+  }
+  auto* response = google::protobuf::Arena::Create<psi_proto::Response>(arena);
+  RETURN_IF_ERROR(
+      FillResponse(client_request, !reveal_intersection, response));
+  return response;
+}
+
+/**
+ * @brief Start a chunked request/response exchange
+ *
+ * @return std::unique_ptr<ResponseStream>
+ */
+std::unique_ptr<ResponseStream> PsiServer::CreateResponseStream() const {
+  return absl::WrapUnique(new ResponseStream(this));
+}
+
+/**
+ * @brief Re-encrypts the request's elements and writes them to `response`
+ *
+ * @param client_request The request containing the elements to re-encrypt
+ * @param unlink Whether to unlink the re-encrypted elements from the request
+ * @param response The message to write the re-encrypted elements to
+ * @return absl::Status
+ */
+absl::Status PsiServer::FillResponse(const psi_proto::Request& client_request,
+                                     bool unlink,
+                                     psi_proto::Response* response) const {
   if (!client_request.IsInitialized()) {
     return absl::InvalidArgumentError("`client_request` is corrupt!");
   }
@@ -164,29 +508,155 @@ StatusOr<psi_proto::Response> PsiServer::ProcessRequest(
                      ", but it is actually ", reveal_intersection));
   }
 
-  // Re-encrypt elements.
+  if (client_request.curve() != curve_) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Client uses curve ", client_request.curve(),
+                     ", but the server uses ", curve_));
+  }
+
+  if (client_request.hash_to_curve() != hash_to_curve_) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Client uses hash-to-curve method ", client_request.hash_to_curve(),
+        ", but the server uses ", hash_to_curve_));
+  }
+
+  if (client_request.point_encoding() != point_encoding_) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Client uses point encoding ", client_request.point_encoding(),
+        ", but the server uses ", point_encoding_));
+  }
+
+  // Packed requests are answered with a packed response.
+  if (client_request.element_width() != 0) {
+    return FillPackedResponse(client_request, unlink, response);
+  }
+
+  // Re-encrypt the request's elements as one batch and add them to the
+  // response.
   const auto& encrypted_elements = client_request.encrypted_elements();
   const std::int64_t num_client_elements =
       static_cast<std::int64_t>(encrypted_elements.size());
+  std::vector<absl::string_view> views(encrypted_elements.begin(),
+                                       encrypted_elements.end());
+  std::string reencrypted;
+  RETURN_IF_ERROR(cipher_->ReEncrypt(views, &reencrypted));
+  const size_t width = cipher_->element_size();
+  response->mutable_encrypted_elements()->Reserve(
+      static_cast<int>(num_client_elements));
+  for (int64_t i = 0; i < num_client_elements; i++) {
+    response->add_encrypted_elements(reencrypted.substr(i * width, width));
+  }
 
-  // Create the response
-  psi_proto::Response response;
+  // Sort or shuffle the resulting ciphertexts if we want to hide the
+  // intersection from the client.
+  if (unlink) {
+    return UnlinkElements(response->mutable_encrypted_elements());
+  }
+  return absl::OkStatus();
+}
 
-  // Re-encrypt the request's elements and add to the response
-  for (int i = 0; i < num_client_elements; i++) {
-    ASSIGN_OR_RETURN(std::string encrypted,
-                     ec_cipher_->ReEncrypt(encrypted_elements[i]));
-    response.add_encrypted_elements(encrypted);
+/**
+ * @brief Re-encrypts the elements of a request in the packed encoding and
+ * writes them to a packed response
+ *
+ * @param client_request The packed request containing the elements to
+ * re-encrypt
+ * @param unlink Whether to unlink the re-encrypted elements from the request
+ * @param response The message to write the packed elements to
+ * @return absl::Status
+ */
+absl::Status PsiServer::FillPackedResponse(
+    const psi_proto::Request& client_request, bool unlink,
+    psi_proto::Response* response) const {
+  if (!client_request.encrypted_elements().empty()) {
+    return absl::InvalidArgumentError(
+        "`client_request` mixes packed and repeated elements");
   }
+  const std::string& packed = client_request.packed_elements();
+  const int32_t width = client_request.element_width();
+  ASSIGN_OR_RETURN(int64_t num_client_elements,
+                   NumPackedElements(packed, width));
 
-  // sort the resulting ciphertexts if we want to hide the intersection from the
-  // client.
-  if (!reveal_intersection) {
-    // Get mutable reference to encrypted_elements array and sort it.
-    auto& elements = *(response.mutable_encrypted_elements());
-    std::sort(elements.begin(), elements.end());
+  // The batch cipher reads the elements in place and appends its results
+  // straight to the packed response.
+  std::vector<absl::string_view> views(num_client_elements);
+  for (int64_t i = 0; i < num_client_elements; i++) {
+    views[i] = PackedElement(packed, width, i);
   }
-  return response;
+  std::string* packed_response = response->mutable_packed_elements();
+  RETURN_IF_ERROR(cipher_->ReEncrypt(views, packed_response));
+  response->set_element_width(
+      num_client_elements == 0
+          ? width
+          : static_cast<int32_t>(cipher_->element_size()));
+
+  // Sort or shuffle the packed elements if we want to hide the intersection
+  // from the client.
+  if (unlink) {
+    return UnlinkPackedElements(response->element_width(), packed_response);
+  }
+  return absl::OkStatus();
+}
+
+/**
+ * @brief Sorts or shuffles the elements of a response
+ *
+ * @param elements The re-encrypted elements
+ * @return absl::Status
+ */
+absl::Status PsiServer::UnlinkElements(
+    google::protobuf::RepeatedPtrField<std::string>* elements) const {
+  if (response_unlinking_ == ResponseUnlinking::kShuffle) {
+    // Swapping elements of the field only swaps pointers.
+    return SecureShuffle(elements->size(), [elements](int64_t i, int64_t j) {
+      elements->SwapElements(static_cast<int>(i), static_cast<int>(j));
+    });
+  }
+  std::sort(elements->begin(), elements->end());
+  return absl::OkStatus();
+}
+
+/**
+ * @brief Sorts or shuffles the elements of a response
+ *
+ * @param elements The re-encrypted elements
+ * @return absl::Status
+ */
+absl::Status PsiServer::UnlinkElements(
+    std::vector<std::string>* elements) const {
+  if (response_unlinking_ == ResponseUnlinking::kShuffle) {
+    return SecureShuffle(static_cast<int64_t>(elements->size()),
+                         [elements](int64_t i, int64_t j) {
+                           (*elements)[i].swap((*elements)[j]);
+                         });
+  }
+  std::sort(elements->begin(), elements->end());
+  return absl::OkStatus();
+}
+
+/**
+ * @brief Sorts or shuffles the elements of a packed response
+ *
+ * @param width The width of each element in bytes
+ * @param packed The re-encrypted elements, back to back
+ * @return absl::Status
+ */
+absl::Status PsiServer::UnlinkPackedElements(int32_t width,
+                                             std::string* packed) const {
+  if (response_unlinking_ == ResponseUnlinking::kShuffle) {
+    return ShufflePackedElements(width, packed);
+  }
+  SortPackedElements(width, packed);
+  return absl::OkStatus();
+}
+
+/**
+ * @brief Selects how responses are unlinked from requests
+ *
+ * @param unlinking Whether to sort or shuffle responses
+ */
+void PsiServer::set_response_unlinking(ResponseUnlinking unlinking) {
+  response_unlinking_ = unlinking;
 }
 
 /**
@@ -195,9 +665,114 @@ StatusOr<psi_proto::Response> PsiServer::ProcessRequest(
  * @return The private key as a null-terminated binary string
  */
 std::string PsiServer::GetPrivateKeyBytes() const {
-  std::string key = ec_cipher_->GetPrivateKeyBytes();
-  key.insert(key.begin(), 32 - key.length(), '\0');
-  return key;
+  return cipher_->GetPrivateKeyBytes();
+}
+
+ResponseStream::ResponseStream(const PsiServer* server) : server_(server) {}
+
+/**
+ * @brief Re-encrypt the next chunk of a client request
+ *
+ * @param request_chunk The next chunk of the client request
+ * @return StatusOr<std::vector<psi_proto::Response>> The response chunks that
+ * are ready to be sent
+ */
+StatusOr<std::vector<psi_proto::Response>> ResponseStream::AddRequestChunk(
+    const psi_proto::Request& request_chunk) {
+  if (finished_) {
+    return absl::FailedPreconditionError("Response stream is finished");
+  }
+  const bool packed = request_chunk.element_width() != 0;
+  if (num_chunks_ > 0 && packed != packed_) {
+    return absl::InvalidArgumentError(
+        "Request chunks mix packed and repeated elements");
+  }
+
+  // Each chunk is re-encrypted as it arrives. Chunks are only unlinked in
+  // `Finish`, across the whole request.
+  psi_proto::Response response_chunk;
+  RETURN_IF_ERROR(
+      server_->FillResponse(request_chunk, /*unlink=*/false, &response_chunk));
+  packed_ = packed;
+  num_chunks_++;
+
+  std::vector<psi_proto::Response> ready;
+  if (server_->reveal_intersection) {
+    ready.push_back(std::move(response_chunk));
+    return ready;
+  }
+
+  // Hold back the re-encrypted elements, remembering the chunk's size.
+  if (packed) {
+    const int32_t width = response_chunk.element_width();
+    if (element_width_ != 0 && width != element_width_) {
+      return absl::InvalidArgumentError(
+          "Request chunks differ in element width");
+    }
+    element_width_ = width;
+    const std::string& elements = response_chunk.packed_elements();
+    chunk_sizes_.push_back(static_cast<int64_t>(elements.size()) / width);
+    packed_elements_.append(elements);
+  } else {
+    auto* elements = response_chunk.mutable_encrypted_elements();
+    chunk_sizes_.push_back(elements->size());
+    for (auto& element : *elements) {
+      elements_.push_back(std::move(element));
+    }
+  }
+  return ready;
+}
+
+/**
+ * @brief Finish the exchange after the last request chunk
+ *
+ * @return StatusOr<std::vector<psi_proto::Response>> The remaining response
+ * chunks
+ */
+StatusOr<std::vector<psi_proto::Response>> ResponseStream::Finish() {
+  if (finished_) {
+    return absl::FailedPreconditionError("Response stream is finished");
+  }
+  finished_ = true;
+
+  std::vector<psi_proto::Response> ready;
+  if (server_->reveal_intersection) {
+    return ready;
+  }
+
+  // Unlinking across all chunks gives the same guarantee as `ProcessRequest`:
+  // no response element can be linked to a request element, nor to the
+  // request chunk it came from. The elements are then split into chunks of the
+  // same sizes as the request chunks.
+  ready.reserve(chunk_sizes_.size());
+  int64_t offset = 0;
+  if (packed_) {
+    RETURN_IF_ERROR(
+        server_->UnlinkPackedElements(element_width_, &packed_elements_));
+    for (int64_t chunk_size : chunk_sizes_) {
+      psi_proto::Response response_chunk;
+      response_chunk.set_element_width(element_width_);
+      response_chunk.set_packed_elements(packed_elements_.substr(
+          offset * element_width_, chunk_size * element_width_));
+      offset += chunk_size;
+      ready.push_back(std::move(response_chunk));
+    }
+    packed_elements_.clear();
+  } else {
+    RETURN_IF_ERROR(server_->UnlinkElements(&elements_));
+    for (int64_t chunk_size : chunk_sizes_) {
+      psi_proto::Response response_chunk;
+      response_chunk.mutable_encrypted_elements()->Reserve(
+          static_cast<int>(chunk_size));
+      for (int64_t i = offset; i < offset + chunk_size; i++) {
+        response_chunk.add_encrypted_elements(std::move(elements_[i]));
+      }
+      offset += chunk_size;
+      ready.push_back(std::move(response_chunk));
+    }
+    elements_.clear();
+  }
+  return ready;
 }
 
 }  // namespace private_set_intersection
@@ -17,16 +17,32 @@
 #ifndef PRIVATE_SET_INTERSECTION_CPP_PSI_SERVER_H_
 #define PRIVATE_SET_INTERSECTION_CPP_PSI_SERVER_H_
 
+#include "absl/functional/function_ref.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
-#include "private_join_and_compute/crypto/ec_commutative_cipher.h"
+#include "google/protobuf/arena.h"
+#include "private_set_intersection/cpp/crypto/curve_cipher.h"
+#include "private_set_intersection/cpp/datastructure/chunked_setup.h"
 #include "private_set_intersection/cpp/datastructure/datastructure.h"
+#include "private_set_intersection/cpp/datastructure/server_setup_view.h"
 #include "private_set_intersection/proto/psi.pb.h"
 
 namespace private_set_intersection {
 
 using absl::StatusOr;
 
+class ResponseStream;
+
+// How a server with `reveal_intersection` == false hides which response
+// element belongs to which request element.
+enum class ResponseUnlinking {
+  // Sort the response, which costs O(n log n) comparisons of ciphertexts.
+  kSort,
+  // Shuffle the response uniformly at random with randomness from a
+  // cryptographically secure generator. This takes O(n) swaps.
+  kShuffle,
+};
+
 // The server side of a Private Set Intersection protocol. See the documentation
 // in PsiClient for a full description of the protocol.
 class PsiServer {
@@ -35,11 +51,25 @@ class PsiServer {
 
   // Creates and returns a new server instance with a fresh private key. If
   // `reveal_intersection` indicates whether the client should learn the
-  // intersection or only its size.
+  // intersection or only its size. `hash_to_curve` selects how inputs are
+  // mapped to the curve, `point_encoding` how encrypted elements are
+  // encoded, and `curve` the group they are encrypted in. All three are
+  // recorded in the setup, and the client must use the same ones.
+  // `POINT_ENCODING_X_ONLY` shrinks every element by one byte.
+  // `CURVE_RISTRETTO255` requires `HASH_TO_CURVE_RISTRETTO255_R255MAP` and
+  // `CURVE_SECP256K1` requires `HASH_TO_CURVE_TRY_AND_INCREMENT`, both with
+  // `POINT_ENCODING_COMPRESSED`.
   //
-  // Returns INTERNAL if any OpenSSL crypto operations fail.
+  // Returns INVALID_ARGUMENT if `hash_to_curve`, `point_encoding` or `curve`
+  // is unknown or they cannot be combined, or INTERNAL if any OpenSSL crypto
+  // operations fail.
   static StatusOr<std::unique_ptr<PsiServer>> CreateWithNewKey(
-      bool reveal_intersection);
+      bool reveal_intersection,
+      psi_proto::HashToCurve hash_to_curve =
+          psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+      psi_proto::PointEncoding point_encoding =
+          psi_proto::POINT_ENCODING_COMPRESSED,
+      psi_proto::Curve curve = psi_proto::CURVE_P256);
 
   // Creates and returns a new server instance with the provided private key. If
   // `reveal_intersection` indicates whether the client should learn the
@@ -50,9 +80,16 @@ class PsiServer {
   // requests can reveal information about the input sets. If in doubt, use
   // `CreateWithNewKey`.
   //
-  // Returns INTERNAL if any OpenSSL crypto operations fail.
+  // Returns INVALID_ARGUMENT if `hash_to_curve`, `point_encoding` or `curve`
+  // is unknown or they cannot be combined, or INTERNAL if any OpenSSL crypto
+  // operations fail.
   static StatusOr<std::unique_ptr<PsiServer>> CreateFromKey(
-      const std::string& key_bytes, bool reveal_intersection);
+      const std::string& key_bytes, bool reveal_intersection,
+      psi_proto::HashToCurve hash_to_curve =
+          psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+      psi_proto::PointEncoding point_encoding =
+          psi_proto::POINT_ENCODING_COMPRESSED,
+      psi_proto::Curve curve = psi_proto::CURVE_P256);
 
   // Creates a setup message from the server's dataset to be sent to the client.
   // The setup message is a set containing `H(x)^s` for each element `x` in
@@ -85,33 +122,187 @@ class PsiServer {
       absl::Span<const std::string> inputs,
       DataStructure ds = DataStructure::Gcs) const;
 
+  // As `CreateSetupMessage`, but allocates the setup message and all of its
+  // fields on `arena`, so that they are freed together when the arena is
+  // destroyed. The returned message is owned by `arena`.
+  //
+  // Returns INVALID_ARGUMENT if `arena` is null, or INTERNAL if encryption
+  // fails.
+  StatusOr<psi_proto::ServerSetup*> CreateSetupMessage(
+      google::protobuf::Arena* arena, double fpr, int64_t num_client_inputs,
+      absl::Span<const std::string> inputs,
+      DataStructure ds = DataStructure::Gcs) const;
+
+  // As `CreateSetupMessage`, but splits the setup into a manifest and
+  // independently serialized chunks whose payload is at most `max_chunk_size`
+  // bytes. This lifts the 2 GB size limit of a single message, and lets the
+  // client fetch chunks in parallel and resume interrupted transfers with a
+  // `ServerSetupAssembler`.
+  //
+  // Returns INVALID_ARGUMENT if `max_chunk_size` is not positive, or INTERNAL
+  // if encryption fails.
+  StatusOr<ChunkedServerSetup> CreateChunkedSetupMessage(
+      double fpr, int64_t num_client_inputs,
+      absl::Span<const std::string> inputs, int64_t max_chunk_size,
+      DataStructure ds = DataStructure::Gcs) const;
+
   // Processes a client query and returns the corresponding server response to
   // be sent to the client. For each encrytped element `H(x)^c` in the decoded
   // `client_request`, computes `(H(x)^c)^s = H(X)^(cs)` and returns these as an
   // array inside a protobuf.
   //
-  // If `reveal_intersection` == false, the resulting array is sorted, which
-  // prevents the client from matching the individual response elements to the
-  // ones in the request, ensuring that they can only learn the intersection
-  // size but not individual elements in the intersection.
+  // If `reveal_intersection` == false, the resulting array is sorted, or
+  // shuffled if selected with `set_response_unlinking`. This prevents the
+  // client from matching the individual response elements to the ones in the
+  // request, ensuring that they can only learn the intersection size but not
+  // individual elements in the intersection.
+  //
+  // If the request uses the packed encoding (`element_width` != 0), the
+  // response is packed as well. Otherwise, it uses `encrypted_elements`.
   //
-  // Returns INVALID_ARGUMENT if the request is malformed or if
-  // reveal_intersection != client_request["reveal_intersection"].
+  // Returns INVALID_ARGUMENT if the request is malformed, if
+  // reveal_intersection != client_request["reveal_intersection"], or if the
+  // client uses a different hash-to-curve method.
   StatusOr<psi_proto::Response> ProcessRequest(
       const psi_proto::Request& client_request) const;
 
+  // As `ProcessRequest`, but allocates the response and all re-encrypted
+  // elements on `arena`. Parsing the request on the same arena lets callers
+  // free a whole request/response round trip at once. The returned message is
+  // owned by `arena`.
+  //
+  // Returns INVALID_ARGUMENT if `arena` is null, the request is malformed,
+  // reveal_intersection != client_request["reveal_intersection"], or the
+  // client uses a different hash-to-curve method.
+  StatusOr<psi_proto::Response*> ProcessRequest(
+      google::protobuf::Arena* arena,
+      const psi_proto::Request& client_request) const;
+
+  // Starts processing a request that the client sends in chunks, e.g. one
+  // `CreateRequest` per slice of its inputs. Response chunks are produced as
+  // request chunks arrive, so neither side needs the whole request or
+  // response in memory, and the client can start decrypting early. See
+  // `ResponseStream` for the size-only mode. The server must outlive the
+  // returned stream.
+  std::unique_ptr<ResponseStream> CreateResponseStream() const;
+
+  // Sets the number of threads that encrypt the inputs of the setup methods. If
+  // positive, the calling thread builds the container from batches handed over
+  // by the encryption threads while they continue, so that setup takes about as
+  // long as encryption alone. The default of 0 encrypts and builds on the
+  // calling thread, one after the other, and never starts a thread.
+  void set_num_setup_threads(int num_threads);
+
+  // Selects how responses are unlinked from requests if
+  // `reveal_intersection` == false. Defaults to `ResponseUnlinking::kSort`.
+  void set_response_unlinking(ResponseUnlinking unlinking);
+
   // Returns this instance's private key. This key should only be used to create
   // other server instances. DO NOT SEND THIS KEY TO ANY OTHER PARTY!
   std::string GetPrivateKeyBytes() const;
 
  private:
-  explicit PsiServer(
-      std::unique_ptr<::private_join_and_compute::ECCommutativeCipher>
-          ec_cipher,
-      bool reveal_intersection);
+  PsiServer(std::unique_ptr<CurveCipher> cipher, bool reveal_intersection,
+            psi_proto::HashToCurve hash_to_curve,
+            psi_proto::PointEncoding point_encoding, psi_proto::Curve curve);
+
+  // Implements `CreateSetupMessage` by writing to `server_setup`.
+  absl::Status FillSetupMessage(double fpr, int64_t num_client_inputs,
+                                absl::Span<const std::string> inputs,
+                                DataStructure ds,
+                                psi_proto::ServerSetup* server_setup) const;
+
+  // Encrypts `inputs`, builds the container selected by `ds` and passes a view
+  // of it to `visit`.
+  absl::Status BuildSetup(
+      double fpr, int64_t num_client_inputs,
+      absl::Span<const std::string> inputs, DataStructure ds,
+      absl::FunctionRef<absl::Status(const ServerSetupView&)> visit) const;
+
+  // Encrypts `inputs` in batches and passes each batch to `consume` on the
+  // calling thread, in no particular order. Uses `num_setup_threads_`
+  // encryption threads if positive.
+  absl::Status EncryptInBatches(
+      absl::Span<const std::string> inputs,
+      absl::FunctionRef<void(std::vector<std::string> batch)> consume) const;
+
+  // Implements `ProcessRequest` by writing to `response`.
+  // The re-encrypted elements are unlinked from the request if `unlink` is
+  // true.
+  absl::Status FillResponse(const psi_proto::Request& client_request,
+                            bool unlink, psi_proto::Response* response) const;
+
+  // Implements `FillResponse` for requests in the packed encoding.
+  absl::Status FillPackedResponse(const psi_proto::Request& client_request,
+                                  bool unlink,
+                                  psi_proto::Response* response) const;
+
+  // Sorts or shuffles `elements` according to `response_unlinking_`.
+  absl::Status UnlinkElements(
+      google::protobuf::RepeatedPtrField<std::string>* elements) const;
+  absl::Status UnlinkElements(std::vector<std::string>* elements) const;
+  absl::Status UnlinkPackedElements(int32_t width, std::string* packed) const;
 
-  std::unique_ptr<::private_join_and_compute::ECCommutativeCipher> ec_cipher_;
+  friend class ResponseStream;
+
+  std::unique_ptr<CurveCipher> cipher_;
   bool reveal_intersection;
+  psi_proto::HashToCurve hash_to_curve_;
+  psi_proto::PointEncoding point_encoding_;
+  psi_proto::Curve curve_;
+  int num_setup_threads_ = 0;
+  ResponseUnlinking response_unlinking_ = ResponseUnlinking::kSort;
+};
+
+// Server side of a chunked request/response exchange, created by
+// `PsiServer::CreateResponseStream`. Request chunks must be added in the order
+// the client created them, followed by a call to `Finish`.
+//
+// If `reveal_intersection` == true, each request chunk is answered
+// immediately by one response chunk in the same order, so the client can
+// match the concatenated response to its inputs.
+//
+// If `reveal_intersection` == false, chunks are still re-encrypted as they
+// arrive, but their elements are held back until `Finish`. They are then
+// sorted or shuffled across all chunks, exactly as `ProcessRequest` unlinks a
+// whole response, and emitted as chunks of the same sizes as the request
+// chunks. Unlinking per chunk instead would let the client link each response
+// element to the request chunk it came from, which for small chunks reveals
+// the intersection.
+class ResponseStream {
+ public:
+  ResponseStream(const ResponseStream&) = delete;
+  ResponseStream& operator=(const ResponseStream&) = delete;
+
+  // Re-encrypts the next request chunk and returns the response chunks that
+  // are ready to be sent, if any.
+  //
+  // Returns INVALID_ARGUMENT if the chunk is malformed or does not match the
+  // encoding of earlier chunks, or FAILED_PRECONDITION after `Finish`.
+  StatusOr<std::vector<psi_proto::Response>> AddRequestChunk(
+      const psi_proto::Request& request_chunk);
+
+  // Marks the end of the request and returns the remaining response chunks.
+  //
+  // Returns FAILED_PRECONDITION if called twice.
+  StatusOr<std::vector<psi_proto::Response>> Finish();
+
+ private:
+  friend class PsiServer;
+
+  explicit ResponseStream(const PsiServer* server);
+
+  const PsiServer* server_;
+  bool finished_ = false;
+  int64_t num_chunks_ = 0;
+  bool packed_ = false;
+
+  // Held back elements and request chunk sizes, if `reveal_intersection` ==
+  // false.
+  std::vector<int64_t> chunk_sizes_;
+  std::vector<std::string> elements_;
+  std::string packed_elements_;
+  int32_t element_width_ = 0;
 };
 
 }  // namespace private_set_intersection
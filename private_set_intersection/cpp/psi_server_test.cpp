@@ -17,6 +17,8 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
@@ -166,6 +168,704 @@ TEST_F(PsiServerTest, TestArrayIsSortedWhenNotRevealingIntersection) {
   EXPECT_TRUE(std::is_sorted(response_array.begin(), response_array.end()));
 }
 
+TEST_F(PsiServerTest, TestPackedRequestAndResponse) {
+  SetUp(true);
+  PSI_ASSERT_OK_AND_ASSIGN(auto client, PsiClient::CreateWithNewKey(true));
+  int num_client_elements = 1000, num_server_elements = 10000;
+  double fpr = 0.0001;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto server_setup,
+      server_->CreateSetupMessage(fpr, num_client_elements, server_elements));
+  PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                           client->CreateRequest(client_elements, true));
+  EXPECT_TRUE(client_request.encrypted_elements().empty());
+  EXPECT_EQ(client_request.packed_elements().size(),
+            num_client_elements * client_request.element_width());
+
+  // The server answers a packed request with a packed response.
+  PSI_ASSERT_OK_AND_ASSIGN(auto server_response,
+                           server_->ProcessRequest(client_request));
+  EXPECT_TRUE(server_response.encrypted_elements().empty());
+  EXPECT_EQ(server_response.packed_elements().size(),
+            num_client_elements * server_response.element_width());
+
+  PSI_ASSERT_OK_AND_ASSIGN(
+      std::vector<int64_t> intersection,
+      client->GetIntersection(server_setup, server_response));
+  absl::flat_hash_set<int64_t> intersection_set(intersection.begin(),
+                                                intersection.end());
+  for (int i = 0; i < num_client_elements; i++) {
+    EXPECT_EQ(intersection_set.contains(i), i % 2 == 0);
+  }
+}
+
+TEST_F(PsiServerTest, TestPackedArrayIsSortedWhenNotRevealingIntersection) {
+  SetUp(false);
+  PSI_ASSERT_OK_AND_ASSIGN(auto client, PsiClient::CreateWithNewKey(false));
+  int num_client_elements = 1000;
+  std::vector<std::string> client_elements(num_client_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                           client->CreateRequest(client_elements, true));
+  PSI_ASSERT_OK_AND_ASSIGN(auto server_response,
+                           server_->ProcessRequest(client_request));
+
+  const std::string& packed = server_response.packed_elements();
+  const int width = server_response.element_width();
+  ASSERT_GT(width, 0);
+  std::vector<std::string> response_array;
+  for (size_t i = 0; i < packed.size(); i += width) {
+    response_array.push_back(packed.substr(i, width));
+  }
+  EXPECT_EQ(response_array.size(), num_client_elements);
+  EXPECT_TRUE(std::is_sorted(response_array.begin(), response_array.end()));
+}
+
+TEST_F(PsiServerTest, TestShuffledResponseMatchesSortedResponse) {
+  SetUp(false);
+  PSI_ASSERT_OK_AND_ASSIGN(auto client, PsiClient::CreateWithNewKey(false));
+  int num_client_elements = 1000;
+  std::vector<std::string> client_elements(num_client_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+
+  for (bool packed : {false, true}) {
+    PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                             client->CreateRequest(client_elements, packed));
+    server_->set_response_unlinking(ResponseUnlinking::kSort);
+    PSI_ASSERT_OK_AND_ASSIGN(auto sorted,
+                             server_->ProcessRequest(client_request));
+    server_->set_response_unlinking(ResponseUnlinking::kShuffle);
+    PSI_ASSERT_OK_AND_ASSIGN(auto shuffled,
+                             server_->ProcessRequest(client_request));
+
+    // The shuffled response holds the same elements in a different order.
+    std::vector<std::string> sorted_array, shuffled_array;
+    if (packed) {
+      const int width = shuffled.element_width();
+      ASSERT_EQ(width, sorted.element_width());
+      for (size_t i = 0; i < shuffled.packed_elements().size(); i += width) {
+        sorted_array.push_back(sorted.packed_elements().substr(i, width));
+        shuffled_array.push_back(shuffled.packed_elements().substr(i, width));
+      }
+    } else {
+      sorted_array.assign(sorted.encrypted_elements().begin(),
+                          sorted.encrypted_elements().end());
+      shuffled_array.assign(shuffled.encrypted_elements().begin(),
+                            shuffled.encrypted_elements().end());
+    }
+    EXPECT_EQ(shuffled_array.size(), num_client_elements);
+    EXPECT_FALSE(std::is_sorted(shuffled_array.begin(), shuffled_array.end()));
+    std::sort(shuffled_array.begin(), shuffled_array.end());
+    EXPECT_EQ(shuffled_array, sorted_array);
+  }
+}
+
+TEST_F(PsiServerTest, FailIfPackedRequestIsMalformed) {
+  SetUp(false);
+  psi_proto::Request client_request;
+  client_request.set_reveal_intersection(false);
+  client_request.set_element_width(33);
+  client_request.set_packed_elements(std::string(40, 'a'));
+  EXPECT_THAT(server_->ProcessRequest(client_request),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Packed elements of length 40 are not a multiple of "
+                       "`element_width` = 33"));
+
+  client_request.set_element_width(-1);
+  EXPECT_THAT(server_->ProcessRequest(client_request),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`element_width` must be positive"));
+}
+
+TEST_F(PsiServerTest, TestArenaOverloads) {
+  SetUp(true);
+  PSI_ASSERT_OK_AND_ASSIGN(auto client, PsiClient::CreateWithNewKey(true));
+  int num_client_elements = 100, num_server_elements = 1000;
+  double fpr = 0.0001;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+
+  // All messages of the round trip are owned by the arena.
+  google::protobuf::Arena arena;
+  PSI_ASSERT_OK_AND_ASSIGN(
+      psi_proto::ServerSetup * server_setup,
+      server_->CreateSetupMessage(&arena, fpr, num_client_elements,
+                                  server_elements, DataStructure::Raw));
+  PSI_ASSERT_OK_AND_ASSIGN(psi_proto::Request * client_request,
+                           client->CreateRequest(&arena, client_elements));
+  PSI_ASSERT_OK_AND_ASSIGN(psi_proto::Response * server_response,
+                           server_->ProcessRequest(&arena, *client_request));
+
+  PSI_ASSERT_OK_AND_ASSIGN(
+      std::vector<int64_t> intersection,
+      client->GetIntersection(*server_setup, *server_response));
+  EXPECT_EQ(intersection.size(), num_client_elements / 2);
+
+  EXPECT_THAT(server_->ProcessRequest(nullptr, *client_request),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`arena` must not be null"));
+}
+
+TEST_F(PsiServerTest, TestChunkedSetup) {
+  SetUp(true);
+  PSI_ASSERT_OK_AND_ASSIGN(auto client, PsiClient::CreateWithNewKey(true));
+  int num_client_elements = 100, num_server_elements = 1000;
+  double fpr = 0.0001;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+
+  for (auto ds : {DataStructure::Raw, DataStructure::Gcs,
+                  DataStructure::BloomFilter}) {
+    PSI_ASSERT_OK_AND_ASSIGN(
+        ChunkedServerSetup chunked,
+        server_->CreateChunkedSetupMessage(fpr, num_client_elements,
+                                           server_elements, 1024, ds));
+    EXPECT_GT(chunked.chunks.size(), 1);
+
+    PSI_ASSERT_OK_AND_ASSIGN(auto assembler,
+                             ServerSetupAssembler::Create(chunked.manifest));
+    for (size_t i = 0; i < chunked.chunks.size(); i++) {
+      ASSERT_TRUE(
+          assembler->AddChunk(static_cast<int>(i), chunked.chunks[i]).ok());
+    }
+    PSI_ASSERT_OK_AND_ASSIGN(auto setup, assembler->GetView());
+
+    PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                             client->CreateRequest(client_elements));
+    PSI_ASSERT_OK_AND_ASSIGN(auto server_response,
+                             server_->ProcessRequest(client_request));
+    PSI_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> intersection,
+                             client->GetIntersection(setup, server_response));
+    EXPECT_GE(intersection.size(), num_client_elements / 2);
+    EXPECT_LE(intersection.size(), num_client_elements / 2 + 2);
+  }
+
+  EXPECT_THAT(server_->CreateChunkedSetupMessage(fpr, num_client_elements,
+                                                 server_elements, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(PsiServerTest, TestStreamingGcsIntersection) {
+  SetUp(true);
+  PSI_ASSERT_OK_AND_ASSIGN(auto client, PsiClient::CreateWithNewKey(true));
+  int num_client_elements = 100, num_server_elements = 1000;
+  double fpr = 0.0001;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+
+  PSI_ASSERT_OK_AND_ASSIGN(
+      ChunkedServerSetup chunked,
+      server_->CreateChunkedSetupMessage(fpr, num_client_elements,
+                                         server_elements, 64));
+  PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                           client->CreateRequest(client_elements));
+  PSI_ASSERT_OK_AND_ASSIGN(auto server_response,
+                           server_->ProcessRequest(client_request));
+
+  // Decode each chunk as it "arrives", before the setup is complete.
+  PSI_ASSERT_OK_AND_ASSIGN(auto intersector,
+                           client->CreateStreamingIntersector(
+                               chunked.manifest.parameters(), server_response));
+  std::vector<int64_t> intersection;
+  for (const std::string& serialized_chunk : chunked.chunks) {
+    psi_proto::ServerSetupChunk chunk;
+    ASSERT_TRUE(chunk.ParseFromString(serialized_chunk));
+    std::vector<int64_t> matches = intersector->Push(chunk.bits());
+    intersection.insert(intersection.end(), matches.begin(), matches.end());
+  }
+  EXPECT_GE(intersection.size(), num_client_elements / 2);
+  EXPECT_LE(intersection.size(), num_client_elements / 2 + 2);
+
+  psi_proto::ServerSetup bloom_filter;
+  bloom_filter.mutable_bloom_filter();
+  EXPECT_THAT(
+      client->CreateStreamingIntersector(bloom_filter, server_response),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(PsiServerTest, TestChunkedRequestAndResponse) {
+  int num_client_elements = 100, num_server_elements = 1000, chunk_size = 30;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+
+  for (bool reveal_intersection : {false, true}) {
+    for (bool packed : {false, true}) {
+      SetUp(reveal_intersection);
+      PSI_ASSERT_OK_AND_ASSIGN(
+          auto client, PsiClient::CreateWithNewKey(reveal_intersection));
+      PSI_ASSERT_OK_AND_ASSIGN(
+          auto setup, server_->CreateSetupMessage(0.0001, num_client_elements,
+                                                  server_elements));
+      PSI_ASSERT_OK_AND_ASSIGN(auto prepared,
+                               PreparedServerSetup::Create(setup));
+
+      auto stream = server_->CreateResponseStream();
+      auto reader = client->CreateResponseReader(*prepared);
+      std::vector<int64_t> response_chunk_sizes;
+      auto add_response_chunks =
+          [&](const std::vector<psi_proto::Response>& chunks) {
+            for (const auto& chunk : chunks) {
+              ASSERT_TRUE(reader->AddChunk(chunk).ok());
+              response_chunk_sizes.push_back(
+                  packed ? chunk.packed_elements().size() /
+                               chunk.element_width()
+                         : chunk.encrypted_elements_size());
+            }
+          };
+      std::vector<int64_t> request_chunk_sizes;
+      for (int i = 0; i < num_client_elements; i += chunk_size) {
+        auto inputs = absl::MakeConstSpan(client_elements)
+                          .subspan(i, chunk_size);
+        request_chunk_sizes.push_back(inputs.size());
+        PSI_ASSERT_OK_AND_ASSIGN(auto request_chunk,
+                                 client->CreateRequest(inputs, packed));
+        PSI_ASSERT_OK_AND_ASSIGN(auto response_chunks,
+                                 stream->AddRequestChunk(request_chunk));
+        // Size-only responses are held back until the request is complete.
+        EXPECT_EQ(response_chunks.size(), reveal_intersection ? 1 : 0);
+        add_response_chunks(response_chunks);
+      }
+      PSI_ASSERT_OK_AND_ASSIGN(auto response_chunks, stream->Finish());
+      add_response_chunks(response_chunks);
+      EXPECT_EQ(response_chunk_sizes, request_chunk_sizes);
+
+      EXPECT_GE(reader->GetIntersectionSize(), num_client_elements / 2);
+      EXPECT_LE(reader->GetIntersectionSize(), num_client_elements / 2 + 2);
+      if (reveal_intersection) {
+        PSI_ASSERT_OK_AND_ASSIGN(auto intersection,
+                                 reader->GetIntersection());
+        for (int64_t i = 0; i < num_client_elements; i += 2) {
+          EXPECT_TRUE(std::binary_search(intersection.begin(),
+                                         intersection.end(), i));
+        }
+      } else {
+        EXPECT_THAT(reader->GetIntersection(),
+                    StatusIs(absl::StatusCode::kInvalidArgument));
+      }
+
+      psi_proto::Request request_chunk;
+      EXPECT_THAT(stream->AddRequestChunk(request_chunk),
+                  StatusIs(absl::StatusCode::kFailedPrecondition));
+      EXPECT_THAT(stream->Finish(),
+                  StatusIs(absl::StatusCode::kFailedPrecondition));
+    }
+  }
+}
+
+TEST_F(PsiServerTest, TestResponseReaderDropsFailedChunk) {
+  SetUp(true);
+  PSI_ASSERT_OK_AND_ASSIGN(auto client, PsiClient::CreateWithNewKey(true));
+  // Spans two decryption batches.
+  int num_client_elements = 2000, num_server_elements = 1000;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto setup, server_->CreateSetupMessage(0.0001, num_client_elements,
+                                              server_elements));
+  PSI_ASSERT_OK_AND_ASSIGN(auto prepared, PreparedServerSetup::Create(setup));
+
+  auto stream = server_->CreateResponseStream();
+  PSI_ASSERT_OK_AND_ASSIGN(auto request_chunk,
+                           client->CreateRequest(client_elements, true));
+  PSI_ASSERT_OK_AND_ASSIGN(auto response_chunks,
+                           stream->AddRequestChunk(request_chunk));
+  ASSERT_EQ(response_chunks.size(), 1);
+  const psi_proto::Response& response_chunk = response_chunks[0];
+
+  // An invalid point in the second batch of 1024 elements fails the chunk
+  // after the first batch has been intersected.
+  psi_proto::Response corrupt_chunk = response_chunk;
+  std::string* packed = corrupt_chunk.mutable_packed_elements();
+  (*packed)[1500 * corrupt_chunk.element_width()] = '\xff';
+
+  auto reader = client->CreateResponseReader(*prepared);
+  EXPECT_THAT(reader->AddChunk(corrupt_chunk),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(reader->GetIntersectionSize(), 0);
+  ASSERT_TRUE(reader->AddChunk(response_chunk).ok());
+
+  auto expected_reader = client->CreateResponseReader(*prepared);
+  ASSERT_TRUE(expected_reader->AddChunk(response_chunk).ok());
+  PSI_ASSERT_OK_AND_ASSIGN(auto expected, expected_reader->GetIntersection());
+  EXPECT_GE(expected.size(), num_client_elements / 2);
+  PSI_ASSERT_OK_AND_ASSIGN(auto intersection, reader->GetIntersection());
+  EXPECT_EQ(intersection, expected);
+}
+
+TEST_F(PsiServerTest, TestSizeOnlyStreamIsSortedAcrossChunks) {
+  SetUp(false);
+  PSI_ASSERT_OK_AND_ASSIGN(auto client, PsiClient::CreateWithNewKey(false));
+  std::vector<std::string> elements = {"a", "b", "c", "d", "e", "f", "g"};
+
+  auto stream = server_->CreateResponseStream();
+  for (int i = 0; i < elements.size(); i += 3) {
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto request_chunk,
+        client->CreateRequest(absl::MakeConstSpan(elements).subspan(i, 3)));
+    ASSERT_TRUE(stream->AddRequestChunk(request_chunk).ok());
+  }
+  PSI_ASSERT_OK_AND_ASSIGN(auto response_chunks, stream->Finish());
+  std::vector<std::string> response;
+  for (const auto& chunk : response_chunks) {
+    response.insert(response.end(), chunk.encrypted_elements().begin(),
+                    chunk.encrypted_elements().end());
+  }
+  EXPECT_EQ(response.size(), elements.size());
+  EXPECT_TRUE(std::is_sorted(response.begin(), response.end()));
+
+  // Mixing encodings is rejected.
+  auto mixed = server_->CreateResponseStream();
+  PSI_ASSERT_OK_AND_ASSIGN(auto repeated, client->CreateRequest(elements));
+  PSI_ASSERT_OK_AND_ASSIGN(auto packed,
+                           client->CreateRequest(elements, /*packed=*/true));
+  ASSERT_TRUE(mixed->AddRequestChunk(repeated).ok());
+  EXPECT_THAT(mixed->AddRequestChunk(packed),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(PsiServerTest, TestThreadedSetupMatchesSequentialSetup) {
+  SetUp(true);
+  int num_client_elements = 100, num_server_elements = 5000;
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", i);
+  }
+
+  for (auto ds : {DataStructure::Raw, DataStructure::Gcs,
+                  DataStructure::BloomFilter}) {
+    server_->set_num_setup_threads(0);
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto sequential, server_->CreateSetupMessage(
+                             0.001, num_client_elements, server_elements, ds));
+    for (int num_threads : {1, 3}) {
+      server_->set_num_setup_threads(num_threads);
+      PSI_ASSERT_OK_AND_ASSIGN(
+          auto threaded,
+          server_->CreateSetupMessage(0.001, num_client_elements,
+                                      server_elements, ds));
+      EXPECT_EQ(threaded.SerializeAsString(), sequential.SerializeAsString());
+    }
+  }
+
+  server_->set_num_setup_threads(2);
+  EXPECT_THAT(server_->CreateSetupMessage(0, num_client_elements,
+                                          server_elements),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(PsiServerTest, TestSswuHashToCurve) {
+  PSI_ASSERT_OK_AND_ASSIGN(
+      server_, PsiServer::CreateWithNewKey(
+                   true, psi_proto::HASH_TO_CURVE_P256_SSWU));
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto client, PsiClient::CreateWithNewKey(
+                       true, psi_proto::HASH_TO_CURVE_P256_SSWU));
+  int num_client_elements = 100, num_server_elements = 1000;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+  std::vector<int64_t> expected;
+  for (int i = 0; i < num_client_elements; i += 2) {
+    expected.push_back(i);
+  }
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                           client->CreateRequest(client_elements));
+  EXPECT_EQ(client_request.hash_to_curve(),
+            psi_proto::HASH_TO_CURVE_P256_SSWU);
+  PSI_ASSERT_OK_AND_ASSIGN(auto server_response,
+                           server_->ProcessRequest(client_request));
+  for (auto ds : {DataStructure::Raw, DataStructure::Gcs,
+                  DataStructure::BloomFilter}) {
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto server_setup,
+        server_->CreateSetupMessage(0.000001, num_client_elements,
+                                    server_elements, ds));
+    EXPECT_EQ(server_setup.hash_to_curve(),
+              psi_proto::HASH_TO_CURVE_P256_SSWU);
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto intersection,
+        client->GetIntersection(server_setup, server_response));
+    std::sort(intersection.begin(), intersection.end());
+    EXPECT_EQ(intersection, expected);
+  }
+}
+
+TEST_F(PsiServerTest, FailIfHashToCurveDoesntMatch) {
+  SetUp(true);
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto client, PsiClient::CreateWithNewKey(
+                       true, psi_proto::HASH_TO_CURVE_P256_SSWU));
+  std::vector<std::string> elements = {"a", "b"};
+  PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                           client->CreateRequest(elements));
+  EXPECT_THAT(server_->ProcessRequest(client_request),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Client uses hash-to-curve method 1, but the server "
+                       "uses 0"));
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto server_setup,
+                           server_->CreateSetupMessage(0.001, 2, elements));
+  client_request.set_hash_to_curve(psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT);
+  PSI_ASSERT_OK_AND_ASSIGN(auto server_response,
+                           server_->ProcessRequest(client_request));
+  EXPECT_THAT(client->GetIntersection(server_setup, server_response),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Server uses hash-to-curve method 0, but the client "
+                       "uses 1"));
+
+  EXPECT_THAT(PsiServer::CreateWithNewKey(
+                  true, static_cast<psi_proto::HashToCurve>(7)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Unsupported hash-to-curve method 7"));
+}
+
+TEST_F(PsiServerTest, TestXOnlyPointEncoding) {
+  int num_client_elements = 100, num_server_elements = 1000;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+  std::vector<int64_t> expected;
+  for (int i = 0; i < num_client_elements; i += 2) {
+    expected.push_back(i);
+  }
+
+  for (auto hash_to_curve : {psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                             psi_proto::HASH_TO_CURVE_P256_SSWU}) {
+    PSI_ASSERT_OK_AND_ASSIGN(
+        server_, PsiServer::CreateWithNewKey(true, hash_to_curve,
+                                             psi_proto::POINT_ENCODING_X_ONLY));
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto client,
+        PsiClient::CreateWithNewKey(true, hash_to_curve,
+                                    psi_proto::POINT_ENCODING_X_ONLY));
+    for (bool packed : {false, true}) {
+      PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                               client->CreateRequest(client_elements, packed));
+      EXPECT_EQ(client_request.point_encoding(),
+                psi_proto::POINT_ENCODING_X_ONLY);
+      if (packed) {
+        EXPECT_EQ(client_request.element_width(), 32);
+      } else {
+        EXPECT_EQ(client_request.encrypted_elements(0).size(), 32);
+      }
+      PSI_ASSERT_OK_AND_ASSIGN(auto server_response,
+                               server_->ProcessRequest(client_request));
+      for (auto ds : {DataStructure::Raw, DataStructure::Gcs,
+                      DataStructure::BloomFilter}) {
+        PSI_ASSERT_OK_AND_ASSIGN(
+            auto server_setup,
+            server_->CreateSetupMessage(0.000001, num_client_elements,
+                                        server_elements, ds));
+        EXPECT_EQ(server_setup.point_encoding(),
+                  psi_proto::POINT_ENCODING_X_ONLY);
+        PSI_ASSERT_OK_AND_ASSIGN(
+            auto intersection,
+            client->GetIntersection(server_setup, server_response));
+        std::sort(intersection.begin(), intersection.end());
+        EXPECT_EQ(intersection, expected);
+      }
+    }
+  }
+}
+
+TEST_F(PsiServerTest, FailIfPointEncodingDoesntMatch) {
+  SetUp(true);
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto client,
+      PsiClient::CreateWithNewKey(true,
+                                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                                  psi_proto::POINT_ENCODING_X_ONLY));
+  std::vector<std::string> elements = {"a", "b"};
+  PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                           client->CreateRequest(elements));
+  EXPECT_THAT(server_->ProcessRequest(client_request),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Client uses point encoding 1, but the server uses 0"));
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto server_setup,
+                           server_->CreateSetupMessage(0.001, 2, elements));
+  EXPECT_THAT(client->GetIntersection(server_setup, psi_proto::Response()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Server uses point encoding 0, but the client uses 1"));
+
+  EXPECT_THAT(
+      PsiClient::CreateWithNewKey(true,
+                                  psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                                  static_cast<psi_proto::PointEncoding>(7)),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "Unsupported point encoding 7"));
+}
+
+TEST_F(PsiServerTest, TestOtherCurves) {
+  int num_client_elements = 100, num_server_elements = 1000;
+  std::vector<std::string> client_elements(num_client_elements);
+  std::vector<std::string> server_elements(num_server_elements);
+  for (int i = 0; i < num_client_elements; i++) {
+    client_elements[i] = absl::StrCat("Element ", i);
+  }
+  for (int i = 0; i < num_server_elements; i++) {
+    server_elements[i] = absl::StrCat("Element ", 2 * i);
+  }
+  std::vector<int64_t> expected;
+  for (int i = 0; i < num_client_elements; i += 2) {
+    expected.push_back(i);
+  }
+
+  struct CurveSettings {
+    psi_proto::Curve curve;
+    psi_proto::HashToCurve hash_to_curve;
+    int element_size;
+  };
+  for (const CurveSettings& settings :
+       {CurveSettings{psi_proto::CURVE_RISTRETTO255,
+                      psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP, 32},
+        CurveSettings{psi_proto::CURVE_SECP256K1,
+                      psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT, 33}}) {
+    PSI_ASSERT_OK_AND_ASSIGN(
+        server_, PsiServer::CreateWithNewKey(
+                     true, settings.hash_to_curve,
+                     psi_proto::POINT_ENCODING_COMPRESSED, settings.curve));
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto client, PsiClient::CreateWithNewKey(
+                         true, settings.hash_to_curve,
+                         psi_proto::POINT_ENCODING_COMPRESSED, settings.curve));
+    for (bool packed : {false, true}) {
+      PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                               client->CreateRequest(client_elements, packed));
+      EXPECT_EQ(client_request.curve(), settings.curve);
+      if (packed) {
+        EXPECT_EQ(client_request.element_width(), settings.element_size);
+      } else {
+        EXPECT_EQ(client_request.encrypted_elements(0).size(),
+                  settings.element_size);
+      }
+      PSI_ASSERT_OK_AND_ASSIGN(auto server_response,
+                               server_->ProcessRequest(client_request));
+      for (auto ds : {DataStructure::Raw, DataStructure::Gcs,
+                      DataStructure::BloomFilter}) {
+        PSI_ASSERT_OK_AND_ASSIGN(
+            auto server_setup,
+            server_->CreateSetupMessage(0.000001, num_client_elements,
+                                        server_elements, ds));
+        EXPECT_EQ(server_setup.curve(), settings.curve);
+        PSI_ASSERT_OK_AND_ASSIGN(
+            auto intersection,
+            client->GetIntersection(server_setup, server_response));
+        std::sort(intersection.begin(), intersection.end());
+        EXPECT_EQ(intersection, expected) << settings.curve;
+      }
+    }
+
+    // The key survives a round trip like a P-256 key.
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto restored,
+        PsiServer::CreateFromKey(server_->GetPrivateKeyBytes(), true,
+                                 settings.hash_to_curve,
+                                 psi_proto::POINT_ENCODING_COMPRESSED,
+                                 settings.curve));
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto setup, server_->CreateSetupMessage(0.001, num_client_elements,
+                                                server_elements,
+                                                DataStructure::Raw));
+    PSI_ASSERT_OK_AND_ASSIGN(
+        auto restored_setup,
+        restored->CreateSetupMessage(0.001, num_client_elements,
+                                     server_elements, DataStructure::Raw));
+    EXPECT_EQ(setup.SerializeAsString(), restored_setup.SerializeAsString());
+  }
+}
+
+TEST_F(PsiServerTest, FailIfCurveDoesntMatch) {
+  SetUp(true);
+  PSI_ASSERT_OK_AND_ASSIGN(
+      auto client, PsiClient::CreateWithNewKey(
+                       true, psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP,
+                       psi_proto::POINT_ENCODING_COMPRESSED,
+                       psi_proto::CURVE_RISTRETTO255));
+  std::vector<std::string> elements = {"a", "b"};
+  PSI_ASSERT_OK_AND_ASSIGN(auto client_request,
+                           client->CreateRequest(elements));
+  EXPECT_THAT(server_->ProcessRequest(client_request),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Client uses curve 1, but the server uses 0"));
+
+  PSI_ASSERT_OK_AND_ASSIGN(auto server_setup,
+                           server_->CreateSetupMessage(0.001, 2, elements));
+  EXPECT_THAT(client->GetIntersection(server_setup, psi_proto::Response()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Server uses curve 0, but the client uses 1"));
+
+  // Each curve only supports its own hash-to-curve methods.
+  EXPECT_THAT(PsiServer::CreateWithNewKey(
+                  true, psi_proto::HASH_TO_CURVE_P256_SSWU,
+                  psi_proto::POINT_ENCODING_COMPRESSED,
+                  psi_proto::CURVE_RISTRETTO255),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(PsiClient::CreateWithNewKey(
+                  true, psi_proto::HASH_TO_CURVE_RISTRETTO255_R255MAP),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(PsiServer::CreateWithNewKey(
+                  true, psi_proto::HASH_TO_CURVE_TRY_AND_INCREMENT,
+                  psi_proto::POINT_ENCODING_COMPRESSED,
+                  static_cast<psi_proto::Curve>(7)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Unsupported curve 7"));
+}
+
 TEST_F(PsiServerTest, TestCreatingFromKey) {
   SetUp(false);
   // Get the original private key
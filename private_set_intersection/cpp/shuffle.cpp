@@ -0,0 +1,92 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/shuffle.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "openssl/rand.h"
+
+namespace private_set_intersection {
+
+namespace {
+
+// Number of random words fetched from the generator at a time.
+constexpr int kRandomBufferSize = 512;
+
+// Hands out uniformly random integers below a bound, drawing the randomness in
+// batches to amortize the cost of calling into the generator.
+class SecureRandomIndices {
+ public:
+  // Returns a uniformly random integer in [0, bound), for `bound` > 0.
+  absl::Status Next(uint64_t bound, uint64_t* value) {
+    // Reject the words below 2^64 mod `bound`, so that the accepted range is a
+    // multiple of `bound` and the reduction below is unbiased.
+    const uint64_t threshold = (0 - bound) % bound;
+    uint64_t word;
+    do {
+      if (next_ == kRandomBufferSize) {
+        if (RAND_bytes(reinterpret_cast<uint8_t*>(buffer_),
+                       sizeof(buffer_)) != 1) {
+          return absl::InternalError("Failed to generate random bytes");
+        }
+        next_ = 0;
+      }
+      word = buffer_[next_++];
+    } while (word < threshold);
+    *value = word % bound;
+    return absl::OkStatus();
+  }
+
+ private:
+  uint64_t buffer_[kRandomBufferSize];
+  int next_ = kRandomBufferSize;
+};
+
+}  // namespace
+
+absl::Status SecureShuffle(int64_t num_elements,
+                           absl::FunctionRef<void(int64_t, int64_t)> swap) {
+  SecureRandomIndices indices;
+  for (int64_t i = num_elements - 1; i > 0; i--) {
+    uint64_t j = 0;
+    absl::Status status = indices.Next(static_cast<uint64_t>(i) + 1, &j);
+    if (!status.ok()) {
+      return status;
+    }
+    if (static_cast<int64_t>(j) != i) {
+      swap(i, static_cast<int64_t>(j));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ShufflePackedElements(int32_t width, std::string* packed) {
+  const int64_t num_elements = static_cast<int64_t>(packed->size() / width);
+  char* data = &(*packed)[0];
+  std::vector<char> tmp(width);
+  return SecureShuffle(num_elements, [data, width, &tmp](int64_t i, int64_t j) {
+    char* a = data + i * width;
+    char* b = data + j * width;
+    std::memcpy(tmp.data(), a, width);
+    std::memcpy(a, b, width);
+    std::memcpy(b, tmp.data(), width);
+  });
+}
+
+}  // namespace private_set_intersection
@@ -0,0 +1,44 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PRIVATE_SET_INTERSECTION_CPP_SHUFFLE_H_
+#define PRIVATE_SET_INTERSECTION_CPP_SHUFFLE_H_
+
+#include <string>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+
+namespace private_set_intersection {
+
+// Permutes `num_elements` elements uniformly at random with the Fisher-Yates
+// algorithm, calling `swap(i, j)` for every exchange. The randomness is drawn
+// from the cryptographically secure generator of the crypto library, so the
+// permutation can be used to hide the order of elements from the peer.
+//
+// Returns INTERNAL if the generator fails.
+absl::Status SecureShuffle(int64_t num_elements,
+                           absl::FunctionRef<void(int64_t, int64_t)> swap);
+
+// Shuffles the `width`-byte elements in `packed` in place, see
+// `SecureShuffle`.
+//
+// Returns INTERNAL if the generator fails.
+absl::Status ShufflePackedElements(int32_t width, std::string* packed);
+
+}  // namespace private_set_intersection
+
+#endif  // PRIVATE_SET_INTERSECTION_CPP_SHUFFLE_H_
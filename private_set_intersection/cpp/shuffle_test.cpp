@@ -0,0 +1,85 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/shuffle.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace private_set_intersection {
+namespace {
+
+TEST(ShuffleTest, TestIsPermutation) {
+  std::vector<int64_t> values(1000);
+  std::iota(values.begin(), values.end(), 0);
+  std::vector<int64_t> shuffled = values;
+  ASSERT_TRUE(SecureShuffle(static_cast<int64_t>(shuffled.size()),
+                            [&shuffled](int64_t i, int64_t j) {
+                              std::swap(shuffled[i], shuffled[j]);
+                            })
+                  .ok());
+  EXPECT_NE(shuffled, values);
+  std::sort(shuffled.begin(), shuffled.end());
+  EXPECT_EQ(shuffled, values);
+}
+
+TEST(ShuffleTest, TestIsUniform) {
+  // Each of the 6 permutations of 3 elements should appear about equally
+  // often.
+  const int num_trials = 60000;
+  std::vector<int> counts(6);
+  for (int trial = 0; trial < num_trials; trial++) {
+    int perm[3] = {0, 1, 2};
+    ASSERT_TRUE(SecureShuffle(3, [&perm](int64_t i, int64_t j) {
+                  std::swap(perm[i], perm[j]);
+                }).ok());
+    counts[perm[0] * 2 + (perm[1] > perm[2] ? 1 : 0)]++;
+  }
+  for (int count : counts) {
+    EXPECT_GT(count, num_trials / 6 * 0.9);
+    EXPECT_LT(count, num_trials / 6 * 1.1);
+  }
+}
+
+TEST(ShuffleTest, TestShufflePackedElements) {
+  const int32_t width = 5;
+  std::string packed;
+  for (int i = 0; i < 200; i++) {
+    packed.append(absl::StrCat(10000 + i));
+  }
+  std::string shuffled = packed;
+  ASSERT_TRUE(ShufflePackedElements(width, &shuffled).ok());
+  EXPECT_NE(shuffled, packed);
+
+  std::vector<std::string> original_elements, shuffled_elements;
+  for (size_t i = 0; i < packed.size(); i += width) {
+    original_elements.push_back(packed.substr(i, width));
+    shuffled_elements.push_back(shuffled.substr(i, width));
+  }
+  std::sort(shuffled_elements.begin(), shuffled_elements.end());
+  EXPECT_EQ(shuffled_elements, original_elements);
+
+  std::string empty;
+  EXPECT_TRUE(ShufflePackedElements(width, &empty).ok());
+}
+
+}  // namespace
+}  // namespace private_set_intersection
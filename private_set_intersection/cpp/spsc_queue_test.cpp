@@ -0,0 +1,72 @@
+//
+// Copyright 2020 the authors listed in CONTRIBUTORS.md
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "private_set_intersection/cpp/spsc_queue.h"
+
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace private_set_intersection {
+namespace {
+
+TEST(SpscQueueTest, TestFullAndEmpty) {
+  SpscQueue<std::string> queue(2);
+  std::string value;
+  EXPECT_FALSE(queue.TryPop(&value));
+
+  std::string a = "a", b = "b", c = "c";
+  EXPECT_TRUE(queue.TryPush(std::move(a)));
+  EXPECT_TRUE(queue.TryPush(std::move(b)));
+  EXPECT_FALSE(queue.TryPush(std::move(c)));
+  EXPECT_EQ(c, "c");
+
+  EXPECT_TRUE(queue.TryPop(&value));
+  EXPECT_EQ(value, "a");
+  EXPECT_TRUE(queue.TryPush(std::move(c)));
+  EXPECT_TRUE(queue.TryPop(&value));
+  EXPECT_EQ(value, "b");
+  EXPECT_TRUE(queue.TryPop(&value));
+  EXPECT_EQ(value, "c");
+  EXPECT_FALSE(queue.TryPop(&value));
+}
+
+TEST(SpscQueueTest, TestProducerAndConsumerThreads) {
+  const int num_values = 100000;
+  SpscQueue<int> queue(16);
+  std::thread producer([&queue]() {
+    for (int i = 0; i < num_values; i++) {
+      int value = i;
+      while (!queue.TryPush(std::move(value))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  // Values arrive complete and in order.
+  for (int i = 0; i < num_values; i++) {
+    int value;
+    while (!queue.TryPop(&value)) {
+      std::this_thread::yield();
+    }
+    ASSERT_EQ(value, i);
+  }
+  producer.join();
+}
+
+}  // namespace
+}  // namespace private_set_intersection